@@ -128,13 +128,40 @@ typedef enum key_store_format_t {
 // combinated keystores
 #define RNP_KEYSTORE_GPG21 "GPG21" /* KBX + G10 keystore format */
 
+/* open-addressing hash tables over keys[], slots keep key index + 1 or 0 if empty.
+ * keyids are hashed by the lower 32 bits, so the same table is used for the short keyid
+ * lookups. Index is used only when all of keys[] are indexed, i.e. count == keyc. */
+typedef struct rnp_key_store_index_t {
+    uint32_t *keyids;  /* slots by the lower 32 bits of keyid */
+    uint32_t *fprints; /* slots by fingerprint */
+    uint32_t *grips;   /* slots by grip */
+    unsigned  size;    /* number of slots in each table, power of 2 */
+    unsigned  count;   /* number of indexed keys */
+} rnp_key_store_index_t;
+
+typedef struct rnp_key_store_lazy_t    rnp_key_store_lazy_t;
+typedef struct rnp_key_store_journal_t rnp_key_store_journal_t;
+
+/* keys are allocated from the chunks which are never moved or reallocated, so pointers to
+ * the keys (e.g. primary key's subkeys[]) stay valid while other keys are added or removed.
+ * Slots of the removed keys are reused by the following additions. */
+typedef struct pgp_key_slab_t pgp_key_slab_t;
+
 typedef struct rnp_key_store_t {
     const char *            path;
     const char *            format_label;
     enum key_store_format_t format;
+    bool                    lazy_load;    /* parse keys on demand, see key_store_lazy.h */
+    bool                    incremental;  /* save changes only, see key_store_journal.h */
+    unsigned                load_threads; /* threads used to parse binary GPG keyrings */
 
-    DYNARRAY(pgp_key_t, key);
+    DYNARRAY(pgp_key_t *, key);   /* keys in order, point to the slabs */
+    DYNARRAY(pgp_key_t *, spare); /* free slots in the slabs */
+    pgp_key_slab_t *slabs;        /* key storage, the most recent chunk first */
     DYNARRAY(kbx_blob_t *, blob);
+    rnp_key_store_index_t index;
+    rnp_key_store_lazy_t *   lazy;    /* offset index of the keys which are not parsed yet */
+    rnp_key_store_journal_t *journal; /* changes since the load or the last save */
 } rnp_key_store_t;
 
 rnp_key_store_t *rnp_key_store_new(const char *format, const char *path);
@@ -160,15 +187,37 @@ void rnp_key_store_free(rnp_key_store_t *);
 bool rnp_key_store_list(pgp_io_t *, const rnp_key_store_t *, const int);
 bool rnp_key_store_json(pgp_io_t *, const rnp_key_store_t *, json_object *, const int);
 
-bool rnp_key_store_append_keyring(rnp_key_store_t *, rnp_key_store_t *);
+/** @brief move keys and blobs of newring to the end of keyring, relinking the subkeys.
+ *         newring is left empty and should be freed by the caller.
+ **/
+bool rnp_key_store_append_keyring(rnp_key_store_t *keyring, rnp_key_store_t *newring);
+
+/** @brief preallocate storage, so the next count keys are added without allocations **/
+bool rnp_key_store_reserve(rnp_key_store_t *, unsigned count);
 
-bool rnp_key_store_add_key(pgp_io_t *, rnp_key_store_t *, pgp_key_t *);
+/** @brief add a copy of the key to the keyring
+ *  @return the added key, which address stays the same until it is removed, or NULL
+ **/
+pgp_key_t *rnp_key_store_add_key(pgp_io_t *, rnp_key_store_t *, pgp_key_t *);
 bool rnp_key_store_add_keydata(
   pgp_io_t *, rnp_key_store_t *, pgp_keydata_key_t *, pgp_key_t **, pgp_content_enum);
 
 bool rnp_key_store_remove_key(pgp_io_t *, rnp_key_store_t *, const pgp_key_t *);
 bool rnp_key_store_remove_key_by_id(pgp_io_t *, rnp_key_store_t *, const uint8_t *);
 
+typedef bool rnp_key_match_func_t(const pgp_key_t *key, void *param);
+
+/** @brief remove the keys [from, keyc) for which match returns true, freeing their data.
+ *         Keys are unlinked from the subkeys, and keys[] and the index are updated once, so
+ *         it is much cheaper than removal of the keys one by one.
+ *  @return number of the removed keys
+ **/
+unsigned rnp_key_store_remove_keys_if(pgp_io_t *            io,
+                                      rnp_key_store_t *     keyring,
+                                      unsigned              from,
+                                      rnp_key_match_func_t *match,
+                                      void *                param);
+
 pgp_key_t *rnp_key_store_get_key_by_id(
   pgp_io_t *, const rnp_key_store_t *, const unsigned char *, unsigned *, pgp_pubkey_t **);
 bool rnp_key_store_get_key_by_name(pgp_io_t *,
@@ -180,5 +229,8 @@ bool rnp_key_store_get_next_key_by_name(
 
 bool       rnp_key_store_get_key_grip(pgp_pubkey_t *, uint8_t *);
 pgp_key_t *rnp_key_store_get_key_by_grip(pgp_io_t *, rnp_key_store_t *, const uint8_t *);
+pgp_key_t *rnp_key_store_get_key_by_fpr(pgp_io_t *,
+                                        const rnp_key_store_t *,
+                                        const pgp_fingerprint_t *);
 
 #endif /* KEY_STORE_H_ */
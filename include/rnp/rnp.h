@@ -67,6 +67,7 @@ rnp_result_t rnp_ctx_init(rnp_ctx_t *, rnp_t *);
 void         rnp_ctx_reset(rnp_ctx_t *);
 void         rnp_ctx_free(rnp_ctx_t *);
 void *rnp_ctx_rng_handle(const rnp_ctx_t *ctx);
+void *rnp_ctx_thread_pool(rnp_ctx_t *ctx);
 
 /* debugging, reflection and information */
 int         rnp_set_debug(const char *);
@@ -84,6 +85,7 @@ bool  rnp_find_key(rnp_t *, const char *);
 char *rnp_get_key(rnp_t *, const char *, const char *);
 char *rnp_export_key(rnp_t *, const char *);
 int   rnp_import_key(rnp_t *, char *);
+bool  rnp_import_keys(rnp_t *, char *const[], size_t, unsigned);
 bool  rnp_generate_key(rnp_t *);
 int   rnp_secret_count(rnp_t *);
 int   rnp_public_count(rnp_t *);
@@ -111,6 +111,18 @@ rnp_result_t rnp_ffi_set_pass_provider(rnp_ffi_t       ffi,
                                        rnp_password_cb getpasscb,
                                        void *          getpasscb_ctx);
 
+/** enable caching of the keys derived from passwords during decryption, and set their
+ *  lifetime. Keys are kept in memory, so opening the same message again with the same
+ *  password does not repeat the slow S2K derivation. Cache is disabled by default, expired
+ *  keys are wiped on the next cache access and all of them on rnp_ffi_destroy().
+ *
+ * @param ffi
+ * @param seconds number of seconds for which the derived key is kept, 0 disables the cache
+ *        and wipes all the cached keys
+ * @return 0 on success, or any other value on error
+ */
+rnp_result_t rnp_ffi_set_s2k_cache_expiry(rnp_ffi_t ffi, unsigned seconds);
+
 /* Operations on key rings */
 
 /** retrieve the default homedir (example: /home/user/.rnp)
@@ -160,6 +172,18 @@ rnp_result_t rnp_keyring_get_key_count(rnp_keyring_t ring, size_t *count);
  */
 rnp_result_t rnp_keyring_load_from_path(rnp_keyring_t keyring, const char *path);
 
+/** load keys into a keyring on demand, from a path. Only packet headers are scanned, and
+ *  keys are parsed when they are located by keyid or grip, or used by the operation.
+ *  Offset index is stored in the file '<path>.idx' and reused while keyring is not changed.
+ *  Falls back to the full load if keyring is not empty, armored or not in GPG format.
+ *  Note that rnp_keyring_get_key_count reports only keys which are already parsed.
+ *
+ * @param ring the keyring
+ * @param path
+ * @return 0 on success, or any other value on error
+ */
+rnp_result_t rnp_keyring_load_from_path_lazy(rnp_keyring_t keyring, const char *path);
+
 // TODO: provide a way to indicate what new keys were loaded
 /** load keys into a keyring, from a buffer
  *
@@ -172,6 +196,29 @@ rnp_result_t rnp_keyring_load_from_memory(rnp_keyring_t keyring,
                                           const uint8_t buf[],
                                           size_t        buf_len);
 
+/** import keys from many files into the ffi keyrings at once. Files are read and parsed
+ *  concurrently, then keys are merged in order of files, skipping the ones which are
+ *  already in the keyrings. Keyrings are not saved, so the caller should save them once
+ *  after the import.
+ *
+ * @param ffi
+ * @param paths array of count paths to the key files or directories. Directories are
+ *        expanded to the regular files in them. Format is guessed by the file name suffix:
+ *        .kbx for KBX, .key for G10, GPG otherwise. Armor is detected by contents.
+ * @param count number of paths
+ * @param threads number of threads to use, including the calling one. 0 or 1 means that
+ *        everything is done on the calling thread.
+ * @param imported if not NULL then number of new keys, including subkeys, is stored here
+ * @param failed if not NULL then number of files which failed to load is stored here
+ * @return 0 if the import was done, even if some files failed, or any other value on error
+ */
+rnp_result_t rnp_import_keys_from_paths(rnp_ffi_t    ffi,
+                                        const char * paths[],
+                                        size_t       count,
+                                        size_t       threads,
+                                        size_t *     imported,
+                                        size_t *     failed);
+
 /** save a keyring to a path
  *
  * @param ring the keyring
@@ -238,7 +285,33 @@ rnp_result_t rnp_key_lock(rnp_key_handle_t key);
 rnp_result_t rnp_key_unlock(rnp_key_handle_t key, const char *password);
 
 rnp_result_t rnp_key_is_protected(rnp_key_handle_t key, bool *result);
-rnp_result_t rnp_key_protect(rnp_key_handle_t key, const char *password);
+
+/** calculate the number of S2K iterations, so that key derivation with the given hash
+ *  algorithm takes about the given time on this host. Hash throughput is measured, which
+ *  takes a few milliseconds.
+ *
+ * @param hash S2K hash algorithm name, or NULL for the default one
+ * @param msec desired derivation time in milliseconds, 0 for the default of 150ms
+ * @param iterations on success the representable iteration count will be stored here
+ * @return 0 on success, or any other value on error
+ */
+rnp_result_t rnp_calculate_iterations(const char *hash, size_t msec, size_t *iterations);
+
+/** protect the secret key with the password
+ *
+ * @param key secret key handle
+ * @param password password to protect the key with
+ * @param cipher protection cipher name, or NULL for the default one
+ * @param hash S2K hash algorithm name, or NULL for the default one
+ * @param iterations number of S2K iterations, or 0 for the default one. Use
+ *        rnp_calculate_iterations() to tune the time needed to unlock the key.
+ * @return 0 on success, or any other value on error
+ */
+rnp_result_t rnp_key_protect(rnp_key_handle_t key,
+                             const char *     password,
+                             const char *     cipher,
+                             const char *     hash,
+                             size_t           iterations);
 rnp_result_t rnp_key_unprotect(rnp_key_handle_t key, const char *password);
 
 rnp_result_t rnp_key_is_primary(rnp_key_handle_t key, bool *result);
@@ -250,6 +323,31 @@ rnp_result_t rnp_key_have_public(rnp_key_handle_t key, bool *result);
 
 /* Signature/verification operations */
 
+/**
+ * Verify a batch of detached signatures.
+ * Signed data of the different items is read and hashed concurrently, then signatures made
+ * by the same key are grouped together and verified on the worker threads. Signer keys are
+ * looked up in the ffi keyrings from the calling thread only.
+ *
+ * @param ffi
+ * @param data array of count inputs with the signed data. Callback inputs may be read from
+ *        the worker threads.
+ * @param signatures array of count inputs with armored or binary detached signatures
+ * @param count number of items in the batch
+ * @param threads number of threads to use, including the calling one. 0 or 1 means that
+ *        everything is done on the calling thread.
+ * @param results array of count results: 0 if all signatures of the item are valid,
+ *        RNP_ERROR_SIGNATURE_INVALID, RNP_ERROR_KEY_NOT_FOUND or other error otherwise.
+ * @return 0 if the batch was processed, even if some items failed, or any other value on
+ *         error
+ */
+rnp_result_t rnp_verify_detached_batch(rnp_ffi_t    ffi,
+                                       rnp_input_t  data[],
+                                       rnp_input_t  signatures[],
+                                       size_t       count,
+                                       size_t       threads,
+                                       rnp_result_t results[]);
+
 /* TODO define functions for password-based encryption */
 
 /* TODO define functions for encrypt+sign */
@@ -309,6 +407,30 @@ rnp_result_t rnp_op_encrypt_set_file_name(rnp_op_encrypt_t op, const char *filen
 rnp_result_t rnp_op_encrypt_set_file_mtime(rnp_op_encrypt_t op, uint32_t mtime);
 
 rnp_result_t rnp_op_encrypt_execute(rnp_op_encrypt_t op);
+
+/**
+ * Encrypt a batch of messages with the settings of the operation.
+ * Recipient keys are looked up once for the whole batch, and messages are encrypted
+ * concurrently, each with its own session key. Operation may be created without input and
+ * output for this, and may be executed for several batches.
+ *
+ * @param op encryption operation with recipients and/or passwords added
+ * @param inputs array of count inputs with the data. Callback inputs and outputs may be
+ *        accessed from the worker threads.
+ * @param outputs array of count outputs for the encrypted messages
+ * @param count number of messages in the batch
+ * @param threads number of threads to use, including the calling one. 0 or 1 means that
+ *        everything is done on the calling thread.
+ * @param results array of count results, 0 if the message was encrypted
+ * @return 0 if the batch was processed, even if some messages failed, or any other value on
+ *         error
+ */
+rnp_result_t rnp_op_encrypt_execute_batch(rnp_op_encrypt_t op,
+                                          rnp_input_t      inputs[],
+                                          rnp_output_t     outputs[],
+                                          size_t           count,
+                                          size_t           threads,
+                                          rnp_result_t     results[]);
 rnp_result_t rnp_op_encrypt_destroy(rnp_op_encrypt_t op);
 
 rnp_result_t rnp_decrypt(rnp_ffi_t ffi, rnp_input_t input, rnp_output_t output);
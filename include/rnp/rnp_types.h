@@ -80,12 +80,15 @@ typedef struct rnp_params_t {
     const char *errs; /* error stream : may be <stdout> */
     const char *ress; /* results stream : maye be <stdout>, <stderr> or file name/path */
 
-    const char *ks_pub_format;     /* format of the public key store */
-    const char *ks_sec_format;     /* format of the secret key store */
-    char *      pubpath;           /* public keystore path */
-    char *      secpath;           /* secret keystore path */
-    char *      defkey;            /* default/preferred key id */
-    bool        keystore_disabled; /* indicates wether keystore must be initialized */
+    const char *ks_pub_format;       /* format of the public key store */
+    const char *ks_sec_format;       /* format of the secret key store */
+    char *      pubpath;             /* public keystore path */
+    char *      secpath;             /* secret keystore path */
+    char *      defkey;              /* default/preferred key id */
+    bool        keystore_disabled;   /* indicates wether keystore must be initialized */
+    bool        lazy_keyring;        /* parse keys on demand, using the offset index */
+    bool        incremental_keyring; /* append changes to the keyring instead of rewrite */
+    unsigned    keyring_threads;     /* threads used to parse large binary keyrings */
     pgp_password_provider_t password_provider;
 } rnp_params_t;
 
@@ -114,6 +117,14 @@ typedef struct rnp_ctx_t {
     bool           discard;       /* discard the output */
     void *         on_signatures; /* handler for signed messages */
     rng_t *        rng;           /* pointer to rng_t */
+    unsigned       threads;       /* number of threads used for the operation */
+    void *         pool;          /* pgp_thread_pool_t, created on demand if threads > 1 */
+    bool           directio;      /* write output file with O_DIRECT, bypassing page cache */
+    list           signers;       /* list of decrypted pgp_seckey_t *, used to sign the data */
+    bool           detached;      /* write detached signature instead of the signed message */
+    bool           clearsign;     /* write cleartext signed message */
+    void *         s2k_cache;     /* pgp_s2k_cache_t of the password-derived keys, or NULL */
+    void *         rcp_cache;     /* pgp_recipient_cache_t of the decrypting keys, or NULL */
 } rnp_ctx_t;
 
 #endif // __RNP_TYPES__
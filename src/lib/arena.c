@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "arena.h"
+#include "utils.h"
+
+struct pgp_arena_chunk_t {
+    pgp_arena_chunk_t *next;
+    size_t             size; /* number of bytes in data */
+    size_t             used; /* number of allocated bytes in data */
+    max_align_t        data[];
+};
+
+#define ARENA_ALIGNMENT _Alignof(max_align_t)
+#define ARENA_ALIGN(size) (((size) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+static pgp_arena_chunk_t *
+arena_new_chunk(size_t size)
+{
+    pgp_arena_chunk_t *chunk;
+
+    if (!(chunk = malloc(sizeof(*chunk) + size))) {
+        RNP_LOG("allocation failed");
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+void
+pgp_arena_init(pgp_arena_t *arena)
+{
+    arena->chunks = NULL;
+    arena->spare = NULL;
+}
+
+void *
+pgp_arena_alloc(pgp_arena_t *arena, size_t size)
+{
+    pgp_arena_chunk_t *chunk = arena->chunks;
+    uint8_t *          res;
+
+    if (size > SIZE_MAX - ARENA_ALIGNMENT - sizeof(*chunk)) {
+        return NULL;
+    }
+    size = ARENA_ALIGN(size);
+
+    /* large allocation gets its own chunk behind the current one, so free space of the
+     * current chunk is not lost */
+    if (size > PGP_ARENA_CHUNK_SIZE / 2) {
+        pgp_arena_chunk_t *large = arena_new_chunk(size);
+        if (!large) {
+            return NULL;
+        }
+        large->used = size;
+        if (chunk) {
+            large->next = chunk->next;
+            chunk->next = large;
+        } else {
+            arena->chunks = large;
+        }
+        return large->data;
+    }
+
+    if (!chunk || (chunk->size - chunk->used < size)) {
+        if ((chunk = arena->spare)) {
+            arena->spare = chunk->next;
+            chunk->used = 0;
+        } else if (!(chunk = arena_new_chunk(PGP_ARENA_CHUNK_SIZE))) {
+            return NULL;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    res = (uint8_t *) chunk->data + chunk->used;
+    chunk->used += size;
+    return res;
+}
+
+void
+pgp_arena_reset(pgp_arena_t *arena)
+{
+    pgp_arena_chunk_t *chunk = arena->chunks;
+    pgp_arena_chunk_t *next;
+
+    while (chunk) {
+        next = chunk->next;
+        if (chunk->size == PGP_ARENA_CHUNK_SIZE) {
+            chunk->next = arena->spare;
+            arena->spare = chunk;
+        } else {
+            free(chunk);
+        }
+        chunk = next;
+    }
+    arena->chunks = NULL;
+}
+
+void
+pgp_arena_destroy(pgp_arena_t *arena)
+{
+    pgp_arena_chunk_t *next;
+
+    pgp_arena_reset(arena);
+    for (pgp_arena_chunk_t *chunk = arena->spare; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+    arena->spare = NULL;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** Arena allocator for the short-lived allocations
+ *  @file
+ */
+#ifndef RNP_ARENA_H_
+#define RNP_ARENA_H_
+
+#include <stddef.h>
+
+/* size of the regular arena chunk, larger allocations get the dedicated chunk */
+#define PGP_ARENA_CHUNK_SIZE (256 * 1024)
+
+/**
+ *  @private
+ *  Arena hands out memory from the large chunks and frees it all at once on reset, so a lot
+ *  of small allocations with the same lifetime, like the per-message parsing state, cost
+ *  almost nothing. Regular chunks are kept after the reset, so the arena reused for the
+ *  similar messages doesn't call malloc at all. Arena is not thread-safe.
+ *
+ *  @code
+ *  pgp_arena_t arena;
+ *  pgp_arena_init(&arena);
+ *  for (each message) {
+ *      param = pgp_arena_alloc(&arena, sizeof(*param));
+ *      ...
+ *      pgp_arena_reset(&arena);
+ *  }
+ *  pgp_arena_destroy(&arena);
+ *  @endcode
+ */
+
+typedef struct pgp_arena_chunk_t pgp_arena_chunk_t;
+
+typedef struct pgp_arena_t {
+    pgp_arena_chunk_t *chunks; /* chunks in use, the current one goes first */
+    pgp_arena_chunk_t *spare;  /* regular chunks kept for reuse after the reset */
+} pgp_arena_t;
+
+/** @private
+ *  initialize the empty arena, no memory is allocated until first use
+ *
+ *  @param arena arena structure, which should not be NULL
+ **/
+void pgp_arena_init(pgp_arena_t *arena);
+
+/** @private
+ *  allocate memory from the arena. Memory is not initialized and must not be freed.
+ *
+ *  @param arena initialized arena, which should not be NULL
+ *  @param size number of bytes to allocate
+ *  @return pointer to the memory, suitably aligned for any type, or NULL if allocation failed
+ **/
+void *pgp_arena_alloc(pgp_arena_t *arena, size_t size);
+
+/** @private
+ *  release all of the memory allocated from the arena, keeping regular chunks for reuse
+ *
+ *  @param arena initialized arena, which should not be NULL
+ **/
+void pgp_arena_reset(pgp_arena_t *arena);
+
+/** @private
+ *  release all of the memory, including the kept chunks. Arena may be reused after
+ *  pgp_arena_init() call.
+ *
+ *  @param arena initialized arena, which should not be NULL
+ **/
+void pgp_arena_destroy(pgp_arena_t *arena);
+
+#endif
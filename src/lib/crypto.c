@@ -537,7 +537,7 @@ pgp_decrypt_file(rnp_ctx_t *    rnpctx,
     parse->cbinfo.cryptinfo.secring = secring;
     parse->cbinfo.cryptinfo.password_provider = *password_provider;
     parse->cbinfo.cryptinfo.pubring = pubring;
-    parse->cbinfo.sshseckey = (sshkeys) ? &secring->keys[0].key.seckey : NULL;
+    parse->cbinfo.sshseckey = (sshkeys) ? &secring->keys[0]->key.seckey : NULL;
     parse->cbinfo.numtries = numtries;
 
     /* Set up armor/password options */
@@ -622,7 +622,7 @@ pgp_decrypt_buf(rnp_ctx_t *    rnpctx,
     parse->cbinfo.cryptinfo.secring = secring;
     parse->cbinfo.cryptinfo.pubring = pubring;
     parse->cbinfo.cryptinfo.password_provider = *password_provider;
-    parse->cbinfo.sshseckey = (sshkeys) ? &secring->keys[0].key.seckey : NULL;
+    parse->cbinfo.sshseckey = (sshkeys) ? &secring->keys[0]->key.seckey : NULL;
     parse->cbinfo.numtries = numtries;
 
     /* Set up armor/password options */
@@ -101,19 +101,61 @@ DSA_SIG_free(DSA_SIG *sig)
     }
 }
 
+/* DSA secret key is loaded from both secret and public parts */
+typedef struct dsa_key_param_t {
+    const pgp_dsa_seckey_t *seckey;
+    const pgp_dsa_pubkey_t *pubkey;
+} dsa_key_param_t;
+
+static bool
+dsa_load_pubkey(void **key, const void *param, rng_t *rng)
+{
+    const pgp_dsa_pubkey_t *dsa = param;
+    botan_pubkey_t          dsa_key = NULL;
+
+    if (botan_pubkey_load_dsa(&dsa_key, dsa->p->mp, dsa->q->mp, dsa->g->mp, dsa->y->mp)) {
+        return false;
+    }
+    *key = dsa_key;
+    return true;
+}
+
+static bool
+dsa_load_seckey(void **key, const void *param, rng_t *rng)
+{
+    const dsa_key_param_t *dsa = param;
+    botan_privkey_t        dsa_key = NULL;
+
+    if (botan_privkey_load_dsa(&dsa_key,
+                               dsa->pubkey->p->mp,
+                               dsa->pubkey->q->mp,
+                               dsa->pubkey->g->mp,
+                               dsa->seckey->x->mp)) {
+        return false;
+    }
+    *key = dsa_key;
+    return true;
+}
+
 unsigned
 pgp_dsa_verify(const uint8_t *         hash,
                size_t                  hash_length,
                const pgp_dsa_sig_t *   sig,
                const pgp_dsa_pubkey_t *dsa)
 {
-    botan_pubkey_t       dsa_key;
     botan_pk_op_verify_t verify_op;
     uint8_t *            encoded_signature = NULL;
     size_t               q_bytes = 0;
     unsigned int         valid;
 
-    botan_pubkey_load_dsa(&dsa_key, dsa->p->mp, dsa->q->mp, dsa->g->mp, dsa->y->mp);
+    if (!pgp_pk_cache_key(
+          &dsa->cache, PGP_PK_KEY_DEFAULT, false, dsa_load_pubkey, dsa, NULL)) {
+        return 0;
+    }
+    verify_op = pgp_pk_cache_op(dsa->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, "Raw");
+    if (!verify_op) {
+        return 0;
+    }
 
     botan_mp_num_bytes(dsa->q->mp, &q_bytes);
 
@@ -121,11 +163,10 @@ pgp_dsa_verify(const uint8_t *         hash,
     bn_bn2bin(sig->r, encoded_signature);
     bn_bn2bin(sig->s, encoded_signature + q_bytes);
 
-    botan_pk_op_verify_create(&verify_op, dsa_key, "Raw", 0);
     botan_pk_op_verify_update(verify_op, hash, hash_length);
     valid = (botan_pk_op_verify_finish(verify_op, encoded_signature, 2 * q_bytes) == 0);
-    botan_pk_op_verify_destroy(verify_op);
-    botan_pubkey_destroy(dsa_key);
+    pgp_pk_cache_release(
+      dsa->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, "Raw", verify_op, true);
 
     free(encoded_signature);
 
@@ -139,26 +180,32 @@ pgp_dsa_sign(rng_t *                 rng,
              const pgp_dsa_seckey_t *secdsa,
              const pgp_dsa_pubkey_t *pubdsa)
 {
-    botan_privkey_t    dsa_key;
+    dsa_key_param_t    param = {.seckey = secdsa, .pubkey = pubdsa};
     botan_pk_op_sign_t sign_op;
     size_t             q_bytes = 0;
     size_t             sigbuf_size = 0;
     uint8_t *          sigbuf = NULL;
     DSA_SIG *          ret;
+    bool               ok;
 
-    botan_privkey_load_dsa(
-      &dsa_key, pubdsa->p->mp, pubdsa->q->mp, pubdsa->g->mp, secdsa->x->mp);
+    if (!pgp_pk_cache_key(
+          &secdsa->cache, PGP_PK_KEY_DEFAULT, true, dsa_load_seckey, &param, rng)) {
+        return NULL;
+    }
+    sign_op = pgp_pk_cache_op(secdsa->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, "Raw");
+    if (!sign_op) {
+        return NULL;
+    }
 
-    botan_pk_op_sign_create(&sign_op, dsa_key, "Raw", 0);
     botan_pk_op_sign_update(sign_op, hashbuf, hashsize);
 
     botan_mp_num_bytes(pubdsa->q->mp, &q_bytes);
     sigbuf_size = q_bytes * 2;
     sigbuf = calloc(sigbuf_size, 1);
 
-    botan_pk_op_sign_finish(sign_op, rng_handle(rng), sigbuf, &sigbuf_size);
-    botan_pk_op_sign_destroy(sign_op);
-    botan_privkey_destroy(dsa_key);
+    ok = !botan_pk_op_sign_finish(sign_op, rng_handle(rng), sigbuf, &sigbuf_size);
+    pgp_pk_cache_release(
+      secdsa->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, "Raw", sign_op, ok);
 
     // Now load the DSA (r,s) values from the signature
     ret = DSA_SIG_new();
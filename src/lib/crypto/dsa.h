@@ -55,6 +55,7 @@
 #include <stdint.h>
 #include "crypto/bn.h"
 #include "crypto/rng.h"
+#include "crypto/pk_cache.h"
 
 /* TODO key generation */
 
@@ -63,16 +64,18 @@
  * \see RFC4880 5.5.2
  */
 typedef struct {
-    bignum_t *p; /* DSA prime p */
-    bignum_t *q; /* DSA group order q */
-    bignum_t *g; /* DSA group generator g */
-    bignum_t *y; /* DSA public key value y (= g^x mod p
-                * with x being the secret) */
+    bignum_t *      p;     /* DSA prime p */
+    bignum_t *      q;     /* DSA group order q */
+    bignum_t *      g;     /* DSA group generator g */
+    bignum_t *      y;     /* DSA public key value y (= g^x mod p
+                            * with x being the secret) */
+    pgp_pk_cache_t *cache; /* loaded botan key and operations */
 } pgp_dsa_pubkey_t;
 
 /** pgp_dsa_seckey_t */
 typedef struct pgp_dsa_seckey_t {
-    bignum_t *x;
+    bignum_t *      x;
+    pgp_pk_cache_t *cache; /* loaded botan key and operations */
 } pgp_dsa_seckey_t;
 
 /** Struct to hold params of a DSA signature */
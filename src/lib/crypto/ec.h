@@ -34,6 +34,7 @@
 #include <repgp/repgp_def.h>
 #include "crypto/bn.h"
 #include "crypto/rng.h"
+#include "crypto/pk_cache.h"
 
 typedef struct pgp_seckey_t pgp_seckey_t;
 
@@ -61,13 +62,15 @@ typedef struct ec_curve_desc_t {
  * \see RFC 6637
  */
 typedef struct {
-    pgp_curve_t curve;
-    bignum_t *  point; /* octet string encoded as MPI */
+    pgp_curve_t     curve;
+    bignum_t *      point; /* octet string encoded as MPI */
+    pgp_pk_cache_t *cache; /* loaded botan key and operations */
 } pgp_ecc_pubkey_t;
 
 /** pgp_ecc_seckey_t */
 typedef struct {
-    bignum_t *x;
+    bignum_t *      x;
+    pgp_pk_cache_t *cache; /* loaded botan key and operations */
 } pgp_ecc_seckey_t;
 
 /** Struct to hold params of a ECDSA/EDDSA/SM2 signature */
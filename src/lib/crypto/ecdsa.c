@@ -37,6 +37,66 @@
 #include "readerwriter.h"
 #include "utils.h"
 
+/* ECDSA secret key is loaded from the secret value and curve */
+typedef struct ecdsa_key_param_t {
+    const pgp_ecc_seckey_t *seckey;
+    const pgp_ecc_pubkey_t *pubkey;
+} ecdsa_key_param_t;
+
+static bool
+ecdsa_load_pubkey(void **key, const void *param, rng_t *rng)
+{
+    const pgp_ecc_pubkey_t *pubkey = param;
+    const ec_curve_desc_t * curve = get_curve_desc(pubkey->curve);
+    botan_mp_t              public_x = NULL;
+    botan_mp_t              public_y = NULL;
+    botan_pubkey_t          pub = NULL;
+    uint8_t                 point_bytes[BITS_TO_BYTES(521) * 2 + 1] = {0};
+    size_t                  point_len;
+    bool                    res = false;
+
+    if (!bn_num_bytes(pubkey->point, &point_len) || (point_len > sizeof(point_bytes)) ||
+        bn_bn2bin(pubkey->point, point_bytes) || (point_bytes[0] != 0x04)) {
+        RNP_LOG("Failed to load public key");
+        return false;
+    }
+
+    const size_t curve_order = BITS_TO_BYTES(curve->bitlen);
+    if (botan_mp_init(&public_x) || botan_mp_init(&public_y) ||
+        botan_mp_from_bin(public_x, &point_bytes[1], curve_order) ||
+        botan_mp_from_bin(public_y, &point_bytes[1 + curve_order], curve_order)) {
+        goto end;
+    }
+
+    if (botan_pubkey_load_ecdsa(&pub, public_x, public_y, curve->botan_name)) {
+        RNP_LOG("Failed to load public key");
+        goto end;
+    }
+
+    *key = pub;
+    res = true;
+end:
+    botan_mp_destroy(public_x);
+    botan_mp_destroy(public_y);
+    return res;
+}
+
+static bool
+ecdsa_load_seckey(void **key, const void *param, rng_t *rng)
+{
+    const ecdsa_key_param_t *ecdsa = param;
+    const ec_curve_desc_t *  curve = get_curve_desc(ecdsa->pubkey->curve);
+    botan_privkey_t          priv = NULL;
+
+    if (botan_privkey_load_ecdsa(&priv, ecdsa->seckey->x->mp, curve->botan_name)) {
+        RNP_LOG("Can't load private key");
+        return false;
+    }
+
+    *key = priv;
+    return true;
+}
+
 rnp_result_t
 pgp_ecdsa_sign_hash(rng_t *                 rng,
                     pgp_ecc_sig_t *         sign,
@@ -45,8 +105,8 @@ pgp_ecdsa_sign_hash(rng_t *                 rng,
                     const pgp_ecc_seckey_t *seckey,
                     const pgp_ecc_pubkey_t *pubkey)
 {
+    ecdsa_key_param_t      param = {.seckey = seckey, .pubkey = pubkey};
     botan_pk_op_sign_t     signer = NULL;
-    botan_privkey_t        key = NULL;
     rnp_result_t           ret = PGP_E_FAIL;
     uint8_t                out_buf[2 * MAX_CURVE_BYTELEN] = {0};
     const ec_curve_desc_t *curve = get_curve_desc(pubkey->curve);
@@ -60,13 +120,14 @@ pgp_ecdsa_sign_hash(rng_t *                 rng,
         return RNP_ERROR_BAD_PARAMETERS;
     }
 
-    if (botan_privkey_load_ecdsa(&key, seckey->x->mp, curve->botan_name)) {
-        RNP_LOG("Can't load private key");
+    if (!pgp_pk_cache_key(
+          &seckey->cache, PGP_PK_KEY_DEFAULT, true, ecdsa_load_seckey, &param, rng)) {
         return RNP_ERROR_GENERIC;
     }
 
-    if (botan_pk_op_sign_create(&signer, key, "Raw", 0)) {
-        goto end;
+    signer = pgp_pk_cache_op(seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, "Raw");
+    if (!signer) {
+        return RNP_ERROR_GENERIC;
     }
 
     const size_t curve_order = BITS_TO_BYTES(curve->bitlen);
@@ -96,8 +157,9 @@ end:
         bn_clear_free(sign->r);
         bn_clear_free(sign->s);
     }
-    botan_privkey_destroy(key);
-    botan_pk_op_sign_destroy(signer);
+    /* signer is reset only by the successful finish */
+    pgp_pk_cache_release(
+      seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, "Raw", signer, ret == RNP_SUCCESS);
 
     return ret;
 }
@@ -108,14 +170,11 @@ pgp_ecdsa_verify_hash(const pgp_ecc_sig_t *   sign,
                       size_t                  hash_len,
                       const pgp_ecc_pubkey_t *pubkey)
 {
-    botan_mp_t           public_x = NULL;
-    botan_mp_t           public_y = NULL;
-    botan_pubkey_t       pub = NULL;
     botan_pk_op_verify_t verifier = NULL;
     rnp_result_t         ret = RNP_ERROR_SIGNATURE_INVALID;
     uint8_t              sign_buf[2 * MAX_CURVE_BYTELEN] = {0};
-    uint8_t              point_bytes[BITS_TO_BYTES(521) * 2 + 1] = {0};
     size_t               r_blen, s_blen;
+    bool                 reusable = false;
 
     const ec_curve_desc_t *curve = get_curve_desc(pubkey->curve);
 
@@ -123,26 +182,22 @@ pgp_ecdsa_verify_hash(const pgp_ecc_sig_t *   sign,
         return RNP_ERROR_BAD_PARAMETERS;
     }
 
-    if (!bn_num_bytes(pubkey->point, &r_blen) || (r_blen > sizeof(point_bytes)) ||
-        bn_bn2bin(pubkey->point, point_bytes) || (point_bytes[0] != 0x04)) {
-        RNP_LOG("Failed to load public key");
-        ret = RNP_ERROR_BAD_PARAMETERS;
-        goto end;
-    }
-
-    const size_t curve_order = BITS_TO_BYTES(curve->bitlen);
-    if (botan_mp_init(&public_x) || botan_mp_init(&public_y) ||
-        botan_mp_from_bin(public_x, &point_bytes[1], curve_order) ||
-        botan_mp_from_bin(public_y, &point_bytes[1 + curve_order], curve_order)) {
-        goto end;
+    if (!pgp_pk_cache_key(
+          &pubkey->cache, PGP_PK_KEY_DEFAULT, false, ecdsa_load_pubkey, pubkey, NULL)) {
+        return RNP_ERROR_BAD_PARAMETERS;
     }
 
-    if (botan_pubkey_load_ecdsa(&pub, public_x, public_y, curve->botan_name)) {
-        RNP_LOG("Failed to load public key");
-        goto end;
+    verifier = pgp_pk_cache_op(pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, "Raw");
+    if (!verifier) {
+        return RNP_ERROR_SIGNATURE_INVALID;
     }
 
-    if (botan_pk_op_verify_create(&verifier, pub, "Raw", 0)) {
+    const size_t curve_order = BITS_TO_BYTES(curve->bitlen);
+    if (!bn_num_bytes(sign->r, &r_blen) || (r_blen > curve_order) ||
+        !bn_num_bytes(sign->s, &s_blen) || (s_blen > curve_order) ||
+        (curve_order > MAX_CURVE_BYTELEN)) {
+        reusable = true;
+        ret = RNP_ERROR_BAD_PARAMETERS;
         goto end;
     }
 
@@ -152,13 +207,6 @@ pgp_ecdsa_verify_hash(const pgp_ecc_sig_t *   sign,
         goto end;
     }
 
-    if (!bn_num_bytes(sign->r, &r_blen) || (r_blen > curve_order) ||
-        !bn_num_bytes(sign->s, &s_blen) || (s_blen > curve_order) ||
-        (curve_order > MAX_CURVE_BYTELEN)) {
-        ret = RNP_ERROR_BAD_PARAMETERS;
-        goto end;
-    }
-
     // Both can't fail
     (void) bn_bn2bin(sign->r, &sign_buf[curve_order - r_blen]);
     (void) bn_bn2bin(sign->s, &sign_buf[curve_order + curve_order - s_blen]);
@@ -166,12 +214,11 @@ pgp_ecdsa_verify_hash(const pgp_ecc_sig_t *   sign,
     ret = botan_pk_op_verify_finish(verifier, sign_buf, curve_order * 2) ?
             RNP_ERROR_SIGNATURE_INVALID :
             RNP_SUCCESS;
+    reusable = true;
 
 end:
-    botan_mp_destroy(public_x);
-    botan_mp_destroy(public_y);
-    botan_pubkey_destroy(pub);
-    botan_pk_op_verify_destroy(verifier);
+    pgp_pk_cache_release(
+      pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, "Raw", verifier, reusable);
     return ret;
 }
 
@@ -64,26 +64,17 @@ end:
     return retval;
 }
 
-int
-pgp_eddsa_verify_hash(const bignum_t *        r,
-                      const bignum_t *        s,
-                      const uint8_t *         hash,
-                      size_t                  hash_len,
-                      const pgp_ecc_pubkey_t *pubkey)
+static bool
+eddsa_load_pubkey(void **key, const void *param, rng_t *rng)
 {
-    botan_pubkey_t       eddsa = NULL;
-    botan_pk_op_verify_t verify_op = NULL;
-    int                  result = 0;
-    uint8_t              bn_buf[64];
-    size_t               sz;
-
-    // Check curve OID matches 25519
-    if (pubkey->curve != PGP_CURVE_ED25519)
-        goto done;
+    const pgp_ecc_pubkey_t *pubkey = param;
+    botan_pubkey_t          eddsa = NULL;
+    uint8_t                 bn_buf[33];
+    size_t                  sz;
 
     // Unexpected size for Ed25519 key
     if (!bn_num_bytes(pubkey->point, &sz) || sz != 33)
-        goto done;
+        return false;
 
     bn_bn2bin(pubkey->point, bn_buf);
 
@@ -91,33 +82,85 @@ pgp_eddsa_verify_hash(const bignum_t *        r,
     * See draft-ietf-openpgp-rfc4880bis-01 section 13.3
     */
     if (bn_buf[0] != 0x40)
-        goto done;
+        return false;
 
     if (botan_pubkey_load_ed25519(&eddsa, bn_buf + 1))
-        goto done;
+        return false;
 
-    if (botan_pk_op_verify_create(&verify_op, eddsa, "Pure", 0) != 0)
-        goto done;
+    *key = eddsa;
+    return true;
+}
 
-    if (botan_pk_op_verify_update(verify_op, hash, hash_len) != 0)
-        goto done;
+static bool
+eddsa_load_seckey(void **key, const void *param, rng_t *rng)
+{
+    const pgp_ecc_seckey_t *seckey = param;
+    botan_privkey_t         eddsa = NULL;
+    uint8_t                 bn_buf[32] = {0};
+    size_t                  sz;
+    bool                    res = false;
+
+    // Unexpected size for Ed25519 key
+    if (!bn_num_bytes(seckey->x, &sz) || (sz > 32))
+        return false;
+
+    bn_bn2bin(seckey->x, bn_buf + (32 - sz));
+
+    if (botan_privkey_load_ed25519(&eddsa, bn_buf) == 0) {
+        *key = eddsa;
+        res = true;
+    }
+
+    botan_scrub_mem(bn_buf, sizeof(bn_buf));
+    return res;
+}
+
+int
+pgp_eddsa_verify_hash(const bignum_t *        r,
+                      const bignum_t *        s,
+                      const uint8_t *         hash,
+                      size_t                  hash_len,
+                      const pgp_ecc_pubkey_t *pubkey)
+{
+    botan_pk_op_verify_t verify_op = NULL;
+    int                  result = 0;
+    bool                 reusable = false;
+    uint8_t              bn_buf[64] = {0};
+    size_t               sz;
+
+    // Check curve OID matches 25519
+    if (pubkey->curve != PGP_CURVE_ED25519)
+        return 0;
+
+    if (!pgp_pk_cache_key(
+          &pubkey->cache, PGP_PK_KEY_DEFAULT, false, eddsa_load_pubkey, pubkey, NULL))
+        return 0;
+
+    verify_op = pgp_pk_cache_op(pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, "Pure");
+    if (!verify_op)
+        return 0;
 
-    memset(bn_buf, 0, sizeof(bn_buf));
     // Unexpected size for Ed25519 signature
     if (!bn_num_bytes(r, &sz) || (sz > 32)) {
+        reusable = true;
         goto done;
     }
     bn_bn2bin(r, &bn_buf[32 - sz]);
     if (!bn_num_bytes(s, &sz) || (sz > 32)) {
+        reusable = true;
         goto done;
     }
     bn_bn2bin(s, &bn_buf[32 + 32 - sz]);
 
+    if (botan_pk_op_verify_update(verify_op, hash, hash_len) != 0)
+        goto done;
+
     result = (botan_pk_op_verify_finish(verify_op, bn_buf, 64) == 0);
+    reusable = true;
 
 done:
-    botan_pk_op_verify_destroy(verify_op);
-    botan_pubkey_destroy(eddsa);
+    pgp_pk_cache_release(
+      pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, "Pure", verify_op, reusable);
     return result;
 }
 
@@ -130,28 +173,23 @@ pgp_eddsa_sign_hash(rng_t *                 rng,
                     const pgp_ecc_seckey_t *seckey,
                     const pgp_ecc_pubkey_t *pubkey)
 {
-    botan_privkey_t    eddsa = NULL;
     botan_pk_op_sign_t sign_op = NULL;
     int                result = -1;
+    bool               reusable = false;
     uint8_t            bn_buf[64] = {0};
-    size_t             sz;
 
     // Check curve OID matches 25519
     if (pubkey->curve != PGP_CURVE_ED25519) {
-        goto done;
+        return -1;
     }
 
-    // Unexpected size for Ed25519 key
-    if (!bn_num_bytes(seckey->x, &sz) || (sz > 32))
-        goto done;
-
-    bn_bn2bin(seckey->x, bn_buf + (32 - sz));
+    if (!pgp_pk_cache_key(
+          &seckey->cache, PGP_PK_KEY_DEFAULT, true, eddsa_load_seckey, seckey, rng))
+        return -1;
 
-    if (botan_privkey_load_ed25519(&eddsa, bn_buf) != 0)
-        goto done;
-
-    if (botan_pk_op_sign_create(&sign_op, eddsa, "Pure", 0) != 0)
-        goto done;
+    sign_op = pgp_pk_cache_op(seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, "Pure");
+    if (!sign_op)
+        return -1;
 
     if (botan_pk_op_sign_update(sign_op, hash, hash_len) != 0)
         goto done;
@@ -159,6 +197,7 @@ pgp_eddsa_sign_hash(rng_t *                 rng,
     size_t sig_size = sizeof(bn_buf);
     if (botan_pk_op_sign_finish(sign_op, rng_handle(rng), bn_buf, &sig_size) != 0)
         goto done;
+    reusable = true;
 
     // Unexpected size...
     if (sig_size != 64)
@@ -169,7 +208,7 @@ pgp_eddsa_sign_hash(rng_t *                 rng,
     result = 0;
 
 done:
-    botan_pk_op_sign_destroy(sign_op);
-    botan_privkey_destroy(eddsa);
+    pgp_pk_cache_release(
+      seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, "Pure", sign_op, reusable);
     return result;
 }
@@ -88,6 +88,55 @@
         goto end;                                                                      \
     } while (0)
 
+/* ElGamal secret key is loaded from both secret and public parts */
+typedef struct elgamal_key_param_t {
+    const pgp_elgamal_seckey_t *seckey;
+    const pgp_elgamal_pubkey_t *pubkey;
+} elgamal_key_param_t;
+
+static bool
+elgamal_load_pubkey(void **key, const void *param, rng_t *rng)
+{
+    const pgp_elgamal_pubkey_t *pubkey = param;
+    botan_pubkey_t              elg_key = NULL;
+
+    if (botan_pubkey_load_elgamal(&elg_key, pubkey->p->mp, pubkey->g->mp, pubkey->y->mp)) {
+        (void) fprintf(stderr, "Failed to load public key\n");
+        return false;
+    }
+
+    if (botan_pubkey_check_key(elg_key, rng_handle(rng), 1)) {
+        (void) fprintf(stderr, "Wrong public key\n");
+        botan_pubkey_destroy(elg_key);
+        return false;
+    }
+
+    *key = elg_key;
+    return true;
+}
+
+static bool
+elgamal_load_seckey(void **key, const void *param, rng_t *rng)
+{
+    const elgamal_key_param_t *elg = param;
+    botan_privkey_t            elg_key = NULL;
+
+    if (botan_privkey_load_elgamal(
+          &elg_key, elg->pubkey->p->mp, elg->pubkey->g->mp, elg->seckey->x->mp)) {
+        (void) fprintf(stderr, "Failed to load private key\n");
+        return false;
+    }
+
+    if (botan_privkey_check_key(elg_key, rng_handle(rng), 1)) {
+        (void) fprintf(stderr, "Wrong private key\n");
+        botan_privkey_destroy(elg_key);
+        return false;
+    }
+
+    *key = elg_key;
+    return true;
+}
+
 int
 pgp_elgamal_public_encrypt_pkcs1(rng_t *                     rng,
                                  uint8_t *                   g2k,
@@ -96,7 +145,6 @@ pgp_elgamal_public_encrypt_pkcs1(rng_t *                     rng,
                                  size_t                      length,
                                  const pgp_elgamal_pubkey_t *pubkey)
 {
-    botan_pubkey_t        key = NULL;
     botan_pk_op_encrypt_t op_ctx = NULL;
     int                   ret = -1;
     size_t                p_len = 0;
@@ -106,13 +154,9 @@ pgp_elgamal_public_encrypt_pkcs1(rng_t *                     rng,
         FAIL("Wrong public key");
     }
 
-    // Initialize RNG and encrypt
-    if (botan_pubkey_load_elgamal(&key, pubkey->p->mp, pubkey->g->mp, pubkey->y->mp)) {
-        FAIL("Failed to load public key");
-    }
-
-    if (botan_pubkey_check_key(key, rng_handle(rng), 1)) {
-        FAIL("Wrong public key");
+    if (!pgp_pk_cache_key(
+          &pubkey->cache, PGP_PK_KEY_DEFAULT, false, elgamal_load_pubkey, pubkey, rng)) {
+        goto end;
     }
 
     /* Max size of an output len is twice an order of underlying group (twice byte-size of p)
@@ -123,7 +167,8 @@ pgp_elgamal_public_encrypt_pkcs1(rng_t *                     rng,
         FAIL("Memory allocation failure");
     }
 
-    if (botan_pk_op_encrypt_create(&op_ctx, key, "PKCS1v15", 0)) {
+    op_ctx = pgp_pk_cache_op(pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_ENCRYPT, "PKCS1v15");
+    if (!op_ctx) {
         FAIL("Failed to create operation context");
     }
 
@@ -143,8 +188,10 @@ pgp_elgamal_public_encrypt_pkcs1(rng_t *                     rng,
     ret = 0;
 
 end:
-    ret |= botan_pk_op_encrypt_destroy(op_ctx);
-    ret |= botan_pubkey_destroy(key);
+    if (op_ctx) {
+        pgp_pk_cache_release(
+          pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_ENCRYPT, "PKCS1v15", op_ctx, true);
+    }
     free(bt_ciphertext);
 
     if (ret) {
@@ -164,7 +211,7 @@ pgp_elgamal_private_decrypt_pkcs1(rng_t *                     rng,
                                   const pgp_elgamal_seckey_t *seckey,
                                   const pgp_elgamal_pubkey_t *pubkey)
 {
-    botan_privkey_t       key = NULL;
+    elgamal_key_param_t   param = {.seckey = seckey, .pubkey = pubkey};
     botan_pk_op_decrypt_t op_ctx = NULL;
     int                   ret = -1;
     size_t                out_len = 0;
@@ -189,18 +236,16 @@ pgp_elgamal_private_decrypt_pkcs1(rng_t *                     rng,
         FAIL("Memory allocation failure");
     }
 
-    if (botan_privkey_load_elgamal(&key, pubkey->p->mp, pubkey->g->mp, seckey->x->mp)) {
-        FAIL("Failed to load private key");
-    }
-
-    if (botan_privkey_check_key(key, rng_handle(rng), 1)) {
-        FAIL("Wrong private key");
+    if (!pgp_pk_cache_key(
+          &seckey->cache, PGP_PK_KEY_DEFAULT, true, elgamal_load_seckey, &param, rng)) {
+        goto end;
     }
 
     memcpy(bt_plaintext, g2k, p_len);
     memcpy(bt_plaintext + p_len, in, p_len);
 
-    if (botan_pk_op_decrypt_create(&op_ctx, key, "PKCS1v15", 0)) {
+    op_ctx = pgp_pk_cache_op(seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_DECRYPT, "PKCS1v15");
+    if (!op_ctx) {
         FAIL("Failed to create operation context");
     }
 
@@ -213,10 +258,8 @@ pgp_elgamal_private_decrypt_pkcs1(rng_t *                     rng,
 
 end:
     if (op_ctx != NULL) {
-        ret |= botan_pk_op_decrypt_destroy(op_ctx);
-    }
-    if (key != NULL) {
-        ret |= botan_privkey_destroy(key);
+        pgp_pk_cache_release(
+          seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_DECRYPT, "PKCS1v15", op_ctx, true);
     }
     if (bt_plaintext != NULL) {
         free(bt_plaintext);
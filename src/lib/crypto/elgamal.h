@@ -34,21 +34,24 @@
 #include <stdint.h>
 #include "crypto/bn.h"
 #include "crypto/rng.h"
+#include "crypto/pk_cache.h"
 
 /** Structure to hold an ElGamal public key params.
  *
  * \see RFC4880 5.5.2
  */
 typedef struct {
-    bignum_t *p; /* ElGamal prime p */
-    bignum_t *g; /* ElGamal group generator g */
-    bignum_t *y; /* ElGamal public key value y (= g^x mod p
-                * with x being the secret) */
+    bignum_t *      p;     /* ElGamal prime p */
+    bignum_t *      g;     /* ElGamal group generator g */
+    bignum_t *      y;     /* ElGamal public key value y (= g^x mod p
+                            * with x being the secret) */
+    pgp_pk_cache_t *cache; /* loaded botan key and operations */
 } pgp_elgamal_pubkey_t;
 
 /** pgp_elgamal_seckey_t */
 typedef struct pgp_elgamal_seckey_t {
-    bignum_t *x;
+    bignum_t *      x;
+    pgp_pk_cache_t *cache; /* loaded botan key and operations */
 } pgp_elgamal_seckey_t;
 
 /** Struct to hold params of a Elgamal signature */
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include <botan/ffi.h>
+#include "crypto/pk_cache.h"
+#include "utils.h"
+
+/* number of idle operation objects kept per key */
+#define PGP_PK_CACHE_OPS 4
+/* params are copied to the slot, longer ones are not cached */
+#define PGP_PK_PARAMS_MAX 64
+
+typedef struct pgp_pk_cached_op_t {
+    void *            op; /* idle operation object or NULL if slot is free */
+    pgp_pk_key_kind_t kind;
+    pgp_pk_op_type_t  type;
+    char              params[PGP_PK_PARAMS_MAX];
+} pgp_pk_cached_op_t;
+
+struct pgp_pk_cache_t {
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t lock;
+#endif
+    void *             keys[PGP_PK_KEY_KINDS];   /* loaded botan keys */
+    bool               secret[PGP_PK_KEY_KINDS]; /* key is botan_privkey_t */
+    pgp_pk_cached_op_t ops[PGP_PK_CACHE_OPS];
+};
+
+#ifdef HAVE_PTHREAD_H
+/* guards the cache field of the key material during the cache allocation */
+static pthread_mutex_t pk_cache_alloc_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void
+pk_cache_lock(pgp_pk_cache_t *cache)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&cache->lock);
+#endif
+}
+
+static void
+pk_cache_unlock(pgp_pk_cache_t *cache)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&cache->lock);
+#endif
+}
+
+static pgp_pk_cache_t *
+pk_cache_get(pgp_pk_cache_t *const *cfield)
+{
+    pgp_pk_cache_t **cache = (pgp_pk_cache_t **) cfield;
+    pgp_pk_cache_t *res;
+
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&pk_cache_alloc_lock);
+#endif
+    if (!(res = *cache) && (res = calloc(1, sizeof(*res)))) {
+#ifdef HAVE_PTHREAD_H
+        if (pthread_mutex_init(&res->lock, NULL)) {
+            free(res);
+            res = NULL;
+        }
+#endif
+        *cache = res;
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&pk_cache_alloc_lock);
+#endif
+    return res;
+}
+
+static void *
+pk_op_create(void *key, pgp_pk_op_type_t type, const char *params)
+{
+    botan_pk_op_encrypt_t enc = NULL;
+    botan_pk_op_decrypt_t dec = NULL;
+    botan_pk_op_sign_t    sign = NULL;
+    botan_pk_op_verify_t  verify = NULL;
+
+    switch (type) {
+    case PGP_PK_OP_ENCRYPT:
+        return botan_pk_op_encrypt_create(&enc, key, params, 0) ? NULL : enc;
+    case PGP_PK_OP_DECRYPT:
+        return botan_pk_op_decrypt_create(&dec, key, params, 0) ? NULL : dec;
+    case PGP_PK_OP_SIGN:
+        return botan_pk_op_sign_create(&sign, key, params, 0) ? NULL : sign;
+    case PGP_PK_OP_VERIFY:
+        return botan_pk_op_verify_create(&verify, key, params, 0) ? NULL : verify;
+    default:
+        return NULL;
+    }
+}
+
+static void
+pk_op_destroy(void *op, pgp_pk_op_type_t type)
+{
+    switch (type) {
+    case PGP_PK_OP_ENCRYPT:
+        botan_pk_op_encrypt_destroy(op);
+        break;
+    case PGP_PK_OP_DECRYPT:
+        botan_pk_op_decrypt_destroy(op);
+        break;
+    case PGP_PK_OP_SIGN:
+        botan_pk_op_sign_destroy(op);
+        break;
+    case PGP_PK_OP_VERIFY:
+        botan_pk_op_verify_destroy(op);
+        break;
+    }
+}
+
+void *
+pgp_pk_cache_key(pgp_pk_cache_t *const *cache,
+                 pgp_pk_key_kind_t      kind,
+                 bool                   secret,
+                 pgp_pk_load_func_t *   load,
+                 const void *           param,
+                 rng_t *                rng)
+{
+    pgp_pk_cache_t *pkc;
+    void *          key = NULL;
+
+    if (!(pkc = pk_cache_get(cache))) {
+        RNP_LOG("allocation failed");
+        return NULL;
+    }
+
+    /* load under the lock so concurrent first uses do not check the key twice */
+    pk_cache_lock(pkc);
+    if (!pkc->keys[kind] && load(&key, param, rng)) {
+        pkc->keys[kind] = key;
+        pkc->secret[kind] = secret;
+    }
+    key = pkc->keys[kind];
+    pk_cache_unlock(pkc);
+    return key;
+}
+
+void *
+pgp_pk_cache_op(pgp_pk_cache_t *  cache,
+                pgp_pk_key_kind_t kind,
+                pgp_pk_op_type_t  type,
+                const char *      params)
+{
+    void *key;
+    void *op = NULL;
+
+    pk_cache_lock(cache);
+    for (size_t i = 0; i < PGP_PK_CACHE_OPS; i++) {
+        pgp_pk_cached_op_t *slot = &cache->ops[i];
+        if (slot->op && (slot->kind == kind) && (slot->type == type) &&
+            !strcmp(slot->params, params)) {
+            op = slot->op;
+            slot->op = NULL;
+            break;
+        }
+    }
+    key = cache->keys[kind];
+    pk_cache_unlock(cache);
+
+    if (!op && key) {
+        op = pk_op_create(key, type, params);
+    }
+    return op;
+}
+
+void
+pgp_pk_cache_release(pgp_pk_cache_t *  cache,
+                     pgp_pk_key_kind_t kind,
+                     pgp_pk_op_type_t  type,
+                     const char *      params,
+                     void *            op,
+                     bool              reusable)
+{
+    if (!op) {
+        return;
+    }
+
+    if (reusable && (strlen(params) < PGP_PK_PARAMS_MAX)) {
+        pk_cache_lock(cache);
+        for (size_t i = 0; i < PGP_PK_CACHE_OPS; i++) {
+            pgp_pk_cached_op_t *slot = &cache->ops[i];
+            if (!slot->op) {
+                slot->op = op;
+                slot->kind = kind;
+                slot->type = type;
+                strcpy(slot->params, params);
+                op = NULL;
+                break;
+            }
+        }
+        pk_cache_unlock(cache);
+    }
+
+    /* not reusable or all slots are busy */
+    if (op) {
+        pk_op_destroy(op, type);
+    }
+}
+
+void
+pgp_pk_cache_destroy(pgp_pk_cache_t **cache)
+{
+    pgp_pk_cache_t *pkc = *cache;
+
+    if (!pkc) {
+        return;
+    }
+
+    /* operations reference the keys so must go first */
+    for (size_t i = 0; i < PGP_PK_CACHE_OPS; i++) {
+        if (pkc->ops[i].op) {
+            pk_op_destroy(pkc->ops[i].op, pkc->ops[i].type);
+        }
+    }
+    for (size_t i = 0; i < PGP_PK_KEY_KINDS; i++) {
+        if (!pkc->keys[i]) {
+            continue;
+        }
+        if (pkc->secret[i]) {
+            botan_privkey_destroy(pkc->keys[i]);
+        } else {
+            botan_pubkey_destroy(pkc->keys[i]);
+        }
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&pkc->lock);
+#endif
+    free(pkc);
+    *cache = NULL;
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** Per-key cache of the loaded botan keys and public key operations
+ *  @file
+ */
+#ifndef RNP_PK_CACHE_H_
+#define RNP_PK_CACHE_H_
+
+#include <stdbool.h>
+#include "crypto/rng.h"
+
+/**
+ *  @private
+ *  Loading botan key from the MPIs, and especially checking it, is much more expensive than
+ *  the operation itself for the small inputs like hashes and session keys. So the loaded and
+ *  checked key, as well as the idle operation objects, are stored together with the key
+ *  material in the cache field of the algorithm-specific key struct. Cache is allocated on
+ *  the first use and is destroyed together with the key material, i.e. on pgp_key_lock() and
+ *  when key is freed. Functions are thread-safe.
+ *
+ *  @code
+ *  botan_pubkey_t       key = pgp_pk_cache_key(&pubkey->cache, ...);
+ *  botan_pk_op_verify_t op = pgp_pk_cache_op(pubkey->cache, ...);
+ *  ok = !botan_pk_op_verify_update(op, ...) && !botan_pk_op_verify_finish(op, ...);
+ *  // op is returned to the cache only if it is in the initial state
+ *  pgp_pk_cache_release(pubkey->cache, ..., op, reusable);
+ *  @endcode
+ */
+
+typedef struct pgp_pk_cache_t pgp_pk_cache_t;
+
+/* the same key material may be loaded as a different botan keys, like SM2 one */
+typedef enum {
+    PGP_PK_KEY_DEFAULT = 0,
+    PGP_PK_KEY_SM2_ENC = 1,
+    PGP_PK_KEY_KINDS
+} pgp_pk_key_kind_t;
+
+typedef enum {
+    PGP_PK_OP_ENCRYPT = 0,
+    PGP_PK_OP_DECRYPT,
+    PGP_PK_OP_SIGN,
+    PGP_PK_OP_VERIFY
+} pgp_pk_op_type_t;
+
+/** @private
+ *  function which loads the botan key from the key material and checks it if needed
+ *
+ *  @param key on success botan_pubkey_t or botan_privkey_t is stored here
+ *  @param param key material, passed as is from pgp_pk_cache_key()
+ *  @param rng random generator for the key check, may be NULL
+ *  @return true on success or false otherwise
+ **/
+typedef bool pgp_pk_load_func_t(void **key, const void *param, rng_t *rng);
+
+/** @private
+ *  get the loaded botan key, loading it on the first call
+ *
+ *  @param cache pointer to the cache field of the key material, cache is allocated if needed.
+ *         Cache is not a part of the key value, so it may be changed via the const key.
+ *  @param kind kind of the key
+ *  @param secret true if key is botan_privkey_t, false for botan_pubkey_t
+ *  @param load function which loads the key
+ *  @param param key material passed to the load function
+ *  @param rng random generator passed to the load function
+ *  @return botan key which is valid until the cache is destroyed, or NULL on failure
+ **/
+void *pgp_pk_cache_key(pgp_pk_cache_t *const *cache,
+                       pgp_pk_key_kind_t      kind,
+                       bool                   secret,
+                       pgp_pk_load_func_t *   load,
+                       const void *           param,
+                       rng_t *                rng);
+
+/** @private
+ *  get the operation object for the key, previously loaded via pgp_pk_cache_key(). Idle
+ *  object from the cache is returned if available, otherwise new one is created.
+ *
+ *  @param cache initialized cache
+ *  @param kind kind of the key
+ *  @param type type of the operation, which also defines type of the returned object
+ *  @param params padding or hash parameters of the operation
+ *  @return botan operation object or NULL on failure. It must be passed later to the
+ *          pgp_pk_cache_release() with the same kind, type and params.
+ **/
+void *pgp_pk_cache_op(pgp_pk_cache_t *  cache,
+                      pgp_pk_key_kind_t kind,
+                      pgp_pk_op_type_t  type,
+                      const char *      params);
+
+/** @private
+ *  return the operation object to the cache or destroy it
+ *
+ *  @param cache cache from which op was obtained
+ *  @param kind kind of the key
+ *  @param type type of the operation
+ *  @param params padding or hash parameters of the operation
+ *  @param op operation object, may be NULL
+ *  @param reusable true if op is in the initial state and may be used again, i.e. there is
+ *         no pending update() without finish()
+ **/
+void pgp_pk_cache_release(pgp_pk_cache_t *  cache,
+                          pgp_pk_key_kind_t kind,
+                          pgp_pk_op_type_t  type,
+                          const char *      params,
+                          void *            op,
+                          bool              reusable);
+
+/** @private
+ *  destroy the cache with all the operation objects and keys. Secret keys are wiped by
+ *  botan on destruction. Must not be called while cache is in use by other threads.
+ *
+ *  @param cache pointer to the cache field of the key material, set to NULL afterwards
+ **/
+void pgp_pk_cache_destroy(pgp_pk_cache_t **cache);
+
+#endif
@@ -87,6 +87,46 @@
 
 #include "hash.h"
 
+/* RSA secret key is loaded from both secret and public parts */
+typedef struct rsa_key_param_t {
+    const pgp_rsa_seckey_t *seckey;
+    const pgp_rsa_pubkey_t *pubkey;
+} rsa_key_param_t;
+
+static bool
+rsa_load_pubkey(void **key, const void *param, rng_t *rng)
+{
+    const pgp_rsa_pubkey_t *pubkey = param;
+    botan_pubkey_t          rsa_key = NULL;
+
+    if (botan_pubkey_load_rsa(&rsa_key, pubkey->n->mp, pubkey->e->mp) ||
+        botan_pubkey_check_key(rsa_key, rng_handle(rng), 1)) {
+        botan_pubkey_destroy(rsa_key);
+        return false;
+    }
+
+    *key = rsa_key;
+    return true;
+}
+
+static bool
+rsa_load_seckey(void **key, const void *param, rng_t *rng)
+{
+    const rsa_key_param_t *rsa = param;
+    botan_privkey_t        rsa_key = NULL;
+
+    /* p and q are reversed from normal usage in PGP */
+    if (botan_privkey_load_rsa(
+          &rsa_key, rsa->seckey->q->mp, rsa->seckey->p->mp, rsa->pubkey->e->mp) ||
+        botan_privkey_check_key(rsa_key, rng_handle(rng), 0)) {
+        botan_privkey_destroy(rsa_key);
+        return false;
+    }
+
+    *key = rsa_key;
+    return true;
+}
+
 /**
    \ingroup Core_Crypto
    \brief Decrypt PKCS1 formatted RSA ciphertext
@@ -105,29 +145,24 @@ pgp_rsa_encrypt_pkcs1(rng_t *                 rng,
                       const pgp_rsa_pubkey_t *pubkey)
 {
     int                   retval = -1;
-    botan_pubkey_t        rsa_key = NULL;
     botan_pk_op_encrypt_t enc_op = NULL;
 
-    if (botan_pubkey_load_rsa(&rsa_key, pubkey->n->mp, pubkey->e->mp) != 0) {
-        goto done;
+    if (!pgp_pk_cache_key(
+          &pubkey->cache, PGP_PK_KEY_DEFAULT, false, rsa_load_pubkey, pubkey, rng)) {
+        return -1;
     }
 
-    if (botan_pubkey_check_key(rsa_key, rng_handle(rng), 1) != 0) {
-        goto done;
-    }
-
-    if (botan_pk_op_encrypt_create(&enc_op, rsa_key, "PKCS1v15", 0) != 0) {
-        goto done;
+    enc_op = pgp_pk_cache_op(pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_ENCRYPT, "PKCS1v15");
+    if (!enc_op) {
+        return -1;
     }
 
     if (botan_pk_op_encrypt(enc_op, rng_handle(rng), out, &out_len, in, in_len) == 0) {
         retval = (int) out_len;
     }
 
-done:
-    botan_pk_op_encrypt_destroy(enc_op);
-    botan_pubkey_destroy(rsa_key);
-
+    pgp_pk_cache_release(
+      pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_ENCRYPT, "PKCS1v15", enc_op, true);
     return retval;
 }
 
@@ -141,7 +176,6 @@ pgp_rsa_pkcs1_verify_hash(rng_t *                 rng,
                           const pgp_rsa_pubkey_t *pubkey)
 {
     char                 padding_name[64] = {0};
-    botan_pubkey_t       rsa_key = NULL;
     botan_pk_op_verify_t verify_op = NULL;
     bool                 result = false;
 
@@ -150,25 +184,28 @@ pgp_rsa_pkcs1_verify_hash(rng_t *                 rng,
              "EMSA-PKCS1-v1_5(Raw,%s)",
              pgp_hash_name_botan(hash_alg));
 
-    botan_pubkey_load_rsa(&rsa_key, pubkey->n->mp, pubkey->e->mp);
-
-    if (botan_pubkey_check_key(rsa_key, rng_handle(rng), 1) != 0) {
-        goto done;
+    if (!pgp_pk_cache_key(
+          &pubkey->cache, PGP_PK_KEY_DEFAULT, false, rsa_load_pubkey, pubkey, rng)) {
+        return false;
     }
 
-    if (botan_pk_op_verify_create(&verify_op, rsa_key, padding_name, 0) != 0) {
-        goto done;
+    verify_op =
+      pgp_pk_cache_op(pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, padding_name);
+    if (!verify_op) {
+        return false;
     }
 
     if (botan_pk_op_verify_update(verify_op, hash, hash_len) != 0) {
-        goto done;
+        /* operation has the pending data so is not reusable */
+        pgp_pk_cache_release(
+          pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, padding_name, verify_op, false);
+        return false;
     }
 
     result = (botan_pk_op_verify_finish(verify_op, sig_buf, sig_buf_size) == 0);
 
-done:
-    botan_pk_op_verify_destroy(verify_op);
-    botan_pubkey_destroy(rsa_key);
+    pgp_pk_cache_release(
+      pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, padding_name, verify_op, true);
     return result;
 }
 
@@ -193,8 +230,9 @@ pgp_rsa_pkcs1_sign_hash(rng_t *                 rng,
                         const pgp_rsa_pubkey_t *pubkey)
 {
     char               padding_name[64] = {0};
-    botan_privkey_t    rsa_key;
+    rsa_key_param_t    param = {.seckey = seckey, .pubkey = pubkey};
     botan_pk_op_sign_t sign_op;
+    bool               ok;
 
     if (seckey->q == NULL) {
         (void) fprintf(stderr, "private key not set in pgp_rsa_private_encrypt\n");
@@ -206,30 +244,23 @@ pgp_rsa_pkcs1_sign_hash(rng_t *                 rng,
              "EMSA-PKCS1-v1_5(Raw,%s)",
              pgp_hash_name_botan(hash_alg));
 
-    /* p and q are reversed from normal usage in PGP */
-    botan_privkey_load_rsa(&rsa_key, seckey->q->mp, seckey->p->mp, pubkey->e->mp);
-
-    if (botan_privkey_check_key(rsa_key, rng_handle(rng), 0) != 0) {
-        botan_privkey_destroy(rsa_key);
+    if (!pgp_pk_cache_key(
+          &seckey->cache, PGP_PK_KEY_DEFAULT, true, rsa_load_seckey, &param, rng)) {
         return 0;
     }
 
-    if (botan_pk_op_sign_create(&sign_op, rsa_key, padding_name, 0) != 0) {
-        botan_privkey_destroy(rsa_key);
+    sign_op = pgp_pk_cache_op(seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, padding_name);
+    if (!sign_op) {
         return 0;
     }
 
-    if (botan_pk_op_sign_update(sign_op, hash_buf, hash_len) != 0 ||
-        botan_pk_op_sign_finish(sign_op, rng_handle(rng), sig_buf, &sig_buf_size) != 0) {
-        botan_pk_op_sign_destroy(sign_op);
-        botan_privkey_destroy(rsa_key);
-        return 0;
-    }
+    ok = !botan_pk_op_sign_update(sign_op, hash_buf, hash_len) &&
+         !botan_pk_op_sign_finish(sign_op, rng_handle(rng), sig_buf, &sig_buf_size);
 
-    botan_pk_op_sign_destroy(sign_op);
-    botan_privkey_destroy(rsa_key);
+    pgp_pk_cache_release(
+      seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, padding_name, sign_op, ok);
 
-    return (int) sig_buf_size;
+    return ok ? (int) sig_buf_size : 0;
 }
 
 /**
@@ -252,28 +283,26 @@ pgp_rsa_decrypt_pkcs1(rng_t *                 rng,
                       const pgp_rsa_pubkey_t *pubkey)
 {
     int                   retval = -1;
-    botan_privkey_t       rsa_key = NULL;
+    rsa_key_param_t       param = {.seckey = seckey, .pubkey = pubkey};
     botan_pk_op_decrypt_t decrypt_op = NULL;
 
-    if (botan_privkey_load_rsa(&rsa_key, seckey->q->mp, seckey->p->mp, pubkey->e->mp) != 0) {
-        goto done;
+    if (!pgp_pk_cache_key(
+          &seckey->cache, PGP_PK_KEY_DEFAULT, true, rsa_load_seckey, &param, rng)) {
+        return -1;
     }
 
-    if (botan_privkey_check_key(rsa_key, rng_handle(rng), 0) != 0) {
-        goto done;
-    }
-
-    if (botan_pk_op_decrypt_create(&decrypt_op, rsa_key, "PKCS1v15", 0) != 0) {
-        goto done;
+    decrypt_op =
+      pgp_pk_cache_op(seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_DECRYPT, "PKCS1v15");
+    if (!decrypt_op) {
+        return -1;
     }
 
     if (botan_pk_op_decrypt(decrypt_op, out, &out_len, (uint8_t *) in, in_len) == 0) {
         retval = (int) out_len;
     }
 
-done:
-    botan_privkey_destroy(rsa_key);
-    botan_pk_op_decrypt_destroy(decrypt_op);
+    pgp_pk_cache_release(
+      seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_DECRYPT, "PKCS1v15", decrypt_op, true);
     return retval;
 }
 
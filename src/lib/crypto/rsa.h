@@ -35,6 +35,7 @@
 #include <repgp/repgp_def.h>
 #include "crypto/bn.h"
 #include "crypto/rng.h"
+#include "crypto/pk_cache.h"
 
 typedef struct pgp_seckey_t     pgp_seckey_t;
 typedef struct pgp_rsa_seckey_t pgp_rsa_seckey_t;
@@ -44,8 +45,9 @@ typedef struct pgp_rsa_seckey_t pgp_rsa_seckey_t;
  * \see RFC4880 5.5.2
  */
 typedef struct {
-    bignum_t *n; /* RSA public modulus n */
-    bignum_t *e; /* RSA public encryption exponent e */
+    bignum_t *      n;     /* RSA public modulus n */
+    bignum_t *      e;     /* RSA public encryption exponent e */
+    pgp_pk_cache_t *cache; /* loaded botan key and operations */
 } pgp_rsa_pubkey_t;
 
 /** Struct to hold params of an RSA signature */
@@ -56,10 +58,11 @@ typedef struct pgp_rsa_sig_t {
 /** Structure to hold data for one RSA secret key
  */
 typedef struct pgp_rsa_seckey_t {
-    bignum_t *d;
-    bignum_t *p;
-    bignum_t *q;
-    bignum_t *u;
+    bignum_t *      d;
+    bignum_t *      p;
+    bignum_t *      q;
+    bignum_t *      u;
+    pgp_pk_cache_t *cache; /* loaded botan key and operations */
 } pgp_rsa_seckey_t;
 
 /*
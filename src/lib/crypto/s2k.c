@@ -29,9 +29,12 @@
  */
 
 #include <stdio.h>
+#include <time.h>
 #include <botan/ffi.h>
 
 #include "crypto/s2k.h"
+#include "memory.h"
+#include "utils.h"
 
 bool
 pgp_s2k_derive_key(pgp_s2k_t *s2k, const char *password, uint8_t *key, int keysize)
@@ -134,3 +137,60 @@ pgp_s2k_encode_iterations(size_t iterations)
     }
     return 255;
 }
+
+static uint64_t
+s2k_time_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+size_t
+pgp_s2k_compute_iters(pgp_hash_alg_t alg, size_t desired_msec, size_t trial_msec)
+{
+    const char *password = "password";
+    uint8_t     salt[PGP_SALT_SIZE] = {0};
+    uint8_t     key[PGP_MAX_KEY_SIZE];
+    size_t      iterations = PGP_S2K_MIN_ITERATIONS / 16;
+    uint64_t    elapsed = 0;
+    uint64_t    start;
+    double      res;
+
+    if (!desired_msec) {
+        desired_msec = PGP_S2K_DEFAULT_MSEC;
+    }
+    if (!trial_msec) {
+        trial_msec = PGP_S2K_TRIAL_MSEC;
+    }
+    if (!pgp_hash_name_botan(alg)) {
+        RNP_LOG("unsupported hash algorithm %d", (int) alg);
+        return 0;
+    }
+
+    /* the single measured run should be long enough to hide the timer granularity and setup */
+    while (true) {
+        start = s2k_time_usec();
+        if (pgp_s2k_iterated(alg, key, sizeof(key), password, salt, iterations)) {
+            RNP_LOG("s2k failed");
+            return 0;
+        }
+        elapsed = s2k_time_usec() - start;
+        if ((elapsed >= trial_msec * 1000) ||
+            (iterations >= pgp_s2k_decode_iterations(255))) {
+            break;
+        }
+        iterations *= 2;
+    }
+    pgp_forget(key, sizeof(key));
+
+    res = (double) iterations * desired_msec * 1000 / (elapsed ? elapsed : 1);
+    if (res < PGP_S2K_MIN_ITERATIONS) {
+        return pgp_s2k_round_iterations(PGP_S2K_MIN_ITERATIONS);
+    }
+    if (res >= pgp_s2k_decode_iterations(255)) {
+        return pgp_s2k_decode_iterations(255);
+    }
+    return pgp_s2k_round_iterations((size_t) res);
+}
@@ -35,6 +35,13 @@
 
 #define PGP_S2K_DEFAULT_ITERATIONS 524288
 
+/* default time in milliseconds which calibrated key derivation should take */
+#define PGP_S2K_DEFAULT_MSEC 150
+/* default time in milliseconds spent on measuring the hash throughput */
+#define PGP_S2K_TRIAL_MSEC 10
+/* calibrated iterations are never lower than this value */
+#define PGP_S2K_MIN_ITERATIONS 65536
+
 int pgp_s2k_simple(pgp_hash_alg_t alg, uint8_t *out, size_t output_len, const char *password);
 
 int pgp_s2k_salted(pgp_hash_alg_t alg,
@@ -57,6 +64,16 @@ uint8_t pgp_s2k_encode_iterations(size_t iterations);
 // Round iterations to nearest representable value
 size_t pgp_s2k_round_iterations(size_t iterations);
 
+/** @brief Pick the iteration count so key derivation takes the desired time on this host.
+ *         Throughput of pgp_s2k_iterated() is measured with growing iteration counts until
+ *         a single run takes at least trial_msec.
+ *  @param alg hash algorithm used by S2K
+ *  @param desired_msec desired derivation time in milliseconds, 0 for PGP_S2K_DEFAULT_MSEC
+ *  @param trial_msec time to spend on measurement, 0 for PGP_S2K_TRIAL_MSEC
+ *  @return representable iteration count, at least PGP_S2K_MIN_ITERATIONS, or 0 on error
+ */
+size_t pgp_s2k_compute_iters(pgp_hash_alg_t alg, size_t desired_msec, size_t trial_msec);
+
 /** @brief Derive key from password using the information stored in s2k structure
  *  @param s2k pointer to s2k structure, filled according to RFC 4880.
  *  Iterations field may contain encoded ( < 256) or decoded ( > 256) value.
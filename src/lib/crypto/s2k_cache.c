@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "crypto/s2k.h"
+#include "crypto/s2k_cache.h"
+#include "hash.h"
+#include "memory.h"
+#include "utils.h"
+
+#define PGP_S2K_CACHE_ID_SIZE 32
+
+typedef struct pgp_s2k_cached_key_t {
+    uint8_t id[PGP_S2K_CACHE_ID_SIZE]; /* digest of the password and s2k params */
+    uint8_t key[PGP_MAX_KEY_SIZE];     /* derived key */
+    time_t  expires;                   /* 0 if slot is free */
+} pgp_s2k_cached_key_t;
+
+struct pgp_s2k_cache_t {
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t lock;
+#endif
+    unsigned             expiry;
+    pgp_s2k_cached_key_t keys[PGP_S2K_CACHE_SIZE];
+};
+
+static void
+s2k_cache_lock(pgp_s2k_cache_t *cache)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&cache->lock);
+#endif
+}
+
+static void
+s2k_cache_unlock(pgp_s2k_cache_t *cache)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&cache->lock);
+#endif
+}
+
+pgp_s2k_cache_t *
+pgp_s2k_cache_create(unsigned expiry)
+{
+    pgp_s2k_cache_t *cache = calloc(1, sizeof(*cache));
+
+    if (!cache) {
+        RNP_LOG("allocation failed");
+        return NULL;
+    }
+#ifdef HAVE_PTHREAD_H
+    if (pthread_mutex_init(&cache->lock, NULL)) {
+        free(cache);
+        return NULL;
+    }
+#endif
+    cache->expiry = expiry;
+    return cache;
+}
+
+void
+pgp_s2k_cache_destroy(pgp_s2k_cache_t *cache)
+{
+    if (!cache) {
+        return;
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&cache->lock);
+#endif
+    pgp_forget(cache, sizeof(*cache));
+    free(cache);
+}
+
+/* digest of everything which affects the derived key */
+static bool
+s2k_cache_id(const pgp_s2k_t *s2k, const char *password, int keysize, uint8_t *id)
+{
+    pgp_hash_t hash = {0};
+    uint8_t    params[6 + PGP_SALT_SIZE + 4];
+
+    params[0] = s2k->specifier;
+    params[1] = s2k->hash_alg;
+    STORE32BE(&params[2], keysize);
+    memcpy(&params[6], s2k->salt, PGP_SALT_SIZE);
+    STORE32BE(&params[6 + PGP_SALT_SIZE], s2k->iterations);
+
+    if (!pgp_hash_create(&hash, PGP_HASH_SHA256)) {
+        return false;
+    }
+    pgp_hash_add(&hash, params, sizeof(params));
+    pgp_hash_add(&hash, (const uint8_t *) password, strlen(password));
+    return pgp_hash_finish(&hash, id) == PGP_S2K_CACHE_ID_SIZE;
+}
+
+/* must be called with cache->lock held */
+static void
+s2k_cache_expire(pgp_s2k_cache_t *cache, time_t now)
+{
+    for (size_t i = 0; i < PGP_S2K_CACHE_SIZE; i++) {
+        pgp_s2k_cached_key_t *slot = &cache->keys[i];
+        if (slot->expires && (slot->expires <= now)) {
+            pgp_forget(slot, sizeof(*slot));
+        }
+    }
+}
+
+/* must be called with cache->lock held */
+static pgp_s2k_cached_key_t *
+s2k_cache_find(pgp_s2k_cache_t *cache, const uint8_t *id)
+{
+    for (size_t i = 0; i < PGP_S2K_CACHE_SIZE; i++) {
+        pgp_s2k_cached_key_t *slot = &cache->keys[i];
+        if (slot->expires && !memcmp(slot->id, id, PGP_S2K_CACHE_ID_SIZE)) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* must be called with cache->lock held, free or the oldest slot is returned */
+static pgp_s2k_cached_key_t *
+s2k_cache_slot(pgp_s2k_cache_t *cache)
+{
+    pgp_s2k_cached_key_t *slot = &cache->keys[0];
+
+    for (size_t i = 0; i < PGP_S2K_CACHE_SIZE; i++) {
+        if (!cache->keys[i].expires) {
+            return &cache->keys[i];
+        }
+        if (cache->keys[i].expires < slot->expires) {
+            slot = &cache->keys[i];
+        }
+    }
+    return slot;
+}
+
+bool
+pgp_s2k_cache_derive_key(
+  pgp_s2k_cache_t *cache, pgp_s2k_t *s2k, const char *password, uint8_t *key, int keysize)
+{
+    uint8_t               id[PGP_S2K_CACHE_ID_SIZE];
+    pgp_s2k_cached_key_t *slot;
+    time_t                now;
+    bool                  res = false;
+
+    if (!cache || (keysize <= 0) || (keysize > PGP_MAX_KEY_SIZE) ||
+        !s2k_cache_id(s2k, password, keysize, id)) {
+        return pgp_s2k_derive_key(s2k, password, key, keysize);
+    }
+
+    /* expired keys are wiped on each lookup and insert, so they don't stay in memory */
+    s2k_cache_lock(cache);
+    s2k_cache_expire(cache, time(NULL));
+    if ((slot = s2k_cache_find(cache, id))) {
+        memcpy(key, slot->key, keysize);
+        res = true;
+    }
+    s2k_cache_unlock(cache);
+    if (res) {
+        goto finish;
+    }
+
+    /* derivation is not done under the lock, so different keys are derived in parallel */
+    if (!pgp_s2k_derive_key(s2k, password, key, keysize)) {
+        goto finish;
+    }
+    res = true;
+
+    s2k_cache_lock(cache);
+    now = time(NULL);
+    s2k_cache_expire(cache, now);
+    if (!s2k_cache_find(cache, id)) {
+        slot = s2k_cache_slot(cache);
+        memcpy(slot->id, id, PGP_S2K_CACHE_ID_SIZE);
+        memcpy(slot->key, key, keysize);
+        slot->expires = now + cache->expiry;
+    }
+    s2k_cache_unlock(cache);
+finish:
+    pgp_forget(id, sizeof(id));
+    return res;
+}
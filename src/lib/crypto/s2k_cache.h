@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** Cache of the keys derived from passwords
+ *  @file
+ */
+#ifndef RNP_S2K_CACHE_H_
+#define RNP_S2K_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+
+/* suggested lifetime of the cached key, in seconds */
+#define PGP_S2K_CACHE_EXPIRY 300
+/* maximum number of the cached keys */
+#define PGP_S2K_CACHE_SIZE 32
+
+/**
+ *  @private
+ *  Iterated and salted S2K is intentionally slow, so opening the same message or key again
+ *  with the same password derives the same key once more. Cache stores derived keys for a
+ *  limited time, indexed by the SHA-256 digest of the password together with all of the S2K
+ *  parameters, so password itself is never stored. Expired keys are wiped on each lookup and
+ *  insert, and the rest of them when cache is destroyed. Functions are thread-safe.
+ *
+ *  @code
+ *  pgp_s2k_cache_t *cache = pgp_s2k_cache_create(PGP_S2K_CACHE_EXPIRY);
+ *  // derives the key, or copies it from the cache if it was derived recently
+ *  ok = pgp_s2k_cache_derive_key(cache, &s2k, password, key, keysize);
+ *  pgp_s2k_cache_destroy(cache);
+ *  @endcode
+ */
+
+typedef struct pgp_s2k_cache_t pgp_s2k_cache_t;
+
+/** @private
+ *  create the cache
+ *
+ *  @param expiry number of seconds for which the derived key is kept
+ *  @return cache or NULL if allocation failed
+ **/
+pgp_s2k_cache_t *pgp_s2k_cache_create(unsigned expiry);
+
+/** @private
+ *  wipe all the cached keys and destroy the cache. Must not be called while cache is in use
+ *  by other threads.
+ *
+ *  @param cache cache or NULL
+ **/
+void pgp_s2k_cache_destroy(pgp_s2k_cache_t *cache);
+
+/** @private
+ *  derive key from the password, using the cached one if available
+ *
+ *  @param cache cache or NULL, then key is always derived
+ *  @param s2k s2k parameters, as for pgp_s2k_derive_key()
+ *  @param password NULL-terminated password
+ *  @param key buffer to store the derived key, must have at least keysize bytes
+ *  @param keysize number of bytes in the key, up to PGP_MAX_KEY_SIZE
+ *  @return true on success or false otherwise
+ **/
+bool pgp_s2k_cache_derive_key(pgp_s2k_cache_t *cache,
+                              pgp_s2k_t *      s2k,
+                              const char *     password,
+                              uint8_t *        key,
+                              int              keysize);
+
+#endif
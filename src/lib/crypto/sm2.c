@@ -36,6 +36,103 @@
 #include "crypto.h"
 #include "utils.h"
 
+/* SM2 secret key is loaded from the secret value and curve */
+typedef struct sm2_key_param_t {
+    const pgp_ecc_seckey_t *seckey;
+    const pgp_ecc_pubkey_t *pubkey;
+} sm2_key_param_t;
+
+static bool
+sm2_load_pubkey_common(void **key, const pgp_ecc_pubkey_t *pubkey, bool enc)
+{
+    const ec_curve_desc_t *curve = get_curve_desc(pubkey->curve);
+    botan_mp_t             public_x = NULL;
+    botan_mp_t             public_y = NULL;
+    botan_pubkey_t         pub = NULL;
+    uint8_t                point_bytes[BITS_TO_BYTES(521) * 2 + 1] = {0};
+    size_t                 sz;
+    bool                   res = false;
+
+    const size_t point_len = BITS_TO_BYTES(curve->bitlen);
+    if (!bn_num_bytes(pubkey->point, &sz) || (sz > sizeof(point_bytes)) ||
+        bn_bn2bin(pubkey->point, point_bytes) || (point_bytes[0] != 0x04)) {
+        RNP_LOG("Failed to load public key");
+        return false;
+    }
+
+    if (botan_mp_init(&public_x) || botan_mp_init(&public_y) ||
+        botan_mp_from_bin(public_x, &point_bytes[1], point_len) ||
+        botan_mp_from_bin(public_y, &point_bytes[1 + point_len], point_len)) {
+        goto end;
+    }
+
+    if (enc ? botan_pubkey_load_sm2_enc(&pub, public_x, public_y, curve->botan_name) :
+              botan_pubkey_load_sm2(&pub, public_x, public_y, curve->botan_name)) {
+        RNP_LOG("Failed to load public key");
+        goto end;
+    }
+
+    *key = pub;
+    res = true;
+end:
+    botan_mp_destroy(public_x);
+    botan_mp_destroy(public_y);
+    return res;
+}
+
+static bool
+sm2_load_pubkey(void **key, const void *param, rng_t *rng)
+{
+    return sm2_load_pubkey_common(key, param, false);
+}
+
+static bool
+sm2_load_enc_pubkey(void **key, const void *param, rng_t *rng)
+{
+    if (!sm2_load_pubkey_common(key, param, true)) {
+        return false;
+    }
+
+    if (botan_pubkey_check_key(*key, rng_handle(rng), 1) != 0) {
+        botan_pubkey_destroy(*key);
+        *key = NULL;
+        return false;
+    }
+    return true;
+}
+
+static bool
+sm2_load_seckey(void **key, const void *param, rng_t *rng)
+{
+    const sm2_key_param_t *sm2 = param;
+    const ec_curve_desc_t *curve = get_curve_desc(sm2->pubkey->curve);
+    botan_privkey_t        priv = NULL;
+
+    if (botan_privkey_load_sm2(&priv, sm2->seckey->x->mp, curve->botan_name)) {
+        RNP_LOG("Can't load private key");
+        return false;
+    }
+
+    *key = priv;
+    return true;
+}
+
+static bool
+sm2_load_enc_seckey(void **key, const void *param, rng_t *rng)
+{
+    const sm2_key_param_t *sm2 = param;
+    const ec_curve_desc_t *curve = get_curve_desc(sm2->pubkey->curve);
+    botan_privkey_t        priv = NULL;
+
+    if (botan_privkey_load_sm2_enc(&priv, sm2->seckey->x->mp, curve->botan_name)) {
+        RNP_LOG("Can't load private key");
+        return false;
+    }
+
+    *key = priv;
+    return true;
+}
+
 rnp_result_t
 pgp_sm2_sign_hash(rng_t *                 rng,
                   pgp_ecc_sig_t *         sign,
@@ -45,10 +142,11 @@ pgp_sm2_sign_hash(rng_t *                 rng,
                   const pgp_ecc_pubkey_t *pubkey)
 {
     const ec_curve_desc_t *curve = get_curve_desc(pubkey->curve);
+    sm2_key_param_t        param = {.seckey = seckey, .pubkey = pubkey};
     botan_pk_op_sign_t     signer = NULL;
-    botan_privkey_t        key = NULL;
     rnp_result_t           ret = RNP_ERROR_GENERIC;
     uint8_t                out_buf[2 * MAX_CURVE_BYTELEN] = {0};
+    bool                   reusable = false;
 
     if (curve == NULL) {
         return RNP_ERROR_GENERIC;
@@ -60,13 +158,13 @@ pgp_sm2_sign_hash(rng_t *                 rng,
         return RNP_ERROR_GENERIC;
     }
 
-    if (botan_privkey_load_sm2(&key, seckey->x->mp, curve->botan_name)) {
-        RNP_LOG("Can't load private key");
+    if (!pgp_pk_cache_key(
+          &seckey->cache, PGP_PK_KEY_DEFAULT, true, sm2_load_seckey, &param, rng)) {
         return RNP_ERROR_BAD_FORMAT;
     }
 
-    if (botan_pk_op_sign_create(&signer, key, "", 0)) {
-        goto end;
+    if (!(signer = pgp_pk_cache_op(seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, ""))) {
+        return RNP_ERROR_GENERIC;
     }
 
     if (botan_pk_op_sign_update(signer, hashbuf, hash_len)) {
@@ -78,6 +176,7 @@ pgp_sm2_sign_hash(rng_t *                 rng,
         RNP_LOG("Signing failed");
         goto end;
     }
+    reusable = true;
 
     // Allocate memory and copy results
     sign->r = bn_bin2bn(out_buf, sign_half_len, sign->r);
@@ -94,8 +193,8 @@ end:
         bn_clear_free(sign->r);
         bn_clear_free(sign->s);
     }
-    botan_privkey_destroy(key);
-    botan_pk_op_sign_destroy(signer);
+    pgp_pk_cache_release(
+      seckey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_SIGN, "", signer, reusable);
 
     return ret;
 }
@@ -108,14 +207,11 @@ pgp_sm2_verify_hash(const pgp_ecc_sig_t *   sign,
 {
     const ec_curve_desc_t *curve = get_curve_desc(pubkey->curve);
 
-    botan_mp_t           public_x = NULL;
-    botan_mp_t           public_y = NULL;
-    botan_pubkey_t       pub = NULL;
     botan_pk_op_verify_t verifier = NULL;
     rnp_result_t         ret = RNP_ERROR_SIGNATURE_INVALID;
     uint8_t              sign_buf[2 * MAX_CURVE_BYTELEN] = {0};
-    uint8_t              point_bytes[BITS_TO_BYTES(521) * 2 + 1] = {0};
     size_t               r_blen, s_blen;
+    bool                 reusable = false;
 
     if (curve == NULL) {
         return RNP_ERROR_BAD_PARAMETERS;
@@ -123,24 +219,20 @@ pgp_sm2_verify_hash(const pgp_ecc_sig_t *   sign,
 
     const size_t sign_half_len = BITS_TO_BYTES(curve->bitlen);
 
-    if (!bn_num_bytes(pubkey->point, &r_blen) || (r_blen > sizeof(point_bytes)) ||
-        bn_bn2bin(pubkey->point, point_bytes) || (point_bytes[0] != 0x04)) {
-        RNP_LOG("Failed to load public key");
-        goto end;
-    }
-
-    if (botan_mp_init(&public_x) || botan_mp_init(&public_y) ||
-        botan_mp_from_bin(public_x, &point_bytes[1], sign_half_len) ||
-        botan_mp_from_bin(public_y, &point_bytes[1 + sign_half_len], sign_half_len)) {
-        goto end;
+    if (!pgp_pk_cache_key(
+          &pubkey->cache, PGP_PK_KEY_DEFAULT, false, sm2_load_pubkey, pubkey, NULL)) {
+        return RNP_ERROR_SIGNATURE_INVALID;
     }
 
-    if (botan_pubkey_load_sm2(&pub, public_x, public_y, curve->botan_name)) {
-        RNP_LOG("Failed to load public key");
-        goto end;
+    verifier = pgp_pk_cache_op(pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, "");
+    if (!verifier) {
+        return RNP_ERROR_SIGNATURE_INVALID;
     }
 
-    if (botan_pk_op_verify_create(&verifier, pub, "", 0)) {
+    if (!bn_num_bytes(sign->r, &r_blen) || (r_blen > sign_half_len) ||
+        !bn_num_bytes(sign->s, &s_blen) || (s_blen > sign_half_len) ||
+        (sign_half_len > MAX_CURVE_BYTELEN)) {
+        reusable = true;
         goto end;
     }
 
@@ -148,24 +240,17 @@ pgp_sm2_verify_hash(const pgp_ecc_sig_t *   sign,
         goto end;
     }
 
-    if (!bn_num_bytes(sign->r, &r_blen) || (r_blen > sign_half_len) ||
-        !bn_num_bytes(sign->s, &s_blen) || (s_blen > sign_half_len) ||
-        (sign_half_len > MAX_CURVE_BYTELEN)) {
-        goto end;
-    }
-
     bn_bn2bin(sign->r, &sign_buf[sign_half_len - r_blen]);
     bn_bn2bin(sign->s, &sign_buf[sign_half_len + sign_half_len - s_blen]);
 
     ret = botan_pk_op_verify_finish(verifier, sign_buf, sign_half_len * 2) ?
             RNP_ERROR_SIGNATURE_INVALID :
             RNP_SUCCESS;
+    reusable = true;
 
 end:
-    botan_mp_destroy(public_x);
-    botan_mp_destroy(public_y);
-    botan_pubkey_destroy(pub);
-    botan_pk_op_verify_destroy(verifier);
+    pgp_pk_cache_release(
+      pubkey->cache, PGP_PK_KEY_DEFAULT, PGP_PK_OP_VERIFY, "", verifier, reusable);
     return ret;
 }
 
@@ -181,23 +266,17 @@ pgp_sm2_encrypt(rng_t *                 rng,
     rnp_result_t retval = RNP_ERROR_GENERIC;
 
     const ec_curve_desc_t *curve = get_curve_desc(pubkey->curve);
-    botan_mp_t             public_x = NULL;
-    botan_mp_t             public_y = NULL;
-    botan_pubkey_t         sm2_key = NULL;
     botan_pk_op_encrypt_t  enc_op = NULL;
-    size_t                 sz;
-
-    const size_t point_len = BITS_TO_BYTES(curve->bitlen);
-    uint8_t      point_bytes[BITS_TO_BYTES(521) * 2 + 1] = {0};
-    size_t       hash_alg_len;
+    size_t                 hash_alg_len;
 
     if (curve == NULL) {
         return RNP_ERROR_GENERIC;
     }
+    const size_t point_len = BITS_TO_BYTES(curve->bitlen);
 
     if (!pgp_digest_length(hash_algo, &hash_alg_len)) {
         RNP_LOG("Unknown hash algorithm for SM2 encryption");
-        goto done;
+        return RNP_ERROR_GENERIC;
     }
 
     /*
@@ -208,29 +287,12 @@ pgp_sm2_encrypt(rng_t *                 rng,
 
     if (*out_len < ctext_len) {
         RNP_LOG("output buffer for SM2 encryption too short");
-        goto done;
-    }
-
-    if (!bn_num_bytes(pubkey->point, &sz) || (sz > sizeof(point_bytes)) ||
-        bn_bn2bin(pubkey->point, point_bytes) || (point_bytes[0] != 0x04)) {
-        RNP_LOG("Failed to load public key");
-        goto done;
-    }
-
-    if (botan_mp_init(&public_x) || botan_mp_init(&public_y) ||
-        botan_mp_from_bin(public_x, &point_bytes[1], point_len) ||
-        botan_mp_from_bin(public_y, &point_bytes[1 + point_len], point_len)) {
-        goto done;
-    }
-
-    const char *curve_name = curve->botan_name;
-    if (botan_pubkey_load_sm2_enc(&sm2_key, public_x, public_y, curve_name)) {
-        RNP_LOG("Failed to load public key");
-        goto done;
+        return RNP_ERROR_GENERIC;
     }
 
-    if (botan_pubkey_check_key(sm2_key, rng_handle(rng), 1) != 0) {
-        goto done;
+    if (!pgp_pk_cache_key(
+          &pubkey->cache, PGP_PK_KEY_SM2_ENC, false, sm2_load_enc_pubkey, pubkey, rng)) {
+        return RNP_ERROR_GENERIC;
     }
 
     /*
@@ -238,8 +300,10 @@ pgp_sm2_encrypt(rng_t *                 rng,
     it's an all in one scheme, only the hash (used for the integrity
     check) is specified.
     */
-    if (botan_pk_op_encrypt_create(&enc_op, sm2_key, pgp_hash_name_botan(hash_algo), 0) != 0) {
-        goto done;
+    const char *hash_name = pgp_hash_name_botan(hash_algo);
+    enc_op = pgp_pk_cache_op(pubkey->cache, PGP_PK_KEY_SM2_ENC, PGP_PK_OP_ENCRYPT, hash_name);
+    if (!enc_op) {
+        return RNP_ERROR_GENERIC;
     }
 
     if (botan_pk_op_encrypt(enc_op, rng_handle(rng), out, out_len, key, key_len) == 0) {
@@ -248,10 +312,8 @@ pgp_sm2_encrypt(rng_t *                 rng,
         retval = RNP_SUCCESS;
     }
 
-done:
-    botan_pk_op_encrypt_destroy(enc_op);
-    botan_pubkey_destroy(sm2_key);
-
+    pgp_pk_cache_release(
+      pubkey->cache, PGP_PK_KEY_SM2_ENC, PGP_PK_OP_ENCRYPT, hash_name, enc_op, true);
     return retval;
 }
 
@@ -264,17 +326,12 @@ pgp_sm2_decrypt(uint8_t *               out,
                 const pgp_ecc_pubkey_t *pubkey)
 {
     const ec_curve_desc_t *curve = get_curve_desc(pubkey->curve);
+    sm2_key_param_t        param = {.seckey = privkey, .pubkey = pubkey};
     botan_pk_op_decrypt_t  decrypt_op = NULL;
-    botan_privkey_t        key = NULL;
     rnp_result_t           retval = RNP_ERROR_GENERIC;
 
     if (curve == NULL || ctext_len < 64) {
-        goto done;
-    }
-
-    if (botan_privkey_load_sm2_enc(&key, privkey->x->mp, curve->botan_name)) {
-        RNP_LOG("Can't load private key");
-        goto done;
+        return RNP_ERROR_GENERIC;
     }
 
     const uint8_t hash_id = ctext[ctext_len - 1];
@@ -282,19 +339,25 @@ pgp_sm2_decrypt(uint8_t *               out,
     const char *hash_name = pgp_hash_name_botan(hash_id);
     if (!hash_name) {
         RNP_LOG("Unknown hash used in SM2 ciphertext");
-        goto done;
+        return RNP_ERROR_GENERIC;
+    }
+
+    if (!pgp_pk_cache_key(
+          &privkey->cache, PGP_PK_KEY_SM2_ENC, true, sm2_load_enc_seckey, &param, NULL)) {
+        return RNP_ERROR_GENERIC;
     }
 
-    if (botan_pk_op_decrypt_create(&decrypt_op, key, hash_name, 0) != 0) {
-        goto done;
+    decrypt_op =
+      pgp_pk_cache_op(privkey->cache, PGP_PK_KEY_SM2_ENC, PGP_PK_OP_DECRYPT, hash_name);
+    if (!decrypt_op) {
+        return RNP_ERROR_GENERIC;
     }
 
     if (botan_pk_op_decrypt(decrypt_op, out, out_len, ctext, ctext_len - 1) == 0) {
         retval = RNP_SUCCESS;
     }
 
-done:
-    botan_privkey_destroy(key);
-    botan_pk_op_decrypt_destroy(decrypt_op);
+    pgp_pk_cache_release(
+      privkey->cache, PGP_PK_KEY_SM2_ENC, PGP_PK_OP_DECRYPT, hash_name, decrypt_op, true);
     return retval;
 }
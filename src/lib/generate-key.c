@@ -89,15 +89,15 @@ load_generated_key(pgp_output_t **    output,
     if (key_store->keyc != 1) {
         goto end;
     }
-    memcpy(dst, &key_store->keys[0], sizeof(*dst));
+    memcpy(dst, key_store->keys[0], sizeof(*dst));
     // we don't want the key store to free the internal key data
-    rnp_key_store_remove_key(&io, key_store, &key_store->keys[0]);
+    rnp_key_store_remove_key(&io, key_store, key_store->keys[0]);
     ok = true;
 
 end:
     rnp_key_store_free(key_store);
     if (pubring) {
-        rnp_key_store_remove_key(&io, pubring, &pubring->keys[0]);
+        rnp_key_store_remove_key(&io, pubring, pubring->keys[0]);
         rnp_key_store_free(pubring);
     }
     pgp_teardown_memory_write(*output, *mem);
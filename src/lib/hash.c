@@ -303,12 +303,79 @@ pgp_hash_list_get(list hashes, pgp_hash_alg_t alg)
     return NULL;
 }
 
+/* maximum number of threads which update the same hash list */
+#define PGP_HASH_MAX_JOBS 8
+
+/* hashes of the list with index % step == first, updated by a single thread */
+typedef struct pgp_hash_list_job_t {
+    list           hashes;
+    const uint8_t *buf;
+    size_t         len;
+    unsigned       first;
+    unsigned       step;
+} pgp_hash_list_job_t;
+
+static void
+hash_list_update_job(void *param)
+{
+    pgp_hash_list_job_t *job = param;
+    size_t               blen;
+    unsigned             idx;
+
+    for (size_t pos = 0; pos < job->len; pos += blen) {
+        blen = job->len - pos < PGP_HASH_BLOCK_SIZE ? job->len - pos : PGP_HASH_BLOCK_SIZE;
+        idx = 0;
+        for (list_item *hash = list_front(job->hashes); hash; hash = list_next(hash), idx++) {
+            if (idx % job->step == job->first) {
+                pgp_hash_add((pgp_hash_t *) hash, job->buf + pos, blen);
+            }
+        }
+    }
+}
+
 void
 pgp_hash_list_update(list hashes, const void *buf, size_t len)
 {
-    for (list_item *hash = list_front(hashes); hash; hash = list_next(hash)) {
-        pgp_hash_add((pgp_hash_t *) hash, buf, len);
+    pgp_hash_list_job_t job = {.hashes = hashes, .buf = buf, .len = len, .step = 1};
+
+    switch (list_length(hashes)) {
+    case 0:
+        return;
+    case 1:
+        pgp_hash_add((pgp_hash_t *) list_front(hashes), buf, len);
+        return;
+    default:
+        hash_list_update_job(&job);
+    }
+}
+
+void
+pgp_hash_list_update_parallel(list               hashes,
+                              const void *       buf,
+                              size_t             len,
+                              pgp_thread_pool_t *pool)
+{
+    pgp_hash_list_job_t jobs[PGP_HASH_MAX_JOBS];
+    pgp_task_t          tasks[PGP_HASH_MAX_JOBS];
+    unsigned            jobc = list_length(hashes);
+
+    if (jobc > pgp_thread_pool_size(pool)) {
+        jobc = pgp_thread_pool_size(pool);
+    }
+    if (jobc > PGP_HASH_MAX_JOBS) {
+        jobc = PGP_HASH_MAX_JOBS;
+    }
+    if ((jobc < 2) || (len < PGP_HASH_PARALLEL_MIN)) {
+        pgp_hash_list_update(hashes, buf, len);
+        return;
+    }
+
+    for (unsigned i = 0; i < jobc; i++) {
+        jobs[i] = (pgp_hash_list_job_t){
+          .hashes = hashes, .buf = buf, .len = len, .first = i, .step = jobc};
+        tasks[i] = (pgp_task_t){.func = hash_list_update_job, .param = &jobs[i]};
     }
+    pgp_thread_pool_run(pool, tasks, jobc);
 }
 
 void
@@ -39,12 +39,20 @@
 #include "types.h"
 #include "utils.h"
 #include "list.h"
+#include "thread-pool.h"
 
 /**
  * Output size (in bytes) of biggest supported hash algo
  */
 #define PGP_MAX_HASH_SIZE BITS_TO_BYTES(512)
 
+/* Data is passed to the several hashes by blocks of this size, so it is read from memory once
+ * and the rest of hashes get it from the cache */
+#define PGP_HASH_BLOCK_SIZE 16384
+
+/* Minimum size of data for which different hashes are updated in parallel */
+#define PGP_HASH_PARALLEL_MIN 32768
+
 /* This is hot function, forces compiler to "inline" it
  * (linking fails if "inline" used)
  */
@@ -110,7 +118,8 @@ bool pgp_hash_list_add(list *hashes, pgp_hash_alg_t alg);
 const pgp_hash_t *pgp_hash_list_get(list hashes, pgp_hash_alg_t alg);
 
 /*
- * @brief Update list of hashes with the data
+ * @brief Update list of hashes with the data. Data is processed block by block, each block
+ *        is passed to all of the hashes before moving to the next one.
  *
  * @param hashes List of pgp_hash_t structures
  * @param buf buffer with data
@@ -118,6 +127,21 @@ const pgp_hash_t *pgp_hash_list_get(list hashes, pgp_hash_alg_t alg);
  **/
 void pgp_hash_list_update(list hashes, const void *buf, size_t len);
 
+/*
+ * @brief Update list of hashes with the data, spreading the hashes between threads of the
+ *        pool if there are several of them and data is large enough. Each thread passes data
+ *        to its hashes in a single pass, as pgp_hash_list_update() does.
+ *
+ * @param hashes List of pgp_hash_t structures
+ * @param buf buffer with data
+ * @param len number of bytes in the buffer
+ * @param pool thread pool or NULL
+ **/
+void pgp_hash_list_update_parallel(list               hashes,
+                                   const void *       buf,
+                                   size_t             len,
+                                   pgp_thread_pool_t *pool);
+
 /* @brief Free the list of hashes and deallocate all internal structures
  *
  * @param hashes List of pgp_hash_t structures
@@ -27,6 +27,7 @@
 #include "key-provider.h"
 #include "pgp-key.h"
 #include <rekey/rnp_key_store.h>
+#include <librekey/key_store_lazy.h>
 
 bool
 pgp_request_key(const pgp_key_provider_t *   provider,
@@ -45,28 +46,33 @@ rnp_key_provider_keyring(const pgp_key_request_ctx_t *ctx, pgp_key_t **key, void
     rnp_t *          rnp = (rnp_t *) userdata;
     pgp_key_t *      ks_key = NULL;
     rnp_key_store_t *ks;
-    unsigned         from = 0;
 
     *key = NULL;
     ks = ctx->secret ? rnp->secring : rnp->pubring;
 
+    /* lazy versions of the search functions parse keys from the offset index if needed */
     if (ctx->stype == PGP_KEY_SEARCH_KEYID) {
-        ks_key = rnp_key_store_get_key_by_id(rnp->io, ks, ctx->search.id, &from, NULL);
+        ks_key = rnp_key_store_lazy_get_key_by_id(rnp->io, ks, ctx->search.id);
         if (!ks_key && !ctx->secret) {
             /* searching for public key in secret keyring as well */
-            from = 0;
-            ks_key =
-              rnp_key_store_get_key_by_id(rnp->io, rnp->secring, ctx->search.id, &from, NULL);
+            ks_key = rnp_key_store_lazy_get_key_by_id(rnp->io, rnp->secring, ctx->search.id);
         }
     } else if (ctx->stype == PGP_KEY_SEARCH_GRIP) {
-        ks_key = rnp_key_store_get_key_by_grip(rnp->io, ks, ctx->search.grip);
+        ks_key = rnp_key_store_lazy_get_key_by_grip(rnp->io, ks, ctx->search.grip);
         if (!ks_key && !ctx->secret) {
-            ks_key = rnp_key_store_get_key_by_grip(rnp->io, rnp->secring, ctx->search.grip);
+            ks_key =
+              rnp_key_store_lazy_get_key_by_grip(rnp->io, rnp->secring, ctx->search.grip);
+        }
+    } else if (ctx->stype == PGP_KEY_SEARCH_INDEX) {
+        /* all of the keys must be parsed to enumerate them */
+        if (rnp_key_store_lazy_load_all(rnp->io, ks) && (ctx->search.index < ks->keyc)) {
+            ks_key = ks->keys[ctx->search.index];
         }
     } else if (ctx->stype == PGP_KEY_SEARCH_USERID) {
-        rnp_key_store_get_key_by_name(rnp->io, ks, ctx->search.userid, &ks_key);
+        rnp_key_store_lazy_get_key_by_name(rnp->io, ks, ctx->search.userid, &ks_key);
         if (!ks_key && !ctx->secret) {
-            rnp_key_store_get_key_by_name(rnp->io, rnp->secring, ctx->search.userid, &ks_key);
+            rnp_key_store_lazy_get_key_by_name(
+              rnp->io, rnp->secring, ctx->search.userid, &ks_key);
         }
     }
 
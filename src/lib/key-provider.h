@@ -35,7 +35,8 @@ typedef struct pgp_key_t pgp_key_t;
 typedef enum {
     PGP_KEY_SEARCH_KEYID,
     PGP_KEY_SEARCH_GRIP,
-    PGP_KEY_SEARCH_USERID
+    PGP_KEY_SEARCH_USERID,
+    PGP_KEY_SEARCH_INDEX /* n-th key of the keyring, used to enumerate all of the keys */
 } pgp_key_search_t;
 
 typedef struct pgp_key_request_ctx_t {
@@ -46,6 +47,7 @@ typedef struct pgp_key_request_ctx_t {
         uint8_t     id[PGP_KEY_ID_SIZE];
         uint8_t     grip[PGP_FINGERPRINT_SIZE];
         const char *userid;
+        size_t      index;
     } search;
 } pgp_key_request_ctx_t;
 
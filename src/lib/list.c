@@ -29,8 +29,9 @@
 #include "list.h"
 
 struct list_head {
-    list_item *first, *last;
-    size_t     length;
+    list_item *  first, *last;
+    size_t       length;
+    pgp_arena_t *arena; /* arena for the items, or NULL */
 };
 
 struct list_item {
@@ -50,6 +51,20 @@ get_data_ptr(list_item *item)
     return item ? (item + 1) : NULL;
 }
 
+bool
+list_init_arena(list *lst, pgp_arena_t *arena)
+{
+    if (!lst || !arena) {
+        return true;
+    }
+    if (!(*lst = pgp_arena_alloc(arena, sizeof(**lst)))) {
+        return false;
+    }
+    memset(*lst, 0, sizeof(**lst));
+    (*lst)->arena = arena;
+    return true;
+}
+
 size_t
 list_length(list head)
 {
@@ -72,7 +87,8 @@ list_do_insert(list *lst, list_item *where, const void *data, size_t data_size)
     }
     list head = *lst;
 
-    list_item *item = malloc(sizeof(*item) + data_size);
+    list_item *item = head->arena ? pgp_arena_alloc(head->arena, sizeof(*item) + data_size) :
+                                    malloc(sizeof(*item) + data_size);
     if (!item) {
         if (allocated_head) {
             free(*lst);
@@ -233,7 +249,9 @@ list_remove(list_item *item)
     if (item == head->last) {
         head->last = item->prev;
     }
-    free(item);
+    if (!head->arena) {
+        free(item);
+    }
     head->length--;
 }
 
@@ -243,7 +261,11 @@ list_destroy(list *lst)
     if (!lst || !*lst) {
         return;
     }
-    list       head = *lst;
+    list head = *lst;
+    *lst = NULL;
+    if (head->arena) {
+        return;
+    }
     list_item *item = head->first;
     while (item) {
         list_item *next = item->next;
@@ -251,5 +273,4 @@ list_destroy(list *lst)
         item = next;
     }
     free(head);
-    *lst = NULL;
 }
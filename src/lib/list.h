@@ -29,7 +29,9 @@
 #ifndef RNP_LIST_H
 #define RNP_LIST_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include "arena.h"
 
 /**
  *  @private
@@ -83,6 +85,18 @@ typedef struct list_head *list;
 typedef struct list_head  list_head;
 typedef struct list_item  list_item;
 
+/** @private
+ *  create the empty list, items of which are allocated from the arena. Items of such list
+ *  are not freed on removal, and list_destroy only forgets the list, memory is released
+ *  with the arena.
+ *
+ *  @param lst pointer to the list, which should be NULL
+ *  @param arena arena to allocate items from. If NULL, list is left as is and regular
+ *         allocations are used.
+ *  @return true on success or false if memory allocation failed
+ **/
+bool list_init_arena(list *lst, pgp_arena_t *arena);
+
 /** @private
  *  append data to the list
  *
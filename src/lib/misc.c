@@ -627,7 +627,8 @@ pgp_mem_writefile(pgp_memory_t *mem, const char *f)
     }
 
     fwrite(mem->buf, mem->length, 1, fp);
-    if (ferror(fp)) {
+    /* make sure that contents are on the disk before the rename */
+    if (ferror(fp) || fflush(fp) || fsync(fd)) {
         fprintf(stderr, "pgp_mem_writefile: can't write to file\n");
         fclose(fp);
         return false;
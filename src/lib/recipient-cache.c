@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "recipient-cache.h"
+#include "utils.h"
+
+typedef struct pgp_recipient_t {
+    uint8_t           keyid[PGP_KEY_ID_SIZE]; /* recipient key id of the session key */
+    pgp_fingerprint_t fp;                     /* fingerprint of the decrypting key */
+    uint64_t          used;                   /* 0 if slot is free, or last use stamp */
+} pgp_recipient_t;
+
+struct pgp_recipient_cache_t {
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_t lock;
+#endif
+    uint64_t        stamp; /* incremented on each use */
+    pgp_recipient_t recipients[PGP_RECIPIENT_CACHE_SIZE];
+};
+
+static void
+recipient_cache_lock(pgp_recipient_cache_t *cache)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_lock(&cache->lock);
+#endif
+}
+
+static void
+recipient_cache_unlock(pgp_recipient_cache_t *cache)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_unlock(&cache->lock);
+#endif
+}
+
+pgp_recipient_cache_t *
+pgp_recipient_cache_create(void)
+{
+    pgp_recipient_cache_t *cache = calloc(1, sizeof(*cache));
+
+    if (!cache) {
+        RNP_LOG("allocation failed");
+        return NULL;
+    }
+#ifdef HAVE_PTHREAD_H
+    if (pthread_mutex_init(&cache->lock, NULL)) {
+        free(cache);
+        return NULL;
+    }
+#endif
+    return cache;
+}
+
+void
+pgp_recipient_cache_destroy(pgp_recipient_cache_t *cache)
+{
+    if (!cache) {
+        return;
+    }
+#ifdef HAVE_PTHREAD_H
+    pthread_mutex_destroy(&cache->lock);
+#endif
+    free(cache);
+}
+
+/* must be called with cache->lock held */
+static pgp_recipient_t *
+recipient_cache_find(pgp_recipient_cache_t *   cache,
+                     const uint8_t *           keyid,
+                     const pgp_fingerprint_t *fp)
+{
+    for (size_t i = 0; i < PGP_RECIPIENT_CACHE_SIZE; i++) {
+        pgp_recipient_t *rcp = &cache->recipients[i];
+        if (rcp->used && (rcp->fp.length == fp->length) &&
+            !memcmp(rcp->keyid, keyid, PGP_KEY_ID_SIZE) &&
+            !memcmp(rcp->fp.fingerprint, fp->fingerprint, fp->length)) {
+            return rcp;
+        }
+    }
+    return NULL;
+}
+
+void
+pgp_recipient_cache_add(pgp_recipient_cache_t *  cache,
+                        const uint8_t *          keyid,
+                        const pgp_fingerprint_t *fp)
+{
+    pgp_recipient_t *rcp;
+
+    if (!cache || (fp->length > sizeof(fp->fingerprint))) {
+        return;
+    }
+
+    recipient_cache_lock(cache);
+    if (!(rcp = recipient_cache_find(cache, keyid, fp))) {
+        /* free or the least recently used slot */
+        rcp = &cache->recipients[0];
+        for (size_t i = 1; (i < PGP_RECIPIENT_CACHE_SIZE) && rcp->used; i++) {
+            if (cache->recipients[i].used < rcp->used) {
+                rcp = &cache->recipients[i];
+            }
+        }
+        memcpy(rcp->keyid, keyid, PGP_KEY_ID_SIZE);
+        rcp->fp = *fp;
+    }
+    rcp->used = ++cache->stamp;
+    recipient_cache_unlock(cache);
+}
+
+bool
+pgp_recipient_cache_check(pgp_recipient_cache_t *  cache,
+                          const uint8_t *          keyid,
+                          const pgp_fingerprint_t *fp)
+{
+    pgp_recipient_t *rcp;
+
+    if (!cache || (fp->length > sizeof(fp->fingerprint))) {
+        return false;
+    }
+
+    recipient_cache_lock(cache);
+    if ((rcp = recipient_cache_find(cache, keyid, fp))) {
+        rcp->used = ++cache->stamp;
+    }
+    recipient_cache_unlock(cache);
+    return rcp != NULL;
+}
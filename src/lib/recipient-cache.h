@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** Cache of the secret keys which decrypted session keys
+ *  @file
+ */
+#ifndef RNP_RECIPIENT_CACHE_H_
+#define RNP_RECIPIENT_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+
+/* maximum number of the remembered recipients */
+#define PGP_RECIPIENT_CACHE_SIZE 64
+
+/**
+ *  @private
+ *  Public-key encrypted session key may have the wildcard key id, or message may be encrypted
+ *  to several of our keys, so a few private key operations may be needed to find the right
+ *  key. Cache remembers which secret key, identified by the fingerprint, decrypted the session
+ *  key with the given recipient key id, so it is tried first next time. Least recently used
+ *  entry is replaced when cache is full. Functions are thread-safe.
+ *
+ *  @code
+ *  pgp_recipient_cache_t *cache = pgp_recipient_cache_create();
+ *  if (pgp_recipient_cache_check(cache, sesskey->key_id, &key->fingerprint)) {
+ *      // try this key first
+ *  }
+ *  // after successful decryption
+ *  pgp_recipient_cache_add(cache, sesskey->key_id, &key->fingerprint);
+ *  pgp_recipient_cache_destroy(cache);
+ *  @endcode
+ */
+
+typedef struct pgp_recipient_cache_t pgp_recipient_cache_t;
+
+/** @private
+ *  create the cache
+ *
+ *  @return cache or NULL if allocation failed
+ **/
+pgp_recipient_cache_t *pgp_recipient_cache_create(void);
+
+/** @private
+ *  destroy the cache. Must not be called while cache is in use by other threads.
+ *
+ *  @param cache cache or NULL
+ **/
+void pgp_recipient_cache_destroy(pgp_recipient_cache_t *cache);
+
+/** @private
+ *  remember that key decrypted the session key for the recipient
+ *
+ *  @param cache cache or NULL
+ *  @param keyid recipient key id from the session key packet, all zeroes for the wildcard
+ *  @param fp fingerprint of the secret key
+ **/
+void pgp_recipient_cache_add(pgp_recipient_cache_t *  cache,
+                             const uint8_t *          keyid,
+                             const pgp_fingerprint_t *fp);
+
+/** @private
+ *  check whether key decrypted the session key for the recipient before
+ *
+ *  @param cache cache or NULL
+ *  @param keyid recipient key id from the session key packet
+ *  @param fp fingerprint of the secret key
+ *  @return true if key is in the cache for the recipient, false otherwise
+ **/
+bool pgp_recipient_cache_check(pgp_recipient_cache_t *  cache,
+                               const uint8_t *          keyid,
+                               const pgp_fingerprint_t *fp);
+
+#endif
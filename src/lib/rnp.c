@@ -77,6 +77,8 @@ __RCSID("$NetBSD: rnp.c,v 1.98 2016/06/28 16:34:40 christos Exp $");
 #include <rnp/rnp_def.h>
 #include <rnp/rnp_sdk.h>
 #include <rekey/rnp_key_store.h>
+#include <librekey/key_store_lazy.h>
+#include <librekey/key_store_import.h>
 
 #include "pass-provider.h"
 #include "key-provider.h"
@@ -97,6 +99,7 @@ __RCSID("$NetBSD: rnp.c,v 1.98 2016/06/28 16:34:40 christos Exp $");
 #include <rnp/rnp_def.h>
 #include "pgp-key.h"
 #include "list.h"
+#include "thread-pool.h"
 #include <librepgp/stream-armor.h>
 #include <librepgp/stream-parse.h>
 #include <librepgp/stream-write.h>
@@ -626,6 +629,13 @@ rnp_init(rnp_t *rnp, const rnp_params_t *params)
             fputs("rnp: can't create empty secring keystore\n", io->errs);
             return RNP_ERROR_BAD_PARAMETERS;
         }
+
+        rnp->pubring->lazy_load = params->lazy_keyring;
+        rnp->secring->lazy_load = params->lazy_keyring;
+        rnp->pubring->incremental = params->incremental_keyring;
+        rnp->secring->incremental = params->incremental_keyring;
+        rnp->pubring->load_threads = params->keyring_threads;
+        rnp->secring->load_threads = params->keyring_threads;
     }
 
     // Lazy mode can't fail
@@ -697,6 +707,20 @@ rnp_ctx_rng_handle(const rnp_ctx_t *ctx)
     return ctx->rng;
 }
 
+/* get the thread pool of the context, NULL means that everything runs on the caller's
+ * thread */
+void *
+rnp_ctx_thread_pool(rnp_ctx_t *ctx)
+{
+    if (!ctx || (ctx->threads < 2)) {
+        return NULL;
+    }
+    if (!ctx->pool) {
+        ctx->pool = pgp_thread_pool_create(ctx->threads);
+    }
+    return ctx->pool;
+}
+
 void
 rnp_ctx_reset(rnp_ctx_t *ctx)
 {
@@ -710,6 +734,9 @@ rnp_ctx_free(rnp_ctx_t *ctx)
 {
     free(ctx->filename);
     list_destroy(&ctx->recipients);
+    list_destroy(&ctx->signers);
+    pgp_thread_pool_destroy(ctx->pool);
+    ctx->pool = NULL;
 }
 
 /* list the keys in a keyring */
@@ -927,115 +954,59 @@ rnp_export_key(rnp_t *rnp, const char *name)
     return pgp_export_key(io, key, &rnp->password_provider);
 }
 
-#define IMPORT_ARMOR_HEAD "-----BEGIN PGP (PUBLIC)|(PRIVATE) KEY BLOCK-----"
-
-/* import a key into our keyring */
-int
-rnp_import_key(rnp_t *rnp, char *f)
+/* print the key which is about to be imported */
+static void
+import_print_key(const rnp_key_store_t *store, const pgp_key_t *key, void *param)
 {
-    int              realarmor;
-    rnp_key_store_t *tmp_keystore = NULL;
-    bool             ret = false;
-    list             imported_grips = NULL;
-    list_item *      item = NULL;
-
-    realarmor = isarmored(f, NULL, IMPORT_ARMOR_HEAD);
-    if (realarmor < 0) {
-        goto done;
-    }
-
-    // guess the key format (TODO: surely this can be improved)
-    size_t fname_len = strlen(f);
-    if (fname_len < 4) {
-        goto done;
-    }
-    const char *suffix = f + fname_len - 4;
-    const char *fmt = NULL;
-    if (strcmp(suffix, ".asc") == 0 || strcmp(suffix, ".gpg") == 0) {
-        fmt = RNP_KEYSTORE_GPG;
-    } else if (strcmp(suffix, ".kbx") == 0) {
-        fmt = RNP_KEYSTORE_KBX;
-    } else if (strcmp(suffix, ".key") == 0) {
-        fmt = RNP_KEYSTORE_G10;
-    } else {
-        RNP_LOG("Warning: failed to guess key format, assuming GPG.");
-        fmt = RNP_KEYSTORE_GPG;
-    }
-
-    // create a temporary key store
-    tmp_keystore = rnp_key_store_new(fmt, f);
-    if (!tmp_keystore) {
-        goto done;
-    }
-
-    // load the key(s)
-    if (!rnp_key_store_load_from_file(rnp->io, tmp_keystore, realarmor, rnp->pubring)) {
-        RNP_LOG("failed to load key from file %s", f);
-        goto done;
-    }
-    if (!tmp_keystore->keyc) {
-        RNP_LOG("failed to load any keys to import");
-        goto done;
-    }
-
-    // loop through each key
-    for (unsigned i = 0; i < tmp_keystore->keyc; i++) {
-        pgp_key_t *      key = &tmp_keystore->keys[i];
-        pgp_key_t *      importedkey = NULL;
-        rnp_key_store_t *dest = pgp_is_key_secret(key) ? rnp->secring : rnp->pubring;
-        const char *     header = pgp_is_key_secret(key) ? "sec" : "pub";
-
-        // check if it already exists
-        importedkey = rnp_key_store_get_key_by_grip(rnp->io, dest, key->grip);
-        if (!importedkey) {
-            // print it out
-            repgp_print_key(rnp->io, tmp_keystore, key, header, pgp_get_pubkey(key), 0);
-
-            // add it to the dest store
-            if (!rnp_key_store_add_key(rnp->io, dest, key)) {
-                RNP_LOG("failed to add key to destination key store");
-                goto done;
-            }
-            // keep track of what keys have been imported
-            list_append(&imported_grips, key->grip, sizeof(key->grip));
-            importedkey = rnp_key_store_get_key_by_grip(rnp->io, dest, key->grip);
-            for (unsigned j = 0; j < key->subkeyc; j++) {
-                pgp_key_t *subkey = key->subkeys[j];
-
-                if (!rnp_key_store_add_key(rnp->io, dest, subkey)) {
-                    RNP_LOG("failed to add key to destination key store");
-                    goto done;
-                }
-                // fix up the subkeys dynarray pointers...
-                importedkey->subkeys[j] =
-                  rnp_key_store_get_key_by_grip(rnp->io, dest, subkey->grip);
-                // keep track of what keys have been imported
-                list_append(&imported_grips, subkey->grip, sizeof(subkey->grip));
-            }
-        }
-    }
+    rnp_t *rnp = param;
+
+    repgp_print_key(rnp->io,
+                    store,
+                    key,
+                    pgp_is_key_secret(key) ? "sec" : "pub",
+                    pgp_get_pubkey(key),
+                    0);
+}
 
-    // update the keyrings on disk
-    if (!rnp_key_store_write_to_file(rnp->io, rnp->secring, 0) ||
-        !rnp_key_store_write_to_file(rnp->io, rnp->pubring, 0)) {
+/* import keys from the files and directories into our keyrings, saving them once */
+bool
+rnp_import_keys(rnp_t *rnp, char *const files[], size_t count, unsigned threads)
+{
+    pgp_thread_pool_t *    pool = pgp_thread_pool_create(threads);
+    rnp_key_import_stats_t stats = {0};
+    bool                   ret;
+
+    ret = rnp_key_store_import_files(rnp->io,
+                                     rnp->pubring,
+                                     rnp->secring,
+                                     (const char *const *) files,
+                                     count,
+                                     pool,
+                                     import_print_key,
+                                     rnp,
+                                     &stats);
+    pgp_thread_pool_destroy(pool);
+
+    if (stats.imported && (!rnp_key_store_write_to_file(rnp->io, rnp->secring, 0) ||
+                           !rnp_key_store_write_to_file(rnp->io, rnp->pubring, 0))) {
         RNP_LOG("failed to write keyring");
-        goto done;
+        return false;
     }
-    ret = true;
+    if (rnp_get_debug(__FILE__)) {
+        RNP_LOG("%zu files, %zu failed, %zu keys, %zu imported",
+                stats.files,
+                stats.failed,
+                stats.keys,
+                stats.imported);
+    }
+    return ret && !stats.failed && stats.files;
+}
 
-done:
-    // remove all the imported keys from the temporary store,
-    // since we're taking ownership of their internal data
-    item = list_front(imported_grips);
-    while (item) {
-        uint8_t *grip = (uint8_t *) item;
-        rnp_key_store_remove_key(
-          rnp->io, tmp_keystore, rnp_key_store_get_key_by_grip(rnp->io, tmp_keystore, grip));
-        item = list_next(item);
-    }
-    list_destroy(&imported_grips);
-    rnp_key_store_free(tmp_keystore);
-    return ret;
+/* import a key into our keyring */
+int
+rnp_import_key(rnp_t *rnp, char *f)
+{
+    return rnp_import_keys(rnp, &f, 1, 1);
 }
 
 int
@@ -1279,7 +1250,13 @@ rnp_initialize_output(rnp_ctx_t *ctx, pgp_dest_t *dst, const char *out)
             return false;
         }
 
-        return init_file_dest(dst, newname, false) == RNP_SUCCESS;
+        if (init_file_dest(dst, newname, false)) {
+            return false;
+        }
+        if (ctx->directio && !file_dest_set_direct(dst)) {
+            RNP_LOG("direct I/O is not available for '%s'", newname);
+        }
+        return true;
     } else {
         return init_stdout_dest(dst) == RNP_SUCCESS;
     }
@@ -1433,6 +1410,10 @@ rnp_encrypt_stream(rnp_ctx_t *ctx, const char *in, const char *out)
 
 finish:
     src_close(&src);
+    if (result == RNP_SUCCESS) {
+        /* buffered output is written only here */
+        result = dst_finish(&dst);
+    }
     dst_close(&dst, result != RNP_SUCCESS);
     free(handler);
     return result;
@@ -1468,6 +1449,9 @@ rnp_armor_stream(rnp_ctx_t *ctx, bool armor, const char *in, const char *out)
         result = rnp_dearmor_source(&src, &dst);
     }
 
+    if (result == RNP_SUCCESS) {
+        result = dst_finish(&dst);
+    }
     if (result != RNP_SUCCESS) {
         RNP_LOG("error code 0x%x", result);
     }
@@ -1477,6 +1461,63 @@ rnp_armor_stream(rnp_ctx_t *ctx, bool armor, const char *in, const char *out)
     return result;
 }
 
+/* sign a file with the streamed signer, if out is NULL then name is derived from the input */
+static rnp_result_t
+rnp_sign_stream(rnp_ctx_t *ctx, const pgp_seckey_t *seckey, const char *in, const char *out)
+{
+    pgp_source_t        src;
+    pgp_dest_t          dst;
+    pgp_write_handler_t handler = {0};
+    rnp_result_t        result;
+    list_item *         signer;
+    char                outname[PATH_MAX];
+
+    if (!out) {
+        const char *suffix =
+          ctx->armor || ctx->clearsign ? "asc" : (ctx->detached ? "sig" : "gpg");
+        if (snprintf(outname, sizeof(outname), "%s.%s", in, suffix) >= (int) sizeof(outname)) {
+            RNP_LOG("too long output file name");
+            return RNP_ERROR_BAD_PARAMETERS;
+        }
+        out = outname;
+    }
+
+    if (!rnp_initialize_input(ctx, &src, in)) {
+        RNP_LOG("failed to initialize reading");
+        return RNP_ERROR_READ;
+    }
+
+    if (!rnp_initialize_output(ctx, &dst, out)) {
+        RNP_LOG("failed to initialize writing");
+        src_close(&src);
+        return RNP_ERROR_WRITE;
+    }
+
+    if (!(signer = list_append(&ctx->signers, &seckey, sizeof(seckey)))) {
+        result = RNP_ERROR_OUT_OF_MEMORY;
+        goto finish;
+    }
+
+    handler.password_provider = &ctx->rnp->password_provider;
+    handler.ctx = ctx;
+
+    result = rnp_sign_src(&handler, &src, &dst);
+    if (result != RNP_SUCCESS) {
+        RNP_LOG("failed with error code 0x%x", (int) result);
+    }
+    /* seckey may be freed by the caller */
+    list_remove(signer);
+
+finish:
+    src_close(&src);
+    if (result == RNP_SUCCESS) {
+        /* buffered output is written only here */
+        result = dst_finish(&dst);
+    }
+    dst_close(&dst, result != RNP_SUCCESS);
+    return result;
+}
+
 /* sign a file */
 rnp_result_t
 rnp_sign_file(rnp_ctx_t * ctx,
@@ -1492,7 +1533,7 @@ rnp_sign_file(rnp_ctx_t * ctx,
     pgp_seckey_t *      decrypted_seckey = NULL;
     pgp_io_t *          io;
     int                 attempts;
-    bool                ret;
+    rnp_result_t        ret;
     int                 i;
 
     io = ctx->rnp->io;
@@ -1547,7 +1588,7 @@ rnp_sign_file(rnp_ctx_t * ctx,
                 seckey = &keypair->key.seckey;
             }
         } else {
-            seckey = &((rnp_key_store_t *) ctx->rnp->secring)->keys[0].key.seckey;
+            seckey = &((rnp_key_store_t *) ctx->rnp->secring)->keys[0]->key.seckey;
         }
     }
     if (!seckey) {
@@ -1555,17 +1596,15 @@ rnp_sign_file(rnp_ctx_t * ctx,
         return RNP_ERROR_GENERIC;
     }
     /* sign file */
-    if (detached) {
-        ret = pgp_sign_detached(ctx, io, f, out, seckey);
-    } else {
-        ret = pgp_sign_file(ctx, io, f, out, seckey, cleartext);
-    }
+    ctx->clearsign = cleartext;
+    ctx->detached = detached && !cleartext;
+    ret = rnp_sign_stream(ctx, seckey, f, out);
 
     if (decrypted_seckey) {
         pgp_seckey_free(decrypted_seckey);
         free(decrypted_seckey);
     }
-    return ret ? RNP_SUCCESS : RNP_ERROR_GENERIC;
+    return ret;
 }
 
 #define ARMOR_SIG_HEAD "-----BEGIN PGP (SIGNATURE|SIGNED MESSAGE|MESSAGE)-----"
@@ -1681,7 +1720,7 @@ rnp_sign_memory(rnp_ctx_t * ctx,
             }
 
         } else {
-            seckey = &((rnp_key_store_t *) ctx->rnp->secring)->keys[0].key.seckey;
+            seckey = &((rnp_key_store_t *) ctx->rnp->secring)->keys[0]->key.seckey;
         }
     }
     if (!seckey) {
@@ -29,13 +29,17 @@
 #include "list.h"
 #include "crypto.h"
 #include "crypto/s2k.h"
+#include "crypto/s2k_cache.h"
 #include "crypto/rng.h"
+#include "recipient-cache.h"
 #include "signature.h"
 #include "pgp-key.h"
 #include <librepgp/validate.h>
 #include <librepgp/stream-common.h>
 #include <librepgp/stream-write.h>
 #include <librepgp/stream-parse.h>
+#include <librekey/key_store_lazy.h>
+#include <librekey/key_store_import.h>
 #include "hash.h"
 #include <rnp/rnp_types.h>
 #include <stdlib.h>
@@ -68,14 +72,17 @@ struct rnp_key_handle_st {
 };
 
 struct rnp_ffi_st {
-    pgp_io_t        io;
-    rnp_keyring_t   pubring;
-    rnp_keyring_t   secring;
-    rnp_get_key_cb  getkeycb;
-    void *          getkeycb_ctx;
-    rnp_password_cb getpasscb;
-    void *          getpasscb_ctx;
-    rng_t           rng;
+    pgp_io_t               io;
+    rnp_keyring_t          pubring;
+    rnp_keyring_t          secring;
+    rnp_get_key_cb         getkeycb;
+    void *                 getkeycb_ctx;
+    rnp_password_cb        getpasscb;
+    void *                 getpasscb_ctx;
+    rng_t                  rng;
+    pgp_s2k_cache_t *      s2k_cache; /* keys derived from passwords during decryption */
+    pgp_recipient_cache_t *rcp_cache; /* keys which decrypted session keys */
+    pgp_arena_t            arena;     /* message parsing state, reused between messages */
 };
 
 struct rnp_input_st {
@@ -124,6 +131,8 @@ rnp_ctx_init_ffi(rnp_ctx_t *ctx, rnp_ffi_t ffi)
     memset(ctx, 0, sizeof(*ctx));
     ctx->rng = &ffi->rng;
     ctx->ealg = PGP_SA_DEFAULT_CIPHER;
+    ctx->s2k_cache = ffi->s2k_cache;
+    ctx->rcp_cache = ffi->rcp_cache;
 }
 
 rnp_result_t
@@ -156,6 +165,11 @@ rnp_ffi_create(rnp_ffi_t *ffi, const char *pub_format, const char *sec_format)
         ret = RNP_ERROR_RNG;
         goto done;
     }
+    if (!(ob->rcp_cache = pgp_recipient_cache_create())) {
+        ret = RNP_ERROR_OUT_OF_MEMORY;
+        goto done;
+    }
+    pgp_arena_init(&ob->arena);
 
     ret = RNP_SUCCESS;
 done:
@@ -198,6 +212,9 @@ rnp_ffi_destroy(rnp_ffi_t ffi)
         rnp_keyring_destroy(ffi->pubring);
         rnp_keyring_destroy(ffi->secring);
         rng_destroy(&ffi->rng);
+        pgp_s2k_cache_destroy(ffi->s2k_cache);
+        pgp_recipient_cache_destroy(ffi->rcp_cache);
+        pgp_arena_destroy(&ffi->arena);
         free(ffi);
     }
     return RNP_SUCCESS;
@@ -279,6 +296,20 @@ rnp_ffi_set_pass_provider(rnp_ffi_t ffi, rnp_password_cb getpasscb, void *getpas
     return RNP_SUCCESS;
 }
 
+rnp_result_t
+rnp_ffi_set_s2k_cache_expiry(rnp_ffi_t ffi, unsigned seconds)
+{
+    if (!ffi) {
+        return RNP_ERROR_NULL_POINTER;
+    }
+    pgp_s2k_cache_destroy(ffi->s2k_cache);
+    ffi->s2k_cache = NULL;
+    if (seconds && !(ffi->s2k_cache = pgp_s2k_cache_create(seconds))) {
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
+    return RNP_SUCCESS;
+}
+
 static const char *
 operation_description(uint8_t op)
 {
@@ -631,8 +662,8 @@ rnp_keyring_get_key_count(rnp_keyring_t ring, size_t *count)
     return RNP_SUCCESS;
 }
 
-rnp_result_t
-rnp_keyring_load_from_path(rnp_keyring_t ring, const char *path)
+static rnp_result_t
+keyring_load_from_path(rnp_keyring_t ring, const char *path, bool lazy)
 {
     // checks
     if (!ring || !ring->store || !path) {
@@ -645,7 +676,10 @@ rnp_keyring_load_from_path(rnp_keyring_t ring, const char *path)
         ring->store->path = oldpath;
         return RNP_ERROR_OUT_OF_MEMORY;
     }
-    if (!rnp_key_store_load_from_file(&ring->ffi->io, ring->store, 0, NULL)) {
+    ring->store->lazy_load = lazy;
+    bool loaded = rnp_key_store_load_from_file(&ring->ffi->io, ring->store, 0, NULL);
+    ring->store->lazy_load = false;
+    if (!loaded) {
         free((void *) ring->store->path);
         ring->store->path = oldpath;
         return RNP_ERROR_GENERIC;
@@ -654,6 +688,18 @@ rnp_keyring_load_from_path(rnp_keyring_t ring, const char *path)
     return RNP_SUCCESS;
 }
 
+rnp_result_t
+rnp_keyring_load_from_path(rnp_keyring_t ring, const char *path)
+{
+    return keyring_load_from_path(ring, path, false);
+}
+
+rnp_result_t
+rnp_keyring_load_from_path_lazy(rnp_keyring_t ring, const char *path)
+{
+    return keyring_load_from_path(ring, path, true);
+}
+
 rnp_result_t
 rnp_keyring_load_from_memory(rnp_keyring_t ring, const uint8_t buf[], size_t buf_len)
 {
@@ -678,6 +724,51 @@ done:
     return ret;
 }
 
+rnp_result_t
+rnp_import_keys_from_paths(rnp_ffi_t    ffi,
+                           const char * paths[],
+                           size_t       count,
+                           size_t       threads,
+                           size_t *     imported,
+                           size_t *     failed)
+{
+    pgp_thread_pool_t *    pool = NULL;
+    rnp_key_import_stats_t stats = {0};
+    bool                   res;
+
+    // checks
+    if (!ffi || !paths) {
+        return RNP_ERROR_NULL_POINTER;
+    }
+    if (!ffi->pubring->store || !ffi->secring->store) {
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!paths[i]) {
+            return RNP_ERROR_NULL_POINTER;
+        }
+    }
+
+    pool = pgp_thread_pool_create(threads > UINT_MAX ? UINT_MAX : (unsigned) threads);
+    res = rnp_key_store_import_files(&ffi->io,
+                                     ffi->pubring->store,
+                                     ffi->secring->store,
+                                     paths,
+                                     count,
+                                     pool,
+                                     NULL,
+                                     NULL,
+                                     &stats);
+    pgp_thread_pool_destroy(pool);
+    if (imported) {
+        *imported = stats.imported;
+    }
+    if (failed) {
+        *failed = stats.failed;
+    }
+    return res ? RNP_SUCCESS : RNP_ERROR_GENERIC;
+}
+
 rnp_result_t
 rnp_keyring_save_to_path(rnp_keyring_t ring, const char *path)
 {
@@ -761,7 +852,26 @@ rnp_input_from_memory(rnp_input_t *input, const uint8_t buf[], size_t buf_len)
     if (!buf_len) {
         return RNP_ERROR_BAD_PARAMETERS;
     }
-    return RNP_ERROR_NOT_IMPLEMENTED;
+    *input = calloc(1, sizeof(**input));
+    if (!*input) {
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
+    // memory source takes ownership of the buffer, so it is copied
+    uint8_t *copy = malloc(buf_len);
+    if (!copy) {
+        free(*input);
+        *input = NULL;
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
+    memcpy(copy, buf, buf_len);
+    rnp_result_t ret = init_mem_src(&(*input)->src, copy, buf_len);
+    if (ret) {
+        free(copy);
+        free(*input);
+        *input = NULL;
+        return ret;
+    }
+    return RNP_SUCCESS;
 }
 
 static ssize_t
@@ -912,8 +1022,8 @@ rnp_op_encrypt_create(rnp_op_encrypt_t *op,
                       rnp_input_t       input,
                       rnp_output_t      output)
 {
-    // checks
-    if (!op || !ffi || !input || !output) {
+    // checks, input and output may be omitted for the batch operation
+    if (!op || !ffi || (!input != !output)) {
         return RNP_ERROR_NULL_POINTER;
     }
 
@@ -1085,10 +1195,64 @@ rnp_op_encrypt_execute(rnp_op_encrypt_t op)
     return ret;
 }
 
+rnp_result_t
+rnp_op_encrypt_execute_batch(rnp_op_encrypt_t op,
+                             rnp_input_t      inputs[],
+                             rnp_output_t     outputs[],
+                             size_t           count,
+                             size_t           threads,
+                             rnp_result_t     results[])
+{
+    pgp_encrypt_item_t *items = NULL;
+    rnp_result_t        ret;
+
+    // checks
+    if (!op || ((!inputs || !outputs || !results) && count)) {
+        return RNP_ERROR_NULL_POINTER;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!inputs[i] || !outputs[i]) {
+            return RNP_ERROR_NULL_POINTER;
+        }
+    }
+    if (!count) {
+        return RNP_SUCCESS;
+    }
+
+    items = calloc(count, sizeof(*items));
+    if (!items) {
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t i = 0; i < count; i++) {
+        items[i].src = &inputs[i]->src;
+        items[i].dst = &outputs[i]->dst;
+    }
+
+    op->rnpctx.threads = threads;
+    pgp_write_handler_t handler = {
+      .ctx = &op->rnpctx,
+      .key_provider =
+        &(pgp_key_provider_t){.callback = key_provider_bounce, .userdata = op->ffi},
+    };
+    ret = rnp_encrypt_batch(&handler, items, count);
+    for (size_t i = 0; i < count; i++) {
+        results[i] = ret == RNP_SUCCESS ? items[i].result : ret;
+        outputs[i]->keep = results[i] == RNP_SUCCESS;
+    }
+
+    free(items);
+    return ret;
+}
+
 rnp_result_t
 rnp_op_encrypt_destroy(rnp_op_encrypt_t op)
 {
     if (op) {
+        for (list_item *pi = list_front(op->rnpctx.passwords); pi; pi = list_next(pi)) {
+            pgp_forget(pi, sizeof(rnp_symmetric_pass_info_t));
+        }
+        list_destroy(&op->rnpctx.passwords);
+        rnp_ctx_free(&op->rnpctx);
         free(op);
     }
     return RNP_SUCCESS;
@@ -1103,14 +1267,20 @@ key_provider_bounce(const pgp_key_request_ctx_t *ctx, pgp_key_t **key, void *use
     switch (ctx->stype) {
     case PGP_KEY_SEARCH_USERID:
         // TODO: this isn't really a userid search...
-        rnp_key_store_get_key_by_name(&ffi->io, ring->store, ctx->search.userid, key);
+        rnp_key_store_lazy_get_key_by_name(&ffi->io, ring->store, ctx->search.userid, key);
         break;
     case PGP_KEY_SEARCH_KEYID: {
-        unsigned from = 0;
-        *key = rnp_key_store_get_key_by_id(&ffi->io, ring->store, ctx->search.id, &from, NULL);
+        *key = rnp_key_store_lazy_get_key_by_id(&ffi->io, ring->store, ctx->search.id);
     } break;
     case PGP_KEY_SEARCH_GRIP: {
-        *key = rnp_key_store_get_key_by_grip(&ffi->io, ring->store, ctx->search.grip);
+        *key = rnp_key_store_lazy_get_key_by_grip(&ffi->io, ring->store, ctx->search.grip);
+    } break;
+    case PGP_KEY_SEARCH_INDEX: {
+        // all of the keys must be parsed to enumerate them
+        if (rnp_key_store_lazy_load_all(&ffi->io, ring->store) &&
+            (ctx->search.index < ring->store->keyc)) {
+            *key = ring->store->keys[ctx->search.index];
+        }
     } break;
     default:
         // should never happen
@@ -1148,7 +1318,8 @@ rnp_decrypt(rnp_ffi_t ffi, rnp_input_t input, rnp_output_t output)
       .key_provider = &(pgp_key_provider_t){.callback = key_provider_bounce, .userdata = ffi},
       .dest_provider = dest_provider,
       .param = output,
-      .ctx = &rnpctx};
+      .ctx = &rnpctx,
+      .arena = &ffi->arena};
 
     rnp_result_t ret = process_pgp_source(&handler, &input->src);
     if (ret == RNP_SUCCESS) {
@@ -1160,6 +1331,58 @@ rnp_decrypt(rnp_ffi_t ffi, rnp_input_t input, rnp_output_t output)
     return ret;
 }
 
+rnp_result_t
+rnp_verify_detached_batch(rnp_ffi_t    ffi,
+                          rnp_input_t  data[],
+                          rnp_input_t  signatures[],
+                          size_t       count,
+                          size_t       threads,
+                          rnp_result_t results[])
+{
+    rnp_ctx_t            rnpctx;
+    pgp_detached_item_t *items = NULL;
+    rnp_result_t         ret;
+
+    // checks
+    if (!ffi || ((!data || !signatures || !results) && count)) {
+        return RNP_ERROR_NULL_POINTER;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!data[i] || !signatures[i]) {
+            return RNP_ERROR_NULL_POINTER;
+        }
+    }
+    if (!count) {
+        return RNP_SUCCESS;
+    }
+
+    items = calloc(count, sizeof(*items));
+    if (!items) {
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
+    for (size_t i = 0; i < count; i++) {
+        items[i].data = &data[i]->src;
+        items[i].sig = &signatures[i]->src;
+    }
+
+    rnp_ctx_init_ffi(&rnpctx, ffi);
+    rnpctx.threads = threads;
+    pgp_parse_handler_t handler = {
+      .key_provider = &(pgp_key_provider_t){.callback = key_provider_bounce, .userdata = ffi},
+      .ctx = &rnpctx};
+
+    ret = process_pgp_detached_batch(&handler, items, count);
+    if (ret == RNP_SUCCESS) {
+        for (size_t i = 0; i < count; i++) {
+            results[i] = items[i].result;
+        }
+    }
+
+    rnp_ctx_free(&rnpctx);
+    free(items);
+    return ret;
+}
+
 static bool
 parse_identifier_type(const char *type, pgp_key_search_t *value)
 {
@@ -1223,14 +1446,13 @@ find_key_by_locator(pgp_io_t *io, rnp_key_store_t *store, key_locator_t *locator
     switch (locator->type) {
     case PGP_KEY_SEARCH_USERID:
         // TODO: this isn't really a userid search...
-        rnp_key_store_get_key_by_name(io, store, locator->id.userid, &key);
+        rnp_key_store_lazy_get_key_by_name(io, store, locator->id.userid, &key);
         break;
     case PGP_KEY_SEARCH_KEYID: {
-        unsigned from = 0;
-        key = rnp_key_store_get_key_by_id(io, store, locator->id.keyid, &from, NULL);
+        key = rnp_key_store_lazy_get_key_by_id(io, store, locator->id.keyid);
     } break;
     case PGP_KEY_SEARCH_GRIP: {
-        key = rnp_key_store_get_key_by_grip(io, store, locator->id.grip);
+        key = rnp_key_store_lazy_get_key_by_grip(io, store, locator->id.grip);
     } break;
     default:
         // should never happen
@@ -2147,20 +2369,56 @@ rnp_key_is_protected(rnp_key_handle_t handle, bool *result)
 }
 
 rnp_result_t
-rnp_key_protect(rnp_key_handle_t handle, const char *password)
+rnp_calculate_iterations(const char *hash, size_t msec, size_t *iterations)
 {
+    pgp_hash_alg_t hash_alg;
+
+    // checks
+    if (!iterations) {
+        return RNP_ERROR_NULL_POINTER;
+    }
+    if (!hash) {
+        hash = DEFAULT_HASH_ALG;
+    }
+    if (!parse_hash_alg(hash, &hash_alg)) {
+        return RNP_ERROR_BAD_FORMAT;
+    }
+
+    *iterations = pgp_s2k_compute_iters(hash_alg, msec, 0);
+    return *iterations ? RNP_SUCCESS : RNP_ERROR_GENERIC;
+}
+
+rnp_result_t
+rnp_key_protect(rnp_key_handle_t handle,
+                const char *     password,
+                const char *     cipher,
+                const char *     hash,
+                size_t           iterations)
+{
+    rnp_key_protection_params_t protection = {0};
+
     // checks
     if (!handle || !password) {
         return RNP_ERROR_NULL_POINTER;
     }
+    if (iterations > UINT_MAX) {
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+    // parse, zero values are replaced with defaults by pgp_key_protect_password
+    if (cipher && !parse_symm_alg(cipher, &protection.symm_alg)) {
+        return RNP_ERROR_BAD_FORMAT;
+    }
+    if (hash && !parse_hash_alg(hash, &protection.hash_alg)) {
+        return RNP_ERROR_BAD_FORMAT;
+    }
+    protection.iterations = iterations;
 
     // get the key
     pgp_key_t *key = get_key_require_secret(handle);
     if (!key) {
         return RNP_ERROR_NO_SUITABLE_KEY;
     }
-    // TODO allow setting protection params
-    if (!pgp_key_protect_password(key, key->format, NULL, password)) {
+    if (!pgp_key_protect_password(key, key->format, &protection, password)) {
         return RNP_ERROR_GENERIC;
     }
     return RNP_SUCCESS;
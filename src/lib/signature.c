@@ -214,6 +214,10 @@ dsa_sign(rng_t *                 rng,
 
     /* write signature to buf */
     dsasig = pgp_dsa_sign(rng, hashbuf, hashsize, sdsa, dsa);
+    if (!dsasig) {
+        RNP_LOG("DSA signing failed");
+        return false;
+    }
 
     /* convert and write the sig out to memory */
     pgp_write_mpi(output, dsasig->r);
@@ -340,6 +344,132 @@ end:
     return ret;
 }
 
+/* store bignum as the signature MPI */
+static bool
+signature_store_mpi(const bignum_t *bn, uint8_t *mpi, unsigned *len)
+{
+    size_t bytes = 0;
+
+    if (!bn || !bn_num_bytes(bn, &bytes) || (bytes > PGP_MPINT_SIZE)) {
+        RNP_LOG("wrong signature mpi");
+        return false;
+    }
+    if (bn_bn2bin(bn, mpi)) {
+        return false;
+    }
+    *len = bytes;
+    return true;
+}
+
+bool
+signature_calculate(pgp_signature_t *   sig,
+                    const pgp_seckey_t *seckey,
+                    pgp_hash_t *        hash,
+                    rng_t *             rng)
+{
+    const pgp_pubkey_t *   pubkey = &seckey->pubkey;
+    const ec_curve_desc_t *curve;
+    uint8_t                hval[PGP_MAX_HASH_SIZE];
+    uint8_t                trailer[6];
+    size_t                 hlen;
+    int                    slen;
+    bool                   ret = false;
+
+    /* hash signature fields and trailer */
+    pgp_hash_add(hash, sig->hashed_data, sig->hashed_len);
+    if (sig->version > 3) {
+        trailer[0] = sig->version;
+        trailer[1] = 0xff;
+        STORE32BE(&trailer[2], sig->hashed_len);
+        pgp_hash_add(hash, trailer, 6);
+    }
+    hlen = pgp_hash_finish(hash, hval);
+
+    /* the high 16 bits of the hash value, to reject some invalid signatures quickly */
+    sig->lbits[0] = hval[0];
+    sig->lbits[1] = hval[1];
+
+    switch (pubkey->alg) {
+    case PGP_PKA_RSA:
+    case PGP_PKA_RSA_ENCRYPT_ONLY:
+    case PGP_PKA_RSA_SIGN_ONLY:
+        slen = pgp_rsa_pkcs1_sign_hash(rng,
+                                       sig->material.rsa.s,
+                                       sizeof(sig->material.rsa.s),
+                                       sig->halg,
+                                       hval,
+                                       hlen,
+                                       &seckey->key.rsa,
+                                       &pubkey->key.rsa);
+        sig->material.rsa.slen = slen;
+        ret = slen > 0;
+        break;
+    case PGP_PKA_DSA: {
+        /* hash size must be equal to the size of q, only 160-bit q is supported now */
+        if (hlen < 20) {
+            RNP_LOG("hash too small for DSA");
+            break;
+        }
+        DSA_SIG *dsasig = pgp_dsa_sign(rng, hval, 20, &seckey->key.dsa, &pubkey->key.dsa);
+        if (!dsasig) {
+            break;
+        }
+        ret = signature_store_mpi(dsasig->r, sig->material.dsa.r, &sig->material.dsa.rlen) &&
+              signature_store_mpi(dsasig->s, sig->material.dsa.s, &sig->material.dsa.slen);
+        DSA_SIG_free(dsasig);
+        break;
+    }
+    case PGP_PKA_EDDSA: {
+        bignum_t *r = bn_new();
+        bignum_t *s = bn_new();
+        if (r && s && (pgp_eddsa_sign_hash(
+                         rng, r, s, hval, hlen, &seckey->key.ecc, &pubkey->key.ecc) >= 0)) {
+            ret = signature_store_mpi(r, sig->material.ecc.r, &sig->material.ecc.rlen) &&
+                  signature_store_mpi(s, sig->material.ecc.s, &sig->material.ecc.slen);
+        }
+        bn_free(r);
+        bn_free(s);
+        break;
+    }
+    case PGP_PKA_ECDH:
+    case PGP_PKA_ECDSA:
+    case PGP_PKA_SM2: {
+        pgp_ecc_sig_t ecc = {NULL, NULL};
+        rnp_result_t  res;
+
+        if (!(curve = get_curve_desc(pubkey->key.ecc.curve))) {
+            RNP_LOG("Unknown curve");
+            break;
+        }
+        /* "-2" because ECDSA on P-521 must work with SHA-512 digest */
+        if (BITS_TO_BYTES(curve->bitlen) - 2 > hlen) {
+            RNP_LOG("Message hash to small");
+            break;
+        }
+        if (pubkey->alg == PGP_PKA_SM2) {
+            res = pgp_sm2_sign_hash(rng, &ecc, hval, hlen, &seckey->key.ecc, &pubkey->key.ecc);
+        } else {
+            res =
+              pgp_ecdsa_sign_hash(rng, &ecc, hval, hlen, &seckey->key.ecc, &pubkey->key.ecc);
+        }
+        ret = (res == RNP_SUCCESS) &&
+              signature_store_mpi(ecc.r, sig->material.ecc.r, &sig->material.ecc.rlen) &&
+              signature_store_mpi(ecc.s, sig->material.ecc.s, &sig->material.ecc.slen);
+        bn_free(ecc.r);
+        bn_free(ecc.s);
+        break;
+    }
+    default:
+        RNP_LOG("Unsupported algorithm %d", (int) pubkey->alg);
+        break;
+    }
+
+    if (!ret) {
+        RNP_LOG("failed to calculate signature");
+    }
+    return ret;
+}
+
 static unsigned
 eddsa_verify(const uint8_t *         hash,
              size_t                  hash_length,
@@ -1041,44 +1171,10 @@ pgp_sig_get_hash(pgp_create_sig_t *sig)
     return &sig->hash;
 }
 
-/* open up an output file */
-static int
-open_output_file(rnp_ctx_t *    ctx,
-                 pgp_output_t **output,
-                 const char *   inname,
-                 const char *   outname,
-                 const char *   suffix,
-                 const unsigned overwrite)
-{
-    int fd;
-
-    /* setup output file */
-    if (outname) {
-        if (strcmp(outname, "-") == 0) {
-            fd = pgp_setup_file_write(ctx, output, NULL, overwrite);
-        } else {
-            fd = pgp_setup_file_write(ctx, output, outname, overwrite);
-        }
-    } else {
-        size_t flen = strlen(inname) + 1 + strlen(suffix) + 1;
-        char * f = NULL;
-
-        if ((f = calloc(1, flen)) == NULL) {
-            (void) fprintf(stderr, "open_output_file: bad alloc\n");
-            fd = -1;
-        } else {
-            (void) snprintf(f, flen, "%s.%s", inname, suffix);
-            fd = pgp_setup_file_write(ctx, output, f, overwrite);
-            free(f);
-        }
-    }
-    return fd;
-}
-
 /**
     Pick up hash algorithm according to secret key and preferences set in the context
 */
-static pgp_hash_alg_t
+pgp_hash_alg_t
 pgp_pick_hash_alg(rnp_ctx_t *ctx, const pgp_seckey_t *seckey)
 {
     if (seckey->pubkey.alg == PGP_PKA_DSA) {
@@ -1095,110 +1191,6 @@ pgp_pick_hash_alg(rnp_ctx_t *ctx, const pgp_seckey_t *seckey)
     }
 }
 
-/**
-\ingroup HighLevel_Sign
-\brief Sign a file
-\param ctx Operation context
-\param inname Input filename
-\param outname Output filename. If NULL, a name is constructed from the input filename.
-\param seckey Secret Key to use for signing
-\param armored Write armored text, if set.
-\param overwrite May overwrite existing file, if set.
-\return 1 if OK; else 0;
-
-*/
-bool
-pgp_sign_file(rnp_ctx_t *         ctx,
-              pgp_io_t *          io,
-              const char *        inname,
-              const char *        outname,
-              const pgp_seckey_t *seckey,
-              bool                cleartext)
-{
-    pgp_create_sig_t *sig = NULL;
-    pgp_sig_type_t    sig_type = PGP_SIG_BINARY;
-    pgp_hash_alg_t    hash_alg;
-    pgp_memory_t *    infile = NULL;
-    pgp_output_t *    output = NULL;
-    pgp_hash_t *      hash = NULL;
-    bool              ok = false;
-    uint8_t           keyid[PGP_KEY_ID_SIZE];
-    int               fd_out = 0;
-
-    /* find the hash algorithm */
-    if ((hash_alg = pgp_pick_hash_alg(ctx, seckey)) == PGP_HASH_UNKNOWN) {
-        (void) fprintf(
-          io->errs, "pgp_sign_file: cannot pick hash algorithm: %d\n", (int) ctx->halg);
-        goto done;
-    }
-
-    /* read input file into buf */
-    infile = pgp_memory_new();
-    if (infile == NULL) {
-        (void) fprintf(stderr, "can't allocate mem\n");
-        goto done;
-    }
-    if (!pgp_mem_readfile(infile, inname)) {
-        goto done;
-    }
-
-    /* setup output file */
-    fd_out = open_output_file(
-      ctx, &output, inname, outname, (ctx->armor) ? "asc" : "gpg", ctx->overwrite);
-    if (fd_out < 0) {
-        goto done;
-    }
-
-    /* set up signature */
-    sig = pgp_create_sig_new();
-    if (!sig) {
-        goto done;
-    }
-
-    pgp_sig_start(sig, seckey, hash_alg, sig_type);
-
-    if (cleartext) {
-        if (!pgp_writer_push_clearsigned(output, sig) ||
-            !pgp_write(output, pgp_mem_data(infile), (unsigned) pgp_mem_len(infile)) ||
-            !pgp_writer_push_armored(output, PGP_PGP_CLEARTEXT_SIGNATURE)) {
-            goto done;
-        }
-    } else {
-        /* set armored/not armored here */
-        if (ctx->armor) {
-            pgp_writer_push_armored(output, PGP_PGP_MESSAGE);
-        }
-        /* hash file contents */
-        hash = pgp_sig_get_hash(sig);
-        pgp_hash_add(hash, pgp_mem_data(infile), (unsigned) pgp_mem_len(infile));
-
-        if (!pgp_write_one_pass_sig(output, seckey, hash_alg, sig_type) ||
-            !pgp_write_litdata(
-              output, pgp_mem_data(infile), (const int) pgp_mem_len(infile), PGP_LDT_BINARY)) {
-            goto done;
-        }
-    }
-    if (!pgp_sig_add_time(sig, (int64_t) ctx->sigcreate, PGP_PTAG_SS_CREATION_TIME) ||
-        !pgp_sig_add_time(sig, (int64_t) ctx->sigexpire, PGP_PTAG_SS_EXPIRATION_TIME) ||
-        !pgp_keyid(keyid, PGP_KEY_ID_SIZE, &seckey->pubkey) ||
-        !pgp_sig_add_issuer_keyid(sig, keyid) || !pgp_sig_end_hashed_subpkts(sig) ||
-        !pgp_sig_write(rnp_ctx_rng_handle(ctx), output, sig, &seckey->pubkey, seckey)) {
-        goto done;
-    }
-    ok = true;
-
-done:
-    if (!ok) {
-        RNP_LOG("Failed to sign file");
-    }
-    pgp_create_sig_delete(sig);
-    pgp_memory_free(infile);
-    if (output) {
-        pgp_teardown_file_write(output, fd_out);
-    }
-    return ok;
-}
-
 /**
 \ingroup HighLevel_Sign
 \brief Signs a buffer
@@ -1300,72 +1292,6 @@ done:
     return mem;
 }
 
-/* sign a file, and put the signature in a separate file */
-int
-pgp_sign_detached(
-  rnp_ctx_t *ctx, pgp_io_t *io, const char *f, const char *sigfile, const pgp_seckey_t *seckey)
-{
-    pgp_create_sig_t *sig = NULL;
-    pgp_hash_alg_t    hash_alg;
-    pgp_output_t *    output = NULL;
-    pgp_memory_t *    mem = NULL;
-    uint8_t           keyid[PGP_KEY_ID_SIZE];
-    int               fd = 0;
-    bool              ok = false;
-
-    /* find out which hash algorithm to use */
-    if ((hash_alg = pgp_pick_hash_alg(ctx, seckey)) == PGP_HASH_UNKNOWN) {
-        (void) fprintf(io->errs, "cannot pick hash algorithm: %d\n", ctx->halg);
-        goto done;
-    }
-
-    /* setup output file */
-    fd =
-      open_output_file(ctx, &output, f, sigfile, (ctx->armor) ? "asc" : "sig", ctx->overwrite);
-    if (fd < 0) {
-        (void) fprintf(io->errs, "Can't open output file: %s\n", f);
-        goto done;
-    }
-
-    /* create a new signature */
-    sig = pgp_create_sig_new();
-    if (sig == NULL) {
-        (void) fprintf(stderr, "can't allocate mem\n");
-        goto done;
-    }
-    pgp_sig_start(sig, seckey, hash_alg, PGP_SIG_BINARY);
-
-    /* read the contents of 'f', and add that to the signature */
-    mem = pgp_memory_new();
-    if (mem == NULL) {
-        (void) fprintf(stderr, "can't allocate mem\n");
-        goto done;
-    }
-    if (!pgp_mem_readfile(mem, f)) {
-        goto done;
-    }
-    /* set armored/not armored here */
-    if (ctx->armor) {
-        pgp_writer_push_armored(output, PGP_PGP_SIGNATURE);
-    }
-    pgp_sig_add_data(sig, pgp_mem_data(mem), pgp_mem_len(mem));
-
-    if (!pgp_sig_add_time(sig, ctx->sigcreate, PGP_PTAG_SS_CREATION_TIME) ||
-        !pgp_sig_add_time(sig, (int64_t) ctx->sigexpire, PGP_PTAG_SS_EXPIRATION_TIME) ||
-        !pgp_keyid(keyid, sizeof(keyid), &seckey->pubkey) ||
-        !pgp_sig_add_issuer_keyid(sig, keyid) || !pgp_sig_end_hashed_subpkts(sig) ||
-        !pgp_sig_write(rnp_ctx_rng_handle(ctx), output, sig, &seckey->pubkey, seckey)) {
-        goto done;
-    }
-    ok = true;
-
-done:
-    pgp_teardown_file_write(output, fd);
-    pgp_create_sig_delete(sig);
-    pgp_memory_free(mem);
-    return ok;
-}
-
 rnp_result_t
 pgp_sign_memory_detached(rnp_ctx_t *         ctx,
                          const pgp_seckey_t *seckey,
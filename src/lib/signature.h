@@ -127,12 +127,6 @@ unsigned pgp_sig_add_key_server_prefs(pgp_create_sig_t *sig,
 unsigned pgp_sig_add_preferred_key_server(pgp_create_sig_t *sig, const uint8_t *uri);
 
 /* Standard Interface */
-bool pgp_sign_file(
-  rnp_ctx_t *, pgp_io_t *, const char *, const char *, const pgp_seckey_t *, bool cleartext);
-
-int pgp_sign_detached(
-  rnp_ctx_t *, pgp_io_t *, const char *, const char *, const pgp_seckey_t *);
-
 rnp_result_t pgp_sign_memory_detached(rnp_ctx_t *         ctx,
                                       const pgp_seckey_t *seckey,
                                       const uint8_t       membuf[],
@@ -143,6 +137,25 @@ rnp_result_t pgp_sign_memory_detached(rnp_ctx_t *         ctx,
 bool pgp_check_sig(
   rng_t *, const uint8_t *, unsigned, const pgp_sig_t *, const pgp_pubkey_t *);
 
+/** @brief pick the hash algorithm for the signature, according to the secret key and
+ *         preferences set in the context
+ *  @return hash algorithm or PGP_HASH_UNKNOWN
+ **/
+pgp_hash_alg_t pgp_pick_hash_alg(rnp_ctx_t *ctx, const pgp_seckey_t *seckey);
+
+/** @brief calculate the signature over the hashed data
+ *  @param sig signature with filled version, algorithms and hashed_data fields. On success
+ *         lbits and signature material are filled.
+ *  @param seckey decrypted secret key
+ *  @param hash hash context of the signed data, will be finalized
+ *  @param rng random number generator
+ *  @return true on success or false otherwise
+ **/
+bool signature_calculate(pgp_signature_t *   sig,
+                         const pgp_seckey_t *seckey,
+                         pgp_hash_t *        hash,
+                         rng_t *             rng);
+
 /* armored stuff */
 unsigned pgp_crc24(unsigned, uint8_t);
 
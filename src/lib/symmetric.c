@@ -263,9 +263,8 @@ pgp_cipher_cfb_decrypt(pgp_crypt_t *crypt, uint8_t *out, const uint8_t *in, size
 {
     /* for better code readability */
     uint64_t *out64, *in64;
-    uint64_t  inbuf64[512]; // 4KB - page size
+    uint64_t  inbuf64[512 + 2]; // 4KB - page size, prepended with the iv
     uint64_t  outbuf64[512];
-    uint64_t  iv64[2];
     size_t    blocks, blockb;
     unsigned  blsize = crypt->blocksize;
 
@@ -282,46 +281,36 @@ pgp_cipher_cfb_decrypt(pgp_crypt_t *crypt, uint8_t *out, const uint8_t *in, size
         return 0;
     }
 
-    /* decrypting full blocks */
+    /* decrypting full blocks. Keystream is the encrypted previous ciphertext block, so
+     * all of the blocks in buffer are encrypted with the single call, starting from iv */
     if (bytes > blsize) {
-        memcpy(iv64, crypt->iv, blsize);
+        memcpy(inbuf64, crypt->iv, blsize);
+        in64 = inbuf64 + blsize / 8;
 
         while ((blocks = bytes & ~(blsize - 1)) > 0) {
-            if (blocks > sizeof(inbuf64)) {
-                blocks = sizeof(inbuf64);
+            if (blocks > sizeof(outbuf64)) {
+                blocks = sizeof(outbuf64);
             }
             bytes -= blocks;
             blockb = blocks;
-            memcpy(inbuf64, in, blockb);
-            out64 = outbuf64;
-            in64 = inbuf64;
+            memcpy(in64, in, blockb);
 
-            if (blsize == 16) {
-                blocks >>= 4;
-                while (blocks--) {
-                    botan_block_cipher_encrypt_blocks(
-                      crypt->obj, (uint8_t *) iv64, (uint8_t *) iv64, 1);
-                    *out64++ = *in64 ^ iv64[0];
-                    iv64[0] = *in64++;
-                    *out64++ = *in64 ^ iv64[1];
-                    iv64[1] = *in64++;
-                }
-            } else {
-                blocks >>= 3;
-                while (blocks--) {
-                    botan_block_cipher_encrypt_blocks(
-                      crypt->obj, (uint8_t *) iv64, (uint8_t *) iv64, 1);
-                    *out64++ = *in64 ^ iv64[0];
-                    iv64[0] = *in64++;
-                }
+            botan_block_cipher_encrypt_blocks(
+              crypt->obj, (uint8_t *) inbuf64, (uint8_t *) outbuf64, blockb / blsize);
+
+            out64 = outbuf64;
+            for (size_t i = 0; i < blockb / 8; i++) {
+                *out64++ ^= in64[i];
             }
 
+            /* last ciphertext block is the iv for the next chunk */
+            memcpy(inbuf64, (uint8_t *) in64 + blockb - blsize, blsize);
             memcpy(out, outbuf64, blockb);
             out += blockb;
             in += blockb;
         }
 
-        memcpy(crypt->iv, iv64, blsize);
+        memcpy(crypt->iv, inbuf64, blsize);
     }
 
     if (!bytes) {
@@ -343,6 +332,78 @@ pgp_cipher_cfb_decrypt(pgp_crypt_t *crypt, uint8_t *out, const uint8_t *in, size
     return 0;
 }
 
+/* minimum number of bytes decrypted by the single thread in parallel CFB */
+#define PGP_CFB_MIN_SEGMENT 65536
+/* maximum number of segments for the single call */
+#define PGP_CFB_MAX_SEGMENTS 64
+
+typedef struct pgp_cfb_segment_t {
+    pgp_crypt_t    crypt; /* copy of the cipher with iv of this segment */
+    uint8_t *      out;
+    const uint8_t *in;
+    size_t         len;
+} pgp_cfb_segment_t;
+
+static void
+cfb_decrypt_segment(void *param)
+{
+    pgp_cfb_segment_t *seg = param;
+    pgp_cipher_cfb_decrypt(&seg->crypt, seg->out, seg->in, seg->len);
+}
+
+int
+pgp_cipher_cfb_decrypt_parallel(
+  pgp_crypt_t *crypt, uint8_t *out, const uint8_t *in, size_t bytes, pgp_thread_pool_t *pool)
+{
+    pgp_cfb_segment_t segs[PGP_CFB_MAX_SEGMENTS];
+    pgp_task_t        tasks[PGP_CFB_MAX_SEGMENTS];
+    size_t            blsize = crypt->blocksize;
+    size_t            segc, seglen, full, head;
+
+    /* first bytes till the block boundary */
+    head = crypt->remaining < bytes ? crypt->remaining : bytes;
+    full = ((bytes - head) / blsize) * blsize;
+    segc = pgp_thread_pool_size(pool);
+    if (segc > full / PGP_CFB_MIN_SEGMENT) {
+        segc = full / PGP_CFB_MIN_SEGMENT;
+    }
+    if (segc > PGP_CFB_MAX_SEGMENTS) {
+        segc = PGP_CFB_MAX_SEGMENTS;
+    }
+    if (segc < 2) {
+        return pgp_cipher_cfb_decrypt(crypt, out, in, bytes);
+    }
+
+    if (head) {
+        pgp_cipher_cfb_decrypt(crypt, out, in, head);
+        out += head;
+        in += head;
+        bytes -= head;
+    }
+
+    /* since in and out may overlap all ivs must be stored before the decryption */
+    seglen = ((full / segc) / blsize) * blsize;
+    for (size_t i = 0; i < segc; i++) {
+        segs[i].crypt = *crypt;
+        segs[i].crypt.remaining = 0;
+        if (i) {
+            memcpy(segs[i].crypt.iv, in + i * seglen - blsize, blsize);
+        }
+        segs[i].out = out + i * seglen;
+        segs[i].in = in + i * seglen;
+        segs[i].len = (i == segc - 1) ? full - i * seglen : seglen;
+        tasks[i].func = cfb_decrypt_segment;
+        tasks[i].param = &segs[i];
+    }
+    memcpy(crypt->iv, in + full - blsize, blsize);
+    crypt->remaining = 0;
+
+    pgp_thread_pool_run(pool, tasks, segc);
+
+    /* decrypting tail */
+    return pgp_cipher_cfb_decrypt(crypt, out + full, in + full, bytes - full);
+}
+
 pgp_symm_alg_t
 pgp_cipher_alg_id(pgp_crypt_t *cipher)
 {
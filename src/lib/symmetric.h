@@ -53,6 +53,7 @@
 #define SYMMETRIC_CRYPTO_H_
 
 #include "crypto/rng.h"
+#include "thread-pool.h"
 
 typedef struct symmetric_key_t {
     pgp_symm_alg_t type;
@@ -94,6 +95,20 @@ pgp_symm_alg_t pgp_cipher_alg_id(pgp_crypt_t *cipher);
 int pgp_cipher_cfb_encrypt(pgp_crypt_t *cipher, uint8_t *out, const uint8_t *in, size_t len);
 int pgp_cipher_cfb_decrypt(pgp_crypt_t *cipher, uint8_t *out, const uint8_t *in, size_t len);
 
+/** @brief CFB decryption split between the threads of the pool. Keystream of each block
+ *         depends only on the previous ciphertext block, so the full blocks are cut into
+ *         segments which are decrypted independently. Result and state of the cipher are
+ *         the same as after pgp_cipher_cfb_decrypt().
+ *  @param cipher initialized cipher
+ *  @param out output buffer, may be the same as in
+ *  @param in ciphertext
+ *  @param len number of bytes to decrypt
+ *  @param pool thread pool. If NULL or len is too small then serial decryption is used.
+ *  @return 0 on success
+ **/
+int pgp_cipher_cfb_decrypt_parallel(
+  pgp_crypt_t *cipher, uint8_t *out, const uint8_t *in, size_t len, pgp_thread_pool_t *pool);
+
 void pgp_cipher_cfb_resync(pgp_crypt_t *crypt, uint8_t *buf);
 
 #endif
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <stdint.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#include "thread-pool.h"
+#include "utils.h"
+
+#ifdef HAVE_PTHREAD_H
+
+struct pgp_thread_pool_t {
+    pthread_mutex_t lock;
+    pthread_cond_t  queued;    /* signalled when task is added to the queue or on stop */
+    pthread_cond_t  completed; /* signalled when any task is completed */
+    pgp_task_t *    first;     /* queue of tasks waiting for execution */
+    pgp_task_t *    last;
+    bool            stop;      /* workers should exit */
+    unsigned        threadc;   /* number of started worker threads */
+    pthread_t       threads[]; /* worker threads */
+};
+
+/* must be called with pool->lock held */
+static pgp_task_t *
+pool_pop_task(pgp_thread_pool_t *pool)
+{
+    pgp_task_t *task = pool->first;
+
+    if (task) {
+        pool->first = task->next;
+        if (!pool->first) {
+            pool->last = NULL;
+        }
+        task->next = NULL;
+    }
+    return task;
+}
+
+/* must be called with pool->lock held, lock is released while task is running */
+static void
+pool_execute_task(pgp_thread_pool_t *pool, pgp_task_t *task)
+{
+    pthread_mutex_unlock(&pool->lock);
+    task->func(task->param);
+    pthread_mutex_lock(&pool->lock);
+    task->done = true;
+    pthread_cond_broadcast(&pool->completed);
+}
+
+static void *
+pool_worker(void *param)
+{
+    pgp_thread_pool_t *pool = param;
+    pgp_task_t *       task;
+
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        if ((task = pool_pop_task(pool))) {
+            pool_execute_task(pool, task);
+            continue;
+        }
+        if (pool->stop) {
+            break;
+        }
+        pthread_cond_wait(&pool->queued, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+pgp_thread_pool_t *
+pgp_thread_pool_create(unsigned threads)
+{
+    pgp_thread_pool_t *pool;
+
+    if (threads < 2) {
+        return NULL;
+    }
+
+    pool = calloc(1, sizeof(*pool) + sizeof(pthread_t) * (threads - 1));
+    if (!pool) {
+        RNP_LOG("allocation failed");
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&pool->lock, NULL)) {
+        free(pool);
+        return NULL;
+    }
+    pthread_cond_init(&pool->queued, NULL);
+    pthread_cond_init(&pool->completed, NULL);
+
+    for (unsigned i = 0; i < threads - 1; i++) {
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, pool)) {
+            RNP_LOG("failed to start worker thread %u", i);
+            break;
+        }
+        pool->threadc++;
+    }
+
+    if (!pool->threadc) {
+        pgp_thread_pool_destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void
+pgp_thread_pool_destroy(pgp_thread_pool_t *pool)
+{
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->queued);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (unsigned i = 0; i < pool->threadc; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->queued);
+    pthread_cond_destroy(&pool->completed);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+unsigned
+pgp_thread_pool_size(const pgp_thread_pool_t *pool)
+{
+    return pool ? pool->threadc + 1 : 1;
+}
+
+void
+pgp_thread_pool_submit(pgp_thread_pool_t *pool, pgp_task_t *task)
+{
+    task->next = NULL;
+    task->done = false;
+
+    if (!pool) {
+        task->func(task->param);
+        task->done = true;
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->last) {
+        pool->last->next = task;
+    } else {
+        pool->first = task;
+    }
+    pool->last = task;
+    pthread_cond_signal(&pool->queued);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void
+pgp_thread_pool_wait(pgp_thread_pool_t *pool, pgp_task_t *task)
+{
+    pgp_task_t *other;
+
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while (!task->done) {
+        /* help the workers instead of sleeping, this also makes nested waits safe */
+        if ((other = pool_pop_task(pool))) {
+            pool_execute_task(pool, other);
+        } else {
+            pthread_cond_wait(&pool->completed, &pool->lock);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+#else
+
+pgp_thread_pool_t *
+pgp_thread_pool_create(unsigned threads)
+{
+    return NULL;
+}
+
+void
+pgp_thread_pool_destroy(pgp_thread_pool_t *pool)
+{
+}
+
+unsigned
+pgp_thread_pool_size(const pgp_thread_pool_t *pool)
+{
+    return 1;
+}
+
+void
+pgp_thread_pool_submit(pgp_thread_pool_t *pool, pgp_task_t *task)
+{
+    task->next = NULL;
+    task->func(task->param);
+    task->done = true;
+}
+
+void
+pgp_thread_pool_wait(pgp_thread_pool_t *pool, pgp_task_t *task)
+{
+}
+
+#endif
+
+void
+pgp_thread_pool_run(pgp_thread_pool_t *pool, pgp_task_t *tasks, size_t count)
+{
+    if (!count) {
+        return;
+    }
+
+    /* the first task is executed on the calling thread */
+    for (size_t i = 1; i < count; i++) {
+        pgp_thread_pool_submit(pool, &tasks[i]);
+    }
+    tasks[0].next = NULL;
+    tasks[0].func(tasks[0].param);
+    tasks[0].done = true;
+
+    for (size_t i = 1; i < count; i++) {
+        pgp_thread_pool_wait(pool, &tasks[i]);
+    }
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** Fixed-size pool of worker threads
+ *  @file
+ */
+#ifndef RNP_THREAD_POOL_H
+#define RNP_THREAD_POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ *  @private
+ *  Tasks are owned by the caller and must stay valid until they are waited for, so
+ *  submitting work never allocates. If pthreads are not available, or pool is NULL,
+ *  every task is executed synchronously inside of pgp_thread_pool_submit().
+ *
+ *  @code
+ *  pgp_thread_pool_t *pool = pgp_thread_pool_create(4);
+ *  pgp_task_t         tasks[8];
+ *  for (int i = 0; i < 8; i++) {
+ *      tasks[i] = (pgp_task_t){.func = process_chunk, .param = &chunks[i]};
+ *  }
+ *  // runs all 8 tasks on 3 workers plus the calling thread
+ *  pgp_thread_pool_run(pool, tasks, 8);
+ *  pgp_thread_pool_destroy(pool);
+ *  @endcode
+ */
+
+typedef struct pgp_thread_pool_t pgp_thread_pool_t;
+
+typedef void pgp_task_func_t(void *param);
+
+typedef struct pgp_task_t {
+    pgp_task_func_t *  func;  /* function to execute */
+    void *             param; /* parameter passed to func */
+    struct pgp_task_t *next;  /* internal: link in the pool queue */
+    bool               done;  /* internal: func has returned */
+} pgp_task_t;
+
+/** @private
+ *  create a thread pool
+ *
+ *  @param threads total number of threads which should run tasks, including the thread
+ *         which waits for the results. So threads - 1 worker threads are started.
+ *  @return pool or NULL if threads < 2, pthreads are not available or allocation failed.
+ *          NULL is still a valid pool which runs everything synchronously.
+ **/
+pgp_thread_pool_t *pgp_thread_pool_create(unsigned threads);
+
+/** @private
+ *  stop worker threads and free the pool. All submitted tasks must be waited for.
+ *
+ *  @param pool pool or NULL
+ **/
+void pgp_thread_pool_destroy(pgp_thread_pool_t *pool);
+
+/** @private
+ *  get the number of threads which may run tasks concurrently
+ *
+ *  @param pool pool or NULL
+ *  @return number of threads, including the waiting one. 1 for the NULL pool.
+ **/
+unsigned pgp_thread_pool_size(const pgp_thread_pool_t *pool);
+
+/** @private
+ *  queue the task for asynchronous execution
+ *
+ *  @param pool pool or NULL
+ *  @param task initialized task, func must be set
+ **/
+void pgp_thread_pool_submit(pgp_thread_pool_t *pool, pgp_task_t *task);
+
+/** @private
+ *  wait until the task is completed. While waiting the calling thread executes other
+ *  queued tasks, so it is safe to call it from inside of a task.
+ *
+ *  @param pool pool or NULL
+ *  @param task previously submitted task
+ **/
+void pgp_thread_pool_wait(pgp_thread_pool_t *pool, pgp_task_t *task);
+
+/** @private
+ *  execute tasks in parallel and wait for all of them
+ *
+ *  @param pool pool or NULL
+ *  @param tasks array of initialized tasks
+ *  @param count number of tasks in array
+ **/
+void pgp_thread_pool_run(pgp_thread_pool_t *pool, pgp_task_t *tasks, size_t count);
+
+#endif
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <rnp/rnp_sdk.h>
+
+#include "key_store_import.h"
+#include "key_store_lazy.h"
+#include "pgp-key.h"
+#include "utils.h"
+
+/* number of files which are parsed before their keys are merged and freed */
+#define IMPORT_BATCH_FILES 256
+
+#define IMPORT_ARMOR_HEAD "-----BEGIN PGP "
+
+typedef struct import_paths_t {
+    DYNARRAY(char *, path);
+} import_paths_t;
+
+typedef struct import_file_t {
+    const char *     path;
+    pgp_io_t *       io;
+    rnp_key_store_t *pubring; /* used by the G10 parser, read only */
+    rnp_key_store_t *store;   /* parsed keys, or NULL if file failed to load */
+} import_file_t;
+
+static bool
+import_paths_add(import_paths_t *paths, const char *path)
+{
+    char *copy;
+
+    EXPAND_ARRAY(paths, path);
+    if (paths->pathc == paths->pathvsize) {
+        RNP_LOG("allocation failed");
+        return false;
+    }
+    if (!(copy = strdup(path))) {
+        RNP_LOG("allocation failed");
+        return false;
+    }
+    paths->paths[paths->pathc++] = copy;
+    return true;
+}
+
+static int
+import_path_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/* add regular files from the directory, sorted by name so import order is stable */
+static bool
+import_paths_add_dir(import_paths_t *paths, const char *dirname)
+{
+    DIR *          dir;
+    struct dirent *ent;
+    struct stat    st;
+    char           path[MAXPATHLEN];
+    unsigned       from = paths->pathc;
+    bool           res = true;
+
+    if (!(dir = opendir(dirname))) {
+        RNP_LOG("can't open directory %s", dirname);
+        return false;
+    }
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dirname, ent->d_name);
+        if (stat(path, &st) || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        if (!(res = import_paths_add(paths, path))) {
+            break;
+        }
+    }
+    closedir(dir);
+    qsort(&paths->paths[from], paths->pathc - from, sizeof(*paths->paths), import_path_cmp);
+    return res;
+}
+
+static void
+import_paths_free(import_paths_t *paths)
+{
+    for (unsigned i = 0; i < paths->pathc; i++) {
+        free(paths->paths[i]);
+    }
+    FREE_ARRAY(paths, path);
+}
+
+static const char *
+import_guess_format(const char *path)
+{
+    size_t len = strlen(path);
+
+    if (len < 4) {
+        return RNP_KEYSTORE_GPG;
+    }
+    if (!strcmp(path + len - 4, ".kbx")) {
+        return RNP_KEYSTORE_KBX;
+    }
+    if (!strcmp(path + len - 4, ".key")) {
+        return RNP_KEYSTORE_G10;
+    }
+    return RNP_KEYSTORE_GPG;
+}
+
+/* armor header is expected on the first line */
+static bool
+import_is_armored(const pgp_memory_t *mem)
+{
+    const char *eol = memchr(mem->buf, '\n', mem->length);
+    size_t      len = eol ? (size_t)(eol - (const char *) mem->buf) : mem->length;
+    size_t      hlen = strlen(IMPORT_ARMOR_HEAD);
+
+    for (size_t i = 0; i + hlen <= len; i++) {
+        if (!memcmp(&mem->buf[i], IMPORT_ARMOR_HEAD, hlen)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* executed on the worker thread */
+static void
+import_parse_file(void *param)
+{
+    import_file_t *file = param;
+    pgp_memory_t   mem = {0};
+    bool           res = false;
+
+    file->store = rnp_key_store_new(import_guess_format(file->path), file->path);
+    if (!file->store) {
+        return;
+    }
+    if (!pgp_mem_readfile(&mem, file->path)) {
+        RNP_LOG("failed to read file %s", file->path);
+        goto done;
+    }
+    res = rnp_key_store_load_from_mem(
+      file->io, file->store, import_is_armored(&mem), file->pubring, &mem);
+    pgp_memory_release(&mem);
+    if (!res) {
+        RNP_LOG("failed to load keys from file %s", file->path);
+        goto done;
+    }
+    if (!file->store->keyc) {
+        RNP_LOG("no keys in file %s", file->path);
+        res = false;
+    }
+done:
+    if (!res) {
+        rnp_key_store_free(file->store);
+        file->store = NULL;
+    }
+}
+
+/* position of the key in the store, subkeys usually follow their primary key */
+static unsigned
+import_key_pos(const rnp_key_store_t *store, const pgp_key_t *key, unsigned from)
+{
+    for (unsigned i = 0; i < store->keyc; i++) {
+        unsigned pos = (from + i) % store->keyc;
+        if (store->keys[pos] == key) {
+            return pos;
+        }
+    }
+    return UINT_MAX;
+}
+
+static bool
+import_merge_store(pgp_io_t *              io,
+                   rnp_key_store_t *       pubring,
+                   rnp_key_store_t *       secring,
+                   rnp_key_store_t *       store,
+                   rnp_key_import_cb *     cb,
+                   void *                  param,
+                   rnp_key_import_stats_t *stats)
+{
+    bool *   moved;
+    bool     res = false;
+    unsigned left = 0;
+
+    if (!(moved = calloc(store->keyc, sizeof(*moved)))) {
+        RNP_LOG("allocation failed");
+        return false;
+    }
+
+    stats->keys += store->keyc;
+    for (unsigned i = 0; i < store->keyc; i++) {
+        pgp_key_t *      key = store->keys[i];
+        rnp_key_store_t *dest = pgp_is_key_secret(key) ? secring : pubring;
+        pgp_key_t *      newkey;
+
+        if (moved[i] || rnp_key_store_lazy_get_key_by_grip(io, dest, key->grip)) {
+            continue;
+        }
+        if (cb) {
+            cb(store, key, param);
+        }
+        if (!(newkey = rnp_key_store_add_key(io, dest, key))) {
+            RNP_LOG("failed to add key to destination key store");
+            goto done;
+        }
+        moved[i] = true;
+        stats->imported++;
+
+        /* subkeys array is moved together with the key, so point it to the keyring */
+        for (unsigned j = 0; j < newkey->subkeyc; j++) {
+            pgp_key_t *subkey = newkey->subkeys[j];
+            unsigned   pos = import_key_pos(store, subkey, i + 1);
+            pgp_key_t *added = rnp_key_store_lazy_get_key_by_grip(io, dest, subkey->grip);
+
+            if (!added) {
+                if ((pos == UINT_MAX) || !(added = rnp_key_store_add_key(io, dest, subkey))) {
+                    RNP_LOG("failed to add key to destination key store");
+                    goto done;
+                }
+                moved[pos] = true;
+                stats->imported++;
+            }
+            newkey->subkeys[j] = added;
+        }
+    }
+    res = true;
+done:
+    /* moved keys are owned by the keyrings now, so drop them without freeing */
+    for (unsigned i = 0; i < store->keyc; i++) {
+        if (!moved[i]) {
+            store->keys[left++] = store->keys[i];
+        }
+    }
+    store->keyc = left;
+    free(moved);
+    return res;
+}
+
+bool
+rnp_key_store_import_files(pgp_io_t *              io,
+                           rnp_key_store_t *       pubring,
+                           rnp_key_store_t *       secring,
+                           const char *const *     paths,
+                           size_t                  count,
+                           pgp_thread_pool_t *     pool,
+                           rnp_key_import_cb *     cb,
+                           void *                  param,
+                           rnp_key_import_stats_t *stats)
+{
+    import_paths_t         files = {0};
+    import_file_t *        batch = NULL;
+    pgp_task_t *           tasks = NULL;
+    rnp_key_import_stats_t dummy = {0};
+    struct stat            st;
+    size_t                 batchc;
+    bool                   res = false;
+
+    if (!stats) {
+        stats = &dummy;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    for (size_t i = 0; i < count; i++) {
+        if (!stat(paths[i], &st) && S_ISDIR(st.st_mode)) {
+            if (!import_paths_add_dir(&files, paths[i])) {
+                goto done;
+            }
+        } else if (!import_paths_add(&files, paths[i])) {
+            goto done;
+        }
+    }
+
+    batchc = files.pathc < IMPORT_BATCH_FILES ? files.pathc : IMPORT_BATCH_FILES;
+    if (!batchc) {
+        res = true;
+        goto done;
+    }
+    batch = calloc(batchc, sizeof(*batch));
+    tasks = calloc(batchc, sizeof(*tasks));
+    if (!batch || !tasks) {
+        RNP_LOG("allocation failed");
+        goto done;
+    }
+
+    for (unsigned from = 0; from < files.pathc; from += batchc) {
+        size_t num = files.pathc - from < batchc ? files.pathc - from : batchc;
+
+        for (size_t i = 0; i < num; i++) {
+            batch[i] = (import_file_t){
+              .path = files.paths[from + i], .io = io, .pubring = pubring, .store = NULL};
+            tasks[i] = (pgp_task_t){.func = import_parse_file, .param = &batch[i]};
+        }
+        pgp_thread_pool_run(pool, tasks, num);
+
+        /* merge in order of files, so the first copy of the key wins */
+        res = true;
+        for (size_t i = 0; i < num; i++) {
+            stats->files++;
+            if (!batch[i].store) {
+                stats->failed++;
+                continue;
+            }
+            if (res) {
+                res =
+                  import_merge_store(io, pubring, secring, batch[i].store, cb, param, stats);
+            }
+            rnp_key_store_free(batch[i].store);
+        }
+        if (!res) {
+            goto done;
+        }
+    }
+done:
+    free(batch);
+    free(tasks);
+    import_paths_free(&files);
+    return res;
+}
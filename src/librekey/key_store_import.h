@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RNP_KEY_STORE_IMPORT_H
+#define RNP_KEY_STORE_IMPORT_H
+
+#include <rnp/rnp.h>
+#include <rekey/rnp_key_store.h>
+#include "thread-pool.h"
+
+/* Bulk import: key files are read and parsed concurrently into the temporary key stores,
+ * then keys are merged into the destination keyrings on the calling thread, in the order of
+ * files. Keys which are already in the keyrings, or were imported from the previous files,
+ * are skipped. Lookups go through the grip index, so importing N keys into the keyring of
+ * M keys doesn't take O(N * M). Keyrings are not saved. */
+
+typedef struct rnp_key_import_stats_t {
+    size_t files;    /* number of processed files */
+    size_t failed;   /* number of files which could not be read or contain no keys */
+    size_t keys;     /* number of keys, including subkeys, found in the files */
+    size_t imported; /* number of keys, including subkeys, added to the keyrings */
+} rnp_key_import_stats_t;
+
+/** @brief called for each new primary key (or orphaned subkey) before it is added.
+ *  @param store temporary key store with the key and its subkeys
+ **/
+typedef void rnp_key_import_cb(const rnp_key_store_t *store,
+                               const pgp_key_t *      key,
+                               void *                 param);
+
+/** @brief import keys from the files into the keyrings.
+ *  @param paths files to import from. Directories are expanded to the regular files in them
+ *         (non-recursively, sorted by name). Format is guessed by the file name suffix:
+ *         .kbx for KBX, .key for G10, GPG otherwise. Armor is detected by contents.
+ *  @param pool thread pool used to parse the files, may be NULL
+ *  @param cb optional callback, called for the each new key
+ *  @param stats optional import statistics
+ *  @return false on fatal error only, files which fail to load are counted in stats
+ **/
+bool rnp_key_store_import_files(pgp_io_t *              io,
+                                rnp_key_store_t *       pubring,
+                                rnp_key_store_t *       secring,
+                                const char *const *     paths,
+                                size_t                  count,
+                                pgp_thread_pool_t *     pool,
+                                rnp_key_import_cb *     cb,
+                                void *                  param,
+                                rnp_key_import_stats_t *stats);
+
+#endif // RNP_KEY_STORE_IMPORT_H
@@ -0,0 +1,686 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <rnp/rnp_sdk.h>
+
+#include "key_store_journal.h"
+#include "key_store_lazy.h"
+#include "key_store_pgp.h"
+#include "key_store_kbx.h"
+#include "pgp-key.h"
+#include "hash.h"
+#include "utils.h"
+
+#define JOURNAL_MAGIC "RNPJ"
+#define TOMBSTONE_MAGIC "RNPT"
+#define JOURNAL_VERSION 1
+/* magic, version, 3 reserved bytes, keyring size before append, length of appended data */
+#define JOURNAL_HDR_SIZE 24
+/* SHA-256 of the header and appended data */
+#define JOURNAL_CHECKSUM_SIZE 32
+/* magic, version, 3 reserved bytes, number of grips */
+#define TOMBSTONE_HDR_SIZE 12
+/* keyring is compacted when more than 1/JOURNAL_COMPACT_RATIO of its keys are removed */
+#define JOURNAL_COMPACT_RATIO 4
+
+typedef struct pgp_key_grip_t {
+    uint8_t grip[PGP_FINGERPRINT_SIZE];
+} pgp_key_grip_t;
+
+struct rnp_key_store_journal_t {
+    char *   path;     /* path of the tracked keyring */
+    uint64_t size;     /* keyring size after the load or the last save */
+    uint64_t mtime;    /* keyring modification time after the load or the last save */
+    unsigned filekeys; /* number of keys in the keyring file, including removed ones */
+    bool     compact;  /* changes cannot be appended, so keyring must be rewritten */
+    DYNARRAY(pgp_key_grip_t, added); /* keys added after the last save, in order */
+    DYNARRAY(pgp_key_grip_t, tomb);  /* removed keys, sorted */
+};
+
+static void
+journal_write_uint64(uint8_t *buf, uint64_t val)
+{
+    STORE32BE(buf, (uint32_t)(val >> 32));
+    STORE32BE(buf + 4, (uint32_t) val);
+}
+
+static uint32_t
+journal_read_uint32(const uint8_t *buf)
+{
+    return ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) | ((uint32_t) buf[2] << 8) |
+           (uint32_t) buf[3];
+}
+
+static uint64_t
+journal_read_uint64(const uint8_t *buf)
+{
+    return ((uint64_t) journal_read_uint32(buf) << 32) | journal_read_uint32(buf + 4);
+}
+
+static bool
+journal_path(char *buf, size_t len, const char *path, const char *suffix)
+{
+    return snprintf(buf, len, "%s%s", path, suffix) < (int) len;
+}
+
+/* flush the file contents to the storage */
+static bool
+journal_sync_file(FILE *fp)
+{
+    return !fflush(fp) && !fsync(fileno(fp));
+}
+
+/* flush the directory entry changes (create, rename, unlink) of the file to the storage */
+static bool
+journal_sync_dir(const char *path)
+{
+    char  dir[MAXPATHLEN];
+    char *slash;
+    int   fd;
+    bool  res;
+
+    if (snprintf(dir, sizeof(dir), "%s", path) >= (int) sizeof(dir)) {
+        return false;
+    }
+    if (!(slash = strrchr(dir, '/'))) {
+        strcpy(dir, ".");
+    } else if (slash == dir) {
+        dir[1] = '\0';
+    } else {
+        *slash = '\0';
+    }
+
+    if ((fd = open(dir, O_RDONLY)) < 0) {
+        return false;
+    }
+    res = !fsync(fd);
+    close(fd);
+    return res;
+}
+
+static bool
+journal_checksum(const uint8_t *hdr, const uint8_t *data, size_t len, uint8_t *checksum)
+{
+    pgp_hash_t hash = {0};
+
+    if (!pgp_hash_create(&hash, PGP_HASH_SHA256)) {
+        return false;
+    }
+    pgp_hash_add(&hash, hdr, JOURNAL_HDR_SIZE);
+    pgp_hash_add(&hash, data, len);
+    return pgp_hash_finish(&hash, checksum) == JOURNAL_CHECKSUM_SIZE;
+}
+
+/* binary search of the grip in the sorted tombstones, pos is set to the insertion point */
+static bool
+journal_find_tomb(const rnp_key_store_journal_t *journal, const uint8_t *grip, unsigned *pos)
+{
+    unsigned lo = 0;
+    unsigned hi = journal->tombc;
+
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        int      cmp = memcmp(journal->tombs[mid].grip, grip, PGP_FINGERPRINT_SIZE);
+        if (!cmp) {
+            *pos = mid;
+            return true;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    *pos = lo;
+    return false;
+}
+
+static bool
+journal_add_tomb(rnp_key_store_journal_t *journal, const uint8_t *grip)
+{
+    unsigned pos;
+
+    if (journal_find_tomb(journal, grip, &pos)) {
+        return true;
+    }
+    EXPAND_ARRAY(journal, tomb);
+    if (journal->tombc == journal->tombvsize) {
+        RNP_LOG("allocation failed");
+        return false;
+    }
+    memmove(&journal->tombs[pos + 1],
+            &journal->tombs[pos],
+            (journal->tombc - pos) * sizeof(*journal->tombs));
+    memcpy(journal->tombs[pos].grip, grip, PGP_FINGERPRINT_SIZE);
+    journal->tombc++;
+    return true;
+}
+
+static bool
+journal_find_added(const rnp_key_store_journal_t *journal, const uint8_t *grip, unsigned *pos)
+{
+    for (unsigned i = 0; i < journal->addedc; i++) {
+        if (!memcmp(journal->addeds[i].grip, grip, PGP_FINGERPRINT_SIZE)) {
+            *pos = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool
+journal_read_tombs(rnp_key_store_journal_t *journal, const char *delpath)
+{
+    uint8_t        hdr[TOMBSTONE_HDR_SIZE];
+    pgp_key_grip_t grip;
+    uint32_t       count;
+    FILE *         fp;
+    bool           res = false;
+
+    if (!(fp = fopen(delpath, "rb"))) {
+        /* no removed keys */
+        return errno == ENOENT;
+    }
+
+    if ((fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) ||
+        memcmp(hdr, TOMBSTONE_MAGIC, 4) || (hdr[4] != JOURNAL_VERSION)) {
+        goto done;
+    }
+    count = journal_read_uint32(&hdr[8]);
+    for (uint32_t i = 0; i < count; i++) {
+        if ((fread(grip.grip, 1, sizeof(grip.grip), fp) != sizeof(grip.grip)) ||
+            !journal_add_tomb(journal, grip.grip)) {
+            goto done;
+        }
+    }
+    res = true;
+done:
+    fclose(fp);
+    if (!res) {
+        RNP_LOG("failed to read removed keys from %s", delpath);
+    }
+    return res;
+}
+
+/* atomically replace the tombstone file. Grips of the keys which were removed and then added
+ * back are not written, since such keyring is compacted right after this */
+static bool
+journal_write_tombs(const rnp_key_store_journal_t *journal)
+{
+    char     delpath[MAXPATHLEN];
+    char     tmppath[MAXPATHLEN];
+    uint8_t  hdr[TOMBSTONE_HDR_SIZE] = {0};
+    uint32_t count = 0;
+    unsigned pos;
+    FILE *   fp;
+    bool     res = false;
+
+    if (!journal_path(delpath, sizeof(delpath), journal->path, ".del") ||
+        !journal_path(tmppath, sizeof(tmppath), journal->path, ".del.tmp")) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < journal->tombc; i++) {
+        count += !journal_find_added(journal, journal->tombs[i].grip, &pos);
+    }
+    if (!count) {
+        if (unlink(delpath) && (errno != ENOENT)) {
+            RNP_LOG("failed to remove %s", delpath);
+            return false;
+        }
+        return true;
+    }
+
+    if (!(fp = fopen(tmppath, "wb"))) {
+        RNP_LOG("failed to create %s", tmppath);
+        return false;
+    }
+    memcpy(hdr, TOMBSTONE_MAGIC, 4);
+    hdr[4] = JOURNAL_VERSION;
+    STORE32BE(&hdr[8], count);
+    if (fwrite(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) {
+        goto done;
+    }
+    for (unsigned i = 0; i < journal->tombc; i++) {
+        const uint8_t *grip = journal->tombs[i].grip;
+        if (journal_find_added(journal, grip, &pos)) {
+            continue;
+        }
+        if (fwrite(grip, 1, PGP_FINGERPRINT_SIZE, fp) != PGP_FINGERPRINT_SIZE) {
+            goto done;
+        }
+    }
+    res = journal_sync_file(fp);
+done:
+    if (fclose(fp)) {
+        res = false;
+    }
+    if (res && rename(tmppath, delpath)) {
+        res = false;
+    }
+    if (!res) {
+        RNP_LOG("failed to write %s", delpath);
+        unlink(tmppath);
+        return false;
+    }
+    return journal_sync_dir(delpath);
+}
+
+/* write data at the offset size of the keyring, dropping everything after it */
+static bool
+journal_apply(const char *path, uint64_t size, const uint8_t *data, size_t len)
+{
+    FILE *fp;
+    bool  res;
+
+    if (!(fp = fopen(path, "r+b"))) {
+        RNP_LOG("failed to open %s", path);
+        return false;
+    }
+    res = !ftruncate(fileno(fp), (off_t) size) && !fseeko(fp, (off_t) size, SEEK_SET) &&
+          (fwrite(data, 1, len, fp) == len) && journal_sync_file(fp);
+    if (fclose(fp)) {
+        res = false;
+    }
+    if (!res) {
+        RNP_LOG("failed to append to %s", path);
+    }
+    return res;
+}
+
+static bool
+journal_drop(const char *jpath)
+{
+    if (unlink(jpath)) {
+        RNP_LOG("failed to remove %s", jpath);
+        return false;
+    }
+    return journal_sync_dir(jpath);
+}
+
+/* append data to the keyring: data is written and synced to the journal first, so if append
+ * is interrupted it will be finished on the next load */
+static bool
+journal_append(const char *path, uint64_t size, const pgp_memory_t *mem)
+{
+    char    jpath[MAXPATHLEN];
+    uint8_t hdr[JOURNAL_HDR_SIZE] = {0};
+    uint8_t checksum[JOURNAL_CHECKSUM_SIZE];
+    FILE *  fp;
+    bool    res;
+
+    if (!journal_path(jpath, sizeof(jpath), path, ".journal")) {
+        return false;
+    }
+
+    memcpy(hdr, JOURNAL_MAGIC, 4);
+    hdr[4] = JOURNAL_VERSION;
+    journal_write_uint64(&hdr[8], size);
+    journal_write_uint64(&hdr[16], mem->length);
+    if (!journal_checksum(hdr, mem->buf, mem->length, checksum)) {
+        return false;
+    }
+
+    if (!(fp = fopen(jpath, "wb"))) {
+        RNP_LOG("failed to create %s", jpath);
+        return false;
+    }
+    res = (fwrite(hdr, 1, sizeof(hdr), fp) == sizeof(hdr)) &&
+          (fwrite(mem->buf, 1, mem->length, fp) == mem->length) &&
+          (fwrite(checksum, 1, sizeof(checksum), fp) == sizeof(checksum)) &&
+          journal_sync_file(fp);
+    if (fclose(fp)) {
+        res = false;
+    }
+    if (!res || !journal_sync_dir(jpath)) {
+        RNP_LOG("failed to write %s", jpath);
+        unlink(jpath);
+        return false;
+    }
+
+    /* on failure journal is left for the recovery */
+    return journal_apply(path, size, mem->buf, mem->length) && journal_drop(jpath);
+}
+
+bool
+rnp_key_store_journal_recover(pgp_io_t *io, rnp_key_store_t *keyring)
+{
+    char         jpath[MAXPATHLEN];
+    pgp_memory_t mem = {0};
+    struct stat  st;
+    uint8_t      checksum[JOURNAL_CHECKSUM_SIZE];
+    uint64_t     size;
+    uint64_t     len;
+    bool         valid;
+    bool         res = false;
+
+    if ((keyring->format != GPG_KEY_STORE) && (keyring->format != KBX_KEY_STORE)) {
+        return true;
+    }
+    if (!journal_path(jpath, sizeof(jpath), keyring->path, ".journal")) {
+        return false;
+    }
+    if (stat(jpath, &st)) {
+        return errno == ENOENT;
+    }
+    if (!pgp_mem_readfile(&mem, jpath)) {
+        return false;
+    }
+
+    /* journal is synced before the keyring is touched, so incomplete one is just dropped */
+    valid = (mem.length >= JOURNAL_HDR_SIZE + JOURNAL_CHECKSUM_SIZE) &&
+            !memcmp(mem.buf, JOURNAL_MAGIC, 4) && (mem.buf[4] == JOURNAL_VERSION);
+    if (valid) {
+        size = journal_read_uint64(&mem.buf[8]);
+        len = journal_read_uint64(&mem.buf[16]);
+        valid = (len == mem.length - JOURNAL_HDR_SIZE - JOURNAL_CHECKSUM_SIZE) &&
+                journal_checksum(mem.buf, &mem.buf[JOURNAL_HDR_SIZE], len, checksum) &&
+                !memcmp(checksum, &mem.buf[JOURNAL_HDR_SIZE + len], JOURNAL_CHECKSUM_SIZE);
+    }
+    if (valid && (stat(keyring->path, &st) || ((uint64_t) st.st_size < size))) {
+        RNP_LOG("journal %s doesn't match the keyring", jpath);
+        valid = false;
+    }
+
+    if (valid) {
+        if (rnp_get_debug(__FILE__)) {
+            fprintf(io->errs, "Finishing interrupted save of '%s'\n", keyring->path);
+        }
+        if (!journal_apply(keyring->path, size, &mem.buf[JOURNAL_HDR_SIZE], len)) {
+            goto done;
+        }
+    }
+    res = journal_drop(jpath);
+done:
+    pgp_memory_release(&mem);
+    return res;
+}
+
+static bool
+journal_stat(rnp_key_store_journal_t *journal)
+{
+    struct stat st;
+
+    if (stat(journal->path, &st) || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    journal->size = st.st_size;
+    journal->mtime = st.st_mtime;
+    return true;
+}
+
+bool
+rnp_key_store_journal_start(pgp_io_t *io, rnp_key_store_t *keyring)
+{
+    rnp_key_store_journal_t *journal;
+    char                     delpath[MAXPATHLEN];
+
+    rnp_key_store_journal_free(keyring);
+    if ((keyring->format != GPG_KEY_STORE) && (keyring->format != KBX_KEY_STORE)) {
+        return true;
+    }
+    if (!journal_path(delpath, sizeof(delpath), keyring->path, ".del")) {
+        return false;
+    }
+
+    if (!(journal = calloc(1, sizeof(*journal))) || !(journal->path = strdup(keyring->path))) {
+        RNP_LOG("allocation failed");
+        free(journal);
+        return false;
+    }
+    /* keyring is not loaded from the file, so it will be written completely */
+    if (!journal_stat(journal)) {
+        journal->compact = true;
+    }
+    if (!journal_read_tombs(journal, delpath)) {
+        FREE_ARRAY(journal, tomb);
+        free(journal->path);
+        free(journal);
+        return false;
+    }
+
+    journal->filekeys = keyring->lazy ? rnp_key_store_lazy_key_count(keyring) : keyring->keyc;
+    keyring->journal = journal;
+    rnp_key_store_journal_filter(io, keyring, 0);
+    return true;
+}
+
+void
+rnp_key_store_journal_free(rnp_key_store_t *keyring)
+{
+    rnp_key_store_journal_t *journal = keyring->journal;
+
+    if (!journal) {
+        return;
+    }
+    FREE_ARRAY(journal, added);
+    FREE_ARRAY(journal, tomb);
+    free(journal->path);
+    free(journal);
+    keyring->journal = NULL;
+}
+
+void
+rnp_key_store_journal_key_added(rnp_key_store_t *keyring, const pgp_key_t *key)
+{
+    rnp_key_store_journal_t *journal = keyring->journal;
+    unsigned                 pos;
+
+    if (!journal) {
+        return;
+    }
+    /* previous version of the key is still in the file */
+    if (journal_find_tomb(journal, key->grip, &pos)) {
+        journal->compact = true;
+    }
+    EXPAND_ARRAY(journal, added);
+    if (journal->addedc == journal->addedvsize) {
+        /* keyring rewrite doesn't need the list */
+        journal->compact = true;
+        return;
+    }
+    memcpy(journal->addeds[journal->addedc++].grip, key->grip, PGP_FINGERPRINT_SIZE);
+}
+
+void
+rnp_key_store_journal_key_removed(rnp_key_store_t *keyring, const pgp_key_t *key)
+{
+    rnp_key_store_journal_t *journal = keyring->journal;
+    unsigned                 pos;
+
+    if (!journal) {
+        return;
+    }
+    /* key was not written yet */
+    if (journal_find_added(journal, key->grip, &pos)) {
+        memmove(&journal->addeds[pos],
+                &journal->addeds[pos + 1],
+                (journal->addedc - pos - 1) * sizeof(*journal->addeds));
+        journal->addedc--;
+        return;
+    }
+    if (!journal_add_tomb(journal, key->grip)) {
+        journal->compact = true;
+    }
+}
+
+static bool
+journal_key_tombstoned(const pgp_key_t *key, void *param)
+{
+    unsigned pos;
+    return journal_find_tomb(param, key->grip, &pos);
+}
+
+void
+rnp_key_store_journal_filter(pgp_io_t *io, rnp_key_store_t *keyring, unsigned from)
+{
+    rnp_key_store_journal_t *journal = keyring->journal;
+
+    if (!journal || !journal->tombc) {
+        return;
+    }
+    /* these are not the removals to record */
+    keyring->journal = NULL;
+    rnp_key_store_remove_keys_if(io, keyring, from, journal_key_tombstoned, journal);
+    keyring->journal = journal;
+}
+
+/* serialize the added keys, returns false if they cannot be appended */
+static bool
+journal_write_added(pgp_io_t *io, rnp_key_store_t *keyring, pgp_memory_t *mem)
+{
+    rnp_key_store_journal_t *journal = keyring->journal;
+    unsigned                 written = 0;
+    unsigned                 pos;
+
+    for (unsigned i = 0; i < journal->addedc; i++) {
+        pgp_key_t *key = rnp_key_store_get_key_by_grip(io, keyring, journal->addeds[i].grip);
+        if (!key) {
+            return false;
+        }
+        /* subkeys are written after their primary key */
+        if (!pgp_key_is_primary_key(key)) {
+            continue;
+        }
+
+        if (keyring->format == KBX_KEY_STORE) {
+            /* blob includes all of the subkeys, so all of them must be new */
+            for (unsigned j = 0; j < key->subkeyc; j++) {
+                if (!journal_find_added(journal, key->subkeys[j]->grip, &pos)) {
+                    return false;
+                }
+            }
+            if (!rnp_key_store_kbx_write_pgp(io, key, mem)) {
+                return false;
+            }
+            written += 1 + key->subkeyc;
+            continue;
+        }
+
+        if (!rnp_key_store_pgp_key_to_mem(io, key, mem)) {
+            return false;
+        }
+        written++;
+        for (unsigned j = 0; j < key->subkeyc; j++) {
+            const pgp_key_t *subkey = key->subkeys[j];
+            if (!journal_find_added(journal, subkey->grip, &pos)) {
+                continue;
+            }
+            if (!rnp_key_store_pgp_key_to_mem(io, subkey, mem)) {
+                return false;
+            }
+            written++;
+        }
+    }
+
+    /* subkeys of the existing keys need to be placed after them */
+    return written == journal->addedc;
+}
+
+bool
+rnp_key_store_journal_save(pgp_io_t *io, rnp_key_store_t *keyring, bool *saved)
+{
+    rnp_key_store_journal_t *journal = keyring->journal;
+    pgp_memory_t             mem = {0};
+    struct stat              st;
+    uint64_t                 size;
+    bool                     append;
+
+    *saved = false;
+    if (!journal) {
+        return true;
+    }
+
+    append = !journal->compact && journal->size && !strcmp(journal->path, keyring->path) &&
+             !stat(keyring->path, &st) && ((uint64_t) st.st_size == journal->size) &&
+             ((uint64_t) st.st_mtime == journal->mtime) &&
+             (journal->tombc * JOURNAL_COMPACT_RATIO <= journal->filekeys) &&
+             journal_write_added(io, keyring, &mem);
+
+    /* removals are saved anyway, since compaction may be interrupted */
+    if (!journal_write_tombs(journal)) {
+        pgp_memory_release(&mem);
+        return false;
+    }
+    if (!append) {
+        pgp_memory_release(&mem);
+        if (rnp_get_debug(__FILE__)) {
+            fprintf(io->errs, "Keyring '%s' will be rewritten\n", keyring->path);
+        }
+        return true;
+    }
+
+    if (mem.length) {
+        size = journal->size;
+        if (!journal_append(keyring->path, size, &mem)) {
+            pgp_memory_release(&mem);
+            return false;
+        }
+        if (!journal_stat(journal)) {
+            journal->compact = true;
+        }
+        rnp_key_store_lazy_appended(io, keyring, size);
+    }
+    pgp_memory_release(&mem);
+
+    journal->filekeys += journal->addedc;
+    FREE_ARRAY(journal, added);
+    *saved = true;
+    return true;
+}
+
+bool
+rnp_key_store_journal_compacted(pgp_io_t *io, rnp_key_store_t *keyring)
+{
+    rnp_key_store_journal_t *journal = keyring->journal;
+    char *                   path;
+
+    if (!journal) {
+        return true;
+    }
+    if (!(path = strdup(keyring->path))) {
+        RNP_LOG("allocation failed");
+        return false;
+    }
+    free(journal->path);
+    journal->path = path;
+    FREE_ARRAY(journal, added);
+    FREE_ARRAY(journal, tomb);
+    journal->filekeys = keyring->keyc;
+    journal->compact = !journal_stat(journal);
+    /* new keyring is already renamed, sync it before dropping the tombstones */
+    return journal_sync_dir(keyring->path) && journal_write_tombs(journal);
+}
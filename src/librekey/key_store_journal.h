@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RNP_KEY_STORE_JOURNAL_H
+#define RNP_KEY_STORE_JOURNAL_H
+
+#include <rnp/rnp.h>
+#include <rekey/rnp_key_store.h>
+
+/* Incremental mode of the GPG and KBX keyrings: keys, added after the load, are appended to
+ * the end of the keyring file instead of rewriting it. Append goes through the journal file
+ * '<keyring>.journal', so interrupted append is rolled forward on the next load. Removed keys
+ * are listed by grip in the tombstone file '<keyring>.del' and skipped on load, until the
+ * keyring is compacted, i.e. rewritten completely. Compaction happens when append is not
+ * possible, or when too many of the keys in the file are removed. */
+
+/** @brief roll forward or drop the journal left by the interrupted save of the keyring.
+ *  Must be called before the keyring file is read.
+ **/
+bool rnp_key_store_journal_recover(pgp_io_t *io, rnp_key_store_t *keyring);
+
+/** @brief start tracking changes of the just loaded keyring, dropping the keys listed in the
+ *  tombstone file. Does nothing if keyring format doesn't support incremental save.
+ **/
+bool rnp_key_store_journal_start(pgp_io_t *io, rnp_key_store_t *keyring);
+
+/** @brief stop tracking changes, keys are left in the keyring **/
+void rnp_key_store_journal_free(rnp_key_store_t *keyring);
+
+/** @brief record the key added to the keyring **/
+void rnp_key_store_journal_key_added(rnp_key_store_t *keyring, const pgp_key_t *key);
+
+/** @brief record the key, which is about to be removed from the keyring **/
+void rnp_key_store_journal_key_removed(rnp_key_store_t *keyring, const pgp_key_t *key);
+
+/** @brief drop keys [from, keyc) which are listed in the tombstone file. Used for the keys
+ *  which are loaded from the file after the rnp_key_store_journal_start() call.
+ **/
+void rnp_key_store_journal_filter(pgp_io_t *io, rnp_key_store_t *keyring, unsigned from);
+
+/** @brief save changes since the load or the last save.
+ *  @param saved is set to false if changes cannot be saved incrementally and keyring
+ *         should be compacted, then rnp_key_store_journal_compacted() must be called
+ *  @return false on I/O error
+ **/
+bool rnp_key_store_journal_save(pgp_io_t *io, rnp_key_store_t *keyring, bool *saved);
+
+/** @brief restart tracking after the keyring was completely rewritten **/
+bool rnp_key_store_journal_compacted(pgp_io_t *io, rnp_key_store_t *keyring);
+
+#endif // RNP_KEY_STORE_JOURNAL_H
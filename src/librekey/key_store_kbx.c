@@ -480,7 +480,7 @@ rnp_key_store_kbx_write_header(rnp_key_store_t *key_store, pgp_memory_t *m)
              !pu32(m, file_created_at) || !pu32(m, time(NULL)) || !pu32(m, 0)); // RFU
 }
 
-static bool
+bool
 rnp_key_store_kbx_write_pgp(pgp_io_t *io, pgp_key_t *key, pgp_memory_t *m)
 {
     unsigned     i;
@@ -690,10 +690,10 @@ rnp_key_store_kbx_to_mem(pgp_io_t *io, rnp_key_store_t *key_store, pgp_memory_t
     }
 
     for (i = 0; i < key_store->keyc; i++) {
-        if (!pgp_key_is_primary_key(&key_store->keys[i])) {
+        if (!pgp_key_is_primary_key(key_store->keys[i])) {
             continue;
         }
-        if (!rnp_key_store_kbx_write_pgp(io, &key_store->keys[i], memory)) {
+        if (!rnp_key_store_kbx_write_pgp(io, key_store->keys[i], memory)) {
             RNP_LOG_FD(io->errs, "Can't write PGP blobs for key %d\n", i);
             return false;
         }
@@ -32,5 +32,6 @@
 
 bool rnp_key_store_kbx_from_mem(pgp_io_t *, rnp_key_store_t *, pgp_memory_t *);
 bool rnp_key_store_kbx_to_mem(pgp_io_t *, rnp_key_store_t *, pgp_memory_t *);
+bool rnp_key_store_kbx_write_pgp(pgp_io_t *, pgp_key_t *, pgp_memory_t *);
 
 #endif // RNP_KEY_STORE_KBX_H
@@ -0,0 +1,775 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <regex.h>
+#include <unistd.h>
+
+#include <rnp/rnp_sdk.h>
+#include <librepgp/stream-common.h>
+#include <librepgp/stream-packet.h>
+
+#include "key_store_lazy.h"
+#include "key_store_journal.h"
+#include "key_store_pgp.h"
+#include "pgp-key.h"
+#include "hash.h"
+#include "utils.h"
+
+#define LAZY_INDEX_MAGIC "RNPI"
+#define LAZY_INDEX_VERSION 2
+/* magic, version, 3 reserved bytes, keyring size, keyring mtime, number of entries, size of
+ * the userids table, keyring hash */
+#define LAZY_INDEX_HDR_SIZE 64
+/* keyid, fingerprint length, fingerprint, grip, key flags, number of userids, offset of the
+ * first userid, index of the primary key, offset, length */
+#define LAZY_INDEX_ENTRY_SIZE (PGP_KEY_ID_SIZE + 1 + 2 * PGP_FINGERPRINT_SIZE + 23)
+/* SHA-256 of the keyring, checked when keyring's mtime is changed but size is the same. It is
+ * not recalculated when keys are appended, all-zero hash is unknown and never matches */
+#define LAZY_INDEX_HASH_SIZE 32
+/* entry of the key without primary key, i.e. primary key itself */
+#define LAZY_NO_PRIMARY UINT32_MAX
+
+typedef struct pgp_lazy_key_t {
+    uint8_t           keyid[PGP_KEY_ID_SIZE];
+    pgp_fingerprint_t fingerprint;
+    uint8_t           grip[PGP_FINGERPRINT_SIZE];
+    uint8_t           key_flags; /* key flags as they are after the full load */
+    uint16_t          uidc;      /* number of userids */
+    uint32_t          uidoff;    /* offset of the first userid in the userids table */
+    uint32_t          primary;   /* index of the primary key or LAZY_NO_PRIMARY */
+    uint64_t          offset;    /* offset of the transferable key, containing this key */
+    uint32_t          length;    /* length of the transferable key */
+    bool              loaded;    /* transferable key is parsed into the keyring */
+} pgp_lazy_key_t;
+
+struct rnp_key_store_lazy_t {
+    char *       path;                       /* path of the indexed keyring */
+    uint64_t     size;                       /* keyring size when index was built */
+    uint64_t     mtime;                      /* keyring mtime when index was built */
+    uint8_t      hash[LAZY_INDEX_HASH_SIZE]; /* keyring hash when index was built */
+    pgp_memory_t uids;                       /* userids table, NUL-terminated strings */
+    DYNARRAY(pgp_lazy_key_t, key);
+};
+
+typedef bool lazy_match_func_t(const rnp_key_store_lazy_t *lazy,
+                               const pgp_lazy_key_t *      key,
+                               const void *                data);
+
+/* name search: hex keyid or extended regex on the userids, as rnp_key_store_get_key_by_name */
+typedef struct lazy_name_t {
+    uint8_t keyid[PGP_KEY_ID_SIZE];
+    regex_t regex;
+} lazy_name_t;
+
+static void
+lazy_write_uint64(uint8_t *buf, uint64_t val)
+{
+    STORE32BE(buf, (uint32_t)(val >> 32));
+    STORE32BE(buf + 4, (uint32_t) val);
+}
+
+static uint32_t
+lazy_read_uint32(const uint8_t *buf)
+{
+    return ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) | ((uint32_t) buf[2] << 8) |
+           (uint32_t) buf[3];
+}
+
+static uint64_t
+lazy_read_uint64(const uint8_t *buf)
+{
+    return ((uint64_t) lazy_read_uint32(buf) << 32) | lazy_read_uint32(buf + 4);
+}
+
+static bool
+lazy_add_key(rnp_key_store_lazy_t *lazy, const pgp_lazy_key_t *key)
+{
+    EXPAND_ARRAY(lazy, key);
+    if (lazy->keyc == lazy->keyvsize) {
+        RNP_LOG("allocation failed");
+        return false;
+    }
+    lazy->keys[lazy->keyc++] = *key;
+    return true;
+}
+
+static bool
+lazy_hash_keyring(const char *path, uint8_t *hash)
+{
+    pgp_hash_t hctx = {0};
+    uint8_t    buf[PGP_INPUT_CACHE_SIZE];
+    size_t     read;
+    FILE *     fp;
+    bool       res;
+
+    if (!(fp = fopen(path, "rb"))) {
+        return false;
+    }
+    if (!pgp_hash_create(&hctx, PGP_HASH_SHA256)) {
+        fclose(fp);
+        return false;
+    }
+    while ((read = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        pgp_hash_add(&hctx, buf, read);
+    }
+    res = !ferror(fp);
+    fclose(fp);
+    return (pgp_hash_finish(&hctx, hash) == LAZY_INDEX_HASH_SIZE) && res;
+}
+
+static bool
+lazy_hash_known(const uint8_t *hash)
+{
+    for (size_t i = 0; i < LAZY_INDEX_HASH_SIZE; i++) {
+        if (hash[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* index file is mapped to the memory, so entries are parsed without the extra copying. If
+ * only keyring's mtime was changed then *touched is set and index should be rewritten */
+static bool
+lazy_read_index(rnp_key_store_lazy_t *lazy, const char *idxpath, bool *touched)
+{
+    pgp_memory_t   mem = {0};
+    const uint8_t *ptr;
+    const uint8_t *uids;
+    uint8_t        hash[LAZY_INDEX_HASH_SIZE];
+    pgp_lazy_key_t key;
+    uint32_t       count;
+    uint32_t       uidsize;
+    struct stat    st;
+    bool           res = false;
+
+    *touched = false;
+    if (stat(idxpath, &st) || !pgp_mem_readfile(&mem, idxpath)) {
+        pgp_memory_release(&mem);
+        return false;
+    }
+
+    ptr = mem.buf;
+    if ((mem.length < LAZY_INDEX_HDR_SIZE) || memcmp(ptr, LAZY_INDEX_MAGIC, 4) ||
+        (ptr[4] != LAZY_INDEX_VERSION) || (lazy_read_uint64(&ptr[8]) != lazy->size)) {
+        goto done;
+    }
+    count = lazy_read_uint32(&ptr[24]);
+    uidsize = lazy_read_uint32(&ptr[28]);
+    if ((uint64_t) count * LAZY_INDEX_ENTRY_SIZE + uidsize !=
+        mem.length - LAZY_INDEX_HDR_SIZE) {
+        goto done;
+    }
+    if (lazy_read_uint64(&ptr[16]) != lazy->mtime) {
+        /* keyring was touched or copied, index is valid while the contents are the same */
+        if (!lazy_hash_known(&ptr[32]) || !lazy_hash_keyring(lazy->path, hash) ||
+            memcmp(hash, &ptr[32], LAZY_INDEX_HASH_SIZE)) {
+            goto done;
+        }
+        *touched = true;
+    }
+    memcpy(lazy->hash, &ptr[32], LAZY_INDEX_HASH_SIZE);
+
+    uids = mem.buf + LAZY_INDEX_HDR_SIZE + (size_t) count * LAZY_INDEX_ENTRY_SIZE;
+    if (uidsize && (uids[uidsize - 1] != '\0')) {
+        goto done;
+    }
+    if (uidsize && !pgp_memory_add(&lazy->uids, uids, uidsize)) {
+        goto done;
+    }
+
+    ptr = mem.buf + LAZY_INDEX_HDR_SIZE;
+    for (uint32_t i = 0; i < count; i++, ptr += LAZY_INDEX_ENTRY_SIZE) {
+        const uint8_t *field = ptr;
+
+        memset(&key, 0, sizeof(key));
+        memcpy(key.keyid, field, PGP_KEY_ID_SIZE);
+        field += PGP_KEY_ID_SIZE;
+        key.fingerprint.length = *field++;
+        memcpy(key.fingerprint.fingerprint, field, PGP_FINGERPRINT_SIZE);
+        field += PGP_FINGERPRINT_SIZE;
+        memcpy(key.grip, field, PGP_FINGERPRINT_SIZE);
+        field += PGP_FINGERPRINT_SIZE;
+        key.key_flags = *field++;
+        key.uidc = ((uint16_t) field[0] << 8) | field[1];
+        key.uidoff = lazy_read_uint32(&field[2]);
+        key.primary = lazy_read_uint32(&field[6]);
+        key.offset = lazy_read_uint64(&field[10]);
+        key.length = lazy_read_uint32(&field[18]);
+
+        if ((key.fingerprint.length > PGP_FINGERPRINT_SIZE) || (key.offset > lazy->size) ||
+            (key.length > lazy->size - key.offset) ||
+            ((key.primary != LAZY_NO_PRIMARY) && (key.primary >= count)) ||
+            (key.uidc && (key.uidoff >= uidsize))) {
+            goto done;
+        }
+        if (!lazy_add_key(lazy, &key)) {
+            goto done;
+        }
+    }
+
+    res = true;
+done:
+    pgp_memory_release(&mem);
+    if (!res) {
+        lazy->keyc = 0;
+        pgp_memory_clear(&lazy->uids);
+    }
+    return res;
+}
+
+static bool
+lazy_write_index(const rnp_key_store_lazy_t *lazy, const char *idxpath)
+{
+    char    tmppath[MAXPATHLEN];
+    uint8_t hdr[LAZY_INDEX_HDR_SIZE] = {0};
+    uint8_t buf[LAZY_INDEX_ENTRY_SIZE];
+    FILE *  fp;
+    bool    res = false;
+
+    if (snprintf(tmppath, sizeof(tmppath), "%s.tmp", idxpath) >= (int) sizeof(tmppath)) {
+        return false;
+    }
+    if (!(fp = fopen(tmppath, "wb"))) {
+        return false;
+    }
+
+    memcpy(hdr, LAZY_INDEX_MAGIC, 4);
+    hdr[4] = LAZY_INDEX_VERSION;
+    lazy_write_uint64(&hdr[8], lazy->size);
+    lazy_write_uint64(&hdr[16], lazy->mtime);
+    STORE32BE(&hdr[24], lazy->keyc);
+    STORE32BE(&hdr[28], (uint32_t) lazy->uids.length);
+    memcpy(&hdr[32], lazy->hash, LAZY_INDEX_HASH_SIZE);
+    if (fwrite(hdr, 1, sizeof(hdr), fp) != sizeof(hdr)) {
+        goto done;
+    }
+
+    for (unsigned i = 0; i < lazy->keyc; i++) {
+        const pgp_lazy_key_t *key = &lazy->keys[i];
+        uint8_t *             field = buf;
+
+        memcpy(field, key->keyid, PGP_KEY_ID_SIZE);
+        field += PGP_KEY_ID_SIZE;
+        *field++ = key->fingerprint.length;
+        memcpy(field, key->fingerprint.fingerprint, PGP_FINGERPRINT_SIZE);
+        field += PGP_FINGERPRINT_SIZE;
+        memcpy(field, key->grip, PGP_FINGERPRINT_SIZE);
+        field += PGP_FINGERPRINT_SIZE;
+        *field++ = key->key_flags;
+        field[0] = key->uidc >> 8;
+        field[1] = key->uidc & 0xff;
+        STORE32BE(&field[2], key->uidoff);
+        STORE32BE(&field[6], key->primary);
+        lazy_write_uint64(&field[10], key->offset);
+        STORE32BE(&field[18], key->length);
+        if (fwrite(buf, 1, sizeof(buf), fp) != sizeof(buf)) {
+            goto done;
+        }
+    }
+    if (lazy->uids.length &&
+        (fwrite(lazy->uids.buf, 1, lazy->uids.length, fp) != lazy->uids.length)) {
+        goto done;
+    }
+
+    res = true;
+done:
+    if (fclose(fp)) {
+        res = false;
+    }
+    if (res && rename(tmppath, idxpath)) {
+        res = false;
+    }
+    if (!res) {
+        unlink(tmppath);
+    }
+    return res;
+}
+
+/* parse the transferable key and add its keys to the index, together with the data which is
+ * available only after the full parsing: userids, key flags and the primary key */
+static bool
+lazy_index_block(pgp_io_t *            io,
+                 rnp_key_store_lazy_t *lazy,
+                 rnp_key_store_t *     tmp,
+                 pgp_memory_t *        block,
+                 uint64_t              start)
+{
+    uint32_t primary = LAZY_NO_PRIMARY;
+    bool     res = false;
+
+    if (!block->length) {
+        return true;
+    }
+    if (block->length > UINT32_MAX) {
+        RNP_LOG("too large key at %llu", (unsigned long long) start);
+        return false;
+    }
+
+    /* keys which cannot be parsed are not loaded by the full load as well */
+    (void) rnp_key_store_pgp_read_from_mem(io, tmp, 0, block);
+    for (unsigned i = 0; i < tmp->keyc; i++) {
+        const pgp_key_t *key = tmp->keys[i];
+        pgp_lazy_key_t   lkey = {0};
+
+        memcpy(lkey.keyid, key->keyid, PGP_KEY_ID_SIZE);
+        lkey.fingerprint = key->fingerprint;
+        memcpy(lkey.grip, key->grip, PGP_FINGERPRINT_SIZE);
+        lkey.key_flags = key->key_flags;
+        lkey.primary = pgp_is_primary_key_tag(key->type) ? LAZY_NO_PRIMARY : primary;
+        lkey.uidoff = (uint32_t) lazy->uids.length;
+        lkey.offset = start;
+        lkey.length = (uint32_t) block->length;
+
+        for (unsigned j = 0; (j < key->uidc) && (j < UINT16_MAX); j++) {
+            size_t len = strlen((const char *) key->uids[j]) + 1;
+
+            if ((lazy->uids.length + len > UINT32_MAX) ||
+                !pgp_memory_add(&lazy->uids, key->uids[j], len)) {
+                RNP_LOG("failed to add userid");
+                goto done;
+            }
+            lkey.uidc++;
+        }
+        if (pgp_is_primary_key_tag(key->type)) {
+            primary = lazy->keyc;
+        }
+        if (!lazy_add_key(lazy, &lkey)) {
+            goto done;
+        }
+    }
+    res = true;
+done:
+    rnp_key_store_clear(tmp);
+    pgp_memory_clear(block);
+    return res;
+}
+
+/* walk over the packet headers starting from the offset and index every transferable key */
+static bool
+lazy_scan_keyring(pgp_io_t *io, rnp_key_store_lazy_t *lazy, uint64_t offset)
+{
+    pgp_source_t     src = {0};
+    rnp_key_store_t *tmp = NULL;
+    pgp_memory_t     block = {0};
+    uint64_t         pos = offset;
+    uint64_t         start = offset; /* offset of the current transferable key */
+    bool             res = false;
+
+    if (init_file_src(&src, lazy->path)) {
+        return false;
+    }
+    if (!(tmp = rnp_key_store_new(RNP_KEYSTORE_GPG, ""))) {
+        goto done;
+    }
+    if (offset && (src_skip(&src, offset) != (ssize_t) offset)) {
+        goto done;
+    }
+
+    while (!src_eof(&src)) {
+        uint8_t hdr[6];
+        ssize_t hdrlen;
+        ssize_t len;
+        int     tag;
+
+        if (((hdrlen = stream_pkt_hdr_len(&src)) < 0) ||
+            (src_peek(&src, hdr, hdrlen) != hdrlen)) {
+            /* armored keyring is not a error, it is just loaded in a usual way */
+            if (pos > offset) {
+                RNP_LOG("bad packet header at %llu", (unsigned long long) pos);
+            }
+            goto done;
+        }
+        tag = get_packet_type(hdr[0]);
+        /* partial and indeterminate lengths are not allowed in keyrings */
+        if ((len = stream_read_pkt_len(&src)) < 0) {
+            RNP_LOG("unsupported packet length at %llu", (unsigned long long) pos);
+            goto done;
+        }
+
+        if (pgp_is_primary_key_tag(tag)) {
+            if (!lazy_index_block(io, lazy, tmp, &block, start)) {
+                goto done;
+            }
+            start = pos;
+        }
+
+        if (!pgp_memory_add(&block, hdr, hdrlen) || !pgp_memory_pad(&block, len)) {
+            RNP_LOG("allocation failed");
+            goto done;
+        }
+        if (src_read(&src, block.buf + block.length, len) != len) {
+            RNP_LOG("failed to read packet at %llu", (unsigned long long) pos);
+            goto done;
+        }
+        block.length += len;
+        pos += hdrlen + len;
+    }
+
+    res = lazy_index_block(io, lazy, tmp, &block, start);
+done:
+    rnp_key_store_free(tmp);
+    pgp_memory_release(&block);
+    src_close(&src);
+    return res;
+}
+
+/* parse transferable key, containing lazy->keys[idx], into the keyring */
+static bool
+lazy_load_block(pgp_io_t *io, rnp_key_store_t *keyring, FILE *fp, unsigned idx)
+{
+    rnp_key_store_lazy_t *lazy = keyring->lazy;
+    pgp_lazy_key_t *      key = &lazy->keys[idx];
+    pgp_memory_t          mem = {0};
+    unsigned              from = 0;
+    unsigned              keyc = keyring->keyc;
+    bool                  res = false;
+
+    if (key->loaded) {
+        return true;
+    }
+
+    if (!(mem.buf = malloc(key->length))) {
+        RNP_LOG("allocation failed");
+        return false;
+    }
+    if (fseeko(fp, (off_t) key->offset, SEEK_SET) ||
+        (fread(mem.buf, 1, key->length, fp) != key->length)) {
+        RNP_LOG("failed to read key at %llu", (unsigned long long) key->offset);
+        goto done;
+    }
+    mem.length = key->length;
+
+    if (!rnp_key_store_pgp_read_from_mem(io, keyring, 0, &mem)) {
+        goto done;
+    }
+    if (!rnp_key_store_get_key_by_id(io, keyring, key->keyid, &from, NULL)) {
+        RNP_LOG("offset index of %s is outdated", lazy->path);
+        goto done;
+    }
+
+    /* all keys of the transferable key are loaded at once */
+    for (unsigned i = 0; i < lazy->keyc; i++) {
+        if (lazy->keys[i].offset == key->offset) {
+            lazy->keys[i].loaded = true;
+        }
+    }
+    /* drop keys which were removed from the keyring in incremental mode */
+    rnp_key_store_journal_filter(io, keyring, keyc);
+    res = true;
+done:
+    free(mem.buf);
+    return res;
+}
+
+/* parse all not loaded transferable keys with at least one key, matching the data */
+static bool
+lazy_load_matching(pgp_io_t *         io,
+                   rnp_key_store_t *  keyring,
+                   lazy_match_func_t *match,
+                   const void *       data)
+{
+    rnp_key_store_lazy_t *lazy = keyring->lazy;
+    FILE *                fp = NULL;
+    bool                  loaded = false;
+
+    if (!lazy) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < lazy->keyc; i++) {
+        if (lazy->keys[i].loaded || !match(lazy, &lazy->keys[i], data)) {
+            continue;
+        }
+        if (!fp && !(fp = fopen(lazy->path, "rb"))) {
+            RNP_LOG("failed to open %s", lazy->path);
+            return false;
+        }
+        loaded |= lazy_load_block(io, keyring, fp, i);
+    }
+
+    if (fp) {
+        fclose(fp);
+    }
+    return loaded;
+}
+
+static bool
+lazy_match_keyid(const rnp_key_store_lazy_t *lazy, const pgp_lazy_key_t *key, const void *data)
+{
+    const uint8_t *keyid = data;
+
+    return !memcmp(key->keyid, keyid, PGP_KEY_ID_SIZE) ||
+           !memcmp(&key->keyid[PGP_KEY_ID_SIZE / 2], keyid, PGP_KEY_ID_SIZE / 2);
+}
+
+static bool
+lazy_match_grip(const rnp_key_store_lazy_t *lazy, const pgp_lazy_key_t *key, const void *data)
+{
+    return !memcmp(key->grip, data, PGP_FINGERPRINT_SIZE);
+}
+
+static bool
+lazy_match_any(const rnp_key_store_lazy_t *lazy, const pgp_lazy_key_t *key, const void *data)
+{
+    return true;
+}
+
+static bool
+lazy_match_name(const rnp_key_store_lazy_t *lazy, const pgp_lazy_key_t *key, const void *data)
+{
+    const lazy_name_t *name = data;
+    const char *       uid;
+    const char *       end;
+
+    if (lazy_match_keyid(lazy, key, name->keyid)) {
+        return true;
+    }
+    if (!key->uidc) {
+        return false;
+    }
+    uid = (const char *) lazy->uids.buf + key->uidoff;
+    end = (const char *) lazy->uids.buf + lazy->uids.length;
+    for (unsigned i = 0; (i < key->uidc) && (uid < end); i++) {
+        if (!regexec(&name->regex, uid, 0, NULL, 0)) {
+            return true;
+        }
+        uid += strlen(uid) + 1;
+    }
+    return false;
+}
+
+bool
+rnp_key_store_lazy_load(pgp_io_t *io, rnp_key_store_t *keyring)
+{
+    rnp_key_store_lazy_t *lazy;
+    struct stat           st;
+    char                  idxpath[MAXPATHLEN];
+    FILE *                fp;
+    bool                  touched = false;
+
+    if (keyring->lazy || keyring->keyc || (keyring->format != GPG_KEY_STORE)) {
+        return false;
+    }
+    if (stat(keyring->path, &st) || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    if (snprintf(idxpath, sizeof(idxpath), "%s.idx", keyring->path) >= (int) sizeof(idxpath)) {
+        return false;
+    }
+
+    if (!(lazy = calloc(1, sizeof(*lazy))) || !(lazy->path = strdup(keyring->path))) {
+        RNP_LOG("allocation failed");
+        free(lazy);
+        return false;
+    }
+    lazy->size = st.st_size;
+    lazy->mtime = st.st_mtime;
+    keyring->lazy = lazy;
+
+    if (!lazy_read_index(lazy, idxpath, &touched)) {
+        if (!lazy_scan_keyring(io, lazy, 0) || !lazy_hash_keyring(lazy->path, lazy->hash)) {
+            rnp_key_store_lazy_free(keyring);
+            return false;
+        }
+        touched = true;
+    }
+    if (touched && !lazy_write_index(lazy, idxpath) && rnp_get_debug(__FILE__)) {
+        fprintf(io->errs, "Can't write keyring index '%s'\n", idxpath);
+    }
+
+    if (!lazy->keyc) {
+        return true;
+    }
+
+    /* parse the first key so the default key is available as after the full load */
+    if (!(fp = fopen(lazy->path, "rb"))) {
+        rnp_key_store_clear(keyring);
+        return false;
+    }
+    if (!lazy_load_block(io, keyring, fp, 0)) {
+        fclose(fp);
+        rnp_key_store_clear(keyring);
+        return false;
+    }
+    fclose(fp);
+    return true;
+}
+
+bool
+rnp_key_store_lazy_load_all(pgp_io_t *io, rnp_key_store_t *keyring)
+{
+    rnp_key_store_lazy_t *lazy = keyring->lazy;
+
+    if (!lazy) {
+        return true;
+    }
+
+    lazy_load_matching(io, keyring, lazy_match_any, NULL);
+    for (unsigned i = 0; i < lazy->keyc; i++) {
+        if (!lazy->keys[i].loaded) {
+            return false;
+        }
+    }
+    rnp_key_store_lazy_free(keyring);
+    return true;
+}
+
+unsigned
+rnp_key_store_lazy_key_count(const rnp_key_store_t *keyring)
+{
+    return keyring->lazy ? keyring->lazy->keyc : 0;
+}
+
+void
+rnp_key_store_lazy_appended(pgp_io_t *io, rnp_key_store_t *keyring, uint64_t offset)
+{
+    rnp_key_store_lazy_t *lazy = keyring->lazy;
+    struct stat           st;
+    char                  idxpath[MAXPATHLEN];
+    unsigned              first;
+    size_t                uidslen;
+
+    /* index of the other keyring version will be rebuilt on the next load */
+    if (!lazy || (lazy->size != offset) || strcmp(lazy->path, keyring->path)) {
+        return;
+    }
+    if (stat(lazy->path, &st) ||
+        snprintf(idxpath, sizeof(idxpath), "%s.idx", lazy->path) >= (int) sizeof(idxpath)) {
+        return;
+    }
+
+    first = lazy->keyc;
+    uidslen = lazy->uids.length;
+    if (!lazy_scan_keyring(io, lazy, offset)) {
+        lazy->keyc = first;
+        lazy->uids.length = uidslen;
+        return;
+    }
+    /* only appended part is read, so the keyring hash becomes unknown */
+    memset(lazy->hash, 0, sizeof(lazy->hash));
+    /* appended keys are written from the keyring */
+    for (unsigned i = first; i < lazy->keyc; i++) {
+        lazy->keys[i].loaded = true;
+    }
+    lazy->size = st.st_size;
+    lazy->mtime = st.st_mtime;
+    if (!lazy_write_index(lazy, idxpath) && rnp_get_debug(__FILE__)) {
+        fprintf(io->errs, "Can't write keyring index '%s'\n", idxpath);
+    }
+}
+
+void
+rnp_key_store_lazy_free(rnp_key_store_t *keyring)
+{
+    rnp_key_store_lazy_t *lazy = keyring->lazy;
+
+    if (!lazy) {
+        return;
+    }
+    FREE_ARRAY(lazy, key);
+    pgp_memory_release(&lazy->uids);
+    free(lazy->path);
+    free(lazy);
+    keyring->lazy = NULL;
+}
+
+pgp_key_t *
+rnp_key_store_lazy_get_key_by_id(pgp_io_t *io, rnp_key_store_t *keyring, const uint8_t *keyid)
+{
+    unsigned   from = 0;
+    pgp_key_t *key = rnp_key_store_get_key_by_id(io, keyring, keyid, &from, NULL);
+
+    if (key || !lazy_load_matching(io, keyring, lazy_match_keyid, keyid)) {
+        return key;
+    }
+    from = 0;
+    return rnp_key_store_get_key_by_id(io, keyring, keyid, &from, NULL);
+}
+
+pgp_key_t *
+rnp_key_store_lazy_get_key_by_grip(pgp_io_t *io, rnp_key_store_t *keyring, const uint8_t *grip)
+{
+    pgp_key_t *key = rnp_key_store_get_key_by_grip(io, keyring, grip);
+
+    if (key || !lazy_load_matching(io, keyring, lazy_match_grip, grip)) {
+        return key;
+    }
+    return rnp_key_store_get_key_by_grip(io, keyring, grip);
+}
+
+/* keyid which rnp_key_store_get_key_by_name() tries for the name: leading pairs of hex digits,
+ * padded with zeroes, so any name matches keys in the same way */
+static void
+lazy_name_keyid(const char *name, uint8_t *keyid)
+{
+    char   hex[PGP_KEY_ID_SIZE * 2 + 1] = {0};
+    size_t len = 0;
+
+    while ((len < sizeof(hex) - 1) && isxdigit((unsigned char) name[len])) {
+        len++;
+    }
+    memcpy(hex, name, len & ~(size_t) 1);
+    if (hex[0]) {
+        (void) rnp_hex_decode(hex, keyid, PGP_KEY_ID_SIZE);
+    }
+}
+
+bool
+rnp_key_store_lazy_get_key_by_name(pgp_io_t *       io,
+                                   rnp_key_store_t *keyring,
+                                   const char *     name,
+                                   pgp_key_t **     key)
+{
+    lazy_name_t lname = {{0}};
+    bool        loaded;
+
+    if (!rnp_key_store_get_key_by_name(io, keyring, name, key)) {
+        return false;
+    }
+    if (*key || !keyring->lazy) {
+        return true;
+    }
+
+    lazy_name_keyid(name, lname.keyid);
+    if (regcomp(&lname.regex, name, REG_EXTENDED | REG_ICASE)) {
+        return false;
+    }
+    loaded = lazy_load_matching(io, keyring, lazy_match_name, &lname);
+    regfree(&lname.regex);
+    if (!loaded) {
+        return true;
+    }
+    return rnp_key_store_get_key_by_name(io, keyring, name, key);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RNP_KEY_STORE_LAZY_H
+#define RNP_KEY_STORE_LAZY_H
+
+#include <rnp/rnp.h>
+#include <rekey/rnp_key_store.h>
+
+/* Lazy mode of the GPG keyring: the parsed key table is kept in the sidecar index file
+ * '<keyring>.idx', so on load only this file is read (it is mapped to the memory). For each
+ * key it stores keyid, fingerprint, grip, key flags, userids, index of the primary key and the
+ * offset of its transferable key. Keys are parsed when they are requested via the
+ * rnp_key_store_lazy_get_key_* functions. Index file is reused while keyring's size and
+ * modification time are not changed, or if only modification time is changed but the keyring
+ * hash is the same. Otherwise it is rebuilt on load. */
+
+/** @brief build or read offset index for the keyring->path and parse the first key only.
+ *  Keyring must be empty, and in GPG format.
+ *  @return true on success or false if lazy loading is not possible, then keyring is left
+ *          empty and should be loaded in a usual way
+ **/
+bool rnp_key_store_lazy_load(pgp_io_t *io, rnp_key_store_t *keyring);
+
+/** @brief parse all keys which are not loaded yet and drop the offset index **/
+bool rnp_key_store_lazy_load_all(pgp_io_t *io, rnp_key_store_t *keyring);
+
+/** @brief number of keys in the offset index, or 0 if keyring is not loaded lazily **/
+unsigned rnp_key_store_lazy_key_count(const rnp_key_store_t *keyring);
+
+/** @brief add keys, appended to the keyring file starting from the offset, to the offset
+ *  index, so it is not rebuilt on the next load. Appended keys must be in the keyring.
+ **/
+void rnp_key_store_lazy_appended(pgp_io_t *io, rnp_key_store_t *keyring, uint64_t offset);
+
+/** @brief free the offset index, already loaded keys are left in the keyring **/
+void rnp_key_store_lazy_free(rnp_key_store_t *keyring);
+
+/** @brief same as rnp_key_store_get_key_by_id() but also parses the matching key(s) from
+ *  the offset index if they are not loaded yet
+ **/
+pgp_key_t *rnp_key_store_lazy_get_key_by_id(pgp_io_t *       io,
+                                            rnp_key_store_t *keyring,
+                                            const uint8_t *  keyid);
+
+/** @brief same as rnp_key_store_get_key_by_grip() but also parses the matching key(s) from
+ *  the offset index if they are not loaded yet
+ **/
+pgp_key_t *rnp_key_store_lazy_get_key_by_grip(pgp_io_t *       io,
+                                              rnp_key_store_t *keyring,
+                                              const uint8_t *  grip);
+
+/** @brief same as rnp_key_store_get_key_by_name(). If key is not found then transferable
+ *  keys with the matching keyid or userid in the index are parsed and search is repeated.
+ **/
+bool rnp_key_store_lazy_get_key_by_name(pgp_io_t *       io,
+                                        rnp_key_store_t *keyring,
+                                        const char *     name,
+                                        pgp_key_t **     key);
+
+#endif // RNP_KEY_STORE_LAZY_H
@@ -60,15 +60,22 @@ __RCSID("$NetBSD: keyring.c,v 1.50 2011/06/25 00:37:44 agc Exp $");
 #include <rnp/rnp_sdk.h>
 #include <librepgp/packet-show.h>
 #include <librepgp/reader.h>
+#include <librepgp/stream-packet.h>
 
 #include "types.h"
 #include "key_store_pgp.h"
 #include "signature.h"
 #include "readerwriter.h"
 #include "pgp-key.h"
+#include "thread-pool.h"
 
 void print_packet_hex(const pgp_rawpacket_t *pkt);
 
+/* smaller binary keyrings are not worth to be parsed on several threads */
+#define KEYRING_PARALLEL_MIN_SIZE (64 * 1024)
+/* more parts than threads, so parts with the larger keys don't keep other threads idle */
+#define KEYRING_PARTS_PER_THREAD 4
+
 /* used to point to data during keyring read */
 typedef struct keyringcb_t {
     rnp_key_store_t *keyring; /* the keyring we're reading */
@@ -374,6 +381,221 @@ cb_keyring_parse(const pgp_packet_t *pkt, pgp_cbdata_t *cbinfo)
     return PGP_RELEASE_MEMORY;
 }
 
+/* get tag and end of the packet which starts at pos, looking at the packet header only. Fails
+ * on the partial or indeterminate lengths, which are not used in keyrings, and on bad data */
+static bool
+keyring_packet_bounds(const pgp_memory_t *mem, size_t pos, int *tag, size_t *end)
+{
+    const uint8_t *buf = mem->buf + pos;
+    size_t         left = mem->length - pos;
+    size_t         hdrlen;
+    size_t         len;
+
+    if ((pos >= mem->length) || (left < 2) || ((*tag = get_packet_type(buf[0])) < 0)) {
+        return false;
+    }
+    if (buf[0] & PGP_PTAG_NEW_FORMAT) {
+        if (buf[1] < 192) {
+            hdrlen = 2;
+            len = buf[1];
+        } else if ((buf[1] < 224) && (left >= 3)) {
+            hdrlen = 3;
+            len = ((size_t)(buf[1] - 192) << 8) + buf[2] + 192;
+        } else if ((buf[1] == 255) && (left >= 6)) {
+            hdrlen = 6;
+            len = ((size_t) buf[2] << 24) | ((size_t) buf[3] << 16) | ((size_t) buf[4] << 8) |
+                  buf[5];
+        } else {
+            return false;
+        }
+    } else {
+        switch (buf[0] & PGP_PTAG_OF_LENGTH_TYPE_MASK) {
+        case PGP_PTAG_OLD_LEN_1:
+            hdrlen = 2;
+            len = buf[1];
+            break;
+        case PGP_PTAG_OLD_LEN_2:
+            if (left < 3) {
+                return false;
+            }
+            hdrlen = 3;
+            len = ((size_t) buf[1] << 8) | buf[2];
+            break;
+        case PGP_PTAG_OLD_LEN_4:
+            if (left < 5) {
+                return false;
+            }
+            hdrlen = 5;
+            len = ((size_t) buf[1] << 24) | ((size_t) buf[2] << 16) | ((size_t) buf[3] << 8) |
+                  buf[4];
+            break;
+        default:
+            return false;
+        }
+    }
+    if (len > left - hdrlen) {
+        return false;
+    }
+    *end = pos + hdrlen + len;
+    return true;
+}
+
+/* number of key packets in the binary keyring. Used to preallocate the key storage, so just
+ * stops on anything unexpected */
+static unsigned
+keyring_key_count_hint(const pgp_memory_t *mem)
+{
+    size_t   pos = 0;
+    unsigned count = 0;
+    int      tag;
+
+    while (keyring_packet_bounds(mem, pos, &tag, &pos)) {
+        if (pgp_is_primary_key_tag(tag) || pgp_is_subkey_tag(tag)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static bool
+keyring_read_from_mem(pgp_io_t *       io,
+                      rnp_key_store_t *keyring,
+                      unsigned         armor,
+                      pgp_memory_t *   mem)
+{
+    pgp_stream_t * stream;
+    const unsigned printerrors = 1;
+    const unsigned accum = 1;
+    keyringcb_t    cb = {0};
+    bool           res;
+
+    cb.keyring = keyring;
+    cb.io = io;
+    /* avoid growing the key storage step by step, it is not critical if this fails */
+    if (!armor) {
+        (void) rnp_key_store_reserve(keyring, keyring_key_count_hint(mem));
+    }
+    if (!pgp_setup_memory_read(io, &stream, mem, &cb, cb_keyring_parse, accum)) {
+        (void) fprintf(io->errs, "can't setup memory read\n");
+        return false;
+    }
+    repgp_parse_options(stream, PGP_PTAG_SS_ALL, REPGP_PARSE_PARSED);
+    if (armor) {
+        pgp_reader_push_dearmor(stream);
+    }
+    res = repgp_parse(stream, printerrors);
+    pgp_print_errors(pgp_stream_get_errors(stream));
+    if (armor) {
+        pgp_reader_pop_dearmor(stream);
+    }
+    /* don't call teardown_memory_read because memory was passed in */
+    pgp_stream_delete(stream);
+    return res;
+}
+
+/* part of the binary keyring, parsed by the worker thread to the separate key store */
+typedef struct keyring_part_t {
+    pgp_io_t *       io;
+    pgp_memory_t     mem;   /* points to the keyring data, so must not be freed */
+    rnp_key_store_t *store; /* keys of the part */
+    bool             res;
+} keyring_part_t;
+
+static void
+keyring_parse_part(void *param)
+{
+    keyring_part_t *part = param;
+
+    part->res = keyring_read_from_mem(part->io, part->store, 0, &part->mem);
+}
+
+/* split keyring to at most maxparts parts of the close size. Parts start with the primary key
+ * so subkeys stay in the same part with their primary key. bounds[] gets the start offsets
+ * and the end of data, returns number of parts or 0 if keyring cannot be walked over */
+static size_t
+keyring_split(const pgp_memory_t *mem, size_t *bounds, size_t maxparts)
+{
+    size_t partc = 1;
+    size_t pos = 0;
+    size_t next;
+    int    tag;
+
+    bounds[0] = 0;
+    while (pos < mem->length) {
+        if (!keyring_packet_bounds(mem, pos, &tag, &next)) {
+            return 0;
+        }
+        if (pgp_is_primary_key_tag(tag) && (partc < maxparts) &&
+            (pos >= mem->length / maxparts * partc)) {
+            bounds[partc++] = pos;
+        }
+        pos = next;
+    }
+    bounds[partc] = mem->length;
+    return partc;
+}
+
+/* parse the parts of the binary keyring on the thread pool and move the keys in order. Returns
+ * false if keyring was not split so should be parsed sequentially */
+static bool
+keyring_read_parallel(pgp_io_t *io, rnp_key_store_t *keyring, pgp_memory_t *mem, bool *res)
+{
+    pgp_thread_pool_t *pool = NULL;
+    keyring_part_t *   parts = NULL;
+    pgp_task_t *       tasks = NULL;
+    size_t *           bounds = NULL;
+    size_t             maxparts;
+    size_t             partc = 0;
+    bool               split = false;
+
+    if (!(pool = pgp_thread_pool_create(keyring->load_threads))) {
+        return false;
+    }
+    maxparts = (size_t) pgp_thread_pool_size(pool) * KEYRING_PARTS_PER_THREAD;
+    parts = calloc(maxparts, sizeof(*parts));
+    tasks = calloc(maxparts, sizeof(*tasks));
+    bounds = calloc(maxparts + 1, sizeof(*bounds));
+    if (!parts || !tasks || !bounds) {
+        RNP_LOG("allocation failed");
+        goto done;
+    }
+    if ((partc = keyring_split(mem, bounds, maxparts)) < 2) {
+        goto done;
+    }
+    for (size_t i = 0; i < partc; i++) {
+        parts[i].io = io;
+        parts[i].mem.buf = mem->buf + bounds[i];
+        parts[i].mem.length = bounds[i + 1] - bounds[i];
+        if (!(parts[i].store = rnp_key_store_new(RNP_KEYSTORE_GPG, ""))) {
+            goto done;
+        }
+        tasks[i].func = keyring_parse_part;
+        tasks[i].param = &parts[i];
+    }
+    pgp_thread_pool_run(pool, tasks, partc);
+
+    /* same result as the sequential parsing: keys up to the first error */
+    split = true;
+    *res = true;
+    for (size_t i = 0; (i < partc) && *res; i++) {
+        if (!rnp_key_store_append_keyring(keyring, parts[i].store)) {
+            RNP_LOG("failed to merge the keyring part");
+            *res = false;
+            break;
+        }
+        *res = parts[i].res;
+    }
+done:
+    for (size_t i = 0; parts && (i < partc); i++) {
+        rnp_key_store_free(parts[i].store);
+    }
+    free(parts);
+    free(tasks);
+    free(bounds);
+    pgp_thread_pool_destroy(pool);
+    return split;
+}
+
 /**
    \ingroup HighLevel_KeyringRead
 
@@ -403,30 +625,13 @@ rnp_key_store_pgp_read_from_mem(pgp_io_t *       io,
                                 const unsigned   armor,
                                 pgp_memory_t *   mem)
 {
-    pgp_stream_t * stream;
-    const unsigned printerrors = 1;
-    const unsigned accum = 1;
-    keyringcb_t    cb = {0};
-    bool           res;
+    bool res = false;
 
-    cb.keyring = keyring;
-    cb.io = io;
-    if (!pgp_setup_memory_read(io, &stream, mem, &cb, cb_keyring_parse, accum)) {
-        (void) fprintf(io->errs, "can't setup memory read\n");
-        return false;
-    }
-    repgp_parse_options(stream, PGP_PTAG_SS_ALL, REPGP_PARSE_PARSED);
-    if (armor) {
-        pgp_reader_push_dearmor(stream);
+    if (!armor && (keyring->load_threads > 1) && (mem->length >= KEYRING_PARALLEL_MIN_SIZE) &&
+        keyring_read_parallel(io, keyring, mem, &res)) {
+        return res;
     }
-    res = repgp_parse(stream, printerrors);
-    pgp_print_errors(pgp_stream_get_errors(stream));
-    if (armor) {
-        pgp_reader_pop_dearmor(stream);
-    }
-    /* don't call teardown_memory_read because memory was passed in */
-    pgp_stream_delete(stream);
-    return res;
+    return keyring_read_from_mem(io, keyring, armor, mem);
 }
 
 int
@@ -444,13 +649,13 @@ rnp_key_store_pgp_write_to_mem(pgp_io_t *       io,
 
     if (armor) {
         pgp_armor_type_t type = PGP_PGP_PUBLIC_KEY_BLOCK;
-        if (key_store->keyc && pgp_is_key_secret(&key_store->keys[0])) {
+        if (key_store->keyc && pgp_is_key_secret(key_store->keys[0])) {
             type = PGP_PGP_PRIVATE_KEY_BLOCK;
         }
         pgp_writer_push_armored(&output, type);
     }
     for (unsigned ikey = 0; ikey < key_store->keyc; ikey++) {
-        key = &key_store->keys[ikey];
+        key = key_store->keys[ikey];
 
         if (key->format != GPG_KEY_STORE) {
             RNP_LOG("incorrect format (conversions not supported): %d", key->format);
@@ -468,3 +673,23 @@ rnp_key_store_pgp_write_to_mem(pgp_io_t *       io,
 
     return rc;
 }
+
+/* append packets of the single key to mem */
+bool
+rnp_key_store_pgp_key_to_mem(pgp_io_t *io, const pgp_key_t *key, pgp_memory_t *mem)
+{
+    pgp_output_t output = {};
+    bool         rc;
+
+    RNP_USED(io);
+    if (key->format != GPG_KEY_STORE) {
+        RNP_LOG("incorrect format (conversions not supported): %d", key->format);
+        return false;
+    }
+
+    pgp_writer_set_memory(&output, mem);
+    rc = pgp_key_write_packets(key, &output);
+    rc = pgp_writer_close(&output) && rc;
+    pgp_writer_info_delete(&output.writer);
+    return rc;
+}
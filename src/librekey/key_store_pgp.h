@@ -70,6 +70,8 @@ int rnp_key_store_pgp_write_to_mem(pgp_io_t *,
                                    const unsigned,
                                    pgp_memory_t *);
 
+bool rnp_key_store_pgp_key_to_mem(pgp_io_t *, const pgp_key_t *, pgp_memory_t *);
+
 bool pgp_parse_key_attrs(pgp_key_t *key, const uint8_t *data, size_t data_len);
 
 #endif /* KEY_STORE_PGP_H_ */
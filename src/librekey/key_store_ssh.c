@@ -396,7 +396,6 @@ bool
 rnp_key_store_ssh_load_keys(rnp_t *rnp, rnp_key_store_t *pubring, rnp_key_store_t *secring)
 {
     pgp_key_t *pubkey;
-    pgp_key_t *seckey;
     pgp_key_t  key;
 
     pubkey = NULL;
@@ -409,32 +408,27 @@ rnp_key_store_ssh_load_keys(rnp_t *rnp, rnp_key_store_t *pubring, rnp_key_store_
             RNP_LOG("can't read pubkeys '%s'", pubring->path);
             return false;
         }
-        EXPAND_ARRAY(pubring, key);
-        if (pubring->keys == NULL) {
+        key.type = PGP_PTAG_CT_PUBLIC_KEY;
+        if (!rnp_key_store_add_key(rnp->io, pubring, &key)) {
             return false;
         }
-        pubkey = &pubring->keys[pubring->keyc++];
-        (void) memcpy(pubkey, &key, sizeof(key));
-        pubkey->type = PGP_PTAG_CT_PUBLIC_KEY;
+        pubkey = pubring->keys[pubring->keyc - 1];
     }
     if (secring) {
         if (rnp_get_debug(__FILE__)) {
             RNP_LOG("secfile '%s'", secring->path);
         }
         if (pubkey == NULL) {
-            pubkey = &pubring->keys[0];
+            pubkey = pubring->keys[0];
         }
         if (!ssh2seckey(rnp->io, secring->path, &key, &pubkey->key.pubkey)) {
             RNP_LOG("can't read seckeys '%s'", secring->path);
             return false;
         }
-        EXPAND_ARRAY(secring, key);
-        if (secring->keys == NULL) {
+        key.type = PGP_PTAG_CT_SECRET_KEY;
+        if (!rnp_key_store_add_key(rnp->io, secring, &key)) {
             return false;
         }
-        seckey = &secring->keys[secring->keyc++];
-        (void) memcpy(seckey, &key, sizeof(key));
-        seckey->type = PGP_PTAG_CT_SECRET_KEY;
     }
     return true;
 }
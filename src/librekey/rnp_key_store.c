@@ -37,6 +37,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <dirent.h>
 
 #include <rnp/rnp.h>
@@ -49,6 +50,8 @@
 #include "key_store_kbx.h"
 #include "key_store_ssh.h"
 #include "key_store_g10.h"
+#include "key_store_lazy.h"
+#include "key_store_journal.h"
 
 #include "pgp-key.h"
 #include "crypto/bn.h"
@@ -210,12 +213,23 @@ rnp_key_store_load_from_file(pgp_io_t *       io,
         return true;
     }
 
-    if (!pgp_mem_readfile(&mem, key_store->path)) {
+    if (key_store->incremental && !armor && !rnp_key_store_journal_recover(io, key_store)) {
         return false;
     }
 
-    rc = rnp_key_store_load_from_mem(io, key_store, armor, pubring, &mem);
-    pgp_memory_release(&mem);
+    if (key_store->lazy_load && !armor && rnp_key_store_lazy_load(io, key_store)) {
+        rc = true;
+    } else {
+        if (!pgp_mem_readfile(&mem, key_store->path)) {
+            return false;
+        }
+        rc = rnp_key_store_load_from_mem(io, key_store, armor, pubring, &mem);
+        pgp_memory_release(&mem);
+    }
+
+    if (rc && key_store->incremental && !armor) {
+        rc = rnp_key_store_journal_start(io, key_store);
+    }
     return rc;
 }
 
@@ -251,6 +265,20 @@ rnp_key_store_write_to_file(pgp_io_t *io, rnp_key_store_t *key_store, const unsi
     bool         rc;
     pgp_memory_t mem = {0};
 
+    if (key_store->journal && !armor) {
+        if (!rnp_key_store_journal_save(io, key_store, &rc)) {
+            return false;
+        }
+        if (rc) {
+            return true;
+        }
+    }
+
+    /* keyring is rewritten, so all of the keys must be parsed */
+    if (!rnp_key_store_lazy_load_all(io, key_store)) {
+        return false;
+    }
+
     if (key_store->format == G10_KEY_STORE) {
         char    path[MAXPATHLEN];
         uint8_t grip[PGP_FINGERPRINT_SIZE];
@@ -275,7 +303,7 @@ rnp_key_store_write_to_file(pgp_io_t *io, rnp_key_store_t *key_store, const unsi
         }
 
         for (unsigned i = 0; i < key_store->keyc; i++) {
-            if (!rnp_key_store_get_key_grip(&key_store->keys[i].key.pubkey, grip)) {
+            if (!rnp_key_store_get_key_grip(&key_store->keys[i]->key.pubkey, grip)) {
                 return false;
             }
 
@@ -286,7 +314,7 @@ rnp_key_store_write_to_file(pgp_io_t *io, rnp_key_store_t *key_store, const unsi
                      rnp_strhexdump_upper(grips, grip, 20, ""));
 
             memset(&mem, 0, sizeof(mem));
-            if (!rnp_key_store_g10_key_to_mem(io, &key_store->keys[i], &mem)) {
+            if (!rnp_key_store_g10_key_to_mem(io, key_store->keys[i], &mem)) {
                 pgp_memory_release(&mem);
                 return false;
             }
@@ -309,6 +337,13 @@ rnp_key_store_write_to_file(pgp_io_t *io, rnp_key_store_t *key_store, const unsi
 
     rc = pgp_mem_writefile(&mem, key_store->path);
     pgp_memory_release(&mem);
+    if (rc && key_store->journal) {
+        rc = rnp_key_store_journal_compacted(io, key_store);
+        /* armored keyring cannot be appended */
+        if (armor) {
+            rnp_key_store_journal_free(key_store);
+        }
+    }
     return rc;
 }
 
@@ -395,12 +430,228 @@ rnp_key_store_get_first_ring(rnp_key_store_t *ring, char *id, size_t len, int la
 
     memset(id, 0x0, len);
 
-    src = (uint8_t *) &ring->keys[(last) ? ring->keyc - 1 : 0].keyid;
+    src = (uint8_t *) &ring->keys[(last) ? ring->keyc - 1 : 0]->keyid;
     rnp_key_store_format_key(id, src, len);
 
     return true;
 }
 
+/* initial number of slots in each of the key index tables */
+#define KEY_INDEX_MIN_SIZE 64
+
+static uint32_t
+key_index_hash(const uint8_t *data)
+{
+    uint32_t hash = ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) |
+                    ((uint32_t) data[2] << 8) | (uint32_t) data[3];
+    /* keyids of non-OpenPGP keys may be not random enough, so mix the bits */
+    hash *= 0x9E3779B1U;
+    return hash ^ (hash >> 16);
+}
+
+static void
+key_index_insert(uint32_t *table, unsigned size, uint32_t hash, unsigned idx)
+{
+    unsigned slot = hash & (size - 1);
+
+    while (table[slot]) {
+        slot = (slot + 1) & (size - 1);
+    }
+    table[slot] = idx + 1;
+}
+
+static void
+key_index_free(rnp_key_store_index_t *index)
+{
+    free(index->keyids);
+    free(index->fprints);
+    free(index->grips);
+    memset(index, 0, sizeof(*index));
+}
+
+/* index keys which were added to the end of keys[], growing tables if needed */
+static void
+key_index_update(rnp_key_store_t *keyring)
+{
+    rnp_key_store_index_t *index = &keyring->index;
+    const pgp_key_t *      key;
+    unsigned               size;
+
+    if ((index->count > keyring->keyc) || (keyring->keyc > index->size / 2)) {
+        size = index->size ? index->size : KEY_INDEX_MIN_SIZE;
+        while (keyring->keyc > size / 2) {
+            size *= 2;
+        }
+        key_index_free(index);
+        index->keyids = calloc(size, sizeof(*index->keyids));
+        index->fprints = calloc(size, sizeof(*index->fprints));
+        index->grips = calloc(size, sizeof(*index->grips));
+        if (!index->keyids || !index->fprints || !index->grips) {
+            /* lookups will fall back to the linear search */
+            RNP_LOG("failed to allocate key index");
+            key_index_free(index);
+            return;
+        }
+        index->size = size;
+    }
+
+    for (; index->count < keyring->keyc; index->count++) {
+        key = keyring->keys[index->count];
+        key_index_insert(index->keyids,
+                         index->size,
+                         key_index_hash(&key->keyid[PGP_KEY_ID_SIZE / 2]),
+                         index->count);
+        key_index_insert(index->fprints,
+                         index->size,
+                         key_index_hash(key->fingerprint.fingerprint),
+                         index->count);
+        key_index_insert(index->grips, index->size, key_index_hash(key->grip), index->count);
+    }
+}
+
+/* index may be used only if it covers all of the keys */
+static bool
+key_index_valid(const rnp_key_store_t *keyring)
+{
+    return keyring->index.size && (keyring->index.count == keyring->keyc);
+}
+
+struct pgp_key_slab_t {
+    pgp_key_slab_t *next;
+    unsigned        size;   /* number of slots */
+    unsigned        used;   /* number of slots given out */
+    pgp_key_t       keys[]; /* slots, not initialized until they are given out */
+};
+
+/* bounds of the chunk size when it is not given by rnp_key_store_reserve() */
+#define KEY_SLAB_MIN_SIZE 16
+#define KEY_SLAB_MAX_SIZE 4096
+
+static bool
+key_slab_add(rnp_key_store_t *keyring, unsigned size)
+{
+    pgp_key_slab_t *slab;
+
+    if (!(slab = malloc(sizeof(*slab) + sizeof(pgp_key_t) * (size_t) size))) {
+        RNP_LOG("allocation failed");
+        return false;
+    }
+    slab->size = size;
+    slab->used = 0;
+    slab->next = keyring->slabs;
+    keyring->slabs = slab;
+    return true;
+}
+
+static void
+key_slabs_free(rnp_key_store_t *keyring)
+{
+    pgp_key_slab_t *next;
+
+    for (pgp_key_slab_t *slab = keyring->slabs; slab; slab = next) {
+        next = slab->next;
+        free(slab);
+    }
+    keyring->slabs = NULL;
+    keyring->sparec = 0;
+}
+
+/* take a free slot for the new key, it is zeroed */
+static pgp_key_t *
+key_slot_take(rnp_key_store_t *keyring)
+{
+    pgp_key_slab_t *slab = keyring->slabs;
+    pgp_key_t *     key;
+
+    if (keyring->sparec) {
+        key = keyring->spares[--keyring->sparec];
+    } else {
+        if (!slab || (slab->used == slab->size)) {
+            /* chunks grow with the keyring, so their number is logarithmic up to the limit */
+            unsigned size = keyring->keyc;
+            if (size < KEY_SLAB_MIN_SIZE) {
+                size = KEY_SLAB_MIN_SIZE;
+            } else if (size > KEY_SLAB_MAX_SIZE) {
+                size = KEY_SLAB_MAX_SIZE;
+            }
+            if (!key_slab_add(keyring, size)) {
+                return NULL;
+            }
+            slab = keyring->slabs;
+        }
+        key = &slab->keys[slab->used++];
+    }
+    memset(key, 0, sizeof(*key));
+    return key;
+}
+
+/* give the slot back, key data must be already freed or owned by someone else */
+static void
+key_slot_release(rnp_key_store_t *keyring, pgp_key_t *key)
+{
+    EXPAND_ARRAY(keyring, spare);
+    /* otherwise slot is just not reused until the keyring is cleared */
+    if (keyring->sparec < keyring->sparevsize) {
+        keyring->spares[keyring->sparec++] = key;
+    }
+}
+
+/* make room for one more key in keys[] */
+static bool
+key_store_expand(rnp_key_store_t *keyring)
+{
+    EXPAND_ARRAY(keyring, key);
+    if (keyring->keyc == keyring->keyvsize) {
+        RNP_LOG("allocation failed");
+        return false;
+    }
+    return true;
+}
+
+bool
+rnp_key_store_reserve(rnp_key_store_t *keyring, unsigned count)
+{
+    pgp_key_slab_t *slab = keyring->slabs;
+    unsigned        avail = keyring->sparec;
+
+    if (count > UINT_MAX - keyring->keyc) {
+        return false;
+    }
+    if (keyring->keyc + count > keyring->keyvsize) {
+        pgp_key_t **keys = realloc(keyring->keys, sizeof(*keys) * (keyring->keyc + count));
+        if (!keys) {
+            RNP_LOG("allocation failed");
+            return false;
+        }
+        keyring->keys = keys;
+        keyring->keyvsize = keyring->keyc + count;
+    }
+
+    if (slab) {
+        avail += slab->size - slab->used;
+    }
+    if (avail >= count) {
+        return true;
+    }
+    /* rest of the current chunk goes to the spare slots, new chunk is used after it */
+    if (slab && (slab->used < slab->size)) {
+        unsigned    sparec = keyring->sparec + slab->size - slab->used;
+        pgp_key_t **spares = keyring->spares;
+        if (sparec > keyring->sparevsize) {
+            if (!(spares = realloc(spares, sizeof(*spares) * sparec))) {
+                RNP_LOG("allocation failed");
+                return false;
+            }
+            keyring->spares = spares;
+            keyring->sparevsize = sparec;
+        }
+        while (slab->used < slab->size) {
+            keyring->spares[keyring->sparec++] = &slab->keys[slab->used++];
+        }
+    }
+    return key_slab_add(keyring, count - avail);
+}
+
 void
 rnp_key_store_clear(rnp_key_store_t *keyring)
 {
@@ -408,10 +659,14 @@ rnp_key_store_clear(rnp_key_store_t *keyring)
 
     if (keyring->keys != NULL) {
         for (i = 0; i < keyring->keyc; i++) {
-            pgp_key_free_data(&keyring->keys[i]);
+            pgp_key_free_data(keyring->keys[i]);
         }
         keyring->keyc = 0;
     }
+    key_slabs_free(keyring);
+    key_index_free(&keyring->index);
+    rnp_key_store_lazy_free(keyring);
+    rnp_key_store_journal_free(keyring);
 
     if (keyring->blobs != NULL) {
         for (i = 0; i < keyring->blobc; i++) {
@@ -439,6 +694,7 @@ rnp_key_store_free(rnp_key_store_t *keyring)
     rnp_key_store_clear(keyring);
 
     FREE_ARRAY(keyring, key);
+    FREE_ARRAY(keyring, spare);
     FREE_ARRAY(keyring, blob);
 
     free((void *) keyring->path);
@@ -469,7 +725,8 @@ rnp_key_store_list(pgp_io_t *io, const rnp_key_store_t *keyring, const int psigs
         return true;
     }
 
-    for (n = 0, key = keyring->keys; n < keyring->keyc; ++n, ++key) {
+    for (n = 0; n < keyring->keyc; ++n) {
+        key = keyring->keys[n];
         if (pgp_is_key_secret(key)) {
             repgp_print_key(io, keyring, key, "sec", &key->key.seckey.pubkey, 0);
         } else {
@@ -488,7 +745,8 @@ rnp_key_store_json(pgp_io_t *             io,
 {
     pgp_key_t *key;
     unsigned   n;
-    for (n = 0, key = keyring->keys; n < keyring->keyc; ++n, ++key) {
+    for (n = 0; n < keyring->keyc; ++n) {
+        key = keyring->keys[n];
         json_object * jso = json_object_new_object();
         pgp_pubkey_t *pubkey = &key->key.pubkey;
         const char *  header = NULL;
@@ -505,36 +763,63 @@ rnp_key_store_json(pgp_io_t *             io,
     return true;
 }
 
-/* append one keyring to another */
+/* position of the key in keyring, searching from the given one since subkeys follow their
+ * primary key */
+static unsigned
+key_store_key_pos(const rnp_key_store_t *keyring, const pgp_key_t *key, unsigned from)
+{
+    for (unsigned i = 0; i < keyring->keyc; i++) {
+        unsigned pos = (from + i) % keyring->keyc;
+        if (keyring->keys[pos] == key) {
+            return pos;
+        }
+    }
+    return UINT_MAX;
+}
+
+/* move keys and blobs of one keyring to the end of another */
 bool
 rnp_key_store_append_keyring(rnp_key_store_t *keyring, rnp_key_store_t *newring)
 {
+    unsigned first = keyring->keyc;
     unsigned i;
 
+    if (!rnp_key_store_reserve(keyring, newring->keyc)) {
+        return false;
+    }
     for (i = 0; i < newring->keyc; i++) {
-        EXPAND_ARRAY(keyring, key);
-        if (keyring->keys == NULL) {
-            return false;
+        pgp_key_t *key = key_slot_take(keyring);
+        *key = *newring->keys[i];
+        keyring->keys[keyring->keyc++] = key;
+    }
+    /* subkeys[] still point to the newring's storage */
+    for (i = 0; i < newring->keyc; i++) {
+        pgp_key_t *key = keyring->keys[first + i];
+
+        for (unsigned j = 0; j < key->subkeyc; j++) {
+            unsigned pos = key_store_key_pos(newring, key->subkeys[j], i + 1);
+            if (pos != UINT_MAX) {
+                key->subkeys[j] = keyring->keys[first + pos];
+            }
         }
-        (void) memcpy(
-          &keyring->keys[keyring->keyc], &newring->keys[i], sizeof(newring->keys[i]));
-        keyring->keyc += 1;
     }
+    newring->keyc = 0;
+    key_index_update(keyring);
 
     for (i = 0; i < newring->blobc; i++) {
         EXPAND_ARRAY(keyring, blob);
-        if (keyring->blobs == NULL) {
+        if (keyring->blobc == keyring->blobvsize) {
             return false;
         }
-        (void) memcpy(
-          &keyring->blobs[keyring->blobc], &newring->blobs[i], sizeof(newring->blobs[i]));
-        keyring->blobc += 1;
+        keyring->blobs[keyring->blobc++] = newring->blobs[i];
+        newring->blobs[i] = NULL;
     }
+    newring->blobc = 0;
     return true;
 }
 
 /* add a key to keyring */
-bool
+pgp_key_t *
 rnp_key_store_add_key(pgp_io_t *io, rnp_key_store_t *keyring, pgp_key_t *key)
 {
     pgp_key_t *newkey;
@@ -543,17 +828,18 @@ rnp_key_store_add_key(pgp_io_t *io, rnp_key_store_t *keyring, pgp_key_t *key)
         fprintf(io->errs, "rnp_key_store_add_key\n");
     }
 
-    EXPAND_ARRAY(keyring, key);
-    if (keyring->keys == NULL) {
-        return false;
+    if (!key_store_expand(keyring) || !(newkey = key_slot_take(keyring))) {
+        return NULL;
     }
-    newkey = &keyring->keys[keyring->keyc++];
     *newkey = *key;
+    keyring->keys[keyring->keyc++] = newkey;
+    key_index_update(keyring);
+    rnp_key_store_journal_key_added(keyring, newkey);
     if (io && rnp_get_debug(__FILE__)) {
         fprintf(io->errs, "rnp_key_store_add_key: keyc %u\n", keyring->keyc);
     }
 
-    return true;
+    return newkey;
 }
 
 bool
@@ -569,25 +855,20 @@ rnp_key_store_add_keydata(pgp_io_t *         io,
         fprintf(io->errs, "rnp_key_store_add_keydata to key_store: %p\n", keyring);
     }
 
-    EXPAND_ARRAY(keyring, key);
-    if (keyring->keys == NULL) {
+    if (!key_store_expand(keyring) || !(key = key_slot_take(keyring))) {
         return false;
     }
-    key = &keyring->keys[keyring->keyc];
-    (void) memset(key, 0x0, sizeof(*key));
-    if (!pgp_keyid(key->keyid, PGP_KEY_ID_SIZE, &keydata->pubkey)) {
-        return false;
-    }
-    if (!pgp_fingerprint(&key->fingerprint, &keydata->pubkey)) {
-        return false;
-    }
-    if (!rnp_key_store_get_key_grip(&keydata->pubkey, key->grip)) {
+    if (!pgp_keyid(key->keyid, PGP_KEY_ID_SIZE, &keydata->pubkey) ||
+        !pgp_fingerprint(&key->fingerprint, &keydata->pubkey) ||
+        !rnp_key_store_get_key_grip(&keydata->pubkey, key->grip)) {
+        key_slot_release(keyring, key);
         return false;
     }
     key->type = tag;
     key->key = *keydata;
     // success
-    keyring->keyc++;
+    keyring->keys[keyring->keyc++] = key;
+    key_index_update(keyring);
     if (inserted) {
         *inserted = key;
     }
@@ -603,17 +884,123 @@ rnp_key_store_add_keydata(pgp_io_t *         io,
 bool
 rnp_key_store_remove_key(pgp_io_t *io, rnp_key_store_t *keyring, const pgp_key_t *key)
 {
+    unsigned found = UINT_MAX;
+
     for (unsigned i = 0; i < keyring->keyc; i++) {
-        if (key == &keyring->keys[i]) {
-            memmove(&keyring->keys[i],
-                    &keyring->keys[i + 1],
-                    sizeof(pgp_key_t) * (keyring->keyc - i));
-            keyring->keyc--;
-            return true;
+        pgp_key_t *other = keyring->keys[i];
+
+        if (key == other) {
+            found = i;
+            continue;
         }
+        /* slot may be reused by another key, so it must not stay in the subkeys */
+        for (unsigned j = 0; j < other->subkeyc; j++) {
+            if (other->subkeys[j] == key) {
+                memmove(&other->subkeys[j],
+                        &other->subkeys[j + 1],
+                        sizeof(*other->subkeys) * (other->subkeyc - j - 1));
+                other->subkeyc--;
+                break;
+            }
+        }
+    }
+    if (found == UINT_MAX) {
+        return false;
     }
 
-    return false;
+    rnp_key_store_journal_key_removed(keyring, key);
+    key_slot_release(keyring, keyring->keys[found]);
+    memmove(&keyring->keys[found],
+            &keyring->keys[found + 1],
+            sizeof(*keyring->keys) * (keyring->keyc - found - 1));
+    keyring->keyc--;
+    /* indexes of the following keys are changed */
+    key_index_free(&keyring->index);
+    key_index_update(keyring);
+    return true;
+}
+
+static int
+key_ptr_compare(const void *a, const void *b)
+{
+    uintptr_t pa = (uintptr_t) *(pgp_key_t *const *) a;
+    uintptr_t pb = (uintptr_t) *(pgp_key_t *const *) b;
+    return (pa > pb) - (pa < pb);
+}
+
+static bool
+key_ptr_listed(pgp_key_t **keys, unsigned count, const pgp_key_t *key)
+{
+    return bsearch(&key, keys, count, sizeof(*keys), key_ptr_compare) != NULL;
+}
+
+unsigned
+rnp_key_store_remove_keys_if(pgp_io_t *            io,
+                             rnp_key_store_t *     keyring,
+                             unsigned              from,
+                             rnp_key_match_func_t *match,
+                             void *                param)
+{
+    pgp_key_t **dead;
+    unsigned    deadc = 0;
+    unsigned    keyc = 0;
+
+    if (from >= keyring->keyc) {
+        return 0;
+    }
+    if (!(dead = malloc(sizeof(*dead) * (keyring->keyc - from)))) {
+        /* slow but still correct way */
+        RNP_LOG("allocation failed");
+        for (unsigned i = keyring->keyc; i-- > from;) {
+            pgp_key_t *key = keyring->keys[i];
+            if (match(key, param)) {
+                pgp_key_free_data(key);
+                rnp_key_store_remove_key(io, keyring, key);
+                deadc++;
+            }
+        }
+        return deadc;
+    }
+
+    for (unsigned i = from; i < keyring->keyc; i++) {
+        if (match(keyring->keys[i], param)) {
+            dead[deadc++] = keyring->keys[i];
+        }
+    }
+    if (!deadc) {
+        free(dead);
+        return 0;
+    }
+    /* sorted by address, so keys are looked up in log(deadc) */
+    qsort(dead, deadc, sizeof(*dead), key_ptr_compare);
+
+    for (unsigned i = 0; i < keyring->keyc; i++) {
+        pgp_key_t *key = keyring->keys[i];
+        unsigned   subkeyc = 0;
+
+        if ((i >= from) && key_ptr_listed(dead, deadc, key)) {
+            continue;
+        }
+        for (unsigned j = 0; j < key->subkeyc; j++) {
+            if (!key_ptr_listed(dead, deadc, key->subkeys[j])) {
+                key->subkeys[subkeyc++] = key->subkeys[j];
+            }
+        }
+        key->subkeyc = subkeyc;
+        keyring->keys[keyc++] = key;
+    }
+    keyring->keyc = keyc;
+
+    for (unsigned i = 0; i < deadc; i++) {
+        rnp_key_store_journal_key_removed(keyring, dead[i]);
+        pgp_key_free_data(dead[i]);
+        key_slot_release(keyring, dead[i]);
+    }
+    free(dead);
+    /* indexes of the following keys are changed */
+    key_index_free(&keyring->index);
+    key_index_update(keyring);
+    return deadc;
 }
 
 bool
@@ -632,6 +1019,36 @@ rnp_key_store_remove_key_by_id(pgp_io_t *io, rnp_key_store_t *keyring, const uin
     return false;
 }
 
+static bool
+key_matches_keyid(const pgp_key_t *key, const uint8_t *keyid)
+{
+    return (memcmp(key->keyid, keyid, PGP_KEY_ID_SIZE) == 0) ||
+           (memcmp(&key->keyid[PGP_KEY_ID_SIZE / 2], keyid, PGP_KEY_ID_SIZE / 2) == 0);
+}
+
+/* return the lowest index >= from of the key matching keyid, or UINT_MAX */
+static unsigned
+key_index_find_keyid(const rnp_key_store_t *keyring, const uint8_t *keyid, unsigned from)
+{
+    const rnp_key_store_index_t *index = &keyring->index;
+    unsigned                     mask = index->size - 1;
+    unsigned                     found = UINT_MAX;
+    /* full keyid is indexed by its lower half, while short one is passed in the first */
+    const uint8_t *halves[2] = {&keyid[PGP_KEY_ID_SIZE / 2], keyid};
+
+    for (int i = 0; i < 2; i++) {
+        for (unsigned slot = key_index_hash(halves[i]) & mask; index->keyids[slot];
+             slot = (slot + 1) & mask) {
+            unsigned idx = index->keyids[slot] - 1;
+            if ((idx >= from) && (idx < found) &&
+                key_matches_keyid(keyring->keys[idx], keyid)) {
+                found = idx;
+            }
+        }
+    }
+    return found;
+}
+
 /**
    \ingroup HighLevel_KeyringFind
 
@@ -657,19 +1074,29 @@ rnp_key_store_get_key_by_id(pgp_io_t *             io,
         fprintf(io->errs, "searching keyring %p\n", keyring);
     }
 
+    if (keyring && (*from < keyring->keyc) && key_index_valid(keyring)) {
+        unsigned idx = key_index_find_keyid(keyring, keyid, *from);
+        if (idx == UINT_MAX) {
+            *from = keyring->keyc;
+            return NULL;
+        }
+        *from = idx;
+        if (pubkey) {
+            *pubkey = &keyring->keys[idx]->key.pubkey;
+        }
+        return keyring->keys[idx];
+    }
+
     for (; keyring && *from < keyring->keyc; *from += 1) {
         if (rnp_get_debug(__FILE__)) {
-            hexdump(io->errs, "keyring keyid", keyring->keys[*from].keyid, PGP_KEY_ID_SIZE);
+            hexdump(io->errs, "keyring keyid", keyring->keys[*from]->keyid, PGP_KEY_ID_SIZE);
             hexdump(io->errs, "keyid", keyid, PGP_KEY_ID_SIZE);
         }
-        if (memcmp(keyring->keys[*from].keyid, keyid, PGP_KEY_ID_SIZE) == 0 ||
-            memcmp(&keyring->keys[*from].keyid[PGP_KEY_ID_SIZE / 2],
-                   keyid,
-                   PGP_KEY_ID_SIZE / 2) == 0) {
+        if (key_matches_keyid(keyring->keys[*from], keyid)) {
             if (pubkey) {
-                *pubkey = &keyring->keys[*from].key.pubkey;
+                *pubkey = &keyring->keys[*from]->key.pubkey;
             }
-            return &keyring->keys[*from];
+            return keyring->keys[*from];
         }
     }
     return NULL;
@@ -682,13 +1109,78 @@ rnp_key_store_get_key_by_grip(pgp_io_t *io, rnp_key_store_t *keyring, const uint
         fprintf(io->errs, "looking keyring %p\n", keyring);
     }
 
+    if (keyring && key_index_valid(keyring)) {
+        const rnp_key_store_index_t *index = &keyring->index;
+        unsigned                     mask = index->size - 1;
+        unsigned                     found = UINT_MAX;
+
+        for (unsigned slot = key_index_hash(grip) & mask; index->grips[slot];
+             slot = (slot + 1) & mask) {
+            unsigned idx = index->grips[slot] - 1;
+            if ((idx < found) &&
+                !memcmp(keyring->keys[idx]->grip, grip, PGP_FINGERPRINT_SIZE)) {
+                found = idx;
+            }
+        }
+        return found == UINT_MAX ? NULL : keyring->keys[found];
+    }
+
     for (unsigned i = 0; keyring && i < keyring->keyc; i++) {
         if (rnp_get_debug(__FILE__)) {
             hexdump(io->errs, "looking for grip", grip, PGP_FINGERPRINT_SIZE);
-            hexdump(io->errs, "keyring grip", keyring->keys[i].grip, PGP_FINGERPRINT_SIZE);
+            hexdump(io->errs, "keyring grip", keyring->keys[i]->grip, PGP_FINGERPRINT_SIZE);
+        }
+        if (memcmp(keyring->keys[i]->grip, grip, PGP_FINGERPRINT_SIZE) == 0) {
+            return keyring->keys[i];
         }
-        if (memcmp(keyring->keys[i].grip, grip, PGP_FINGERPRINT_SIZE) == 0) {
-            return &keyring->keys[i];
+    }
+    return NULL;
+}
+
+static bool
+key_matches_fpr(const pgp_key_t *key, const pgp_fingerprint_t *fpr)
+{
+    return (key->fingerprint.length == fpr->length) &&
+           !memcmp(key->fingerprint.fingerprint, fpr->fingerprint, fpr->length);
+}
+
+/**
+   \ingroup HighLevel_KeyringFind
+
+   \brief Finds key in keyring from its fingerprint
+
+   \param keyring Keyring to be searched
+   \param fpr fingerprint of required key
+
+   \return Pointer to the first matching key, if found; NULL, if not found
+*/
+pgp_key_t *
+rnp_key_store_get_key_by_fpr(pgp_io_t *               io,
+                             const rnp_key_store_t *  keyring,
+                             const pgp_fingerprint_t *fpr)
+{
+    if (!keyring || !fpr || (fpr->length < 4)) {
+        return NULL;
+    }
+
+    if (key_index_valid(keyring)) {
+        const rnp_key_store_index_t *index = &keyring->index;
+        unsigned                     mask = index->size - 1;
+        unsigned                     found = UINT_MAX;
+
+        for (unsigned slot = key_index_hash(fpr->fingerprint) & mask; index->fprints[slot];
+             slot = (slot + 1) & mask) {
+            unsigned idx = index->fprints[slot] - 1;
+            if ((idx < found) && key_matches_fpr(keyring->keys[idx], fpr)) {
+                found = idx;
+            }
+        }
+        return found == UINT_MAX ? NULL : keyring->keys[found];
+    }
+
+    for (unsigned i = 0; i < keyring->keyc; i++) {
+        if (key_matches_fpr(keyring->keys[i], fpr)) {
+            return keyring->keys[i];
         }
     }
     return NULL;
@@ -776,7 +1268,8 @@ get_key_by_name(pgp_io_t *             io,
         RNP_LOG_FD(io->errs, "Can't compile regex from string: '%s'", name);
         return false;
     }
-    for (keyp = &keyring->keys[*from]; *from < keyring->keyc; *from += 1, keyp++) {
+    for (; *from < keyring->keyc; *from += 1) {
+        keyp = keyring->keys[*from];
         uidp = keyp->uids;
         for (i = 0; i < keyp->uidc; i++, uidp++) {
             if (regexec(&r, (char *) *uidp, 0, NULL, 0) == 0) {
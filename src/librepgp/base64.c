@@ -0,0 +1,472 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <string.h>
+#include "base64.h"
+#include "crc24.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+   Table for base64 lookups:
+   0xff - wrong character,
+   0xfe - '='
+   0xfd - eol/whitespace,
+   0..0x3f - represented 6-bit number
+*/
+const uint8_t PGP_B64DEC[256] = {
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfd, 0xfd, 0xff, 0xff, 0xfd, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xfd, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff,
+  0xff, 0xff, 0x3f, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff,
+  0xff, 0xfe, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+  0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+  0x19, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21,
+  0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+  0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff};
+
+/* Base 64 encoded table, quadruplicated to save cycles on use & 0x3f operation  */
+const uint8_t PGP_B64ENC[256] = {
+  'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R',
+  'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j',
+  'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1',
+  '2', '3', '4', '5', '6', '7', '8', '9', '+', '/', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+  'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
+  'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r',
+  's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+  '+', '/', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+  'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h',
+  'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
+  '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/', 'A', 'B', 'C', 'D', 'E', 'F',
+  'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+  'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p',
+  'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7',
+  '8', '9', '+', '/'};
+
+/* number of bytes which are packed and then checksummed at once, must be multiple of 3 */
+#define BASE64_CRC_BLOCK 1536
+
+typedef enum { BASE64_SCALAR, BASE64_SSE41, BASE64_AVX2 } base64_impl_t;
+
+static base64_impl_t
+base64_impl(void)
+{
+#ifdef BASE64_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return BASE64_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return BASE64_SSE41;
+    }
+#endif
+    return BASE64_SCALAR;
+}
+
+static void
+base64_encode_scalar(uint8_t *out, const uint8_t *in, size_t len)
+{
+    const uint8_t *end = in + len;
+    uint32_t       t;
+
+    while (in < end) {
+        t = (in[0] << 16) | (in[1] << 8) | (in[2]);
+        in += 3;
+        *out++ = PGP_B64ENC[(t >> 18) & 0xff];
+        *out++ = PGP_B64ENC[(t >> 12) & 0xff];
+        *out++ = PGP_B64ENC[(t >> 6) & 0xff];
+        *out++ = PGP_B64ENC[t & 0xff];
+    }
+}
+
+/* process characters until the first one which is not base64 value or whitespace */
+static size_t
+base64_decode_chars_scalar(uint8_t *out, const uint8_t *in, size_t len, size_t *used)
+{
+    uint8_t *optr = out;
+    uint8_t  bval;
+    size_t   i;
+
+    for (i = 0; i < len; i++) {
+        if ((bval = PGP_B64DEC[in[i]]) < 64) {
+            *optr++ = bval;
+        } else if (bval != 0xfd) {
+            break;
+        }
+    }
+
+    *used = i;
+    return optr - out;
+}
+
+static void
+base64_pack_scalar(uint8_t *out, const uint8_t *in, size_t len)
+{
+    const uint8_t *end = in + len;
+    uint32_t       b24;
+
+    while (in < end) {
+        b24 = *in++ << 18;
+        b24 |= *in++ << 12;
+        b24 |= *in++ << 6;
+        b24 |= *in++;
+        *out++ = b24 >> 16;
+        *out++ = b24 >> 8;
+        *out++ = b24 & 0xff;
+    }
+}
+
+#ifdef BASE64_X86
+
+/* SIMD kernels are based on the algorithms by Wojciech Mula and Daniel Lemire from
+ * "Faster Base64 Encoding and Decoding Using AVX2 Instructions". AVX2 versions do the same
+ * operations in both 128-bit lanes. */
+
+/* 6-bit indexes to base64 characters */
+__attribute__((target("sse4.1"))) static inline __m128i
+base64_enc_lookup_sse41(__m128i idx)
+{
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    __m128i res = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+
+    res = _mm_or_si128(res, _mm_and_si128(less, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, res), idx);
+}
+
+/* 12 bytes at the beginning of the vector to 16 6-bit indexes */
+__attribute__((target("sse4.1"))) static inline __m128i
+base64_enc_split_sse41(__m128i in)
+{
+    __m128i t0, t1;
+
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                         _mm_set1_epi32(0x04000040));
+    t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                         _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t0, t1);
+}
+
+__attribute__((target("sse4.1"))) static void
+base64_encode_sse41(uint8_t *out, const uint8_t *in, size_t len)
+{
+    /* 16 bytes are loaded while 12 are used */
+    while (len >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) in);
+        v = base64_enc_lookup_sse41(base64_enc_split_sse41(v));
+        _mm_storeu_si128((__m128i *) out, v);
+        in += 12;
+        out += 16;
+        len -= 12;
+    }
+    base64_encode_scalar(out, in, len);
+}
+
+/* base64 characters to 6-bit values, sets bits of *bad for the non-base64 characters */
+__attribute__((target("sse4.1"))) static inline __m128i
+base64_dec_lookup_sse41(__m128i in, unsigned *bad)
+{
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll =
+      _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    __m128i hi = _mm_and_si128(_mm_srli_epi32(in, 4), mask);
+    __m128i lo = _mm_and_si128(in, mask);
+    __m128i chk = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo), _mm_shuffle_epi8(lut_hi, hi));
+    __m128i eq = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+    __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq, hi));
+
+    *bad = ~_mm_movemask_epi8(_mm_cmpeq_epi8(chk, _mm_setzero_si128())) & 0xffff;
+    return _mm_add_epi8(in, roll);
+}
+
+__attribute__((target("sse4.1"))) static size_t
+base64_decode_chars_sse41(uint8_t *out, const uint8_t *in, size_t len, size_t *used)
+{
+    size_t   i = 0;
+    size_t   o = 0;
+    unsigned bad;
+
+    while (i + 16 <= len) {
+        __m128i v = base64_dec_lookup_sse41(_mm_loadu_si128((const __m128i *) &in[i]), &bad);
+        /* o <= i so store doesn't go beyond the out + len */
+        _mm_storeu_si128((__m128i *) &out[o], v);
+        if (!bad) {
+            i += 16;
+            o += 16;
+            continue;
+        }
+        /* leave values before the first non-base64 character, skip it if it is whitespace */
+        i += __builtin_ctz(bad);
+        o += __builtin_ctz(bad);
+        if (PGP_B64DEC[in[i]] != 0xfd) {
+            *used = i;
+            return o;
+        }
+        i++;
+    }
+
+    o += base64_decode_chars_scalar(&out[o], &in[i], len - i, used);
+    *used += i;
+    return o;
+}
+
+/* 16 6-bit values to 12 bytes at the beginning of the vector */
+__attribute__((target("sse4.1"))) static inline __m128i
+base64_dec_pack_sse41(__m128i v)
+{
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(
+      v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__((target("sse4.1"))) static void
+base64_pack_sse41(uint8_t *out, const uint8_t *in, size_t len)
+{
+    uint32_t last;
+
+    while (len >= 16) {
+        __m128i v = base64_dec_pack_sse41(_mm_loadu_si128((const __m128i *) in));
+        /* exactly 12 bytes are stored */
+        _mm_storel_epi64((__m128i *) out, v);
+        last = _mm_extract_epi32(v, 2);
+        memcpy(out + 8, &last, 4);
+        in += 16;
+        out += 12;
+        len -= 16;
+    }
+    base64_pack_scalar(out, in, len);
+}
+
+__attribute__((target("avx2"))) static void
+base64_encode_avx2(uint8_t *out, const uint8_t *in, size_t len)
+{
+    const __m256i shift = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    const __m256i shuf = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                         10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+
+    /* each lane gets 12 bytes, while 16 are loaded */
+    while (len >= 28) {
+        __m256i v = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) in)),
+          _mm_loadu_si128((const __m128i *) (in + 12)),
+          1);
+        __m256i t0, t1, res, less;
+
+        v = _mm256_shuffle_epi8(v, shuf);
+        t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)),
+                                _mm256_set1_epi32(0x04000040));
+        t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)),
+                                _mm256_set1_epi32(0x01000010));
+        v = _mm256_or_si256(t0, t1);
+
+        res = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), v);
+        res = _mm256_or_si256(res, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        v = _mm256_add_epi8(_mm256_shuffle_epi8(shift, res), v);
+
+        _mm256_storeu_si256((__m256i *) out, v);
+        in += 24;
+        out += 32;
+        len -= 24;
+    }
+    /* avoid the AVX to SSE transition penalty in the tail and in the caller */
+    _mm256_zeroupper();
+    base64_encode_sse41(out, in, len);
+}
+
+__attribute__((target("avx2"))) static size_t
+base64_decode_chars_avx2(uint8_t *out, const uint8_t *in, size_t len, size_t *used)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B,
+      0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B,
+      0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0,
+                                              0, 0, 0, 0, 16, 19, 4, -65, -65, -71, -71, 0, 0,
+                                              0, 0, 0, 0, 0, 0);
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t        i = 0;
+    size_t        o = 0;
+    size_t        rest;
+
+    while (i + 32 <= len) {
+        __m256i  v = _mm256_loadu_si256((const __m256i *) &in[i]);
+        __m256i  hi = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask);
+        __m256i  lo = _mm256_and_si256(v, mask);
+        __m256i  chk = _mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo),
+                                       _mm256_shuffle_epi8(lut_hi, hi));
+        __m256i  eq = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'));
+        __m256i  roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq, hi));
+        uint32_t bad = ~(uint32_t) _mm256_movemask_epi8(
+          _mm256_cmpeq_epi8(chk, _mm256_setzero_si256()));
+
+        /* o <= i so store doesn't go beyond the out + len */
+        _mm256_storeu_si256((__m256i *) &out[o], _mm256_add_epi8(v, roll));
+        if (!bad) {
+            i += 32;
+            o += 32;
+            continue;
+        }
+        /* leave values before the first non-base64 character, skip it if it is whitespace */
+        i += __builtin_ctz(bad);
+        o += __builtin_ctz(bad);
+        if (PGP_B64DEC[in[i]] != 0xfd) {
+            *used = i;
+            return o;
+        }
+        i++;
+    }
+
+    _mm256_zeroupper();
+    o += base64_decode_chars_sse41(&out[o], &in[i], len - i, &rest);
+    *used = i + rest;
+    return o;
+}
+
+__attribute__((target("avx2"))) static void
+base64_pack_avx2(uint8_t *out, const uint8_t *in, size_t len)
+{
+    const __m256i shuf = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1,
+                                          -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                                          -1, -1);
+    /* move 12 bytes of each lane together */
+    const __m256i perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+    while (len >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) in);
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+        v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuf), perm);
+        /* exactly 24 bytes are stored */
+        _mm_storeu_si128((__m128i *) out, _mm256_castsi256_si128(v));
+        _mm_storel_epi64((__m128i *) (out + 16), _mm256_extracti128_si256(v, 1));
+        in += 32;
+        out += 24;
+        len -= 32;
+    }
+    _mm256_zeroupper();
+    base64_pack_sse41(out, in, len);
+}
+
+#endif
+
+void
+pgp_base64_encode(uint8_t *out, const uint8_t *in, size_t len)
+{
+    switch (base64_impl()) {
+#ifdef BASE64_X86
+    case BASE64_AVX2:
+        base64_encode_avx2(out, in, len);
+        return;
+    case BASE64_SSE41:
+        base64_encode_sse41(out, in, len);
+        return;
+#endif
+    default:
+        base64_encode_scalar(out, in, len);
+    }
+}
+
+size_t
+pgp_base64_decode_chars(uint8_t *out, const uint8_t *in, size_t len, size_t *used)
+{
+    switch (base64_impl()) {
+#ifdef BASE64_X86
+    case BASE64_AVX2:
+        return base64_decode_chars_avx2(out, in, len, used);
+    case BASE64_SSE41:
+        return base64_decode_chars_sse41(out, in, len, used);
+#endif
+    default:
+        return base64_decode_chars_scalar(out, in, len, used);
+    }
+}
+
+static void
+base64_pack(uint8_t *out, const uint8_t *in, size_t len)
+{
+    switch (base64_impl()) {
+#ifdef BASE64_X86
+    case BASE64_AVX2:
+        base64_pack_avx2(out, in, len);
+        return;
+    case BASE64_SSE41:
+        base64_pack_sse41(out, in, len);
+        return;
+#endif
+    default:
+        base64_pack_scalar(out, in, len);
+    }
+}
+
+void
+pgp_base64_pack(uint8_t *out, const uint8_t *in, size_t len, uint32_t *crc)
+{
+    size_t blen;
+
+    if (!crc) {
+        base64_pack(out, in, len);
+        return;
+    }
+
+    while (len) {
+        blen = len > BASE64_CRC_BLOCK / 3 * 4 ? BASE64_CRC_BLOCK / 3 * 4 : len;
+        base64_pack(out, in, blen);
+        *crc = pgp_crc24_update(*crc, out, blen / 4 * 3);
+        in += blen;
+        out += blen / 4 * 3;
+        len -= blen;
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** Base64 kernels used by the ASCII armor streams
+ *  @file
+ */
+#ifndef RNP_BASE64_H
+#define RNP_BASE64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ *  @private
+ *  SSE4.1 and AVX2 versions of the kernels are selected at runtime on x86 CPUs which support
+ *  them, otherwise portable table-driven code is used. All of the versions produce the
+ *  same output. Packing may update the armor checksum on the same blocks of data, so
+ *  decoded data is not read once more in a separate pass.
+ */
+
+/* base64 character to 6-bit value, or 0xff for wrong character, 0xfe for '=', 0xfd for
+ * eol/whitespace */
+extern const uint8_t PGP_B64DEC[256];
+/* 8-bit value to base64 character, upper 2 bits are ignored */
+extern const uint8_t PGP_B64ENC[256];
+
+/** @private
+ *  encode 3-byte groups to the base64 characters, without any line breaks
+ *
+ *  @param out output buffer, must have space for len / 3 * 4 characters
+ *  @param in input data
+ *  @param len length of the input data, must be multiple of 3
+ **/
+void pgp_base64_encode(uint8_t *out, const uint8_t *in, size_t len);
+
+/** @private
+ *  convert base64 characters to the 6-bit values, skipping spaces, tabs and eols
+ *
+ *  @param out output buffer, must have space for len values
+ *  @param in base64 characters
+ *  @param len number of characters in the input
+ *  @param used number of processed characters will be stored here. If it is less than len
+ *         then in[*used] is either '=' or the wrong character.
+ *  @return number of values stored in out
+ **/
+size_t pgp_base64_decode_chars(uint8_t *out, const uint8_t *in, size_t len, size_t *used);
+
+/** @private
+ *  pack 6-bit values, produced by pgp_base64_decode_chars(), to bytes
+ *
+ *  @param out output buffer, must have space for len / 4 * 3 bytes
+ *  @param in 6-bit values
+ *  @param len number of values, must be multiple of 4
+ *  @param crc if not NULL then CRC24 of the output bytes is accumulated here
+ **/
+void pgp_base64_pack(uint8_t *out, const uint8_t *in, size_t len, uint32_t *crc);
+
+#endif
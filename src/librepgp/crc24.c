@@ -0,0 +1,446 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <stdbool.h>
+#include "crc24.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC24_CLMUL 1
+#include <immintrin.h>
+#endif
+
+/*
+   CRC24_TABLE[k][b] = b * x^(24 + 8 * k) mod P, where P = 0x1864CFB is the OpenPGP CRC24
+   polynomial. So CRC24_TABLE[0] is the usual bytewise table, and the others allow to
+   process 8 bytes per step.
+*/
+static const uint32_t CRC24_TABLE[8][256] = {
+  {
+    0x000000, 0x864cfb, 0x8ad50d, 0x0c99f6, 0x93e6e1, 0x15aa1a, 0x1933ec, 0x9f7f17,
+    0xa18139, 0x27cdc2, 0x2b5434, 0xad18cf, 0x3267d8, 0xb42b23, 0xb8b2d5, 0x3efe2e,
+    0xc54e89, 0x430272, 0x4f9b84, 0xc9d77f, 0x56a868, 0xd0e493, 0xdc7d65, 0x5a319e,
+    0x64cfb0, 0xe2834b, 0xee1abd, 0x685646, 0xf72951, 0x7165aa, 0x7dfc5c, 0xfbb0a7,
+    0x0cd1e9, 0x8a9d12, 0x8604e4, 0x00481f, 0x9f3708, 0x197bf3, 0x15e205, 0x93aefe,
+    0xad50d0, 0x2b1c2b, 0x2785dd, 0xa1c926, 0x3eb631, 0xb8faca, 0xb4633c, 0x322fc7,
+    0xc99f60, 0x4fd39b, 0x434a6d, 0xc50696, 0x5a7981, 0xdc357a, 0xd0ac8c, 0x56e077,
+    0x681e59, 0xee52a2, 0xe2cb54, 0x6487af, 0xfbf8b8, 0x7db443, 0x712db5, 0xf7614e,
+    0x19a3d2, 0x9fef29, 0x9376df, 0x153a24, 0x8a4533, 0x0c09c8, 0x00903e, 0x86dcc5,
+    0xb822eb, 0x3e6e10, 0x32f7e6, 0xb4bb1d, 0x2bc40a, 0xad88f1, 0xa11107, 0x275dfc,
+    0xdced5b, 0x5aa1a0, 0x563856, 0xd074ad, 0x4f0bba, 0xc94741, 0xc5deb7, 0x43924c,
+    0x7d6c62, 0xfb2099, 0xf7b96f, 0x71f594, 0xee8a83, 0x68c678, 0x645f8e, 0xe21375,
+    0x15723b, 0x933ec0, 0x9fa736, 0x19ebcd, 0x8694da, 0x00d821, 0x0c41d7, 0x8a0d2c,
+    0xb4f302, 0x32bff9, 0x3e260f, 0xb86af4, 0x2715e3, 0xa15918, 0xadc0ee, 0x2b8c15,
+    0xd03cb2, 0x567049, 0x5ae9bf, 0xdca544, 0x43da53, 0xc596a8, 0xc90f5e, 0x4f43a5,
+    0x71bd8b, 0xf7f170, 0xfb6886, 0x7d247d, 0xe25b6a, 0x641791, 0x688e67, 0xeec29c,
+    0x3347a4, 0xb50b5f, 0xb992a9, 0x3fde52, 0xa0a145, 0x26edbe, 0x2a7448, 0xac38b3,
+    0x92c69d, 0x148a66, 0x181390, 0x9e5f6b, 0x01207c, 0x876c87, 0x8bf571, 0x0db98a,
+    0xf6092d, 0x7045d6, 0x7cdc20, 0xfa90db, 0x65efcc, 0xe3a337, 0xef3ac1, 0x69763a,
+    0x578814, 0xd1c4ef, 0xdd5d19, 0x5b11e2, 0xc46ef5, 0x42220e, 0x4ebbf8, 0xc8f703,
+    0x3f964d, 0xb9dab6, 0xb54340, 0x330fbb, 0xac70ac, 0x2a3c57, 0x26a5a1, 0xa0e95a,
+    0x9e1774, 0x185b8f, 0x14c279, 0x928e82, 0x0df195, 0x8bbd6e, 0x872498, 0x016863,
+    0xfad8c4, 0x7c943f, 0x700dc9, 0xf64132, 0x693e25, 0xef72de, 0xe3eb28, 0x65a7d3,
+    0x5b59fd, 0xdd1506, 0xd18cf0, 0x57c00b, 0xc8bf1c, 0x4ef3e7, 0x426a11, 0xc426ea,
+    0x2ae476, 0xaca88d, 0xa0317b, 0x267d80, 0xb90297, 0x3f4e6c, 0x33d79a, 0xb59b61,
+    0x8b654f, 0x0d29b4, 0x01b042, 0x87fcb9, 0x1883ae, 0x9ecf55, 0x9256a3, 0x141a58,
+    0xefaaff, 0x69e604, 0x657ff2, 0xe33309, 0x7c4c1e, 0xfa00e5, 0xf69913, 0x70d5e8,
+    0x4e2bc6, 0xc8673d, 0xc4fecb, 0x42b230, 0xddcd27, 0x5b81dc, 0x57182a, 0xd154d1,
+    0x26359f, 0xa07964, 0xace092, 0x2aac69, 0xb5d37e, 0x339f85, 0x3f0673, 0xb94a88,
+    0x87b4a6, 0x01f85d, 0x0d61ab, 0x8b2d50, 0x145247, 0x921ebc, 0x9e874a, 0x18cbb1,
+    0xe37b16, 0x6537ed, 0x69ae1b, 0xefe2e0, 0x709df7, 0xf6d10c, 0xfa48fa, 0x7c0401,
+    0x42fa2f, 0xc4b6d4, 0xc82f22, 0x4e63d9, 0xd11cce, 0x575035, 0x5bc9c3, 0xdd8538
+  },
+  {
+    0x000000, 0x668f48, 0xcd1e90, 0xab91d8, 0x1c71db, 0x7afe93, 0xd16f4b, 0xb7e003,
+    0x38e3b6, 0x5e6cfe, 0xf5fd26, 0x93726e, 0x24926d, 0x421d25, 0xe98cfd, 0x8f03b5,
+    0x71c76c, 0x174824, 0xbcd9fc, 0xda56b4, 0x6db6b7, 0x0b39ff, 0xa0a827, 0xc6276f,
+    0x4924da, 0x2fab92, 0x843a4a, 0xe2b502, 0x555501, 0x33da49, 0x984b91, 0xfec4d9,
+    0xe38ed8, 0x850190, 0x2e9048, 0x481f00, 0xffff03, 0x99704b, 0x32e193, 0x546edb,
+    0xdb6d6e, 0xbde226, 0x1673fe, 0x70fcb6, 0xc71cb5, 0xa193fd, 0x0a0225, 0x6c8d6d,
+    0x9249b4, 0xf4c6fc, 0x5f5724, 0x39d86c, 0x8e386f, 0xe8b727, 0x4326ff, 0x25a9b7,
+    0xaaaa02, 0xcc254a, 0x67b492, 0x013bda, 0xb6dbd9, 0xd05491, 0x7bc549, 0x1d4a01,
+    0x41514b, 0x27de03, 0x8c4fdb, 0xeac093, 0x5d2090, 0x3bafd8, 0x903e00, 0xf6b148,
+    0x79b2fd, 0x1f3db5, 0xb4ac6d, 0xd22325, 0x65c326, 0x034c6e, 0xa8ddb6, 0xce52fe,
+    0x309627, 0x56196f, 0xfd88b7, 0x9b07ff, 0x2ce7fc, 0x4a68b4, 0xe1f96c, 0x877624,
+    0x087591, 0x6efad9, 0xc56b01, 0xa3e449, 0x14044a, 0x728b02, 0xd91ada, 0xbf9592,
+    0xa2df93, 0xc450db, 0x6fc103, 0x094e4b, 0xbeae48, 0xd82100, 0x73b0d8, 0x153f90,
+    0x9a3c25, 0xfcb36d, 0x5722b5, 0x31adfd, 0x864dfe, 0xe0c2b6, 0x4b536e, 0x2ddc26,
+    0xd318ff, 0xb597b7, 0x1e066f, 0x788927, 0xcf6924, 0xa9e66c, 0x0277b4, 0x64f8fc,
+    0xebfb49, 0x8d7401, 0x26e5d9, 0x406a91, 0xf78a92, 0x9105da, 0x3a9402, 0x5c1b4a,
+    0x82a296, 0xe42dde, 0x4fbc06, 0x29334e, 0x9ed34d, 0xf85c05, 0x53cddd, 0x354295,
+    0xba4120, 0xdcce68, 0x775fb0, 0x11d0f8, 0xa630fb, 0xc0bfb3, 0x6b2e6b, 0x0da123,
+    0xf365fa, 0x95eab2, 0x3e7b6a, 0x58f422, 0xef1421, 0x899b69, 0x220ab1, 0x4485f9,
+    0xcb864c, 0xad0904, 0x0698dc, 0x601794, 0xd7f797, 0xb178df, 0x1ae907, 0x7c664f,
+    0x612c4e, 0x07a306, 0xac32de, 0xcabd96, 0x7d5d95, 0x1bd2dd, 0xb04305, 0xd6cc4d,
+    0x59cff8, 0x3f40b0, 0x94d168, 0xf25e20, 0x45be23, 0x23316b, 0x88a0b3, 0xee2ffb,
+    0x10eb22, 0x76646a, 0xddf5b2, 0xbb7afa, 0x0c9af9, 0x6a15b1, 0xc18469, 0xa70b21,
+    0x280894, 0x4e87dc, 0xe51604, 0x83994c, 0x34794f, 0x52f607, 0xf967df, 0x9fe897,
+    0xc3f3dd, 0xa57c95, 0x0eed4d, 0x686205, 0xdf8206, 0xb90d4e, 0x129c96, 0x7413de,
+    0xfb106b, 0x9d9f23, 0x360efb, 0x5081b3, 0xe761b0, 0x81eef8, 0x2a7f20, 0x4cf068,
+    0xb234b1, 0xd4bbf9, 0x7f2a21, 0x19a569, 0xae456a, 0xc8ca22, 0x635bfa, 0x05d4b2,
+    0x8ad707, 0xec584f, 0x47c997, 0x2146df, 0x96a6dc, 0xf02994, 0x5bb84c, 0x3d3704,
+    0x207d05, 0x46f24d, 0xed6395, 0x8becdd, 0x3c0cde, 0x5a8396, 0xf1124e, 0x979d06,
+    0x189eb3, 0x7e11fb, 0xd58023, 0xb30f6b, 0x04ef68, 0x626020, 0xc9f1f8, 0xaf7eb0,
+    0x51ba69, 0x373521, 0x9ca4f9, 0xfa2bb1, 0x4dcbb2, 0x2b44fa, 0x80d522, 0xe65a6a,
+    0x6959df, 0x0fd697, 0xa4474f, 0xc2c807, 0x752804, 0x13a74c, 0xb83694, 0xdeb9dc
+  },
+  {
+    0x000000, 0x8309d7, 0x805f55, 0x035682, 0x86f251, 0x05fb86, 0x06ad04, 0x85a4d3,
+    0x8ba859, 0x08a18e, 0x0bf70c, 0x88fedb, 0x0d5a08, 0x8e53df, 0x8d055d, 0x0e0c8a,
+    0x911c49, 0x12159e, 0x11431c, 0x924acb, 0x17ee18, 0x94e7cf, 0x97b14d, 0x14b89a,
+    0x1ab410, 0x99bdc7, 0x9aeb45, 0x19e292, 0x9c4641, 0x1f4f96, 0x1c1914, 0x9f10c3,
+    0xa47469, 0x277dbe, 0x242b3c, 0xa722eb, 0x228638, 0xa18fef, 0xa2d96d, 0x21d0ba,
+    0x2fdc30, 0xacd5e7, 0xaf8365, 0x2c8ab2, 0xa92e61, 0x2a27b6, 0x297134, 0xaa78e3,
+    0x356820, 0xb661f7, 0xb53775, 0x363ea2, 0xb39a71, 0x3093a6, 0x33c524, 0xb0ccf3,
+    0xbec079, 0x3dc9ae, 0x3e9f2c, 0xbd96fb, 0x383228, 0xbb3bff, 0xb86d7d, 0x3b64aa,
+    0xcea429, 0x4dadfe, 0x4efb7c, 0xcdf2ab, 0x485678, 0xcb5faf, 0xc8092d, 0x4b00fa,
+    0x450c70, 0xc605a7, 0xc55325, 0x465af2, 0xc3fe21, 0x40f7f6, 0x43a174, 0xc0a8a3,
+    0x5fb860, 0xdcb1b7, 0xdfe735, 0x5ceee2, 0xd94a31, 0x5a43e6, 0x591564, 0xda1cb3,
+    0xd41039, 0x5719ee, 0x544f6c, 0xd746bb, 0x52e268, 0xd1ebbf, 0xd2bd3d, 0x51b4ea,
+    0x6ad040, 0xe9d997, 0xea8f15, 0x6986c2, 0xec2211, 0x6f2bc6, 0x6c7d44, 0xef7493,
+    0xe17819, 0x6271ce, 0x61274c, 0xe22e9b, 0x678a48, 0xe4839f, 0xe7d51d, 0x64dcca,
+    0xfbcc09, 0x78c5de, 0x7b935c, 0xf89a8b, 0x7d3e58, 0xfe378f, 0xfd610d, 0x7e68da,
+    0x706450, 0xf36d87, 0xf03b05, 0x7332d2, 0xf69601, 0x759fd6, 0x76c954, 0xf5c083,
+    0x1b04a9, 0x980d7e, 0x9b5bfc, 0x18522b, 0x9df6f8, 0x1eff2f, 0x1da9ad, 0x9ea07a,
+    0x90acf0, 0x13a527, 0x10f3a5, 0x93fa72, 0x165ea1, 0x955776, 0x9601f4, 0x150823,
+    0x8a18e0, 0x091137, 0x0a47b5, 0x894e62, 0x0ceab1, 0x8fe366, 0x8cb5e4, 0x0fbc33,
+    0x01b0b9, 0x82b96e, 0x81efec, 0x02e63b, 0x8742e8, 0x044b3f, 0x071dbd, 0x84146a,
+    0xbf70c0, 0x3c7917, 0x3f2f95, 0xbc2642, 0x398291, 0xba8b46, 0xb9ddc4, 0x3ad413,
+    0x34d899, 0xb7d14e, 0xb487cc, 0x378e1b, 0xb22ac8, 0x31231f, 0x32759d, 0xb17c4a,
+    0x2e6c89, 0xad655e, 0xae33dc, 0x2d3a0b, 0xa89ed8, 0x2b970f, 0x28c18d, 0xabc85a,
+    0xa5c4d0, 0x26cd07, 0x259b85, 0xa69252, 0x233681, 0xa03f56, 0xa369d4, 0x206003,
+    0xd5a080, 0x56a957, 0x55ffd5, 0xd6f602, 0x5352d1, 0xd05b06, 0xd30d84, 0x500453,
+    0x5e08d9, 0xdd010e, 0xde578c, 0x5d5e5b, 0xd8fa88, 0x5bf35f, 0x58a5dd, 0xdbac0a,
+    0x44bcc9, 0xc7b51e, 0xc4e39c, 0x47ea4b, 0xc24e98, 0x41474f, 0x4211cd, 0xc1181a,
+    0xcf1490, 0x4c1d47, 0x4f4bc5, 0xcc4212, 0x49e6c1, 0xcaef16, 0xc9b994, 0x4ab043,
+    0x71d4e9, 0xf2dd3e, 0xf18bbc, 0x72826b, 0xf726b8, 0x742f6f, 0x7779ed, 0xf4703a,
+    0xfa7cb0, 0x797567, 0x7a23e5, 0xf92a32, 0x7c8ee1, 0xff8736, 0xfcd1b4, 0x7fd863,
+    0xe0c8a0, 0x63c177, 0x6097f5, 0xe39e22, 0x663af1, 0xe53326, 0xe665a4, 0x656c73,
+    0x6b60f9, 0xe8692e, 0xeb3fac, 0x68367b, 0xed92a8, 0x6e9b7f, 0x6dcdfd, 0xeec42a
+  },
+  {
+    0x000000, 0x360952, 0x6c12a4, 0x5a1bf6, 0xd82548, 0xee2c1a, 0xb437ec, 0x823ebe,
+    0x36066b, 0x000f39, 0x5a14cf, 0x6c1d9d, 0xee2323, 0xd82a71, 0x823187, 0xb438d5,
+    0x6c0cd6, 0x5a0584, 0x001e72, 0x361720, 0xb4299e, 0x8220cc, 0xd83b3a, 0xee3268,
+    0x5a0abd, 0x6c03ef, 0x361819, 0x00114b, 0x822ff5, 0xb426a7, 0xee3d51, 0xd83403,
+    0xd819ac, 0xee10fe, 0xb40b08, 0x82025a, 0x003ce4, 0x3635b6, 0x6c2e40, 0x5a2712,
+    0xee1fc7, 0xd81695, 0x820d63, 0xb40431, 0x363a8f, 0x0033dd, 0x5a282b, 0x6c2179,
+    0xb4157a, 0x821c28, 0xd807de, 0xee0e8c, 0x6c3032, 0x5a3960, 0x002296, 0x362bc4,
+    0x821311, 0xb41a43, 0xee01b5, 0xd808e7, 0x5a3659, 0x6c3f0b, 0x3624fd, 0x002daf,
+    0x367fa3, 0x0076f1, 0x5a6d07, 0x6c6455, 0xee5aeb, 0xd853b9, 0x82484f, 0xb4411d,
+    0x0079c8, 0x36709a, 0x6c6b6c, 0x5a623e, 0xd85c80, 0xee55d2, 0xb44e24, 0x824776,
+    0x5a7375, 0x6c7a27, 0x3661d1, 0x006883, 0x82563d, 0xb45f6f, 0xee4499, 0xd84dcb,
+    0x6c751e, 0x5a7c4c, 0x0067ba, 0x366ee8, 0xb45056, 0x825904, 0xd842f2, 0xee4ba0,
+    0xee660f, 0xd86f5d, 0x8274ab, 0xb47df9, 0x364347, 0x004a15, 0x5a51e3, 0x6c58b1,
+    0xd86064, 0xee6936, 0xb472c0, 0x827b92, 0x00452c, 0x364c7e, 0x6c5788, 0x5a5eda,
+    0x826ad9, 0xb4638b, 0xee787d, 0xd8712f, 0x5a4f91, 0x6c46c3, 0x365d35, 0x005467,
+    0xb46cb2, 0x8265e0, 0xd87e16, 0xee7744, 0x6c49fa, 0x5a40a8, 0x005b5e, 0x36520c,
+    0x6cff46, 0x5af614, 0x00ede2, 0x36e4b0, 0xb4da0e, 0x82d35c, 0xd8c8aa, 0xeec1f8,
+    0x5af92d, 0x6cf07f, 0x36eb89, 0x00e2db, 0x82dc65, 0xb4d537, 0xeecec1, 0xd8c793,
+    0x00f390, 0x36fac2, 0x6ce134, 0x5ae866, 0xd8d6d8, 0xeedf8a, 0xb4c47c, 0x82cd2e,
+    0x36f5fb, 0x00fca9, 0x5ae75f, 0x6cee0d, 0xeed0b3, 0xd8d9e1, 0x82c217, 0xb4cb45,
+    0xb4e6ea, 0x82efb8, 0xd8f44e, 0xeefd1c, 0x6cc3a2, 0x5acaf0, 0x00d106, 0x36d854,
+    0x82e081, 0xb4e9d3, 0xeef225, 0xd8fb77, 0x5ac5c9, 0x6ccc9b, 0x36d76d, 0x00de3f,
+    0xd8ea3c, 0xeee36e, 0xb4f898, 0x82f1ca, 0x00cf74, 0x36c626, 0x6cddd0, 0x5ad482,
+    0xeeec57, 0xd8e505, 0x82fef3, 0xb4f7a1, 0x36c91f, 0x00c04d, 0x5adbbb, 0x6cd2e9,
+    0x5a80e5, 0x6c89b7, 0x369241, 0x009b13, 0x82a5ad, 0xb4acff, 0xeeb709, 0xd8be5b,
+    0x6c868e, 0x5a8fdc, 0x00942a, 0x369d78, 0xb4a3c6, 0x82aa94, 0xd8b162, 0xeeb830,
+    0x368c33, 0x008561, 0x5a9e97, 0x6c97c5, 0xeea97b, 0xd8a029, 0x82bbdf, 0xb4b28d,
+    0x008a58, 0x36830a, 0x6c98fc, 0x5a91ae, 0xd8af10, 0xeea642, 0xb4bdb4, 0x82b4e6,
+    0x829949, 0xb4901b, 0xee8bed, 0xd882bf, 0x5abc01, 0x6cb553, 0x36aea5, 0x00a7f7,
+    0xb49f22, 0x829670, 0xd88d86, 0xee84d4, 0x6cba6a, 0x5ab338, 0x00a8ce, 0x36a19c,
+    0xee959f, 0xd89ccd, 0x82873b, 0xb48e69, 0x36b0d7, 0x00b985, 0x5aa273, 0x6cab21,
+    0xd893f4, 0xee9aa6, 0xb48150, 0x828802, 0x00b6bc, 0x36bfee, 0x6ca418, 0x5aad4a
+  },
+  {
+    0x000000, 0xd9fe8c, 0x35b1e3, 0xec4f6f, 0x6b63c6, 0xb29d4a, 0x5ed225, 0x872ca9,
+    0xd6c78c, 0x0f3900, 0xe3766f, 0x3a88e3, 0xbda44a, 0x645ac6, 0x8815a9, 0x51eb25,
+    0x2bc3e3, 0xf23d6f, 0x1e7200, 0xc78c8c, 0x40a025, 0x995ea9, 0x7511c6, 0xacef4a,
+    0xfd046f, 0x24fae3, 0xc8b58c, 0x114b00, 0x9667a9, 0x4f9925, 0xa3d64a, 0x7a28c6,
+    0x5787c6, 0x8e794a, 0x623625, 0xbbc8a9, 0x3ce400, 0xe51a8c, 0x0955e3, 0xd0ab6f,
+    0x81404a, 0x58bec6, 0xb4f1a9, 0x6d0f25, 0xea238c, 0x33dd00, 0xdf926f, 0x066ce3,
+    0x7c4425, 0xa5baa9, 0x49f5c6, 0x900b4a, 0x1727e3, 0xced96f, 0x229600, 0xfb688c,
+    0xaa83a9, 0x737d25, 0x9f324a, 0x46ccc6, 0xc1e06f, 0x181ee3, 0xf4518c, 0x2daf00,
+    0xaf0f8c, 0x76f100, 0x9abe6f, 0x4340e3, 0xc46c4a, 0x1d92c6, 0xf1dda9, 0x282325,
+    0x79c800, 0xa0368c, 0x4c79e3, 0x95876f, 0x12abc6, 0xcb554a, 0x271a25, 0xfee4a9,
+    0x84cc6f, 0x5d32e3, 0xb17d8c, 0x688300, 0xefafa9, 0x365125, 0xda1e4a, 0x03e0c6,
+    0x520be3, 0x8bf56f, 0x67ba00, 0xbe448c, 0x396825, 0xe096a9, 0x0cd9c6, 0xd5274a,
+    0xf8884a, 0x2176c6, 0xcd39a9, 0x14c725, 0x93eb8c, 0x4a1500, 0xa65a6f, 0x7fa4e3,
+    0x2e4fc6, 0xf7b14a, 0x1bfe25, 0xc200a9, 0x452c00, 0x9cd28c, 0x709de3, 0xa9636f,
+    0xd34ba9, 0x0ab525, 0xe6fa4a, 0x3f04c6, 0xb8286f, 0x61d6e3, 0x8d998c, 0x546700,
+    0x058c25, 0xdc72a9, 0x303dc6, 0xe9c34a, 0x6eefe3, 0xb7116f, 0x5b5e00, 0x82a08c,
+    0xd853e3, 0x01ad6f, 0xede200, 0x341c8c, 0xb33025, 0x6acea9, 0x8681c6, 0x5f7f4a,
+    0x0e946f, 0xd76ae3, 0x3b258c, 0xe2db00, 0x65f7a9, 0xbc0925, 0x50464a, 0x89b8c6,
+    0xf39000, 0x2a6e8c, 0xc621e3, 0x1fdf6f, 0x98f3c6, 0x410d4a, 0xad4225, 0x74bca9,
+    0x25578c, 0xfca900, 0x10e66f, 0xc918e3, 0x4e344a, 0x97cac6, 0x7b85a9, 0xa27b25,
+    0x8fd425, 0x562aa9, 0xba65c6, 0x639b4a, 0xe4b7e3, 0x3d496f, 0xd10600, 0x08f88c,
+    0x5913a9, 0x80ed25, 0x6ca24a, 0xb55cc6, 0x32706f, 0xeb8ee3, 0x07c18c, 0xde3f00,
+    0xa417c6, 0x7de94a, 0x91a625, 0x4858a9, 0xcf7400, 0x168a8c, 0xfac5e3, 0x233b6f,
+    0x72d04a, 0xab2ec6, 0x4761a9, 0x9e9f25, 0x19b38c, 0xc04d00, 0x2c026f, 0xf5fce3,
+    0x775c6f, 0xaea2e3, 0x42ed8c, 0x9b1300, 0x1c3fa9, 0xc5c125, 0x298e4a, 0xf070c6,
+    0xa19be3, 0x78656f, 0x942a00, 0x4dd48c, 0xcaf825, 0x1306a9, 0xff49c6, 0x26b74a,
+    0x5c9f8c, 0x856100, 0x692e6f, 0xb0d0e3, 0x37fc4a, 0xee02c6, 0x024da9, 0xdbb325,
+    0x8a5800, 0x53a68c, 0xbfe9e3, 0x66176f, 0xe13bc6, 0x38c54a, 0xd48a25, 0x0d74a9,
+    0x20dba9, 0xf92525, 0x156a4a, 0xcc94c6, 0x4bb86f, 0x9246e3, 0x7e098c, 0xa7f700,
+    0xf61c25, 0x2fe2a9, 0xc3adc6, 0x1a534a, 0x9d7fe3, 0x44816f, 0xa8ce00, 0x71308c,
+    0x0b184a, 0xd2e6c6, 0x3ea9a9, 0xe75725, 0x607b8c, 0xb98500, 0x55ca6f, 0x8c34e3,
+    0xdddfc6, 0x04214a, 0xe86e25, 0x3190a9, 0xb6bc00, 0x6f428c, 0x830de3, 0x5af36f
+  },
+  {
+    0x000000, 0x36eb3d, 0x6dd67a, 0x5b3d47, 0xdbacf4, 0xed47c9, 0xb67a8e, 0x8091b3,
+    0x311513, 0x07fe2e, 0x5cc369, 0x6a2854, 0xeab9e7, 0xdc52da, 0x876f9d, 0xb184a0,
+    0x622a26, 0x54c11b, 0x0ffc5c, 0x391761, 0xb986d2, 0x8f6def, 0xd450a8, 0xe2bb95,
+    0x533f35, 0x65d408, 0x3ee94f, 0x080272, 0x8893c1, 0xbe78fc, 0xe545bb, 0xd3ae86,
+    0xc4544c, 0xf2bf71, 0xa98236, 0x9f690b, 0x1ff8b8, 0x291385, 0x722ec2, 0x44c5ff,
+    0xf5415f, 0xc3aa62, 0x989725, 0xae7c18, 0x2eedab, 0x180696, 0x433bd1, 0x75d0ec,
+    0xa67e6a, 0x909557, 0xcba810, 0xfd432d, 0x7dd29e, 0x4b39a3, 0x1004e4, 0x26efd9,
+    0x976b79, 0xa18044, 0xfabd03, 0xcc563e, 0x4cc78d, 0x7a2cb0, 0x2111f7, 0x17faca,
+    0x0ee463, 0x380f5e, 0x633219, 0x55d924, 0xd54897, 0xe3a3aa, 0xb89eed, 0x8e75d0,
+    0x3ff170, 0x091a4d, 0x52270a, 0x64cc37, 0xe45d84, 0xd2b6b9, 0x898bfe, 0xbf60c3,
+    0x6cce45, 0x5a2578, 0x01183f, 0x37f302, 0xb762b1, 0x81898c, 0xdab4cb, 0xec5ff6,
+    0x5ddb56, 0x6b306b, 0x300d2c, 0x06e611, 0x8677a2, 0xb09c9f, 0xeba1d8, 0xdd4ae5,
+    0xcab02f, 0xfc5b12, 0xa76655, 0x918d68, 0x111cdb, 0x27f7e6, 0x7ccaa1, 0x4a219c,
+    0xfba53c, 0xcd4e01, 0x967346, 0xa0987b, 0x2009c8, 0x16e2f5, 0x4ddfb2, 0x7b348f,
+    0xa89a09, 0x9e7134, 0xc54c73, 0xf3a74e, 0x7336fd, 0x45ddc0, 0x1ee087, 0x280bba,
+    0x998f1a, 0xaf6427, 0xf45960, 0xc2b25d, 0x4223ee, 0x74c8d3, 0x2ff594, 0x191ea9,
+    0x1dc8c6, 0x2b23fb, 0x701ebc, 0x46f581, 0xc66432, 0xf08f0f, 0xabb248, 0x9d5975,
+    0x2cddd5, 0x1a36e8, 0x410baf, 0x77e092, 0xf77121, 0xc19a1c, 0x9aa75b, 0xac4c66,
+    0x7fe2e0, 0x4909dd, 0x12349a, 0x24dfa7, 0xa44e14, 0x92a529, 0xc9986e, 0xff7353,
+    0x4ef7f3, 0x781cce, 0x232189, 0x15cab4, 0x955b07, 0xa3b03a, 0xf88d7d, 0xce6640,
+    0xd99c8a, 0xef77b7, 0xb44af0, 0x82a1cd, 0x02307e, 0x34db43, 0x6fe604, 0x590d39,
+    0xe88999, 0xde62a4, 0x855fe3, 0xb3b4de, 0x33256d, 0x05ce50, 0x5ef317, 0x68182a,
+    0xbbb6ac, 0x8d5d91, 0xd660d6, 0xe08beb, 0x601a58, 0x56f165, 0x0dcc22, 0x3b271f,
+    0x8aa3bf, 0xbc4882, 0xe775c5, 0xd19ef8, 0x510f4b, 0x67e476, 0x3cd931, 0x0a320c,
+    0x132ca5, 0x25c798, 0x7efadf, 0x4811e2, 0xc88051, 0xfe6b6c, 0xa5562b, 0x93bd16,
+    0x2239b6, 0x14d28b, 0x4fefcc, 0x7904f1, 0xf99542, 0xcf7e7f, 0x944338, 0xa2a805,
+    0x710683, 0x47edbe, 0x1cd0f9, 0x2a3bc4, 0xaaaa77, 0x9c414a, 0xc77c0d, 0xf19730,
+    0x401390, 0x76f8ad, 0x2dc5ea, 0x1b2ed7, 0x9bbf64, 0xad5459, 0xf6691e, 0xc08223,
+    0xd778e9, 0xe193d4, 0xbaae93, 0x8c45ae, 0x0cd41d, 0x3a3f20, 0x610267, 0x57e95a,
+    0xe66dfa, 0xd086c7, 0x8bbb80, 0xbd50bd, 0x3dc10e, 0x0b2a33, 0x501774, 0x66fc49,
+    0xb552cf, 0x83b9f2, 0xd884b5, 0xee6f88, 0x6efe3b, 0x581506, 0x032841, 0x35c37c,
+    0x8447dc, 0xb2ace1, 0xe991a6, 0xdf7a9b, 0x5feb28, 0x690015, 0x323d52, 0x04d66f
+  },
+  {
+    0x000000, 0x3b918c, 0x772318, 0x4cb294, 0xee4630, 0xd5d7bc, 0x996528, 0xa2f4a4,
+    0x5ac09b, 0x615117, 0x2de383, 0x16720f, 0xb486ab, 0x8f1727, 0xc3a5b3, 0xf8343f,
+    0xb58136, 0x8e10ba, 0xc2a22e, 0xf933a2, 0x5bc706, 0x60568a, 0x2ce41e, 0x177592,
+    0xef41ad, 0xd4d021, 0x9862b5, 0xa3f339, 0x01079d, 0x3a9611, 0x762485, 0x4db509,
+    0xed4e97, 0xd6df1b, 0x9a6d8f, 0xa1fc03, 0x0308a7, 0x38992b, 0x742bbf, 0x4fba33,
+    0xb78e0c, 0x8c1f80, 0xc0ad14, 0xfb3c98, 0x59c83c, 0x6259b0, 0x2eeb24, 0x157aa8,
+    0x58cfa1, 0x635e2d, 0x2fecb9, 0x147d35, 0xb68991, 0x8d181d, 0xc1aa89, 0xfa3b05,
+    0x020f3a, 0x399eb6, 0x752c22, 0x4ebdae, 0xec490a, 0xd7d886, 0x9b6a12, 0xa0fb9e,
+    0x5cd1d5, 0x674059, 0x2bf2cd, 0x106341, 0xb297e5, 0x890669, 0xc5b4fd, 0xfe2571,
+    0x06114e, 0x3d80c2, 0x713256, 0x4aa3da, 0xe8577e, 0xd3c6f2, 0x9f7466, 0xa4e5ea,
+    0xe950e3, 0xd2c16f, 0x9e73fb, 0xa5e277, 0x0716d3, 0x3c875f, 0x7035cb, 0x4ba447,
+    0xb39078, 0x8801f4, 0xc4b360, 0xff22ec, 0x5dd648, 0x6647c4, 0x2af550, 0x1164dc,
+    0xb19f42, 0x8a0ece, 0xc6bc5a, 0xfd2dd6, 0x5fd972, 0x6448fe, 0x28fa6a, 0x136be6,
+    0xeb5fd9, 0xd0ce55, 0x9c7cc1, 0xa7ed4d, 0x0519e9, 0x3e8865, 0x723af1, 0x49ab7d,
+    0x041e74, 0x3f8ff8, 0x733d6c, 0x48ace0, 0xea5844, 0xd1c9c8, 0x9d7b5c, 0xa6ead0,
+    0x5edeef, 0x654f63, 0x29fdf7, 0x126c7b, 0xb098df, 0x8b0953, 0xc7bbc7, 0xfc2a4b,
+    0xb9a3aa, 0x823226, 0xce80b2, 0xf5113e, 0x57e59a, 0x6c7416, 0x20c682, 0x1b570e,
+    0xe36331, 0xd8f2bd, 0x944029, 0xafd1a5, 0x0d2501, 0x36b48d, 0x7a0619, 0x419795,
+    0x0c229c, 0x37b310, 0x7b0184, 0x409008, 0xe264ac, 0xd9f520, 0x9547b4, 0xaed638,
+    0x56e207, 0x6d738b, 0x21c11f, 0x1a5093, 0xb8a437, 0x8335bb, 0xcf872f, 0xf416a3,
+    0x54ed3d, 0x6f7cb1, 0x23ce25, 0x185fa9, 0xbaab0d, 0x813a81, 0xcd8815, 0xf61999,
+    0x0e2da6, 0x35bc2a, 0x790ebe, 0x429f32, 0xe06b96, 0xdbfa1a, 0x97488e, 0xacd902,
+    0xe16c0b, 0xdafd87, 0x964f13, 0xadde9f, 0x0f2a3b, 0x34bbb7, 0x780923, 0x4398af,
+    0xbbac90, 0x803d1c, 0xcc8f88, 0xf71e04, 0x55eaa0, 0x6e7b2c, 0x22c9b8, 0x195834,
+    0xe5727f, 0xdee3f3, 0x925167, 0xa9c0eb, 0x0b344f, 0x30a5c3, 0x7c1757, 0x4786db,
+    0xbfb2e4, 0x842368, 0xc891fc, 0xf30070, 0x51f4d4, 0x6a6558, 0x26d7cc, 0x1d4640,
+    0x50f349, 0x6b62c5, 0x27d051, 0x1c41dd, 0xbeb579, 0x8524f5, 0xc99661, 0xf207ed,
+    0x0a33d2, 0x31a25e, 0x7d10ca, 0x468146, 0xe475e2, 0xdfe46e, 0x9356fa, 0xa8c776,
+    0x083ce8, 0x33ad64, 0x7f1ff0, 0x448e7c, 0xe67ad8, 0xddeb54, 0x9159c0, 0xaac84c,
+    0x52fc73, 0x696dff, 0x25df6b, 0x1e4ee7, 0xbcba43, 0x872bcf, 0xcb995b, 0xf008d7,
+    0xbdbdde, 0x862c52, 0xca9ec6, 0xf10f4a, 0x53fbee, 0x686a62, 0x24d8f6, 0x1f497a,
+    0xe77d45, 0xdcecc9, 0x905e5d, 0xabcfd1, 0x093b75, 0x32aaf9, 0x7e186d, 0x4589e1
+  },
+  {
+    0x000000, 0xf50baf, 0x6c5ba5, 0x99500a, 0xd8b74a, 0x2dbce5, 0xb4ecef, 0x41e740,
+    0x37226f, 0xc229c0, 0x5b79ca, 0xae7265, 0xef9525, 0x1a9e8a, 0x83ce80, 0x76c52f,
+    0x6e44de, 0x9b4f71, 0x021f7b, 0xf714d4, 0xb6f394, 0x43f83b, 0xdaa831, 0x2fa39e,
+    0x5966b1, 0xac6d1e, 0x353d14, 0xc036bb, 0x81d1fb, 0x74da54, 0xed8a5e, 0x1881f1,
+    0xdc89bc, 0x298213, 0xb0d219, 0x45d9b6, 0x043ef6, 0xf13559, 0x686553, 0x9d6efc,
+    0xebabd3, 0x1ea07c, 0x87f076, 0x72fbd9, 0x331c99, 0xc61736, 0x5f473c, 0xaa4c93,
+    0xb2cd62, 0x47c6cd, 0xde96c7, 0x2b9d68, 0x6a7a28, 0x9f7187, 0x06218d, 0xf32a22,
+    0x85ef0d, 0x70e4a2, 0xe9b4a8, 0x1cbf07, 0x5d5847, 0xa853e8, 0x3103e2, 0xc4084d,
+    0x3f5f83, 0xca542c, 0x530426, 0xa60f89, 0xe7e8c9, 0x12e366, 0x8bb36c, 0x7eb8c3,
+    0x087dec, 0xfd7643, 0x642649, 0x912de6, 0xd0caa6, 0x25c109, 0xbc9103, 0x499aac,
+    0x511b5d, 0xa410f2, 0x3d40f8, 0xc84b57, 0x89ac17, 0x7ca7b8, 0xe5f7b2, 0x10fc1d,
+    0x663932, 0x93329d, 0x0a6297, 0xff6938, 0xbe8e78, 0x4b85d7, 0xd2d5dd, 0x27de72,
+    0xe3d63f, 0x16dd90, 0x8f8d9a, 0x7a8635, 0x3b6175, 0xce6ada, 0x573ad0, 0xa2317f,
+    0xd4f450, 0x21ffff, 0xb8aff5, 0x4da45a, 0x0c431a, 0xf948b5, 0x6018bf, 0x951310,
+    0x8d92e1, 0x78994e, 0xe1c944, 0x14c2eb, 0x5525ab, 0xa02e04, 0x397e0e, 0xcc75a1,
+    0xbab08e, 0x4fbb21, 0xd6eb2b, 0x23e084, 0x6207c4, 0x970c6b, 0x0e5c61, 0xfb57ce,
+    0x7ebf06, 0x8bb4a9, 0x12e4a3, 0xe7ef0c, 0xa6084c, 0x5303e3, 0xca53e9, 0x3f5846,
+    0x499d69, 0xbc96c6, 0x25c6cc, 0xd0cd63, 0x912a23, 0x64218c, 0xfd7186, 0x087a29,
+    0x10fbd8, 0xe5f077, 0x7ca07d, 0x89abd2, 0xc84c92, 0x3d473d, 0xa41737, 0x511c98,
+    0x27d9b7, 0xd2d218, 0x4b8212, 0xbe89bd, 0xff6efd, 0x0a6552, 0x933558, 0x663ef7,
+    0xa236ba, 0x573d15, 0xce6d1f, 0x3b66b0, 0x7a81f0, 0x8f8a5f, 0x16da55, 0xe3d1fa,
+    0x9514d5, 0x601f7a, 0xf94f70, 0x0c44df, 0x4da39f, 0xb8a830, 0x21f83a, 0xd4f395,
+    0xcc7264, 0x3979cb, 0xa029c1, 0x55226e, 0x14c52e, 0xe1ce81, 0x789e8b, 0x8d9524,
+    0xfb500b, 0x0e5ba4, 0x970bae, 0x620001, 0x23e741, 0xd6ecee, 0x4fbce4, 0xbab74b,
+    0x41e085, 0xb4eb2a, 0x2dbb20, 0xd8b08f, 0x9957cf, 0x6c5c60, 0xf50c6a, 0x0007c5,
+    0x76c2ea, 0x83c945, 0x1a994f, 0xef92e0, 0xae75a0, 0x5b7e0f, 0xc22e05, 0x3725aa,
+    0x2fa45b, 0xdaaff4, 0x43fffe, 0xb6f451, 0xf71311, 0x0218be, 0x9b48b4, 0x6e431b,
+    0x188634, 0xed8d9b, 0x74dd91, 0x81d63e, 0xc0317e, 0x353ad1, 0xac6adb, 0x596174,
+    0x9d6939, 0x686296, 0xf1329c, 0x043933, 0x45de73, 0xb0d5dc, 0x2985d6, 0xdc8e79,
+    0xaa4b56, 0x5f40f9, 0xc610f3, 0x331b5c, 0x72fc1c, 0x87f7b3, 0x1ea7b9, 0xebac16,
+    0xf32de7, 0x062648, 0x9f7642, 0x6a7ded, 0x2b9aad, 0xde9102, 0x47c108, 0xb2caa7,
+    0xc40f88, 0x310427, 0xa8542d, 0x5d5f82, 0x1cb8c2, 0xe9b36d, 0x70e367, 0x85e8c8
+  }};
+
+static uint32_t
+crc24_update_table(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    while (len && ((uintptr_t) buf & 3)) {
+        crc = (crc << 8) ^ CRC24_TABLE[0][((crc >> 16) ^ *buf++) & 0xff];
+        len--;
+    }
+
+    while (len >= 8) {
+        uint32_t one = (crc << 8) ^ ((uint32_t) buf[0] << 24 | (uint32_t) buf[1] << 16 |
+                                     (uint32_t) buf[2] << 8 | buf[3]);
+        crc = CRC24_TABLE[7][one >> 24] ^ CRC24_TABLE[6][(one >> 16) & 0xff] ^
+              CRC24_TABLE[5][(one >> 8) & 0xff] ^ CRC24_TABLE[4][one & 0xff] ^
+              CRC24_TABLE[3][buf[4]] ^ CRC24_TABLE[2][buf[5]] ^ CRC24_TABLE[1][buf[6]] ^
+              CRC24_TABLE[0][buf[7]];
+        buf += 8;
+        len -= 8;
+    }
+
+    while (len--) {
+        crc = (crc << 8) ^ CRC24_TABLE[0][((crc >> 16) ^ *buf++) & 0xff];
+    }
+    return crc & 0xffffff;
+}
+
+#ifdef CRC24_CLMUL
+/*
+   Folding works with the 32-bit state crc << 8 and polynomial P << 8, so the usual
+   non-reflected CRC32 approach applies. Constants are x^n mod (P << 8):
+*/
+#define CRC24_X576 0x1f428700 /* fold by 4 blocks, high half */
+#define CRC24_X512 0x467d2400 /* fold by 4 blocks, low half */
+#define CRC24_X192 0x2c8c9d00 /* fold by 1 block, high half */
+#define CRC24_X128 0x64e4d700 /* fold by 1 block, low half */
+#define CRC24_X96 0xfd7e0c00  /* final reduction of the high half */
+
+__attribute__((target("pclmul,ssse3"))) static inline __m128i
+crc24_load_clmul(const uint8_t *buf)
+{
+    const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) buf), bswap);
+}
+
+/* x * x^128 + next, reduced to 128 bits with the constants k = (x^(n + 64), x^n) */
+__attribute__((target("pclmul,ssse3"))) static inline __m128i
+crc24_fold_clmul(__m128i x, __m128i k, __m128i next)
+{
+    __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+    __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+    return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+}
+
+/* len must be at least 16 */
+__attribute__((target("pclmul,ssse3"))) static uint32_t
+crc24_update_clmul(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    const __m128i k1 = _mm_set_epi64x(CRC24_X576, CRC24_X512);
+    const __m128i k4 = _mm_set_epi64x(CRC24_X192, CRC24_X128);
+    __m128i       x0 = crc24_load_clmul(buf);
+    uint64_t      hi;
+    uint32_t      lo;
+
+    x0 = _mm_xor_si128(x0, _mm_set_epi32(crc << 8, 0, 0, 0));
+    buf += 16;
+    len -= 16;
+
+    if (len >= 112) {
+        /* 4 independent streams to hide the multiplication latency */
+        __m128i x1 = crc24_load_clmul(buf);
+        __m128i x2 = crc24_load_clmul(buf + 16);
+        __m128i x3 = crc24_load_clmul(buf + 32);
+        buf += 48;
+        len -= 48;
+        while (len >= 64) {
+            x0 = crc24_fold_clmul(x0, k1, crc24_load_clmul(buf));
+            x1 = crc24_fold_clmul(x1, k1, crc24_load_clmul(buf + 16));
+            x2 = crc24_fold_clmul(x2, k1, crc24_load_clmul(buf + 32));
+            x3 = crc24_fold_clmul(x3, k1, crc24_load_clmul(buf + 48));
+            buf += 64;
+            len -= 64;
+        }
+        x0 = crc24_fold_clmul(x0, k4, x1);
+        x0 = crc24_fold_clmul(x0, k4, x2);
+        x0 = crc24_fold_clmul(x0, k4, x3);
+    }
+
+    while (len >= 16) {
+        x0 = crc24_fold_clmul(x0, k4, crc24_load_clmul(buf));
+        buf += 16;
+        len -= 16;
+    }
+
+    /* x * x^32 = hi * x^96 + lo * x^32, which fits into 96 bits */
+    x0 = _mm_xor_si128(_mm_clmulepi64_si128(x0, _mm_set_epi64x(0, CRC24_X96), 0x01),
+                       _mm_slli_si128(_mm_move_epi64(x0), 4));
+    /* remaining 64 + 32 bits are reduced via the table */
+    hi = (uint64_t) _mm_cvtsi128_si64(_mm_srli_si128(x0, 4));
+    lo = (uint32_t) _mm_cvtsi128_si32(x0);
+    crc = CRC24_TABLE[7][hi >> 56] ^ CRC24_TABLE[6][(hi >> 48) & 0xff] ^
+          CRC24_TABLE[5][(hi >> 40) & 0xff] ^ CRC24_TABLE[4][(hi >> 32) & 0xff] ^
+          CRC24_TABLE[3][(hi >> 24) & 0xff] ^ CRC24_TABLE[2][(hi >> 16) & 0xff] ^
+          CRC24_TABLE[1][(hi >> 8) & 0xff] ^ CRC24_TABLE[0][hi & 0xff] ^ (lo >> 8);
+
+    return crc24_update_table(crc, buf, len);
+}
+
+static bool
+crc24_has_clmul(void)
+{
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+#endif
+
+uint32_t
+pgp_crc24_update(uint32_t crc, const uint8_t *buf, size_t len)
+{
+#ifdef CRC24_CLMUL
+    /* for the short buffers setup of the folding costs more than it saves */
+    if ((len >= 32) && crc24_has_clmul()) {
+        return crc24_update_clmul(crc, buf, len);
+    }
+#endif
+    return crc24_update_table(crc, buf, len);
+}
+
+void
+pgp_crc24_final(uint32_t crc, uint8_t *out)
+{
+    out[0] = (crc >> 16) & 0xff;
+    out[1] = (crc >> 8) & 0xff;
+    out[2] = crc & 0xff;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/** OpenPGP CRC24 checksum, used by the ASCII armor
+ *  @file
+ */
+#ifndef RNP_CRC24_H
+#define RNP_CRC24_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ *  @private
+ *  Checksum is calculated by the slice-by-8 table code, or by folding with the carry-less
+ *  multiplication on x86-64 CPUs which support PCLMULQDQ. Choice is made at runtime.
+ *
+ *  @code
+ *  uint32_t crc = PGP_CRC24_INIT;
+ *  crc = pgp_crc24_update(crc, data1, len1);
+ *  crc = pgp_crc24_update(crc, data2, len2);
+ *  pgp_crc24_final(crc, crcbuf);
+ *  @endcode
+ */
+
+#define PGP_CRC24_INIT 0xB704CEU
+
+/** @private
+ *  add data to the checksum
+ *
+ *  @param crc current checksum value, PGP_CRC24_INIT for the first call
+ *  @param buf data
+ *  @param len length of the data
+ *  @return updated checksum value
+ **/
+uint32_t pgp_crc24_update(uint32_t crc, const uint8_t *buf, size_t len);
+
+/** @private
+ *  store checksum in the big-endian 3-byte form, as it is written in the armor
+ *
+ *  @param crc checksum value
+ *  @param out buffer with at least 3 bytes of space
+ **/
+void pgp_crc24_final(uint32_t crc, uint8_t *out);
+
+#endif
@@ -1197,11 +1197,13 @@ pgp_pubkey_free(pgp_pubkey_t *p)
     case PGP_PKA_RSA:
     case PGP_PKA_RSA_ENCRYPT_ONLY:
     case PGP_PKA_RSA_SIGN_ONLY:
+        pgp_pk_cache_destroy(&p->key.rsa.cache);
         free_BN(&p->key.rsa.n);
         free_BN(&p->key.rsa.e);
         break;
 
     case PGP_PKA_DSA:
+        pgp_pk_cache_destroy(&p->key.dsa.cache);
         free_BN(&p->key.dsa.p);
         free_BN(&p->key.dsa.q);
         free_BN(&p->key.dsa.g);
@@ -1212,11 +1214,13 @@ pgp_pubkey_free(pgp_pubkey_t *p)
     case PGP_PKA_ECDSA:
     case PGP_PKA_EDDSA:
     case PGP_PKA_SM2:
+        pgp_pk_cache_destroy(&p->key.ecc.cache);
         free_BN(&p->key.ecc.point);
         break;
 
     case PGP_PKA_ELGAMAL:
     case PGP_PKA_ELGAMAL_ENCRYPT_OR_SIGN:
+        pgp_pk_cache_destroy(&p->key.elgamal.cache);
         free_BN(&p->key.elgamal.p);
         free_BN(&p->key.elgamal.g);
         free_BN(&p->key.elgamal.y);
@@ -2420,6 +2424,7 @@ pgp_seckey_free_secret_mpis(pgp_seckey_t *seckey)
     case PGP_PKA_RSA:
     case PGP_PKA_RSA_ENCRYPT_ONLY:
     case PGP_PKA_RSA_SIGN_ONLY:
+        pgp_pk_cache_destroy(&seckey->key.rsa.cache);
         free_BN(&seckey->key.rsa.d);
         free_BN(&seckey->key.rsa.p);
         free_BN(&seckey->key.rsa.q);
@@ -2427,6 +2432,7 @@ pgp_seckey_free_secret_mpis(pgp_seckey_t *seckey)
         break;
 
     case PGP_PKA_DSA:
+        pgp_pk_cache_destroy(&seckey->key.dsa.cache);
         free_BN(&seckey->key.dsa.x);
         break;
 
@@ -2434,11 +2440,13 @@ pgp_seckey_free_secret_mpis(pgp_seckey_t *seckey)
     case PGP_PKA_ECDH:
     case PGP_PKA_ECDSA:
     case PGP_PKA_SM2:
+        pgp_pk_cache_destroy(&seckey->key.ecc.cache);
         free_BN(&seckey->key.ecc.x);
         break;
 
     case PGP_PKA_ELGAMAL:
     case PGP_PKA_ELGAMAL_ENCRYPT_OR_SIGN:
+        pgp_pk_cache_destroy(&seckey->key.elgamal.cache);
         free_BN(&seckey->key.elgamal.x);
         break;
 
@@ -384,7 +384,7 @@ repgp_validate_pubkeys_signatures(void *ctx)
     result.rnp_ctx = rctx;
     for (size_t n = 0; n < ring->keyc; ++n) {
         ret &= pgp_validate_key_sigs(
-          &result, &ring->keys[n], ring, NULL /* no pwd callback; validating public keys */);
+          &result, ring->keys[n], ring, NULL /* no pwd callback; validating public keys */);
     }
 
     ret &= validate_result_status("keyring", &result);
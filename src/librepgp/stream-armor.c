@@ -40,7 +40,8 @@
 #include "types.h"
 #include "symmetric.h"
 #include "utils.h"
-#include "hash.h"
+#include "base64.h"
+#include "crc24.h"
 
 #define ARMORED_BLOCK_SIZE (4096)
 
@@ -59,7 +60,7 @@ typedef struct pgp_source_armored_param_t {
     unsigned brestlen;   /* number of bytes in brest */
     bool     eofb64;     /* end of base64 stream reached */
     uint8_t  readcrc[3]; /* crc-24 from the armored data */
-    pgp_hash_t crc_ctx;  /* CTX used to calculate CRC */
+    uint32_t crc;        /* crc-24 of the decoded data */
 } pgp_source_armored_param_t;
 
 typedef struct pgp_dest_armored_param_t {
@@ -70,36 +71,9 @@ typedef struct pgp_dest_armored_param_t {
     unsigned          llen;    /* length of the base64 line, defaults to 76 as per RFC */
     uint8_t           tail[2]; /* bytes which didn't fit into 3-byte boundary */
     unsigned          tailc;   /* number of bytes in tail */
-    pgp_hash_t        crc_ctx; /* CTX used to calculate CRC */
+    uint32_t          crc;     /* crc-24 of the written data */
 } pgp_dest_armored_param_t;
 
-/*
-   Table for base64 lookups:
-   0xff - wrong character,
-   0xfe - '='
-   0xfd - eol/whitespace,
-   0..0x3f - represented 6-bit number
-*/
-static const uint8_t B64DEC[256] = {
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfd, 0xfd, 0xff, 0xff, 0xfd, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff, 0xff, 0xfd, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3e, 0xff,
-  0xff, 0xff, 0x3f, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0xff, 0xff,
-  0xff, 0xfe, 0xff, 0xff, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
-  0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
-  0x19, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21,
-  0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
-  0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-  0xff};
-
 static int
 armor_read_padding(pgp_source_t *src)
 {
@@ -140,7 +114,7 @@ armor_read_crc(pgp_source_t *src)
 
     if ((clen == 5) && (crc[0] == CH_EQ)) {
         for (int i = 0; i < 4; i++) {
-            if ((dec[i] = B64DEC[(int) crc[i + 1]]) >= 64) {
+            if ((dec[i] = PGP_B64DEC[(int) crc[i + 1]]) >= 64) {
                 return false;
             }
         }
@@ -186,12 +160,12 @@ armored_src_read(pgp_source_t *src, void *buf, size_t len)
     uint8_t  b64buf[ARMORED_BLOCK_SIZE];     /* input base64 data with spaces and so on */
     uint8_t  decbuf[ARMORED_BLOCK_SIZE + 4]; /* decoded 6-bit values */
     uint8_t *bufptr = buf;                   /* for better readability below */
-    uint8_t *bptr, *bend;                    /* pointer to input data in b64buf */
+    uint8_t *bptr;                           /* pointer to input data in b64buf */
     uint8_t *dptr, *dend, *pend; /* pointers to decoded data in decbuf: working pointer, last
                                     available byte, last byte to process */
-    uint8_t  bval;
     uint32_t b24;
     ssize_t  read;
+    size_t   used;
     ssize_t  left = len;
     int      eqcount = 0; /* number of '=' at the end of base64 stream */
 
@@ -204,11 +178,16 @@ armored_src_read(pgp_source_t *src, void *buf, size_t len)
         if (param->restlen - param->restpos >= len) {
             memcpy(bufptr, &param->rest[param->restpos], len);
             param->restpos += len;
-            pgp_hash_add(&param->crc_ctx, bufptr, len);
+            if (!param->eofb64) {
+                param->crc = pgp_crc24_update(param->crc, bufptr, len);
+            }
             return len;
         } else {
             left = len - (param->restlen - param->restpos);
             memcpy(bufptr, &param->rest[param->restpos], len - left);
+            if (!param->eofb64) {
+                param->crc = pgp_crc24_update(param->crc, bufptr, len - left);
+            }
             param->restpos = param->restlen = 0;
             bufptr += len - left;
         }
@@ -227,24 +206,19 @@ armored_src_read(pgp_source_t *src, void *buf, size_t len)
             return read;
         }
 
-        dptr = dend;
-        bptr = b64buf;
-        bend = b64buf + read;
         /* checking input data, stripping away whitespaces, checking for end of the b64 data */
-        while (bptr < bend) {
-            if ((bval = B64DEC[*(bptr++)]) < 64) {
-                *(dptr++) = bval;
-            } else if (bval == 0xfe) {
-                /* '=' means the base64 padding or the beginning of checksum */
-                param->eofb64 = true;
-                break;
-            } else if (bval == 0xff) {
-                RNP_LOG("wrong base64 character %c", (char) *(bptr - 1));
+        dend += pgp_base64_decode_chars(dend, b64buf, read, &used);
+        bptr = b64buf + used;
+        if (used < (size_t) read) {
+            if (*bptr != CH_EQ) {
+                RNP_LOG("wrong base64 character %c", (char) *bptr);
                 return -1;
             }
+            /* '=' means the base64 padding or the beginning of checksum */
+            param->eofb64 = true;
+            bptr++;
         }
 
-        dend = dptr;
         dptr = decbuf;
         /* Processing full 4s which will go directly to the buf.
            After this left < 3 or decbuf has < 4 bytes */
@@ -257,15 +231,9 @@ armored_src_read(pgp_source_t *src, void *buf, size_t len)
         }
 
         /* this one would the most performance-consuming part for large chunks */
-        while (dptr < pend) {
-            b24 = *dptr++ << 18;
-            b24 |= *dptr++ << 12;
-            b24 |= *dptr++ << 6;
-            b24 |= *dptr++;
-            *bufptr++ = b24 >> 16;
-            *bufptr++ = b24 >> 8;
-            *bufptr++ = b24 & 0xff;
-        }
+        pgp_base64_pack(bufptr, dptr, pend - dptr, &param->crc);
+        bufptr += (pend - dptr) / 4 * 3;
+        dptr = pend;
 
         /* moving rest to the beginning of decbuf */
         memmove(decbuf, dptr, dend - dptr);
@@ -304,17 +272,10 @@ armored_src_read(pgp_source_t *src, void *buf, size_t len)
     dptr = decbuf;
     pend = decbuf + (dend - decbuf) / 4 * 4;
     bptr = param->rest;
-    while (dptr < pend) {
-        b24 = *dptr++ << 18;
-        b24 |= *dptr++ << 12;
-        b24 |= *dptr++ << 6;
-        b24 |= *dptr++;
-        *bptr++ = b24 >> 16;
-        *bptr++ = b24 >> 8;
-        *bptr++ = b24 & 0xff;
-    }
-
-    pgp_hash_add(&param->crc_ctx, buf, bufptr - (uint8_t *) buf);
+    /* crc of the rest is calculated when it is copied to the caller or on eof */
+    pgp_base64_pack(bptr, dptr, pend - dptr, NULL);
+    bptr += (pend - dptr) / 4 * 3;
+    dptr = pend;
 
     if (param->eofb64) {
         if ((dend - dptr + eqcount) % 4 != 0) {
@@ -330,13 +291,10 @@ armored_src_read(pgp_source_t *src, void *buf, size_t len)
             *bptr++ = (*dptr << 2) | (*(dptr + 1) >> 4);
         }
 
-        uint8_t crc_fin[5];
+        uint8_t crc_fin[3];
         /* Calculate CRC after reading whole input stream */
-        pgp_hash_add(&param->crc_ctx, param->rest, bptr - param->rest);
-        if (!pgp_hash_finish(&param->crc_ctx, crc_fin)) {
-            RNP_LOG("Can't finalize RNP ctx");
-            return -1;
-        }
+        param->crc = pgp_crc24_update(param->crc, param->rest, bptr - param->rest);
+        pgp_crc24_final(param->crc, crc_fin);
 
         if (memcmp(param->readcrc, crc_fin, 3)) {
             RNP_LOG("CRC mismatch");
@@ -357,7 +315,7 @@ armored_src_read(pgp_source_t *src, void *buf, size_t len)
         read = left > param->restlen ? param->restlen : left;
         memcpy(bufptr, param->rest, read);
         if (!param->eofb64) {
-            pgp_hash_add(&param->crc_ctx, bufptr, read);
+            param->crc = pgp_crc24_update(param->crc, bufptr, read);
         }
         left -= read;
         param->restpos += read;
@@ -372,7 +330,6 @@ armored_src_close(pgp_source_t *src)
     pgp_source_armored_param_t *param = src->param;
 
     if (param) {
-        (void) pgp_hash_finish(&param->crc_ctx, NULL);
         free(param->armorhdr);
         free(param->version);
         free(param->comment);
@@ -582,10 +539,7 @@ init_armored_src(pgp_source_t *src, pgp_source_t *readsrc)
     param = src->param;
     param->readsrc = readsrc;
 
-    if (!pgp_hash_create(&param->crc_ctx, PGP_HASH_CRC24)) {
-        RNP_LOG("Internal error");
-        return RNP_ERROR_GENERIC;
-    }
+    param->crc = PGP_CRC24_INIT;
 
     src->read = armored_src_read;
     src->close = armored_src_close;
@@ -664,31 +618,13 @@ armor_write_eol(pgp_dest_armored_param_t *param)
     }
 }
 
-/* Base 64 encoded table, quadruplicated to save cycles on use & 0x3f operation  */
-static const uint8_t B64ENC[256] = {
-  'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R',
-  'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j',
-  'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1',
-  '2', '3', '4', '5', '6', '7', '8', '9', '+', '/', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
-  'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
-  'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r',
-  's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
-  '+', '/', 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
-  'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h',
-  'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
-  '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/', 'A', 'B', 'C', 'D', 'E', 'F',
-  'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
-  'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p',
-  'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7',
-  '8', '9', '+', '/'};
-
 static void
 armored_encode3(uint8_t *out, uint8_t *in)
 {
-    out[0] = B64ENC[in[0] >> 2];
-    out[1] = B64ENC[((in[0] << 4) | (in[1] >> 4)) & 0xff];
-    out[2] = B64ENC[((in[1] << 2) | (in[2] >> 6)) & 0xff];
-    out[3] = B64ENC[in[2] & 0xff];
+    out[0] = PGP_B64ENC[in[0] >> 2];
+    out[1] = PGP_B64ENC[((in[0] << 4) | (in[1] >> 4)) & 0xff];
+    out[2] = PGP_B64ENC[((in[1] << 2) | (in[2] >> 6)) & 0xff];
+    out[3] = PGP_B64ENC[in[2] & 0xff];
 }
 
 static rnp_result_t
@@ -700,8 +636,8 @@ armored_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
     uint8_t                   dec3[3];
     uint8_t *                 bufptr = (uint8_t *) buf;
     uint8_t *                 bufend = bufptr + len;
+    uint8_t *                 crcptr;
     uint8_t *                 inlend;
-    uint32_t                  t;
     unsigned                  inllen;
     pgp_dest_armored_param_t *param = dst->param;
 
@@ -710,10 +646,7 @@ armored_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
         return RNP_ERROR_BAD_PARAMETERS;
     }
 
-    /* update crc */
-    pgp_hash_add(&param->crc_ctx, buf, len);
-
-    /* processing tail if any */
+    /* processing tail if any, crc is updated when bytes are encoded */
     if (len + param->tailc < 3) {
         memcpy(&param->tail[param->tailc], buf, len);
         param->tailc += len;
@@ -723,6 +656,7 @@ armored_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
         memcpy(&dec3[param->tailc], bufptr, 3 - param->tailc);
         bufptr += 3 - param->tailc;
         param->tailc = 0;
+        param->crc = pgp_crc24_update(param->crc, dec3, 3);
         armored_encode3(encptr, dec3);
         encptr += 4;
         param->lout += 4;
@@ -740,10 +674,15 @@ armored_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
     /* pointer to the last full line space in encbuf */
     enclast = encbuf + sizeof(encbuf) - param->llen - 2;
 
-    /* processing line chunks, this is the main performance-hitting cycle */
+    /* processing line chunks, this is the main performance-hitting cycle. Crc of the
+     * input is calculated once per encbuf, while the input is still in the cache, since
+     * single lines are too short for the fast crc code. */
+    crcptr = bufptr;
     while (bufptr + 3 <= bufend) {
         /* checking whether we have enough space in encbuf */
         if (encptr > enclast) {
+            param->crc = pgp_crc24_update(param->crc, crcptr, bufptr - crcptr);
+            crcptr = bufptr;
             dst_write(param->writedst, encbuf, encptr - encbuf);
             encptr = encbuf;
         }
@@ -760,14 +699,9 @@ armored_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
         }
 
         /* processing one line */
-        while (bufptr < inlend) {
-            t = (bufptr[0] << 16) | (bufptr[1] << 8) | (bufptr[2]);
-            bufptr += 3;
-            *encptr++ = B64ENC[(t >> 18) & 0xff];
-            *encptr++ = B64ENC[(t >> 12) & 0xff];
-            *encptr++ = B64ENC[(t >> 6) & 0xff];
-            *encptr++ = B64ENC[t & 0xff];
-        }
+        pgp_base64_encode(encptr, bufptr, inlend - bufptr);
+        encptr += (inlend - bufptr) / 3 * 4;
+        bufptr = inlend;
 
         /* adding line ending */
         if (param->lout == 0) {
@@ -778,6 +712,7 @@ armored_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
         }
     }
 
+    param->crc = pgp_crc24_update(param->crc, crcptr, bufptr - crcptr);
     dst_write(param->writedst, encbuf, encptr - encbuf);
 
     /* saving tail */
@@ -796,15 +731,15 @@ armored_dst_finish(pgp_dest_t *dst)
 
     /* writing tail */
     if (param->tailc == 1) {
-        buf[0] = B64ENC[param->tail[0] >> 2];
-        buf[1] = B64ENC[(param->tail[0] << 4) & 0xff];
+        buf[0] = PGP_B64ENC[param->tail[0] >> 2];
+        buf[1] = PGP_B64ENC[(param->tail[0] << 4) & 0xff];
         buf[2] = CH_EQ;
         buf[3] = CH_EQ;
         dst_write(param->writedst, buf, 4);
     } else if (param->tailc == 2) {
-        buf[0] = B64ENC[(param->tail[0] >> 2)];
-        buf[1] = B64ENC[((param->tail[0] << 4) | (param->tail[1] >> 4)) & 0xff];
-        buf[2] = B64ENC[(param->tail[1] << 2) & 0xff];
+        buf[0] = PGP_B64ENC[(param->tail[0] >> 2)];
+        buf[1] = PGP_B64ENC[((param->tail[0] << 4) | (param->tail[1] >> 4)) & 0xff];
+        buf[2] = PGP_B64ENC[(param->tail[1] << 2) & 0xff];
         buf[3] = CH_EQ;
         dst_write(param->writedst, buf, 4);
     }
@@ -817,8 +752,8 @@ armored_dst_finish(pgp_dest_t *dst)
     /* writing CRC and EOL */
     buf[0] = CH_EQ;
 
-    // At this point crc_ctx is initialized, so call can't fail
-    (void) pgp_hash_finish(&param->crc_ctx, crcbuf);
+    param->crc = pgp_crc24_update(param->crc, param->tail, param->tailc);
+    pgp_crc24_final(param->crc, crcbuf);
     armored_encode3(&buf[1], crcbuf);
     dst_write(param->writedst, buf, 5);
     armor_write_eol(param);
@@ -840,8 +775,6 @@ armored_dst_close(pgp_dest_t *dst, bool discard)
         return;
     }
 
-    /* dst_close may be called without dst_finish on error */
-    (void) pgp_hash_finish(&param->crc_ctx, NULL);
     free(param);
     dst->param = NULL;
 }
@@ -867,11 +800,7 @@ init_armored_dst(pgp_dest_t *dst, pgp_dest_t *writedst, pgp_armored_msg_t msgtyp
     dst->param = param;
     dst->werr = RNP_SUCCESS;
 
-    if (!pgp_hash_create(&param->crc_ctx, PGP_HASH_CRC24)) {
-        RNP_LOG("Internal error");
-        return RNP_ERROR_GENERIC;
-    }
-
+    param->crc = PGP_CRC24_INIT;
     param->writedst = writedst;
     param->type = msgtype;
     param->usecrlf = true;
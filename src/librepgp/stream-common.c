@@ -37,24 +37,65 @@
 #ifdef HAVE_LIMITS_H
 #include <limits.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#include <errno.h>
 #include <rnp/rnp_def.h>
 #include "defs.h"
 #include "types.h"
 #include "symmetric.h"
 #include "utils.h"
 
+/* read from the source which gives direct access to its data, bypassing the cache */
+static ssize_t
+src_read_mapped(pgp_source_t *src, void *buf, size_t len)
+{
+    const uint8_t *data;
+    size_t         avail;
+    size_t         read = 0;
+
+    while (read < len) {
+        avail = len - read;
+        if (!(data = src->map(src, &avail))) {
+            return -1;
+        }
+        if (!avail) {
+            src->eof = 1;
+            break;
+        }
+        avail = avail > len - read ? len - read : avail;
+        memcpy((uint8_t *) buf + read, data, avail);
+        read += avail;
+        src->readb += avail;
+    }
+
+    if (src->readb == src->size) {
+        src->eof = 1;
+    }
+    return read;
+}
+
 ssize_t
 src_read(pgp_source_t *src, void *buf, size_t len)
 {
     size_t              left = len;
     ssize_t             read;
     pgp_source_cache_t *cache = src->cache;
-    bool                readahead = cache->readahead;
+    bool                readahead;
 
     if (src->eof || (len == 0)) {
         return 0;
     }
 
+    if (src->map) {
+        return src_read_mapped(src, buf, len);
+    }
+    readahead = cache->readahead;
+
     // Do not read more then available if source size is known
     if (src->knownsize && (src->readb + len > src->size)) {
         len = src->size - src->readb;
@@ -129,11 +170,29 @@ src_peek(pgp_source_t *src, void *buf, size_t len)
 {
     ssize_t             read;
     pgp_source_cache_t *cache = src->cache;
-    bool                readahead = cache->readahead;
+    bool                readahead;
+    const uint8_t *     data;
+    size_t              avail;
+
+    if (src->map && (len <= PGP_INPUT_CACHE_SIZE)) {
+        if (src->eof) {
+            return 0;
+        }
+        avail = len;
+        if (!(data = src->map(src, &avail))) {
+            return -1;
+        }
+        len = avail < len ? avail : len;
+        if (buf) {
+            memcpy(buf, data, len);
+        }
+        return len;
+    }
 
     if (!cache || (len > sizeof(cache->buf))) {
         return -1;
     }
+    readahead = cache->readahead;
 
     if (src->eof) {
         return 0;
@@ -189,6 +248,18 @@ src_skip(pgp_source_t *src, size_t len)
     void *  buf;
     uint8_t sbuf[16];
 
+    /* nothing to read, just move the position */
+    if (src->map) {
+        if (len > src->size - src->readb) {
+            len = src->size - src->readb;
+        }
+        src->readb += len;
+        if (src->readb == src->size) {
+            src->eof = 1;
+        }
+        return len;
+    }
+
     if (src->cache && (src->cache->len - src->cache->pos >= len)) {
         src->readb += len;
         src->cache->pos += len;
@@ -241,7 +312,7 @@ src_close(pgp_source_t *src)
     }
 
     if (src->cache) {
-        free(src->cache);
+        src_free(src, src->cache);
         src->cache = NULL;
     }
 }
@@ -297,19 +368,31 @@ src_peek_line(pgp_source_t *src, char *buf, size_t len)
 
 bool
 init_src_common(pgp_source_t *src, size_t paramsize)
+{
+    return init_src_arena(src, paramsize, NULL);
+}
+
+bool
+init_src_arena(pgp_source_t *src, size_t paramsize, pgp_arena_t *arena)
 {
     memset(src, 0, sizeof(*src));
+    src->arena = arena;
 
-    if ((src->cache = calloc(1, sizeof(pgp_source_cache_t))) == NULL) {
+    /* cache buffer doesn't need to be zeroed */
+    src->cache = arena ? pgp_arena_alloc(arena, sizeof(pgp_source_cache_t)) :
+                         malloc(sizeof(pgp_source_cache_t));
+    if (src->cache == NULL) {
         RNP_LOG("cache allocation failed");
         return false;
     }
+    src->cache->pos = 0;
+    src->cache->len = 0;
     src->cache->readahead = true;
 
     if (paramsize > 0) {
-        if ((src->param = calloc(1, paramsize)) == NULL) {
+        if ((src->param = src_alloc(src, paramsize)) == NULL) {
             RNP_LOG("param allocation failed");
-            free(src->cache);
+            src_free(src, src->cache);
             src->cache = NULL;
             return false;
         }
@@ -318,8 +401,38 @@ init_src_common(pgp_source_t *src, size_t paramsize)
     return true;
 }
 
+void *
+src_alloc(pgp_source_t *src, size_t size)
+{
+    void *res;
+
+    if (!src->arena) {
+        return calloc(1, size);
+    }
+    if ((res = pgp_arena_alloc(src->arena, size))) {
+        memset(res, 0, size);
+    }
+    return res;
+}
+
+void
+src_free(pgp_source_t *src, void *ptr)
+{
+    if (!src->arena) {
+        free(ptr);
+    }
+}
+
+/* maximum size of the file mapping, larger files are mapped by windows of this size */
+#define PGP_FILE_MAP_BUDGET (SIZE_MAX > 0xffffffffU ? ((size_t) 1 << 30) : ((size_t) 1 << 26))
+
 typedef struct pgp_source_file_param_t {
     int fd;
+#ifdef HAVE_SYS_MMAN_H
+    uint8_t *map;    /* mapped window of the file or NULL */
+    uint64_t mapoff; /* offset of the window in the file */
+    size_t   maplen; /* length of the window */
+#endif
 } pgp_source_file_param_t;
 
 static ssize_t
@@ -334,11 +447,77 @@ file_src_read(pgp_source_t *src, void *buf, size_t len)
     }
 }
 
+#ifdef HAVE_SYS_MMAN_H
+/* map the window of the file, starting at the page which contains pos */
+static bool
+file_src_map_window(pgp_source_t *src, uint64_t pos)
+{
+    pgp_source_file_param_t *param = src->param;
+    long                     page = sysconf(_SC_PAGESIZE);
+    uint64_t                 off;
+    size_t                   len;
+    void *                   map;
+
+    off = page > 0 ? pos - pos % page : 0;
+    len = src->size - off > PGP_FILE_MAP_BUDGET ? PGP_FILE_MAP_BUDGET : src->size - off;
+    if (param->map) {
+        munmap(param->map, param->maplen);
+        param->map = NULL;
+    }
+
+    map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, param->fd, off);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(map, len, MADV_SEQUENTIAL);
+#endif
+    param->map = map;
+    param->mapoff = off;
+    param->maplen = len;
+    return true;
+}
+
+static const uint8_t *
+file_src_map(pgp_source_t *src, size_t *len)
+{
+    pgp_source_file_param_t *param = src->param;
+    uint64_t                 pos = src->readb;
+    uint64_t                 need = *len;
+
+    if (!param || !param->map) {
+        return NULL;
+    }
+    if (pos >= src->size) {
+        *len = 0;
+        return param->map;
+    }
+
+    /* larger reads are done by the window remainders, so only peeks must be contiguous */
+    need = need > PGP_INPUT_CACHE_SIZE ? PGP_INPUT_CACHE_SIZE : need;
+    need = need > src->size - pos ? src->size - pos : need;
+    if ((pos < param->mapoff) || (pos + need > param->mapoff + param->maplen)) {
+        if (!file_src_map_window(src, pos)) {
+            RNP_LOG("failed to map file at %llu", (unsigned long long) pos);
+            return NULL;
+        }
+    }
+
+    *len = param->mapoff + param->maplen - pos;
+    return param->map + (pos - param->mapoff);
+}
+#endif
+
 static void
 file_src_close(pgp_source_t *src)
 {
     pgp_source_file_param_t *param = src->param;
     if (param) {
+#ifdef HAVE_SYS_MMAN_H
+        if (param->map) {
+            munmap(param->map, param->maplen);
+        }
+#endif
         if (src->type == PGP_STREAM_FILE) {
             close(param->fd);
         }
@@ -382,6 +561,15 @@ init_file_src(pgp_source_t *src, const char *path)
     src->size = st.st_size;
     src->knownsize = 1;
 
+#ifdef HAVE_SYS_MMAN_H
+    /* data is copied directly from the mapping, so cache is not needed */
+    if (S_ISREG(st.st_mode) && (st.st_size > 0) && file_src_map_window(src, 0)) {
+        src->map = file_src_map;
+        free(src->cache);
+        src->cache = NULL;
+    }
+#endif
+
     return RNP_SUCCESS;
 }
 
@@ -528,6 +716,10 @@ dst_finish(pgp_dest_t *dst)
     if (dst->finish) {
         res = dst->finish(dst);
     }
+    /* failed write of the cached data must be reported as well */
+    if (res == RNP_SUCCESS) {
+        res = dst->werr;
+    }
 
     dst->finished = true;
 
@@ -546,33 +738,179 @@ dst_close(pgp_dest_t *dst, bool discard)
     }
 }
 
+/* file output is collected in the buffer, which grows from the minimum up to the maximum size
+ * while data is written. So short outputs do not allocate much and long ones are written with
+ * large chunks */
+#define PGP_FILE_BUFFER_MIN (64 * 1024)
+#define PGP_FILE_BUFFER_MAX (1024 * 1024)
+/* alignment of the memory, file offset and length for O_DIRECT writes */
+#define PGP_FILE_DIRECT_ALIGN 4096
+
+#ifndef HAVE_SYS_UIO_H
+struct iovec {
+    void * iov_base;
+    size_t iov_len;
+};
+#endif
+
 typedef struct pgp_dest_file_param_t {
-    int  fd;
-    int  errcode;
-    char path[PATH_MAX];
+    int      fd;
+    int      errcode;
+    char     path[PATH_MAX];
+    uint8_t *buf;    /* output buffer or NULL if output is not buffered */
+    size_t   buflen; /* number of bytes in buffer */
+    size_t   bufcap; /* allocated size of the buffer */
+    bool     direct; /* whether O_DIRECT is set on fd */
 } pgp_dest_file_param_t;
 
+static void
+file_dst_clear_direct(pgp_dest_file_param_t *param)
+{
+#ifdef O_DIRECT
+    int flags = fcntl(param->fd, F_GETFL);
+    if (flags != -1) {
+        fcntl(param->fd, F_SETFL, flags & ~O_DIRECT);
+    }
+#endif
+    param->direct = false;
+}
+
+/* write all of the vectors, continuing after partial writes */
+static rnp_result_t
+file_dst_writev(pgp_dest_file_param_t *param, struct iovec *iov, int iovcnt)
+{
+    ssize_t ret;
+
+    while (iovcnt > 0) {
+#ifdef HAVE_SYS_UIO_H
+        ret = writev(param->fd, iov, iovcnt);
+#else
+        ret = write(param->fd, iov->iov_base, iov->iov_len);
+#endif
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EINVAL) && param->direct) {
+                /* file system doesn't support direct I/O */
+                file_dst_clear_direct(param);
+                continue;
+            }
+            param->errcode = errno;
+            RNP_LOG("write failed, error %d", param->errcode);
+            return RNP_ERROR_WRITE;
+        }
+
+        while ((iovcnt > 0) && ((size_t) ret >= iov->iov_len)) {
+            ret -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *) iov->iov_base + ret;
+            iov->iov_len -= ret;
+        }
+    }
+
+    param->errcode = 0;
+    return RNP_SUCCESS;
+}
+
+static rnp_result_t
+file_dst_flush(pgp_dest_file_param_t *param)
+{
+    size_t       len = param->buflen;
+    size_t       aligned = len - len % PGP_FILE_DIRECT_ALIGN;
+    struct iovec iov = {.iov_base = param->buf, .iov_len = len};
+    rnp_result_t ret;
+
+    if (!len) {
+        return RNP_SUCCESS;
+    }
+    param->buflen = 0;
+
+    /* direct write must have aligned length, so unaligned tail, which happens only at the
+     * end of the output, is written without O_DIRECT */
+    if (param->direct && (aligned < len)) {
+        iov.iov_len = aligned;
+        if (aligned && (ret = file_dst_writev(param, &iov, 1))) {
+            return ret;
+        }
+        file_dst_clear_direct(param);
+        iov.iov_base = param->buf + aligned;
+        iov.iov_len = len - aligned;
+    }
+    return file_dst_writev(param, &iov, 1);
+}
+
 static rnp_result_t
 file_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
 {
-    ssize_t                ret;
     pgp_dest_file_param_t *param = dst->param;
+    struct iovec           iov[2];
+    size_t                 newcap;
+    uint8_t *              newbuf;
+    size_t                 part;
+    rnp_result_t           ret;
 
     if (!param) {
         RNP_LOG("wrong param");
         return RNP_ERROR_BAD_PARAMETERS;
     }
 
-    /* we assyme that blocking I/O is used so everything is written or error received */
-    ret = write(param->fd, buf, len);
-    if (ret < 0) {
-        param->errcode = errno;
-        RNP_LOG("write failed, error %d", param->errcode);
-        return RNP_ERROR_WRITE;
-    } else {
-        param->errcode = 0;
-        return RNP_SUCCESS;
+    iov[0].iov_base = (void *) buf;
+    iov[0].iov_len = len;
+    if (!param->buf) {
+        return file_dst_writev(param, iov, 1);
     }
+
+    /* grow the buffer while output continues */
+    if ((param->buflen + len > param->bufcap) && (param->bufcap < PGP_FILE_BUFFER_MAX)) {
+        newcap = param->bufcap * 2;
+        while ((newcap < param->buflen + len) && (newcap < PGP_FILE_BUFFER_MAX)) {
+            newcap *= 2;
+        }
+        newcap = newcap > PGP_FILE_BUFFER_MAX ? PGP_FILE_BUFFER_MAX : newcap;
+        if ((newbuf = realloc(param->buf, newcap))) {
+            param->buf = newbuf;
+            param->bufcap = newcap;
+        }
+    }
+
+    /* buffered data and the new chunk are written with the single call, without copying */
+    if (!param->direct && (param->buflen + len > param->bufcap)) {
+        iov[0].iov_base = param->buf;
+        iov[0].iov_len = param->buflen;
+        iov[1].iov_base = (void *) buf;
+        iov[1].iov_len = len;
+        param->buflen = 0;
+        return file_dst_writev(param, iov, 2);
+    }
+
+    /* direct I/O needs the aligned memory, so everything goes via the buffer */
+    while (len) {
+        part = param->bufcap - param->buflen;
+        part = part > len ? len : part;
+        memcpy(param->buf + param->buflen, buf, part);
+        param->buflen += part;
+        buf = (uint8_t *) buf + part;
+        len -= part;
+        if ((param->buflen == param->bufcap) && (ret = file_dst_flush(param))) {
+            return ret;
+        }
+    }
+    return RNP_SUCCESS;
+}
+
+static rnp_result_t
+file_dst_finish(pgp_dest_t *dst)
+{
+    pgp_dest_file_param_t *param = dst->param;
+
+    if (!param) {
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+    return file_dst_flush(param);
 }
 
 static void
@@ -590,6 +928,7 @@ file_dst_close(pgp_dest_t *dst, bool discard)
         unlink(param->path);
     }
 
+    free(param->buf);
     free(param);
     dst->param = NULL;
 }
@@ -631,13 +970,50 @@ init_file_dest(pgp_dest_t *dst, const char *path, bool overwrite)
     param = dst->param;
     param->fd = fd;
     strcpy(param->path, path);
+    /* output is not buffered if allocation fails */
+    if ((param->buf = malloc(PGP_FILE_BUFFER_MIN))) {
+        param->bufcap = PGP_FILE_BUFFER_MIN;
+    }
     dst->write = file_dst_write;
+    dst->finish = file_dst_finish;
     dst->close = file_dst_close;
     dst->type = PGP_STREAM_FILE;
 
     return RNP_SUCCESS;
 }
 
+bool
+file_dest_set_direct(pgp_dest_t *dst)
+{
+#ifdef O_DIRECT
+    pgp_dest_file_param_t *param = dst->param;
+    void *                 buf = NULL;
+    int                    flags;
+
+    /* file offset must be aligned, so nothing should be written yet */
+    if (!param || (dst->type != PGP_STREAM_FILE) || dst->writeb || dst->clen ||
+        param->buflen) {
+        return false;
+    }
+    if (posix_memalign(&buf, PGP_FILE_DIRECT_ALIGN, PGP_FILE_BUFFER_MAX)) {
+        return false;
+    }
+    if (((flags = fcntl(param->fd, F_GETFL)) == -1) ||
+        (fcntl(param->fd, F_SETFL, flags | O_DIRECT) == -1)) {
+        free(buf);
+        return false;
+    }
+
+    free(param->buf);
+    param->buf = buf;
+    param->bufcap = PGP_FILE_BUFFER_MAX;
+    param->direct = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
 rnp_result_t
 init_stdout_dest(pgp_dest_t *dst)
 {
@@ -650,6 +1026,7 @@ init_stdout_dest(pgp_dest_t *dst)
     param = dst->param;
     param->fd = STDOUT_FILENO;
     dst->write = file_dst_write;
+    dst->finish = file_dst_finish;
     dst->close = file_dst_close;
     dst->type = PGP_STREAM_STDOUT;
 
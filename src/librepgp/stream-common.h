@@ -31,6 +31,7 @@
 #include <stdbool.h>
 #include <sys/types.h>
 #include "errors.h"
+#include "arena.h"
 #include <repgp/repgp.h>
 
 #define PGP_INPUT_CACHE_SIZE 32768
@@ -49,7 +50,8 @@ typedef enum {
     PGP_STREAM_ENCRYPTED,
     PGP_STREAM_SIGNED,
     PGP_STREAM_ARMORED,
-    PGP_STREAM_CLEARTEXT
+    PGP_STREAM_CLEARTEXT,
+    PGP_STREAM_PIPE
 } pgp_stream_type_t;
 
 typedef struct pgp_source_t pgp_source_t;
@@ -58,6 +60,11 @@ typedef struct pgp_dest_t   pgp_dest_t;
 typedef ssize_t pgp_source_read_func_t(pgp_source_t *src, void *buf, size_t len);
 typedef rnp_result_t pgp_source_finish_func_t(pgp_source_t *src);
 typedef void pgp_source_close_func_t(pgp_source_t *src);
+/* get pointer to the source data at the current position (readb). On input len is the
+ * number of bytes needed, on output - number of bytes available at the pointer, 0 on the end
+ * of data. At least min(len, PGP_INPUT_CACHE_SIZE) bytes must be returned unless the end of
+ * data is reached. Only sources with known size may provide it. NULL is returned on error. */
+typedef const uint8_t *pgp_source_map_func_t(pgp_source_t *src, size_t *len);
 
 typedef rnp_result_t pgp_dest_write_func_t(pgp_dest_t *dst, const void *buf, size_t len);
 typedef rnp_result_t pgp_dest_finish_func_t(pgp_dest_t *src);
@@ -75,6 +82,7 @@ typedef struct pgp_source_t {
     pgp_source_read_func_t *  read;
     pgp_source_finish_func_t *finish;
     pgp_source_close_func_t * close;
+    pgp_source_map_func_t *   map; /* direct access to the data, used instead of the read */
     pgp_stream_type_t         type;
 
     uint64_t size;  /* size of the data if available, see knownsize */
@@ -82,6 +90,7 @@ typedef struct pgp_source_t {
                        number of bytes as returned via the read since data may be cached */
     pgp_source_cache_t *cache; /* cache if used */
     void *              param; /* source-specific additional data */
+    pgp_arena_t *       arena; /* arena which owns cache and param, or NULL */
 
     unsigned eof : 1;       /* end of data as reported by read and empty cache */
     unsigned knownsize : 1; /* whether size of the data is known */
@@ -95,6 +104,28 @@ typedef struct pgp_source_t {
  **/
 bool init_src_common(pgp_source_t *src, size_t paramsize);
 
+/** @brief same as init_src_common, but cache and param are allocated from the arena
+ *  @param src pointer to the source structure
+ *  @param paramsize number of bytes required for src->param
+ *  @param arena arena to allocate from. If NULL then regular allocation is used.
+ *  @return true on success or false if memory allocation failed.
+ **/
+bool init_src_arena(pgp_source_t *src, size_t paramsize, pgp_arena_t *arena);
+
+/** @brief allocate zero-filled memory with the lifetime of the source, from the source's
+ *         arena if it has one
+ *  @param src source structure
+ *  @param size number of bytes to allocate
+ *  @return pointer to the memory or NULL if allocation failed
+ **/
+void *src_alloc(pgp_source_t *src, size_t size);
+
+/** @brief free memory allocated with src_alloc
+ *  @param src source structure
+ *  @param ptr pointer to the memory, may be NULL
+ **/
+void src_free(pgp_source_t *src, void *ptr);
+
 /** @brief read up to len bytes from the source
  *  While this function tries to read as much bytes as possible however it may return
  *  less then len bytes. Then src->eof can be checked if it's end of data.
@@ -159,6 +190,9 @@ bool src_skip_eol(pgp_source_t *src);
 ssize_t src_peek_line(pgp_source_t *src, char *buf, size_t len);
 
 /** @brief init file source
+ *  Regular files are memory-mapped if possible, so data is copied directly from the
+ *  mapping to the caller's buffer. Files larger than the address budget are mapped by
+ *  windows. Otherwise file is read via the cache.
  *  @param src pre-allocated source structure
  *  @param path path to the file
  *  @return RNP_SUCCESS or error code
@@ -229,6 +263,8 @@ rnp_result_t dst_finish(pgp_dest_t *dst);
 void dst_close(pgp_dest_t *dst, bool discard);
 
 /** @brief init file destination
+ *  Output is collected in the buffer, which grows up to 1MB, and written with writev()
+ *  together with the large chunks, so number of system calls is small.
  *  @param dst pre-allocated dest structure
  *  @param path path to the file
  *  @param overwrite overwrite existing file
@@ -236,6 +272,13 @@ void dst_close(pgp_dest_t *dst, bool discard);
  **/
 rnp_result_t init_file_dest(pgp_dest_t *dst, const char *path, bool overwrite);
 
+/** @brief write the file with O_DIRECT, bypassing the page cache. Makes sense for very large
+ *         outputs. Must be called before anything is written.
+ *  @param dst file dest, initialized with init_file_dest()
+ *  @return true on success or false if direct I/O is not available
+ **/
+bool file_dest_set_direct(pgp_dest_t *dst);
+
 /** @brief init stdout destination
  *  @param dst pre-allocated dest structure
  *  @return RNP_SUCCESS or error code
@@ -27,7 +27,10 @@
 #ifndef STREAM_DEF_H_
 #define STREAM_DEF_H_
 
-#define CT_BUF_LEN 4096
+/* size of the cleartext block which is dash-unescaped and hashed at once */
+#define CT_BUF_LEN 32768
+/* size of the window which is decrypted in parallel, if threads are enabled */
+#define PGP_DECRYPT_WINDOW_SIZE (2 * 1024 * 1024)
 #define CH_CR ('\r')
 #define CH_LF ('\n')
 #define CH_EQ ('=')
@@ -458,10 +458,107 @@ stream_write_one_pass(pgp_one_pass_sig_t *onepass, pgp_dest_t *dst)
     }
 }
 
+/* write subpacket length in the same encoding as packet length, and subpacket type */
+static bool
+add_packet_body_subpkt(pgp_packet_body_t *body, pgp_sig_subpkt_t *subpkt)
+{
+    uint8_t hdr[6];
+    size_t  hlen;
+
+    hlen = write_packet_len(hdr, subpkt->len + 1);
+    hdr[hlen++] = subpkt->type | (subpkt->critical ? 0x80 : 0x00);
+    return add_packet_body(body, hdr, hlen) &&
+           add_packet_body(body, subpkt->data, subpkt->len);
+}
+
+static bool
+signature_write_material(pgp_signature_t *sig, pgp_packet_body_t *body)
+{
+    switch (sig->palg) {
+    case PGP_PKA_RSA:
+    case PGP_PKA_RSA_SIGN_ONLY:
+        return add_packet_body_mpi(body, sig->material.rsa.s, sig->material.rsa.slen);
+    case PGP_PKA_DSA:
+        return add_packet_body_mpi(body, sig->material.dsa.r, sig->material.dsa.rlen) &&
+               add_packet_body_mpi(body, sig->material.dsa.s, sig->material.dsa.slen);
+    case PGP_PKA_EDDSA:
+    case PGP_PKA_ECDSA:
+    case PGP_PKA_SM2:
+    case PGP_PKA_ECDH:
+        return add_packet_body_mpi(body, sig->material.ecc.r, sig->material.ecc.rlen) &&
+               add_packet_body_mpi(body, sig->material.ecc.s, sig->material.ecc.slen);
+    case PGP_PKA_ELGAMAL_ENCRYPT_OR_SIGN:
+        return add_packet_body_mpi(body, sig->material.eg.r, sig->material.eg.rlen) &&
+               add_packet_body_mpi(body, sig->material.eg.s, sig->material.eg.slen);
+    default:
+        RNP_LOG("Unknown pk algorithm : %d", (int) sig->palg);
+        return false;
+    }
+}
+
 bool
 stream_write_signature(pgp_signature_t *sig, pgp_dest_t *dst)
 {
-    return false;
+    pgp_packet_body_t pktbody;
+    pgp_sig_subpkt_t *subpkt;
+    size_t            unhashed_len = 0;
+    uint8_t           buf[6];
+    bool              res;
+
+    if ((sig->version < 2) || (sig->version > 4)) {
+        RNP_LOG("don't know version %d", (int) sig->version);
+        return false;
+    }
+
+    if (!init_packet_body(&pktbody, PGP_PTAG_CT_SIGNATURE)) {
+        return false;
+    }
+
+    if (sig->version < 4) {
+        /* for v3 signatures only type and creation time are hashed */
+        STORE32BE(buf, sig->creation_time);
+        res = add_packet_body_byte(&pktbody, sig->version) &&
+              add_packet_body_byte(&pktbody, 5) && add_packet_body_byte(&pktbody, sig->type) &&
+              add_packet_body(&pktbody, buf, 4) &&
+              add_packet_body(&pktbody, sig->signer, PGP_KEY_ID_SIZE) &&
+              add_packet_body_byte(&pktbody, sig->palg) &&
+              add_packet_body_byte(&pktbody, sig->halg);
+    } else {
+        /* version, type, algorithms and hashed subpackets are already in hashed_data */
+        res = add_packet_body(&pktbody, sig->hashed_data, sig->hashed_len);
+
+        for (list_item *sp = list_front(sig->subpkts); sp; sp = list_next(sp)) {
+            subpkt = (pgp_sig_subpkt_t *) sp;
+            if (!subpkt->hashed) {
+                unhashed_len += write_packet_len(buf, subpkt->len + 1) + 1 + subpkt->len;
+            }
+        }
+        if (unhashed_len > 0xffff) {
+            RNP_LOG("too long unhashed subpackets");
+            res = false;
+        }
+        buf[0] = unhashed_len >> 8;
+        buf[1] = unhashed_len & 0xff;
+        res = res && add_packet_body(&pktbody, buf, 2);
+
+        for (list_item *sp = list_front(sig->subpkts); res && sp; sp = list_next(sp)) {
+            subpkt = (pgp_sig_subpkt_t *) sp;
+            if (!subpkt->hashed) {
+                res = add_packet_body_subpkt(&pktbody, subpkt);
+            }
+        }
+    }
+
+    res = res && add_packet_body(&pktbody, sig->lbits, 2) &&
+          signature_write_material(sig, &pktbody);
+
+    if (res) {
+        stream_flush_packet_body(&pktbody, dst);
+        return true;
+    } else {
+        free_packet_body(&pktbody);
+        return false;
+    }
 }
 
 rnp_result_t
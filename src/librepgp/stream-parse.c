@@ -34,6 +34,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdatomic.h>
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
@@ -45,6 +46,7 @@
 #include "types.h"
 #include "symmetric.h"
 #include "crypto/s2k.h"
+#include "crypto/s2k_cache.h"
 #include "crypto/sm2.h"
 #include "crypto/ec.h"
 #include "crypto/rsa.h"
@@ -55,6 +57,7 @@
 #include "pgp-key.h"
 #include "signature.h"
 #include "list.h"
+#include "recipient-cache.h"
 #ifdef HAVE_ZLIB_H
 #include <zlib.h>
 #endif
@@ -76,6 +79,8 @@ typedef struct pgp_processing_ctx_t {
     pgp_message_t       msg_type;
     pgp_dest_t          output;
     list                sources;
+    pgp_arena_t *       arena;    /* arena for the message parsing state */
+    pgp_arena_t         ownarena; /* used if handler doesn't provide the arena */
 } pgp_processing_ctx_t;
 
 /* common fields for encrypted, compressed and literal data */
@@ -96,25 +101,63 @@ typedef struct pgp_source_encrypted_param_t {
     bool                      mdc_validated; /* mdc was validated already */
     pgp_crypt_t               decrypt;       /* decrypting crypto */
     pgp_hash_t                mdc;           /* mdc SHA1 hash */
+    pgp_thread_pool_t *       pool;          /* pool for parallel decryption, or NULL */
+    uint8_t *                 windows[2];    /* decrypted data windows for parallel mode */
+    unsigned                  wincur;        /* index of the window being read */
+    size_t                    winlen;        /* number of bytes in the current window */
+    size_t                    winpos;        /* number of bytes already read from the window */
+    pgp_task_t                mdctask;       /* asynchronous mdc hash update */
+    bool                      mdcpending;    /* mdctask is submitted and not waited for */
+    const uint8_t *           mdcdata;       /* data for mdctask */
+    size_t                    mdclen;        /* length of mdcdata */
 } pgp_source_encrypted_param_t;
 
 typedef struct pgp_source_signed_param_t {
     pgp_processing_ctx_t *ctx;             /* processing context */
     pgp_source_t *        readsrc;         /* source to read from */
+    pgp_thread_pool_t *   pool;            /* pool for parallel hashing, or NULL */
     bool                  detached;        /* detached signature */
     bool                  cleartext;       /* source is cleartext signed */
     bool                  clr_eod;         /* cleartext data is over */
     bool                  clr_fline;       /* first line of the cleartext */
     bool                  clr_mline;       /* in the middle of the very long line */
-    uint8_t               out[CT_BUF_LEN]; /* cleartext output cache for easier parsing */
+    uint8_t *             out;             /* cleartext output of the block, CT_BUF_LEN */
     size_t                outlen;          /* total bytes in out */
     size_t                outpos;          /* offset of first available byte in out */
+    uint8_t *             clr_hashed;      /* canonical text of the block, 2 * CT_BUF_LEN */
+    size_t                clr_hashlen;     /* total bytes in clr_hashed */
     list                  onepasses;       /* list of one-pass singatures */
     list                  sigs;            /* list of signatures */
     list                  hashes;          /* hash contexts */
     list                  siginfos;        /* signature validation info */
 } pgp_source_signed_param_t;
 
+/* signature of the detached batch item */
+typedef struct pgp_batch_check_t {
+    pgp_signature_t sig;                     /* parsed signature */
+    uint8_t         keyid[PGP_KEY_ID_SIZE];  /* signer's key id */
+    pgp_pubkey_t *  signer;                  /* signer's key, if found */
+    uint8_t         hval[PGP_MAX_HASH_SIZE]; /* signature's hash value */
+    unsigned        hlen;                    /* length of the hash value */
+    bool            hashed;                  /* hval is calculated */
+    bool            valid;                   /* signature is valid */
+    bool            expired;                 /* signature is expired */
+    bool            no_signer;               /* signer's key is not found */
+} pgp_batch_check_t;
+
+typedef struct pgp_batch_item_t {
+    pgp_detached_item_t *item;    /* item of the caller */
+    list                 checks;  /* list of pgp_batch_check_t */
+    bool                 unknown; /* some signature was not parsed */
+    rnp_result_t         res;     /* read or parse error */
+} pgp_batch_item_t;
+
+/* range of the checks, sorted by the signer's key id, verified by a single task */
+typedef struct pgp_batch_chunk_t {
+    pgp_batch_check_t **checks;
+    size_t              count;
+} pgp_batch_chunk_t;
+
 typedef struct pgp_source_compressed_param_t {
     pgp_source_packet_param_t pkt; /* underlying packet-related params */
     pgp_compression_type_t    alg;
@@ -299,13 +342,13 @@ partial_pkt_src_close(pgp_source_t *src)
 {
     pgp_source_partial_param_t *param = src->param;
     if (param) {
-        free(src->param);
+        src_free(src, src->param);
         src->param = NULL;
     }
 }
 
 static rnp_result_t
-init_partial_pkt_src(pgp_source_t *src, pgp_source_t *readsrc)
+init_partial_pkt_src(pgp_source_t *src, pgp_source_t *readsrc, pgp_arena_t *arena)
 {
     pgp_source_partial_param_t *param;
     uint8_t                     buf[2];
@@ -315,7 +358,7 @@ init_partial_pkt_src(pgp_source_t *src, pgp_source_t *readsrc)
         return RNP_ERROR_BAD_FORMAT;
     }
 
-    if (!init_src_common(src, sizeof(*param))) {
+    if (!init_src_arena(src, sizeof(*param), arena)) {
         return RNP_ERROR_OUT_OF_MEMORY;
     }
 
@@ -353,11 +396,11 @@ literal_src_close(pgp_source_t *src)
     if (param) {
         if (param->pkt.partial) {
             param->pkt.readsrc->close(param->pkt.readsrc);
-            free(param->pkt.readsrc);
+            src_free(src, param->pkt.readsrc);
             param->pkt.readsrc = NULL;
         }
 
-        free(src->param);
+        src_free(src, src->param);
         src->param = NULL;
     }
 }
@@ -457,7 +500,7 @@ compressed_src_close(pgp_source_t *src)
     if (param) {
         if (param->pkt.partial) {
             param->pkt.readsrc->close(param->pkt.readsrc);
-            free(param->pkt.readsrc);
+            src_free(src, param->pkt.readsrc);
             param->pkt.readsrc = NULL;
         }
 
@@ -470,30 +513,24 @@ compressed_src_close(pgp_source_t *src)
             inflateEnd(&param->z);
         }
 
-        free(src->param);
+        src_free(src, src->param);
         src->param = NULL;
     }
 }
 
+/* read the encrypted data, leaving the mdc packet in mdcbuf if the end of input is reached */
 static ssize_t
-encrypted_src_read(pgp_source_t *src, void *buf, size_t len)
+encrypted_read_raw(pgp_source_encrypted_param_t *param,
+                   uint8_t *                     buf,
+                   size_t                        len,
+                   uint8_t *                     mdcbuf,
+                   bool *                        parsemdc)
 {
-    pgp_source_encrypted_param_t *param = src->param;
-    ssize_t                       read;
-    ssize_t                       mdcread;
-    ssize_t                       mdcsub;
-    bool                          parsemdc = false;
-    uint8_t                       mdcbuf[MDC_V1_SIZE];
-    uint8_t                       hash[PGP_SHA1_HASH_SIZE];
-
-    if (param == NULL) {
-        return -1;
-    }
-
-    if (src->eof) {
-        return 0;
-    }
+    ssize_t read;
+    ssize_t mdcread;
+    ssize_t mdcsub;
 
+    *parsemdc = false;
     read = src_read(param->pkt.readsrc, buf, len);
     if (read <= 0) {
         return read;
@@ -510,35 +547,150 @@ encrypted_src_read(pgp_source_t *src, void *buf, size_t len)
 
             mdcsub = MDC_V1_SIZE - mdcread;
             memmove(&mdcbuf[mdcsub], mdcbuf, mdcread);
-            memcpy(mdcbuf, (uint8_t *) buf + read - mdcsub, mdcsub);
+            memcpy(mdcbuf, buf + read - mdcsub, mdcsub);
             read -= mdcsub;
-            parsemdc = true;
+            *parsemdc = true;
         }
     }
 
-    pgp_cipher_cfb_decrypt(&param->decrypt, buf, buf, read);
+    return read;
+}
 
-    if (param->has_mdc) {
-        pgp_hash_add(&param->mdc, buf, read);
+/* decrypt the mdc packet and check it against the hash of all data */
+static bool
+encrypted_check_mdc(pgp_source_encrypted_param_t *param, uint8_t *mdcbuf)
+{
+    uint8_t hash[PGP_SHA1_HASH_SIZE];
 
-        if (parsemdc) {
-            pgp_cipher_cfb_decrypt(&param->decrypt, mdcbuf, mdcbuf, MDC_V1_SIZE);
-            pgp_cipher_finish(&param->decrypt);
-            pgp_hash_add(&param->mdc, mdcbuf, 2);
-            pgp_hash_finish(&param->mdc, hash);
+    pgp_cipher_cfb_decrypt(&param->decrypt, mdcbuf, mdcbuf, MDC_V1_SIZE);
+    pgp_cipher_finish(&param->decrypt);
+    pgp_hash_add(&param->mdc, mdcbuf, 2);
+    pgp_hash_finish(&param->mdc, hash);
 
-            if ((mdcbuf[0] != MDC_PKT_TAG) || (mdcbuf[1] != MDC_V1_SIZE - 2)) {
-                RNP_LOG("mdc header check failed");
-                return -1;
-            }
+    if ((mdcbuf[0] != MDC_PKT_TAG) || (mdcbuf[1] != MDC_V1_SIZE - 2)) {
+        RNP_LOG("mdc header check failed");
+        return false;
+    }
 
-            if (memcmp(&mdcbuf[2], hash, PGP_SHA1_HASH_SIZE) != 0) {
-                RNP_LOG("mdc hash check failed");
-                return -1;
-            }
+    if (memcmp(&mdcbuf[2], hash, PGP_SHA1_HASH_SIZE) != 0) {
+        RNP_LOG("mdc hash check failed");
+        return false;
+    }
+
+    param->mdc_validated = true;
+    return true;
+}
+
+static void
+encrypted_mdc_update(void *data)
+{
+    pgp_source_encrypted_param_t *param = data;
+    pgp_hash_add(&param->mdc, param->mdcdata, param->mdclen);
+}
+
+static void
+encrypted_mdc_wait(pgp_source_encrypted_param_t *param)
+{
+    if (param->mdcpending) {
+        pgp_thread_pool_wait(param->pool, &param->mdctask);
+        param->mdcpending = false;
+    }
+}
+
+/* read and decrypt the next window of data in parallel. mdc of the window is calculated
+ * asynchronously while the caller consumes data and next window is decrypted */
+static bool
+encrypted_fill_window(pgp_source_encrypted_param_t *param)
+{
+    uint8_t  mdcbuf[MDC_V1_SIZE];
+    bool     parsemdc = false;
+    uint8_t *win;
+    ssize_t  read;
+
+    /* mdc task of this window was waited for before the current window's one was submitted */
+    param->wincur ^= 1;
+    win = param->windows[param->wincur];
+    param->winlen = 0;
+    param->winpos = 0;
+
+    read = encrypted_read_raw(param, win, PGP_DECRYPT_WINDOW_SIZE, mdcbuf, &parsemdc);
+    if (read < 0) {
+        return false;
+    }
+    if (!read && !parsemdc) {
+        return true;
+    }
+
+    pgp_cipher_cfb_decrypt_parallel(&param->decrypt, win, win, read, param->pool);
+    param->winlen = read;
+
+    if (!param->has_mdc) {
+        return true;
+    }
+
+    /* mdc must be calculated sequentially */
+    encrypted_mdc_wait(param);
+    if (parsemdc) {
+        pgp_hash_add(&param->mdc, win, read);
+        return encrypted_check_mdc(param, mdcbuf);
+    }
+
+    param->mdcdata = win;
+    param->mdclen = read;
+    param->mdctask.func = encrypted_mdc_update;
+    param->mdctask.param = param;
+    pgp_thread_pool_submit(param->pool, &param->mdctask);
+    param->mdcpending = true;
+    return true;
+}
+
+static ssize_t
+encrypted_src_read(pgp_source_t *src, void *buf, size_t len)
+{
+    pgp_source_encrypted_param_t *param = src->param;
+    ssize_t                       read;
+    bool                          parsemdc = false;
+    uint8_t                       mdcbuf[MDC_V1_SIZE];
 
-            param->mdc_validated = true;
+    if (param == NULL) {
+        return -1;
+    }
+
+    if (src->eof) {
+        return 0;
+    }
+
+    if (param->pool) {
+        if ((param->winpos == param->winlen) && !encrypted_fill_window(param)) {
+            return -1;
+        }
+        read = param->winlen - param->winpos;
+        if ((size_t) read > len) {
+            read = len;
         }
+        memcpy(buf, param->windows[param->wincur] + param->winpos, read);
+        param->winpos += read;
+        return read;
+    }
+
+    read = encrypted_read_raw(param, buf, len, mdcbuf, &parsemdc);
+    if ((read < 0) || (!read && !parsemdc)) {
+        return read;
+    }
+
+    /* decrypt and hash by blocks, so hash gets the data from the cache */
+    for (size_t pos = 0; pos < (size_t) read; pos += PGP_HASH_BLOCK_SIZE) {
+        uint8_t *block = (uint8_t *) buf + pos;
+        size_t   blen = read - pos < PGP_HASH_BLOCK_SIZE ? read - pos : PGP_HASH_BLOCK_SIZE;
+
+        pgp_cipher_cfb_decrypt(&param->decrypt, block, block, blen);
+        if (param->has_mdc) {
+            pgp_hash_add(&param->mdc, block, blen);
+        }
+    }
+
+    if (param->has_mdc && parsemdc && !encrypted_check_mdc(param, mdcbuf)) {
+        return -1;
     }
 
     return read;
@@ -549,6 +701,7 @@ encrypted_src_finish(pgp_source_t *src)
 {
     pgp_source_encrypted_param_t *param = src->param;
 
+    encrypted_mdc_wait(param);
     if (param->has_mdc && !param->mdc_validated) {
         RNP_LOG("mdc was not validated");
         return RNP_ERROR_BAD_STATE;
@@ -562,36 +715,31 @@ encrypted_src_close(pgp_source_t *src)
 {
     pgp_source_encrypted_param_t *param = src->param;
     if (param) {
+        encrypted_mdc_wait(param);
+        free(param->windows[0]);
         list_destroy(&param->symencs);
         list_destroy(&param->pubencs);
 
         if (param->pkt.partial) {
             param->pkt.readsrc->close(param->pkt.readsrc);
-            free(param->pkt.readsrc);
+            src_free(src, param->pkt.readsrc);
             param->pkt.readsrc = NULL;
         }
 
-        free(src->param);
+        src_free(src, src->param);
         src->param = NULL;
     }
 }
 
+/* finish the signature hash: add hashed subpackets and trailer to the copy of data hash */
 static bool
-signed_validate_signature(pgp_source_t *src, pgp_signature_t *sig, pgp_pubkey_t *key)
+signature_hash_finish(const pgp_signature_t *sig,
+                      const pgp_hash_t *     hash,
+                      uint8_t *              hval,
+                      unsigned *             hlen)
 {
-    const pgp_hash_t *         hash;
-    pgp_hash_t                 shash = {0};
-    uint8_t                    trailer[6];
-    uint8_t                    hval[PGP_MAX_HASH_SIZE];
-    unsigned                   len;
-    pgp_source_signed_param_t *param = src->param;
-    bool                       ret = false;
-
-    /* Get the hash context */
-    if ((hash = pgp_hash_list_get(param->hashes, sig->halg)) == NULL) {
-        RNP_LOG("hash context %d not found", (int) sig->halg);
-        return false;
-    }
+    pgp_hash_t shash = {0};
+    uint8_t    trailer[6];
 
     if (!pgp_hash_copy(&shash, hash)) {
         RNP_LOG("failed to clone hash context");
@@ -608,9 +756,19 @@ signed_validate_signature(pgp_source_t *src, pgp_signature_t *sig, pgp_pubkey_t
         pgp_hash_add(&shash, trailer, 6);
     }
 
-    len = pgp_hash_finish(&shash, hval);
+    *hlen = pgp_hash_finish(&shash, hval);
+    return true;
+}
 
-    /* validate signature */
+/* check the signature material against the hash value */
+static bool
+signature_validate_hash(const pgp_signature_t *sig,
+                        pgp_pubkey_t *         key,
+                        const uint8_t *        hval,
+                        unsigned               len,
+                        rng_t *                rng)
+{
+    bool ret = false;
 
     switch (sig->palg) {
     case PGP_PKA_DSA: {
@@ -640,7 +798,7 @@ signed_validate_signature(pgp_source_t *src, pgp_signature_t *sig, pgp_pubkey_t
         break;
     }
     case PGP_PKA_RSA: {
-        ret = pgp_rsa_pkcs1_verify_hash(rnp_ctx_rng_handle(param->ctx->handler.ctx),
+        ret = pgp_rsa_pkcs1_verify_hash(rng,
                                         sig->material.rsa.s,
                                         sig->material.rsa.slen,
                                         sig->halg,
@@ -666,11 +824,56 @@ signed_validate_signature(pgp_source_t *src, pgp_signature_t *sig, pgp_pubkey_t
     return ret;
 }
 
+/* check whether signature is created in the future or is already expired */
+static bool
+signature_check_expired(pgp_signature_t *sig)
+{
+    time_t   now = time(NULL);
+    uint32_t create = signature_get_creation(sig);
+    uint32_t expiry = signature_get_expiration(sig);
+
+    if (create > 0) {
+        if (create > now) {
+            /* signature created later then now */
+            return true;
+        }
+        if ((expiry > 0) && (create + expiry < now)) {
+            /* signature expired */
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool
+signed_validate_signature(pgp_source_t *src, pgp_signature_t *sig, pgp_pubkey_t *key)
+{
+    const pgp_hash_t *         hash;
+    uint8_t                    hval[PGP_MAX_HASH_SIZE];
+    unsigned                   len;
+    pgp_source_signed_param_t *param = src->param;
+
+    /* Get the hash context */
+    if ((hash = pgp_hash_list_get(param->hashes, sig->halg)) == NULL) {
+        RNP_LOG("hash context %d not found", (int) sig->halg);
+        return false;
+    }
+
+    if (!signature_hash_finish(sig, hash, hval, &len)) {
+        return false;
+    }
+
+    /* validate signature */
+    return signature_validate_hash(
+      sig, key, hval, len, rnp_ctx_rng_handle(param->ctx->handler.ctx));
+}
+
 static void
 signed_src_update(pgp_source_t *src, const void *buf, size_t len)
 {
     pgp_source_signed_param_t *param = src->param;
-    pgp_hash_list_update(param->hashes, buf, len);
+    pgp_hash_list_update_parallel(param->hashes, buf, len, param->pool);
 }
 
 static ssize_t
@@ -698,7 +901,9 @@ signed_src_close(pgp_source_t *src)
             free_signature((pgp_signature_t *) sig);
         }
         list_destroy(&param->sigs);
-        free(src->param);
+        src_free(src, param->out);
+        src_free(src, param->clr_hashed);
+        src_free(src, src->param);
         src->param = NULL;
     }
 }
@@ -810,8 +1015,6 @@ signed_src_finish(pgp_source_t *src)
     pgp_key_request_ctx_t      keyctx;
     pgp_key_t *                key = NULL;
     rnp_result_t               ret = RNP_ERROR_GENERIC;
-    time_t                     now;
-    uint32_t                   create, expiry;
 
     if (param->cleartext) {
         ret = signed_read_cleartext_signatures(src);
@@ -827,7 +1030,7 @@ signed_src_finish(pgp_source_t *src)
         RNP_LOG("warning: unexpected data on the stream end");
     }
 
-    sinfos = calloc(list_length(param->siginfos), sizeof(pgp_signature_info_t));
+    sinfos = src_alloc(src, list_length(param->siginfos) * sizeof(pgp_signature_info_t));
     if (!sinfos) {
         return RNP_ERROR_OUT_OF_MEMORY;
     }
@@ -863,19 +1066,7 @@ signed_src_finish(pgp_source_t *src)
         sinfo->valid = signed_validate_signature(src, sinfo->sig, sinfo->signer);
 
         /* Check signature's expiration time */
-        now = time(NULL);
-        create = signature_get_creation(sinfo->sig);
-        expiry = signature_get_expiration(sinfo->sig);
-        if (create > 0) {
-            if (create > now) {
-                /* signature created later then now */
-                sinfo->expired = true;
-            }
-            if ((expiry > 0) && (create + expiry < now)) {
-                /* signature expired */
-                sinfo->expired = true;
-            }
-        }
+        sinfo->expired = signature_check_expired(sinfo->sig);
     }
 
     /* checking the validation results */
@@ -892,7 +1083,7 @@ signed_src_finish(pgp_source_t *src)
         param->ctx->handler.on_signatures(&param->ctx->handler, sinfos, sinfoc);
     }
 
-    free(sinfos);
+    src_free(src, sinfos);
 
     return ret;
 }
@@ -946,11 +1137,12 @@ cleartext_parse_headers(pgp_source_t *src)
     return src_skip_eol(param->readsrc);
 }
 
+/* process a single line of the cleartext. Dash escaping and trailing whitespaces are removed,
+ * text goes to the output and, in canonical form, to the hashed buffer of the block */
 static void
 cleartext_process_line(pgp_source_t *src, const uint8_t *buf, size_t len, bool eol)
 {
     pgp_source_signed_param_t *param = src->param;
-    uint8_t *                  bufen = (uint8_t *) buf + len - 1;
 
     /* check for dashes only if we are not in the middle */
     if (!param->clr_mline && (len > 0) && (buf[0] == CH_DASH)) {
@@ -968,121 +1160,114 @@ cleartext_process_line(pgp_source_t *src, const uint8_t *buf, size_t len, bool e
     /* hash eol if it is not the first line and we are not in the middle */
     if (!param->clr_fline && !param->clr_mline) {
         /* we hash \r\n after the previous line to not hash the last eol before the sig */
-        signed_src_update(src, ST_CRLF, 2);
-    }
-
-    if (!len) {
-        return;
-    }
-
-    if (len + param->outlen > sizeof(param->out)) {
-        RNP_LOG("wrong state");
-        return;
+        memcpy(param->clr_hashed + param->clr_hashlen, ST_CRLF, 2);
+        param->clr_hashlen += 2;
     }
 
     /* if we have eol after this line then strip trailing spaces and tabs */
     if (eol) {
-        for (; ((*bufen == CH_SPACE) || (*bufen == CH_TAB)) && (bufen >= buf); bufen--)
-            ;
+        while ((len > 0) && ((buf[len - 1] == CH_SPACE) || (buf[len - 1] == CH_TAB))) {
+            len--;
+        }
     }
 
-    if ((len = bufen + 1 - buf)) {
+    if (len) {
         memcpy(param->out + param->outlen, buf, len);
         param->outlen += len;
-        signed_src_update(src, buf, len);
+        memcpy(param->clr_hashed + param->clr_hashlen, buf, len);
+        param->clr_hashlen += len;
     }
 }
 
-static ssize_t
-cleartext_src_read(pgp_source_t *src, void *buf, size_t len)
+/* process the next block of the cleartext. Lines are located with memchr(), which is
+ * vectorized in libc, and the whole block is hashed with a single update */
+static bool
+cleartext_process_block(pgp_source_t *src)
 {
-    uint8_t                    srcb[CT_BUF_LEN];
-    uint8_t *                  cur, *en, *bg;
-    ssize_t                    read = 0;
-    ssize_t                    origlen = len;
     pgp_source_signed_param_t *param = src->param;
+    uint8_t                    srcb[CT_BUF_LEN];
+    const uint8_t *            bg, *en, *lf, *lnen;
+    ssize_t                    read;
 
-    if (param == NULL) {
-        return -1;
-    }
+    param->outpos = param->outlen = param->clr_hashlen = 0;
 
-    read = param->outlen - param->outpos;
-    if ((size_t) read >= len) {
-        memcpy(buf, param->out + param->outpos, len);
-        param->outpos += len;
-        if (param->outpos == param->outlen) {
-            param->outpos = param->outlen = 0;
-        }
-        return len;
-    } else if (read > 0) {
-        memcpy(buf, param->out + param->outpos, read);
-        len -= read;
-        buf = (uint8_t *) buf + read;
-        param->outpos = param->outlen = 0;
+    read = src_peek(param->readsrc, srcb, sizeof(srcb));
+    if (read <= 0) {
+        return read == 0;
     }
 
-    if (param->clr_eod) {
-        return origlen - len;
-    }
+    /* processing data line by line, eol could be \n or \r\n */
+    for (bg = srcb, en = srcb + read; bg < en; bg = lf + 1) {
+        if (!(lf = memchr(bg, CH_LF, en - bg))) {
+            break;
+        }
 
-    do {
-        read = src_peek(param->readsrc, srcb, sizeof(srcb));
-        if (read < 0) {
-            return -1;
-        } else if (read == 0) {
+        lnen = (lf > bg) && (*(lf - 1) == CH_CR) ? lf - 1 : lf;
+        cleartext_process_line(src, bg, lnen - bg, true);
+        if (param->clr_eod) {
             break;
         }
 
-        /* processing data line by line, eol could be \n or \r\n */
-        for (cur = srcb, bg = srcb, en = cur + read; cur < en; cur++) {
-            if ((*cur == CH_LF) ||
-                ((*cur == CH_CR) && (cur + 1 < en) && (*(cur + 1) == CH_LF))) {
-                cleartext_process_line(src, bg, cur - bg, true);
-                /* processing eol */
-                if (param->clr_eod) {
-                    break;
-                }
+        /* processing eol */
+        param->clr_fline = false;
+        param->clr_mline = false;
+        memcpy(param->out + param->outlen, lnen, lf + 1 - lnen);
+        param->outlen += lf + 1 - lnen;
+    }
 
-                /* processing eol */
-                param->clr_fline = false;
-                param->clr_mline = false;
-                if (*cur == CH_CR) {
-                    param->out[param->outlen++] = *cur++;
-                }
-                param->out[param->outlen++] = *cur;
-                bg = cur + 1;
-            }
-        }
+    /* if line is larger then the block then just dump it out */
+    if ((bg == srcb) && !param->clr_eod) {
+        /* do not dump trailing whitespaces and \r, they will be stripped if eol follows */
+        for (lnen = en; (lnen > bg) && ((*(lnen - 1) == CH_SPACE) || (*(lnen - 1) == CH_TAB) ||
+                                        (*(lnen - 1) == CH_CR));
+             lnen--)
+            ;
+        en = lnen > bg ? lnen : en;
+        cleartext_process_line(src, bg, en - bg, false);
+        param->clr_mline = true;
+        bg = en;
+    }
+    src_skip(param->readsrc, bg - srcb);
 
-        /* if line is larger then 4k then just dump it out */
-        if ((bg == srcb) && !param->clr_eod) {
-            /* if last char is \r then do not dump it */
-            if ((en > bg) && (*(en - 1) == CH_CR)) {
-                en--;
-            }
-            cleartext_process_line(src, bg, en - bg, false);
-            param->clr_mline = true;
-            bg = en;
-        }
-        src_skip(param->readsrc, bg - srcb);
+    if (param->clr_hashlen) {
+        signed_src_update(src, param->clr_hashed, param->clr_hashlen);
+    }
+    return true;
+}
 
-        /* put data from the param->out to buf */
-        read = param->outlen > len ? len : param->outlen;
-        memcpy(buf, param->out, read);
-        buf = (uint8_t *) buf + read;
-        len -= read;
+static ssize_t
+cleartext_src_read(pgp_source_t *src, void *buf, size_t len)
+{
+    pgp_source_signed_param_t *param = src->param;
+    size_t                     origlen = len;
+    size_t                     avail;
 
-        if ((size_t) read == param->outlen) {
-            param->outlen = 0;
-        } else {
-            param->outpos = read;
-        }
+    if (param == NULL) {
+        return -1;
+    }
 
-        /* we got to the signature marker */
-        if (param->clr_eod || !len) {
-            break;
+    while (len > 0) {
+        if (param->outpos == param->outlen) {
+            /* we got to the signature marker */
+            if (param->clr_eod) {
+                break;
+            }
+            if (!cleartext_process_block(src)) {
+                return -1;
+            }
+            /* end of the source, or signature marker at the beginning of the block */
+            if (!param->outlen) {
+                break;
+            }
         }
-    } while (1);
+
+        avail = param->outlen - param->outpos;
+        avail = avail > len ? len : avail;
+        memcpy(buf, param->out + param->outpos, avail);
+        param->outpos += avail;
+        buf = (uint8_t *) buf + avail;
+        len -= avail;
+    }
 
     return origlen - len;
 }
@@ -1137,11 +1322,14 @@ encrypted_decrypt_header(pgp_source_t *src, pgp_symm_alg_t alg, uint8_t *key)
     }
 }
 
+/* decrypt the session key and check its checksum, key must be able to hold
+ * PGP_MAX_KEY_SIZE bytes */
 static bool
-encrypted_try_key(pgp_source_t *        src,
-                  pgp_pk_sesskey_pkt_t *sesskey,
-                  pgp_seckey_t *        seckey,
-                  rng_t *               rng)
+encrypted_decrypt_sesskey(pgp_pk_sesskey_pkt_t *sesskey,
+                          const pgp_seckey_t *  seckey,
+                          rng_t *               rng,
+                          pgp_symm_alg_t *      alg,
+                          uint8_t *             key)
 {
     uint8_t           decbuf[PGP_MPINT_SIZE];
     rnp_result_t      err;
@@ -1247,8 +1435,9 @@ encrypted_try_key(pgp_source_t *        src,
         goto finish;
     }
 
-    /* Decrypt header */
-    res = encrypted_decrypt_header(src, salg, &decbuf[1]);
+    *alg = salg;
+    memcpy(key, &decbuf[1], keylen);
+    res = true;
 
 finish:
     pgp_forget(&checksum, sizeof(checksum));
@@ -1257,71 +1446,377 @@ finish:
     return res;
 }
 
-static int
-encrypted_try_password(pgp_source_t *src, const char *password)
+static bool
+encrypted_try_key(pgp_source_t *        src,
+                  pgp_pk_sesskey_pkt_t *sesskey,
+                  const pgp_seckey_t *  seckey,
+                  rng_t *               rng)
 {
-    pgp_source_encrypted_param_t *param = src->param;
-    pgp_sk_sesskey_t *            symkey;
-    pgp_crypt_t                   crypt;
-    pgp_symm_alg_t                alg;
-    uint8_t                       keybuf[PGP_MAX_KEY_SIZE + 1];
-    unsigned                      keysize;
-    unsigned                      blsize;
-    bool                          keyavail = false;
-    int                           res;
+    uint8_t        key[PGP_MAX_KEY_SIZE];
+    pgp_symm_alg_t alg;
+    bool           res;
 
-    for (list_item *se = list_front(param->symencs); se; se = list_next(se)) {
-        /* deriving symmetric key from password */
-        symkey = (pgp_sk_sesskey_t *) se;
-        keysize = pgp_key_size(symkey->alg);
-        if (!keysize || !pgp_s2k_derive_key(&symkey->s2k, password, keybuf, keysize)) {
-            continue;
+    res = encrypted_decrypt_sesskey(sesskey, seckey, rng, &alg, key) &&
+          encrypted_decrypt_header(src, alg, key);
+    pgp_forget(key, sizeof(key));
+    return res;
+}
+
+/* check the key against the encrypted header, without changing the source state */
+static bool
+encrypted_check_header(const uint8_t *enchdr, size_t hdrlen, pgp_symm_alg_t alg, uint8_t *key)
+{
+    pgp_crypt_t crypt;
+    uint8_t     dechdr[PGP_MAX_BLOCK_SIZE + 2];
+    unsigned    blsize = pgp_block_size(alg);
+
+    if (!blsize || (hdrlen < blsize + 2) || !pgp_cipher_start(&crypt, alg, key, NULL)) {
+        return false;
+    }
+    pgp_cipher_cfb_decrypt(&crypt, dechdr, enchdr, blsize + 2);
+    pgp_cipher_finish(&crypt);
+    return (dechdr[blsize] == dechdr[blsize - 2]) &&
+           (dechdr[blsize + 1] == dechdr[blsize - 1]);
+}
+
+/* trial of the secret key against a pk-encrypted session key */
+typedef struct pgp_key_try_t {
+    pgp_pk_sesskey_pkt_t *sesskey; /* session key packet */
+    pgp_key_t *           key;     /* secret key */
+    const uint8_t *       enchdr;  /* encrypted header of the data */
+    size_t                hdrlen;  /* number of available bytes in enchdr */
+    atomic_bool *         found;   /* some other trial already succeeded */
+    bool                  valid;   /* session key decrypts the header */
+    pgp_symm_alg_t        alg;     /* data encryption algorithm */
+    uint8_t               skey[PGP_MAX_KEY_SIZE];
+} pgp_key_try_t;
+
+/* task: decrypt the session key with the unlocked secret key and check it */
+static void
+encrypted_try_key_task(void *param)
+{
+    pgp_key_try_t *trial = param;
+    rng_t          rng = {0};
+
+    /* private key operation is expensive, so it is not started if the key is already found */
+    if (atomic_load(trial->found)) {
+        return;
+    }
+    /* rng_t is not thread-safe, so each trial uses its own one */
+    if (!rng_init(&rng, RNG_SYSTEM)) {
+        RNP_LOG("failed to initialize rng");
+        return;
+    }
+    if (encrypted_decrypt_sesskey(
+          trial->sesskey, &trial->key->key.seckey, &rng, &trial->alg, trial->skey) &&
+        encrypted_check_header(trial->enchdr, trial->hdrlen, trial->alg, trial->skey)) {
+        trial->valid = true;
+        atomic_store(trial->found, true);
+    }
+    rng_destroy(&rng);
+}
+
+static bool
+encrypted_keyid_wildcard(const uint8_t *keyid)
+{
+    for (size_t i = 0; i < PGP_KEY_ID_SIZE; i++) {
+        if (keyid[i]) {
+            return false;
         }
+    }
+    return true;
+}
 
-        if (symkey->enckeylen > 0) {
-            /* decrypting session key */
-            if (!pgp_cipher_start(&crypt, symkey->alg, keybuf, NULL)) {
+/* request the secret keys which may decrypt the session keys: the one with matching keyid,
+ * or all of the encrypting keys with the same algorithm for the wildcard keyid. Requests
+ * may load keys and move the already found ones, so if trials is NULL keys are only requested
+ * and count is calculated. */
+static void
+encrypted_request_keys(pgp_processing_ctx_t *ctx,
+                       list                  pubencs,
+                       pgp_key_try_t *       trials,
+                       size_t *              count)
+{
+    pgp_key_request_ctx_t keyctx = {.op = PGP_OP_DECRYPT_SYM, .secret = true};
+    pgp_key_t *           key = NULL;
+    size_t                idx = 0;
+
+    for (list_item *pe = list_front(pubencs); pe; pe = list_next(pe)) {
+        pgp_pk_sesskey_pkt_t *sesskey = (pgp_pk_sesskey_pkt_t *) pe;
+        bool                  wildcard = encrypted_keyid_wildcard(sesskey->key_id);
+
+        keyctx.stype = wildcard ? PGP_KEY_SEARCH_INDEX : PGP_KEY_SEARCH_KEYID;
+        memcpy(keyctx.search.id, sesskey->key_id, sizeof(keyctx.search.id));
+        for (size_t i = 0; wildcard || !i; i++) {
+            if (wildcard) {
+                keyctx.search.index = i;
+            }
+            if (!pgp_request_key(ctx->handler.key_provider, &keyctx, &key)) {
+                break;
+            }
+            if (!pgp_is_key_secret(key) ||
+                (wildcard && ((pgp_get_pubkey(key)->alg != sesskey->alg) ||
+                              !pgp_key_can_encrypt(key)))) {
                 continue;
             }
+            if (trials) {
+                trials[idx].sesskey = sesskey;
+                trials[idx].key = key;
+            }
+            idx++;
+        }
+    }
+    *count = idx;
+}
 
-            pgp_cipher_cfb_decrypt(&crypt, keybuf, symkey->enckey, symkey->enckeylen);
-            pgp_cipher_finish(&crypt);
+/* Secret keys are tried in parallel on the context thread pool, with cancellation of the
+ * trials which are not started yet once the key is found. Keys which decrypted the session
+ * key before are tried first, and locked keys are tried last and one by one, since the
+ * password is requested for each of them. */
+static bool
+encrypted_try_keys(pgp_processing_ctx_t *ctx, pgp_source_t *src)
+{
+    pgp_source_encrypted_param_t *param = src->param;
+    pgp_recipient_cache_t *       cache = NULL;
+    pgp_key_try_t *               trials = NULL;
+    pgp_task_t *                  tasks = NULL;
+    pgp_key_try_t                 trial;
+    size_t                        count = 0;
+    size_t                        taskc = 0;
+    size_t                        first = 0;
+    uint8_t                       enchdr[PGP_MAX_BLOCK_SIZE + 2];
+    ssize_t                       hdrlen;
+    atomic_bool                   found = false;
+    pgp_seckey_t *                decrypted_seckey;
+    pgp_key_t *                   key;
+    bool                          res = false;
+
+    if (ctx->handler.ctx) {
+        cache = ctx->handler.ctx->rcp_cache;
+    }
+
+    /* reading encrypted header to check the session key validity */
+    if ((hdrlen = src_peek(param->pkt.readsrc, enchdr, sizeof(enchdr))) < 0) {
+        RNP_LOG("failed to read encrypted header");
+        return false;
+    }
 
-            keyavail = true;
-            alg = (pgp_symm_alg_t) keybuf[0];
-            keysize = pgp_key_size(alg);
-            blsize = pgp_block_size(alg);
-            if (!keysize || (keysize + 1 != symkey->enckeylen) || !blsize) {
+    encrypted_request_keys(ctx, param->pubencs, NULL, &count);
+    if (!count) {
+        return false;
+    }
+    trials = calloc(count, sizeof(*trials));
+    tasks = calloc(count, sizeof(*tasks));
+    if (!trials || !tasks) {
+        RNP_LOG("allocation failed");
+        goto finish;
+    }
+    encrypted_request_keys(ctx, param->pubencs, trials, &count);
+
+    /* ordering: unlocked keys go first, and previously successful keys first in each group */
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = first; i < count; i++) {
+            key = trials[i].key;
+            if (key->key.seckey.encrypted ||
+                (!pass && !pgp_recipient_cache_check(
+                            cache, trials[i].sesskey->key_id, &key->fingerprint))) {
                 continue;
             }
-            memmove(keybuf, keybuf + 1, keysize);
+            trial = trials[i];
+            memmove(&trials[first + 1], &trials[first], (i - first) * sizeof(*trials));
+            trials[first++] = trial;
+        }
+    }
+    taskc = first;
+    for (size_t i = taskc; i < count; i++) {
+        key = trials[i].key;
+        if (!pgp_recipient_cache_check(cache, trials[i].sesskey->key_id, &key->fingerprint)) {
+            continue;
+        }
+        trial = trials[i];
+        memmove(&trials[first + 1], &trials[first], (i - first) * sizeof(*trials));
+        trials[first++] = trial;
+    }
+
+    /* unlocked keys */
+    for (size_t i = 0; i < taskc; i++) {
+        trials[i].enchdr = enchdr;
+        trials[i].hdrlen = hdrlen;
+        trials[i].found = &found;
+        tasks[i] = (pgp_task_t){.func = encrypted_try_key_task, .param = &trials[i]};
+    }
+    pgp_thread_pool_run(rnp_ctx_thread_pool(ctx->handler.ctx), tasks, taskc);
+
+    for (size_t i = 0; i < count; i++) {
+        key = trials[i].key;
+        if (i < taskc) {
+            /* initializing the decryption with the found key */
+            res = trials[i].valid &&
+                  encrypted_decrypt_header(src, trials[i].alg, trials[i].skey);
         } else {
-            alg = (pgp_symm_alg_t) symkey->alg;
-            blsize = pgp_block_size(alg);
-            if (!blsize) {
+            /* locked keys, password is requested for each of them */
+            decrypted_seckey = pgp_decrypt_seckey(
+              key,
+              ctx->handler.password_provider,
+              &(pgp_password_ctx_t){.op = PGP_OP_DECRYPT, .key = key});
+            if (!decrypted_seckey) {
                 continue;
             }
-            keyavail = true;
+            res = encrypted_try_key(src,
+                                    trials[i].sesskey,
+                                    decrypted_seckey,
+                                    rnp_ctx_rng_handle(ctx->handler.ctx));
+            pgp_seckey_free(decrypted_seckey);
+            free(decrypted_seckey);
+        }
+        if (res) {
+            pgp_recipient_cache_add(cache, trials[i].sesskey->key_id, &key->fingerprint);
+            break;
         }
+    }
 
-        /* decrypting header and checking key validity */
-        if (!encrypted_decrypt_header(src, alg, keybuf)) {
-            continue;
+finish:
+    for (size_t i = 0; trials && (i < count); i++) {
+        pgp_forget(trials[i].skey, sizeof(trials[i].skey));
+    }
+    pgp_forget(&trial, sizeof(trial));
+    free(trials);
+    free(tasks);
+    return res;
+}
+
+/* trial of the password against a single sk-encrypted session key */
+typedef struct pgp_password_try_t {
+    pgp_sk_sesskey_t *symkey;   /* session key packet */
+    const char *      password; /* password to try */
+    pgp_s2k_cache_t * cache;    /* cache of the derived keys, or NULL */
+    const uint8_t *   enchdr;   /* encrypted header of the data */
+    size_t            hdrlen;   /* number of available bytes in enchdr */
+    atomic_bool *     found;    /* some other trial already succeeded */
+    bool              keyavail; /* key was derived and alg is supported */
+    bool              valid;    /* key decrypts the header */
+    pgp_symm_alg_t    alg;      /* data encryption algorithm */
+    uint8_t           key[PGP_MAX_KEY_SIZE + 1];
+} pgp_password_try_t;
+
+/* task: derive the key from the password and check it */
+static void
+encrypted_try_password_task(void *param)
+{
+    pgp_password_try_t *trial = param;
+    pgp_sk_sesskey_t *  symkey = trial->symkey;
+    pgp_crypt_t         crypt;
+    unsigned            keysize;
+
+    /* S2K derivation is expensive, so it is not started if the key is already found */
+    if (atomic_load(trial->found)) {
+        return;
+    }
+
+    /* deriving symmetric key from password */
+    keysize = pgp_key_size(symkey->alg);
+    if (!keysize || !pgp_s2k_cache_derive_key(
+                      trial->cache, &symkey->s2k, trial->password, trial->key, keysize)) {
+        return;
+    }
+
+    if (symkey->enckeylen > 0) {
+        /* decrypting session key */
+        if (!pgp_cipher_start(&crypt, symkey->alg, trial->key, NULL)) {
+            return;
+        }
+
+        pgp_cipher_cfb_decrypt(&crypt, trial->key, symkey->enckey, symkey->enckeylen);
+        pgp_cipher_finish(&crypt);
+
+        trial->keyavail = true;
+        trial->alg = (pgp_symm_alg_t) trial->key[0];
+        keysize = pgp_key_size(trial->alg);
+        if (!keysize || (keysize + 1 != symkey->enckeylen) || !pgp_block_size(trial->alg)) {
+            return;
+        }
+        memmove(trial->key, trial->key + 1, keysize);
+    } else {
+        trial->alg = (pgp_symm_alg_t) symkey->alg;
+        if (!pgp_block_size(trial->alg)) {
+            return;
         }
+        trial->keyavail = true;
+    }
+
+    /* checking key validity */
+    if (encrypted_check_header(trial->enchdr, trial->hdrlen, trial->alg, trial->key)) {
+        trial->valid = true;
+        atomic_store(trial->found, true);
+    }
+}
 
-        res = 1;
+/* Password is tried against all sk-encrypted session keys in parallel, since S2K derivation
+ * of each of them takes a lot of time. The first matching session key in order is used. */
+static int
+encrypted_try_password(pgp_source_t *src, const char *password, rnp_ctx_t *ctx)
+{
+    pgp_source_encrypted_param_t *param = src->param;
+    pgp_password_try_t *          trials = NULL;
+    pgp_task_t *                  tasks = NULL;
+    size_t                        count = list_length(param->symencs);
+    uint8_t                       enchdr[PGP_MAX_BLOCK_SIZE + 2];
+    ssize_t                       hdrlen;
+    atomic_bool                   found = false;
+    bool                          keyavail = false;
+    int                           res = 0;
+    size_t                        i = 0;
+
+    /* reading encrypted header to check the password validity */
+    if ((hdrlen = src_peek(param->pkt.readsrc, enchdr, sizeof(enchdr))) < 0) {
+        RNP_LOG("failed to read encrypted header");
+        return 0;
+    }
+
+    if (!count) {
+        RNP_LOG("no supported sk available");
+        return -1;
+    }
+
+    trials = calloc(count, sizeof(*trials));
+    tasks = calloc(count, sizeof(*tasks));
+    if (!trials || !tasks) {
+        RNP_LOG("allocation failed");
+        res = -1;
         goto finish;
     }
 
+    for (list_item *se = list_front(param->symencs); se; se = list_next(se), i++) {
+        trials[i].symkey = (pgp_sk_sesskey_t *) se;
+        trials[i].password = password;
+        trials[i].cache = ctx ? ctx->s2k_cache : NULL;
+        trials[i].enchdr = enchdr;
+        trials[i].hdrlen = hdrlen;
+        trials[i].found = &found;
+        tasks[i] = (pgp_task_t){.func = encrypted_try_password_task, .param = &trials[i]};
+    }
+    pgp_thread_pool_run(rnp_ctx_thread_pool(ctx), tasks, count);
+
+    for (i = 0; i < count; i++) {
+        keyavail = keyavail || trials[i].keyavail;
+        /* initializing the decryption with the found key */
+        if (trials[i].valid && encrypted_decrypt_header(src, trials[i].alg, trials[i].key)) {
+            res = 1;
+            goto finish;
+        }
+    }
+
     if (!keyavail) {
         RNP_LOG("no supported sk available");
         res = -1;
-    } else {
-        res = 0;
     }
 
 finish:
-    pgp_forget(keybuf, sizeof(keybuf));
+    for (i = 0; trials && (i < count); i++) {
+        pgp_forget(trials[i].key, sizeof(trials[i].key));
+    }
+    free(trials);
+    free(tasks);
     return res;
 }
 
@@ -1337,12 +1832,12 @@ init_packet_params(pgp_source_t *src, pgp_source_packet_param_t *param)
     // initialize partial reader if needed
     param->hdrlen = stream_pkt_hdr_len(param->readsrc);
     if (stream_partial_pkt_len(param->readsrc)) {
-        if ((partsrc = calloc(1, sizeof(*partsrc))) == NULL) {
+        if ((partsrc = src_alloc(src, sizeof(*partsrc))) == NULL) {
             return RNP_ERROR_OUT_OF_MEMORY;
         }
-        errcode = init_partial_pkt_src(partsrc, param->readsrc);
+        errcode = init_partial_pkt_src(partsrc, param->readsrc, src->arena);
         if (errcode != RNP_SUCCESS) {
-            free(partsrc);
+            src_free(src, partsrc);
             return errcode;
         }
         param->partial = true;
@@ -1371,7 +1866,7 @@ init_literal_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *rea
     uint8_t                     bt;
     uint8_t                     tstbuf[4];
 
-    if (!init_src_common(src, sizeof(*param))) {
+    if (!init_src_arena(src, sizeof(*param), ctx->arena)) {
         return RNP_ERROR_OUT_OF_MEMORY;
     }
 
@@ -1447,6 +1942,18 @@ finish:
     return errcode;
 }
 
+/* zlib state and window are allocated from the arena of the message */
+static voidpf
+compressed_zalloc(voidpf opaque, uInt items, uInt size)
+{
+    return pgp_arena_alloc((pgp_arena_t *) opaque, (size_t) items * size);
+}
+
+static void
+compressed_zfree(voidpf opaque, voidpf address)
+{
+}
+
 static rnp_result_t
 init_compressed_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *readsrc)
 {
@@ -1455,7 +1962,7 @@ init_compressed_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *
     uint8_t                        alg;
     int                            zret;
 
-    if (!init_src_common(src, sizeof(*param))) {
+    if (!init_src_arena(src, sizeof(*param), ctx->arena)) {
         return RNP_ERROR_OUT_OF_MEMORY;
     }
 
@@ -1483,6 +1990,11 @@ init_compressed_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *
     case PGP_C_ZIP:
     case PGP_C_ZLIB:
         (void) memset(&param->z, 0x0, sizeof(param->z));
+        if (src->arena) {
+            param->z.zalloc = compressed_zalloc;
+            param->z.zfree = compressed_zfree;
+            param->z.opaque = src->arena;
+        }
         zret =
           alg == PGP_C_ZIP ? (int) inflateInit2(&param->z, -15) : (int) inflateInit(&param->z);
         if (zret != Z_OK) {
@@ -1529,15 +2041,12 @@ init_encrypted_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *r
     int                           ptype;
     pgp_sk_sesskey_t              skey = {0};
     pgp_pk_sesskey_pkt_t          pkey = {0};
-    pgp_key_t *                   seckey = NULL;
-    pgp_key_request_ctx_t         keyctx;
-    pgp_seckey_t *                decrypted_seckey = NULL;
     char                          password[MAX_PASSWORD_LENGTH] = {0};
     int                           intres;
     bool                          have_key = false;
     uint64_t                      readb;
 
-    if (!init_src_common(src, sizeof(*param))) {
+    if (!init_src_arena(src, sizeof(*param), ctx->arena)) {
         return RNP_ERROR_OUT_OF_MEMORY;
     }
     param = src->param;
@@ -1547,6 +2056,12 @@ init_encrypted_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *r
     src->finish = encrypted_src_finish;
     src->type = PGP_STREAM_ENCRYPTED;
 
+    if (!list_init_arena(&param->symencs, src->arena) ||
+        !list_init_arena(&param->pubencs, src->arena)) {
+        errcode = RNP_ERROR_OUT_OF_MEMORY;
+        goto finish;
+    }
+
     /* Reading pk/sk encrypted session key(s) */
     while (true) {
         if (src_peek(readsrc, &ptag, 1) < 1) {
@@ -1625,51 +2140,7 @@ init_encrypted_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *r
             errcode = RNP_ERROR_BAD_PARAMETERS;
             goto finish;
         }
-
-        keyctx.op = PGP_OP_DECRYPT_SYM;
-        keyctx.secret = true;
-        keyctx.stype = PGP_KEY_SEARCH_KEYID;
-
-        for (list_item *pe = list_front(param->pubencs); pe; pe = list_next(pe)) {
-            memcpy(keyctx.search.id,
-                   ((pgp_pk_sesskey_pkt_t *) pe)->key_id,
-                   sizeof(keyctx.search.id));
-            /* Get the key if any */
-            if (!pgp_request_key(ctx->handler.key_provider, &keyctx, &seckey)) {
-                continue;
-            }
-            /* Decrypt key */
-            if (seckey->key.seckey.encrypted) {
-                decrypted_seckey = pgp_decrypt_seckey(
-                  seckey,
-                  ctx->handler.password_provider,
-                  &(pgp_password_ctx_t){.op = PGP_OP_DECRYPT, .key = seckey});
-                if (!decrypted_seckey) {
-                    continue;
-                }
-            } else {
-                decrypted_seckey = &(seckey->key.seckey);
-            }
-
-            /* Try to initialize the decryption */
-            if (encrypted_try_key(src,
-                                  (pgp_pk_sesskey_pkt_t *) pe,
-                                  decrypted_seckey,
-                                  rnp_ctx_rng_handle(ctx->handler.ctx))) {
-                have_key = true;
-            }
-
-            /* Destroy decrypted key */
-            if (seckey->key.seckey.encrypted) {
-                pgp_seckey_free(decrypted_seckey);
-                free(decrypted_seckey);
-                decrypted_seckey = NULL;
-            }
-
-            if (have_key) {
-                break;
-            }
-        }
+        have_key = encrypted_try_keys(ctx, src);
     }
 
     /* Trying password-based decryption */
@@ -1684,7 +2155,7 @@ init_encrypted_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *r
                 goto finish;
             }
 
-            intres = encrypted_try_password(src, password);
+            intres = encrypted_try_password(src, password, ctx->handler.ctx);
             if (intres > 0) {
                 have_key = true;
                 break;
@@ -1710,6 +2181,15 @@ init_encrypted_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *r
         src->size = param->pkt.len - (param->pkt.readsrc->readb - readb);
     }
 
+    /* Decrypting large windows in parallel, serial decryption is used on failure */
+    if ((param->pool = rnp_ctx_thread_pool(ctx->handler.ctx))) {
+        if ((param->windows[0] = malloc(2 * PGP_DECRYPT_WINDOW_SIZE))) {
+            param->windows[1] = param->windows[0] + PGP_DECRYPT_WINDOW_SIZE;
+        } else {
+            param->pool = NULL;
+        }
+    }
+
     errcode = RNP_SUCCESS;
 finish:
     if (errcode != RNP_SUCCESS) {
@@ -1749,6 +2229,12 @@ init_cleartext_signed_src(pgp_source_t *src)
         return RNP_ERROR_BAD_FORMAT;
     }
 
+    param->out = src_alloc(src, CT_BUF_LEN);
+    param->clr_hashed = src_alloc(src, CT_BUF_LEN * 2);
+    if (!param->out || !param->clr_hashed) {
+        RNP_LOG("allocation failed");
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
     param->clr_fline = true;
 
     /* now we are good to go */
@@ -1766,7 +2252,7 @@ init_signed_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *read
     pgp_signature_t *          sig = NULL;
     bool                       cleartext;
 
-    if (!init_src_common(src, sizeof(*param))) {
+    if (!init_src_arena(src, sizeof(*param), ctx->arena)) {
         return RNP_ERROR_OUT_OF_MEMORY;
     }
 
@@ -1775,12 +2261,21 @@ init_signed_src(pgp_processing_ctx_t *ctx, pgp_source_t *src, pgp_source_t *read
     param = src->param;
     param->readsrc = readsrc;
     param->ctx = ctx;
+    param->pool = rnp_ctx_thread_pool(ctx->handler.ctx);
     param->cleartext = cleartext;
     src->read = cleartext ? cleartext_src_read : signed_src_read;
     src->close = signed_src_close;
     src->finish = signed_src_finish;
     src->type = cleartext ? PGP_STREAM_CLEARTEXT : PGP_STREAM_SIGNED;
 
+    if (!list_init_arena(&param->onepasses, src->arena) ||
+        !list_init_arena(&param->hashes, src->arena) ||
+        !list_init_arena(&param->sigs, src->arena) ||
+        !list_init_arena(&param->siginfos, src->arena)) {
+        errcode = RNP_ERROR_OUT_OF_MEMORY;
+        goto finish;
+    }
+
     /* we need key provider to validate signatures */
     if (!ctx->handler.key_provider) {
         RNP_LOG("no key provider");
@@ -1861,10 +2356,14 @@ finish:
     return errcode;
 }
 
-static void
-init_processing_ctx(pgp_processing_ctx_t *ctx)
+static bool
+init_processing_ctx(pgp_processing_ctx_t *ctx, pgp_parse_handler_t *handler)
 {
     memset(ctx, 0, sizeof(*ctx));
+    ctx->handler = *handler;
+    pgp_arena_init(&ctx->ownarena);
+    ctx->arena = handler->arena ? handler->arena : &ctx->ownarena;
+    return list_init_arena(&ctx->sources, ctx->arena);
 }
 
 static void
@@ -1874,6 +2373,12 @@ free_processing_ctx(pgp_processing_ctx_t *ctx)
         src_close((pgp_source_t *) src);
     }
     list_destroy(&ctx->sources);
+    /* all of the message parsing state is released at once, keeping memory for the next one */
+    if (ctx->arena == &ctx->ownarena) {
+        pgp_arena_destroy(&ctx->ownarena);
+    } else {
+        pgp_arena_reset(ctx->arena);
+    }
 }
 
 /** @brief build PGP source sequence down to the literal data packet
@@ -2004,8 +2509,11 @@ process_pgp_source(pgp_parse_handler_t *handler, pgp_source_t *src)
     uint8_t *            readbuf = NULL;
     char *               filename = NULL;
 
-    init_processing_ctx(&ctx);
-    ctx.handler = *handler;
+    if (!init_processing_ctx(&ctx, handler)) {
+        RNP_LOG("allocation failure");
+        res = RNP_ERROR_OUT_OF_MEMORY;
+        goto finish;
+    }
 
     /* Building readers sequence. Checking whether it is binary data */
     if (is_pgp_source(src)) {
@@ -2029,7 +2537,7 @@ process_pgp_source(pgp_parse_handler_t *handler, pgp_source_t *src)
         goto finish;
     }
 
-    if ((readbuf = calloc(1, PGP_INPUT_CACHE_SIZE)) == NULL) {
+    if ((readbuf = pgp_arena_alloc(ctx.arena, PGP_INPUT_CACHE_SIZE)) == NULL) {
         RNP_LOG("allocation failure");
         res = RNP_ERROR_OUT_OF_MEMORY;
         goto finish;
@@ -2096,11 +2604,319 @@ process_pgp_source(pgp_parse_handler_t *handler, pgp_source_t *src)
     }
 
     if (ctx.msg_type != PGP_MESSAGE_DETACHED) {
+        /* output may be buffered, so write errors are reported only here */
+        if ((res == RNP_SUCCESS) && ((fres = dst_finish(&outdest)) != RNP_SUCCESS)) {
+            RNP_LOG("failed to finish output");
+            res = fres;
+        }
         dst_close(&outdest, res != RNP_SUCCESS);
     }
 
 finish:
     free_processing_ctx(&ctx);
-    free(readbuf);
     return res;
 }
+
+static rnp_result_t
+batch_read_signatures(pgp_batch_item_t *bitem, pgp_source_t *src)
+{
+    uint8_t            ptag;
+    int                ptype;
+    pgp_signature_t    sig;
+    pgp_batch_check_t *check;
+    rnp_result_t       res;
+
+    while (!src_eof(src)) {
+        if (src_peek(src, &ptag, 1) < 1) {
+            RNP_LOG("failed to read signature packet header");
+            return RNP_ERROR_READ;
+        }
+
+        ptype = get_packet_type(ptag);
+        if (ptype != PGP_PTAG_CT_SIGNATURE) {
+            RNP_LOG("unexpected packet %d", ptype);
+            return RNP_ERROR_BAD_FORMAT;
+        }
+
+        if ((res = stream_parse_signature(src, &sig)) != RNP_SUCCESS) {
+            if (res == RNP_ERROR_READ) {
+                return res;
+            }
+            /* packet is skipped so we may continue */
+            RNP_LOG("failed to parse signature");
+            bitem->unknown = true;
+            continue;
+        }
+
+        check = (pgp_batch_check_t *) list_append(&bitem->checks, NULL, sizeof(*check));
+        if (!check) {
+            RNP_LOG("check allocation failed");
+            free_signature(&sig);
+            return RNP_ERROR_OUT_OF_MEMORY;
+        }
+        check->sig = sig;
+    }
+
+    return RNP_SUCCESS;
+}
+
+/* task: parse the signatures of the item and calculate their hashes over the data */
+static void
+batch_read_item(void *param)
+{
+    pgp_batch_item_t * bitem = param;
+    pgp_source_t *     data = bitem->item->data;
+    pgp_source_t *     sigsrc = bitem->item->sig;
+    pgp_source_t       armor = {0};
+    list               hashes = NULL;
+    const pgp_hash_t * hash;
+    pgp_batch_check_t *check;
+    uint8_t *          buf = NULL;
+    ssize_t            read;
+
+    if (is_armored_source(sigsrc)) {
+        if ((bitem->res = init_armored_src(&armor, sigsrc)) != RNP_SUCCESS) {
+            return;
+        }
+        sigsrc = &armor;
+    }
+
+    bitem->res = batch_read_signatures(bitem, sigsrc);
+    if (sigsrc == &armor) {
+        src_close(&armor);
+    }
+    if ((bitem->res != RNP_SUCCESS) || !list_length(bitem->checks)) {
+        return;
+    }
+
+    for (list_item *li = list_front(bitem->checks); li; li = list_next(li)) {
+        pgp_hash_list_add(&hashes, ((pgp_batch_check_t *) li)->sig.halg);
+    }
+
+    if (!(buf = malloc(PGP_INPUT_CACHE_SIZE))) {
+        RNP_LOG("allocation failure");
+        bitem->res = RNP_ERROR_OUT_OF_MEMORY;
+        goto finish;
+    }
+
+    while (!src_eof(data)) {
+        read = src_read(data, buf, PGP_INPUT_CACHE_SIZE);
+        if (read < 0) {
+            bitem->res = RNP_ERROR_READ;
+            goto finish;
+        }
+        pgp_hash_list_update(hashes, buf, read);
+    }
+
+    for (list_item *li = list_front(bitem->checks); li; li = list_next(li)) {
+        check = (pgp_batch_check_t *) li;
+        if (!(hash = pgp_hash_list_get(hashes, check->sig.halg))) {
+            RNP_LOG("hash context %d not found", (int) check->sig.halg);
+            continue;
+        }
+        check->hashed = signature_hash_finish(&check->sig, hash, check->hval, &check->hlen);
+    }
+
+finish:
+    pgp_hash_list_free(&hashes);
+    free(buf);
+}
+
+/* task: verify the range of checks */
+static void
+batch_verify_chunk(void *param)
+{
+    pgp_batch_chunk_t *chunk = param;
+    pgp_batch_check_t *check;
+    rng_t              rng = {0};
+
+    /* rng is not thread-safe, so each task uses its own one */
+    if (!rng_init(&rng, RNG_SYSTEM)) {
+        RNP_LOG("failed to initialize rng");
+        return;
+    }
+
+    for (size_t i = 0; i < chunk->count; i++) {
+        check = chunk->checks[i];
+        check->valid =
+          signature_validate_hash(&check->sig, check->signer, check->hval, check->hlen, &rng);
+        check->expired = signature_check_expired(&check->sig);
+    }
+
+    rng_destroy(&rng);
+}
+
+static int
+batch_check_cmp(const void *a, const void *b)
+{
+    const pgp_batch_check_t *ca = *(pgp_batch_check_t *const *) a;
+    const pgp_batch_check_t *cb = *(pgp_batch_check_t *const *) b;
+    return memcmp(ca->keyid, cb->keyid, PGP_KEY_ID_SIZE);
+}
+
+static rnp_result_t
+batch_item_result(const pgp_batch_item_t *bitem)
+{
+    rnp_result_t             res = RNP_SUCCESS;
+    const pgp_batch_check_t *check;
+
+    if (bitem->res != RNP_SUCCESS) {
+        return bitem->res;
+    }
+    if (bitem->unknown) {
+        return RNP_ERROR_SIGNATURE_INVALID;
+    }
+    if (!list_length(bitem->checks)) {
+        return RNP_ERROR_NO_SIGNATURES_FOUND;
+    }
+
+    for (list_item *li = list_front(bitem->checks); li; li = list_next(li)) {
+        check = (const pgp_batch_check_t *) li;
+        if (check->no_signer) {
+            res = RNP_ERROR_KEY_NOT_FOUND;
+        } else if (!check->valid || check->expired) {
+            return RNP_ERROR_SIGNATURE_INVALID;
+        }
+    }
+
+    return res;
+}
+
+rnp_result_t
+process_pgp_detached_batch(pgp_parse_handler_t *handler,
+                           pgp_detached_item_t *items,
+                           size_t               count)
+{
+    pgp_thread_pool_t *   pool = rnp_ctx_thread_pool(handler->ctx);
+    pgp_batch_item_t *    bitems = NULL;
+    pgp_batch_check_t **  checks = NULL;
+    pgp_batch_check_t *   check;
+    pgp_batch_chunk_t *   chunks = NULL;
+    pgp_task_t *          tasks = NULL;
+    pgp_key_request_ctx_t keyctx = {.op = PGP_OP_VERIFY, .stype = PGP_KEY_SEARCH_KEYID};
+    pgp_key_t *           key = NULL;
+    bool                  found = false;
+    size_t                checkc = 0;
+    size_t                foundc = 0;
+    size_t                chunkc = 0;
+    rnp_result_t          ret = RNP_ERROR_OUT_OF_MEMORY;
+
+    if (!handler->key_provider) {
+        RNP_LOG("no key provider");
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+    if (!count) {
+        return RNP_SUCCESS;
+    }
+
+    bitems = calloc(count, sizeof(*bitems));
+    tasks = calloc(count, sizeof(*tasks));
+    if (!bitems || !tasks) {
+        RNP_LOG("allocation failed");
+        goto finish;
+    }
+
+    /* parse signatures and hash the data */
+    for (size_t i = 0; i < count; i++) {
+        bitems[i].item = &items[i];
+        tasks[i] = (pgp_task_t){.func = batch_read_item, .param = &bitems[i]};
+    }
+    pgp_thread_pool_run(pool, tasks, count);
+
+    for (size_t i = 0; i < count; i++) {
+        checkc += list_length(bitems[i].checks);
+    }
+    if (checkc && !(checks = calloc(checkc, sizeof(*checks)))) {
+        RNP_LOG("allocation failed");
+        goto finish;
+    }
+
+    /* collect checks which have the hash and key id */
+    checkc = 0;
+    for (size_t i = 0; i < count; i++) {
+        for (list_item *li = list_front(bitems[i].checks); li; li = list_next(li)) {
+            check = (pgp_batch_check_t *) li;
+            if (!check->hashed) {
+                continue;
+            }
+            if (!signature_get_keyid(&check->sig, check->keyid)) {
+                RNP_LOG("cannot get signer's key id from signature");
+                continue;
+            }
+            checks[checkc++] = check;
+        }
+    }
+    if (checkc) {
+        qsort(checks, checkc, sizeof(*checks), batch_check_cmp);
+    }
+
+    /* Request signer's keys once per key id, and from this thread only since key provider is
+     * not thread-safe. Request may load new keys to the key store, moving the already found
+     * ones, so pointers are taken on the second pass, when all the keys are loaded. */
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < checkc; i++) {
+            check = checks[i];
+            if (check->no_signer) {
+                continue;
+            }
+            if (!i || memcmp(check->keyid, checks[i - 1]->keyid, PGP_KEY_ID_SIZE)) {
+                memcpy(keyctx.search.id, check->keyid, PGP_KEY_ID_SIZE);
+                found = pgp_request_key(handler->key_provider, &keyctx, &key);
+            }
+            if (!found) {
+                RNP_LOG("signer's key not found");
+                check->no_signer = true;
+                continue;
+            }
+            check->signer = &key->key.pubkey;
+        }
+    }
+
+    for (size_t i = 0; i < checkc; i++) {
+        if (!checks[i]->no_signer) {
+            checks[foundc++] = checks[i];
+        }
+    }
+    checkc = foundc;
+
+    /* verify signatures, each chunk gets consecutive checks of the same signer(s) */
+    if (checkc) {
+        chunkc = pgp_thread_pool_size(pool) * 4;
+        if (chunkc > checkc) {
+            chunkc = checkc;
+        }
+        free(tasks);
+        chunks = calloc(chunkc, sizeof(*chunks));
+        tasks = calloc(chunkc, sizeof(*tasks));
+        if (!chunks || !tasks) {
+            RNP_LOG("allocation failed");
+            goto finish;
+        }
+
+        for (size_t i = 0; i < chunkc; i++) {
+            size_t start = checkc * i / chunkc;
+            chunks[i].checks = &checks[start];
+            chunks[i].count = checkc * (i + 1) / chunkc - start;
+            tasks[i] = (pgp_task_t){.func = batch_verify_chunk, .param = &chunks[i]};
+        }
+        pgp_thread_pool_run(pool, tasks, chunkc);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        items[i].result = batch_item_result(&bitems[i]);
+    }
+    ret = RNP_SUCCESS;
+
+finish:
+    for (size_t i = 0; bitems && (i < count); i++) {
+        for (list_item *li = list_front(bitems[i].checks); li; li = list_next(li)) {
+            free_signature(&((pgp_batch_check_t *) li)->sig);
+        }
+        list_destroy(&bitems[i].checks);
+    }
+    free(bitems);
+    free(checks);
+    free(chunks);
+    free(tasks);
+    return ret;
+}
@@ -56,8 +56,10 @@ typedef struct pgp_parse_handler_t {
                                               signature verification */
     pgp_signatures_func_t *on_signatures;  /* for signature verification results */
 
-    rnp_ctx_t *ctx;   /* operation context */
-    void *     param; /* additional parameters */
+    rnp_ctx_t *  ctx;   /* operation context */
+    void *       param; /* additional parameters */
+    pgp_arena_t *arena; /* arena for the message parsing state, reset after each message. If
+                           NULL then the temporary one is used */
 } pgp_parse_handler_t;
 
 /* information about the signature */
@@ -79,4 +81,30 @@ typedef struct pgp_signature_info_t {
  **/
 rnp_result_t process_pgp_source(pgp_parse_handler_t *handler, pgp_source_t *src);
 
+/* detached signature together with the signed data, used for the batch verification */
+typedef struct pgp_detached_item_t {
+    pgp_source_t *data;   /* signed data */
+    pgp_source_t *sig;    /* armored or binary detached signature(s) */
+    rnp_result_t  result; /* verification result of this item */
+} pgp_detached_item_t;
+
+/* @brief Verify a batch of detached signatures
+ * Items are parsed and hashed on the thread pool of handler->ctx, then signer keys are
+ * requested once per key id from the calling thread, and signatures, grouped by the signer,
+ * are verified on the thread pool again. So sources of the different items are read
+ * concurrently, while key provider is called only from the calling thread.
+ * Result of each item is RNP_SUCCESS if all of its signatures are valid,
+ * RNP_ERROR_SIGNATURE_INVALID if any signature is invalid, expired or cannot be parsed,
+ * RNP_ERROR_KEY_NOT_FOUND if some signer's key is not available,
+ * RNP_ERROR_NO_SIGNATURES_FOUND or reading/parsing error code otherwise.
+ * @param handler handler with key_provider and ctx set
+ * @param items array of items with data and sig sources initialized. Result is stored in
+ *        the result field, sources are read but not closed.
+ * @param count number of items
+ * @return RNP_SUCCESS if batch was processed, even if some items failed, or error code
+ **/
+rnp_result_t process_pgp_detached_batch(pgp_parse_handler_t *handler,
+                                        pgp_detached_item_t *items,
+                                        size_t               count);
+
 #endif
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2017, [Ribose Inc](https://www.ribose.com).
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1.  Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *
+ * 2.  Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+#include <rnp/rnp_def.h>
+#include "stream-pipe.h"
+#include "utils.h"
+
+#ifdef HAVE_PTHREAD_H
+
+/* chunk is large enough to amortize synchronization, and ring is small enough to stay in L2 */
+#define PIPE_CHUNK_SIZE (64 * 1024)
+#define PIPE_CHUNK_COUNT 8
+/* number of checks before going to sleep on the condition variable */
+#define PIPE_SPIN_COUNT 1024
+
+#define PIPE_WAIT_PRODUCER 1
+#define PIPE_WAIT_CONSUMER 2
+
+typedef struct pgp_pipe_chunk_t {
+    size_t  len;
+    uint8_t data[PIPE_CHUNK_SIZE];
+} pgp_pipe_chunk_t;
+
+/* Ring indices are only incremented: producer owns chunks[head % count] while it is being
+ * filled, consumer owns chunks[tail % count] while it is being written. Mutex and condition
+ * are used only to sleep when ring is full or empty, not to access the data. */
+typedef struct pgp_dest_pipe_param_t {
+    pgp_dest_t *     writedst;
+    pthread_t        thread;
+    bool             started;
+    atomic_size_t    head;    /* number of chunks pushed by producer */
+    atomic_size_t    tail;    /* number of chunks written by consumer */
+    atomic_bool      eof;     /* producer will not push anything anymore */
+    atomic_bool      abort;   /* consumer should exit without writing the rest */
+    atomic_bool      failed;  /* write to writedst failed, consumer exited */
+    atomic_uint      waiting; /* PIPE_WAIT_* flags of the sleeping sides */
+    pthread_mutex_t  lock;
+    pthread_cond_t   cond;
+    pgp_pipe_chunk_t chunks[PIPE_CHUNK_COUNT];
+} pgp_dest_pipe_param_t;
+
+typedef bool pipe_ready_func_t(pgp_dest_pipe_param_t *param);
+
+static bool
+pipe_can_push(pgp_dest_pipe_param_t *param)
+{
+    return (atomic_load(&param->head) - atomic_load(&param->tail) < PIPE_CHUNK_COUNT) ||
+           atomic_load(&param->failed);
+}
+
+static bool
+pipe_can_pop(pgp_dest_pipe_param_t *param)
+{
+    return (atomic_load(&param->tail) != atomic_load(&param->head)) ||
+           atomic_load(&param->eof) || atomic_load(&param->abort);
+}
+
+static void
+pipe_wait(pgp_dest_pipe_param_t *param, unsigned flag, pipe_ready_func_t *ready)
+{
+    for (int i = 0; i < PIPE_SPIN_COUNT; i++) {
+        if (ready(param)) {
+            return;
+        }
+    }
+
+    /* flag is set before the last check, and other side checks it after the update, so
+     * either we see the update or it sees the flag and signals under the lock */
+    pthread_mutex_lock(&param->lock);
+    atomic_fetch_or(&param->waiting, flag);
+    while (!ready(param)) {
+        pthread_cond_wait(&param->cond, &param->lock);
+    }
+    atomic_fetch_and(&param->waiting, ~flag);
+    pthread_mutex_unlock(&param->lock);
+}
+
+static void
+pipe_wake(pgp_dest_pipe_param_t *param, unsigned flag)
+{
+    if (atomic_load(&param->waiting) & flag) {
+        pthread_mutex_lock(&param->lock);
+        pthread_cond_broadcast(&param->cond);
+        pthread_mutex_unlock(&param->lock);
+    }
+}
+
+static void *
+pipe_thread(void *arg)
+{
+    pgp_dest_pipe_param_t *param = arg;
+    pgp_pipe_chunk_t *     chunk;
+    size_t                 tail;
+
+    while (true) {
+        pipe_wait(param, PIPE_WAIT_CONSUMER, pipe_can_pop);
+        if (atomic_load(&param->abort)) {
+            break;
+        }
+        tail = atomic_load(&param->tail);
+        if (tail == atomic_load(&param->head)) {
+            /* eof is set only after the last chunk is pushed */
+            break;
+        }
+
+        chunk = &param->chunks[tail % PIPE_CHUNK_COUNT];
+        dst_write(param->writedst, chunk->data, chunk->len);
+        if (param->writedst->werr != RNP_SUCCESS) {
+            atomic_store(&param->failed, true);
+            pipe_wake(param, PIPE_WAIT_PRODUCER);
+            break;
+        }
+        chunk->len = 0;
+        atomic_store(&param->tail, tail + 1);
+        pipe_wake(param, PIPE_WAIT_PRODUCER);
+    }
+
+    return NULL;
+}
+
+static void
+pipe_push(pgp_dest_pipe_param_t *param)
+{
+    atomic_store(&param->head, atomic_load(&param->head) + 1);
+    pipe_wake(param, PIPE_WAIT_CONSUMER);
+}
+
+static rnp_result_t
+pipe_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
+{
+    pgp_dest_pipe_param_t *param = dst->param;
+    const uint8_t *        bufptr = buf;
+    pgp_pipe_chunk_t *     chunk;
+    size_t                 part;
+
+    if (!param) {
+        RNP_LOG("wrong param");
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+
+    while (len) {
+        /* waiting for the free chunk. Last one may be partially filled already */
+        pipe_wait(param, PIPE_WAIT_PRODUCER, pipe_can_push);
+        if (atomic_load(&param->failed)) {
+            return RNP_ERROR_WRITE;
+        }
+
+        chunk = &param->chunks[atomic_load(&param->head) % PIPE_CHUNK_COUNT];
+        part = PIPE_CHUNK_SIZE - chunk->len;
+        part = part > len ? len : part;
+        memcpy(chunk->data + chunk->len, bufptr, part);
+        chunk->len += part;
+        bufptr += part;
+        len -= part;
+
+        if (chunk->len == PIPE_CHUNK_SIZE) {
+            pipe_push(param);
+        }
+    }
+
+    return RNP_SUCCESS;
+}
+
+static void
+pipe_dst_stop(pgp_dest_pipe_param_t *param, bool abort)
+{
+    if (!param->started) {
+        return;
+    }
+
+    atomic_store(abort ? &param->abort : &param->eof, true);
+    pipe_wake(param, PIPE_WAIT_CONSUMER);
+    pthread_join(param->thread, NULL);
+    param->started = false;
+}
+
+static rnp_result_t
+pipe_dst_finish(pgp_dest_t *dst)
+{
+    pgp_dest_pipe_param_t *param = dst->param;
+    pgp_pipe_chunk_t *     chunk;
+
+    if (!param) {
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+
+    /* pushing partially filled chunk if any */
+    pipe_wait(param, PIPE_WAIT_PRODUCER, pipe_can_push);
+    chunk = &param->chunks[atomic_load(&param->head) % PIPE_CHUNK_COUNT];
+    if (chunk->len && !atomic_load(&param->failed)) {
+        pipe_push(param);
+    }
+
+    pipe_dst_stop(param, false);
+    if (atomic_load(&param->failed)) {
+        return param->writedst->werr;
+    }
+    return RNP_SUCCESS;
+}
+
+static void
+pipe_dst_close(pgp_dest_t *dst, bool discard)
+{
+    pgp_dest_pipe_param_t *param = dst->param;
+
+    if (!param) {
+        return;
+    }
+
+    pipe_dst_stop(param, true);
+    pthread_cond_destroy(&param->cond);
+    pthread_mutex_destroy(&param->lock);
+    free(param);
+    dst->param = NULL;
+}
+
+rnp_result_t
+init_pipe_dst(pgp_dest_t *dst, pgp_dest_t *writedst)
+{
+    pgp_dest_pipe_param_t *param;
+
+    if (!init_dst_common(dst, sizeof(*param))) {
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
+
+    param = dst->param;
+    param->writedst = writedst;
+    atomic_init(&param->head, 0);
+    atomic_init(&param->tail, 0);
+    atomic_init(&param->eof, false);
+    atomic_init(&param->abort, false);
+    atomic_init(&param->failed, false);
+    atomic_init(&param->waiting, 0);
+
+    dst->write = pipe_dst_write;
+    dst->finish = pipe_dst_finish;
+    dst->close = pipe_dst_close;
+    dst->type = PGP_STREAM_PIPE;
+    /* data is copied to the chunks anyway */
+    dst->no_cache = true;
+
+    if (pthread_mutex_init(&param->lock, NULL)) {
+        free(param);
+        dst->param = NULL;
+        return RNP_ERROR_GENERIC;
+    }
+    pthread_cond_init(&param->cond, NULL);
+
+    if (pthread_create(&param->thread, NULL, pipe_thread, param)) {
+        RNP_LOG("failed to start pipe thread");
+        pipe_dst_close(dst, true);
+        return RNP_ERROR_GENERIC;
+    }
+    param->started = true;
+
+    return RNP_SUCCESS;
+}
+
+#else
+
+rnp_result_t
+init_pipe_dst(pgp_dest_t *dst, pgp_dest_t *writedst)
+{
+    return RNP_ERROR_NOT_SUPPORTED;
+}
+
+#endif
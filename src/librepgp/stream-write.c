@@ -25,14 +25,17 @@
  */
 
 #include "config.h"
+#include "stream-def.h"
 #include "stream-write.h"
 #include "stream-packet.h"
 #include "stream-armor.h"
+#include "stream-pipe.h"
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
@@ -42,6 +45,8 @@
 #include <rnp/rnp_def.h>
 #include "pgp-key.h"
 #include "fingerprint.h"
+#include "signature.h"
+#include "hash.h"
 #include "defs.h"
 #include "types.h"
 #include "symmetric.h"
@@ -68,6 +73,31 @@ typedef struct pgp_dest_packet_param_t {
     int         tag;           /* packet tag */
 } pgp_dest_packet_param_t;
 
+/* input block of the parallel deflate, as in pigz */
+#define PGP_ZBLOCK_SIZE (128 * 1024)
+/* deflate window, tail of the previous block is used as the dictionary */
+#define PGP_ZDICT_SIZE (32 * 1024)
+
+/* single block of the parallel compression, processed by the pool thread */
+typedef struct pgp_compress_job_t {
+    pgp_task_t             task;
+    pgp_compression_type_t alg;
+    int                    level;
+    bool                   last;     /* last block of the stream */
+    uint8_t *              in;       /* input data */
+    size_t                 inlen;    /* number of bytes in input */
+    size_t                 incap;    /* capacity of the input */
+    uint8_t *              dict;     /* deflate dictionary */
+    size_t                 dictlen;  /* dictionary length */
+    uint8_t *              out;      /* compressed data */
+    size_t                 outlen;   /* length of compressed data */
+    size_t                 outcap;   /* capacity of the output */
+    size_t                 bitstart; /* bzip2: first bit of the block data in out */
+    size_t                 bitend;   /* bzip2: bit after the end of the block data */
+    uint32_t               crc;      /* bzip2: block crc, deflate: adler32 of the input */
+    rnp_result_t           ret;
+} pgp_compress_job_t;
+
 typedef struct pgp_dest_compressed_param_t {
     pgp_dest_packet_param_t pkt;
     pgp_compression_type_t  alg;
@@ -78,6 +108,15 @@ typedef struct pgp_dest_compressed_param_t {
     bool    zstarted;                        /* whether we initialize zlib/bzip2  */
     uint8_t cache[PGP_INPUT_CACHE_SIZE / 2]; /* pre-allocated cache for compression */
     size_t  len;                             /* number of bytes cached */
+    /* parallel compression fields, used if pool is not NULL */
+    pgp_thread_pool_t * pool;  /* pool for parallel compression */
+    pgp_compress_job_t *jobs;  /* ring of blocks, submitted or being filled */
+    unsigned            jobc;  /* number of jobs in ring */
+    unsigned            first; /* index of the first submitted job */
+    unsigned            busy;  /* number of submitted jobs */
+    uint32_t            crc;   /* zlib: adler32 of the input, bzip2: combined crc */
+    uint32_t            bits;  /* bzip2: pending output bits */
+    unsigned            bitc;  /* bzip2: number of pending output bits */
 } pgp_dest_compressed_param_t;
 
 typedef struct pgp_dest_encrypted_param_t {
@@ -89,6 +128,29 @@ typedef struct pgp_dest_encrypted_param_t {
     uint8_t cache[PGP_INPUT_CACHE_SIZE]; /* pre-allocated cache for encryption */
 } pgp_dest_encrypted_param_t;
 
+/* signer of the data, produces single signature */
+typedef struct pgp_dest_signer_info_t {
+    const pgp_seckey_t *key;                    /* decrypted secret key */
+    pgp_hash_alg_t      halg;                   /* hash algorithm */
+    uint8_t             keyid[PGP_KEY_ID_SIZE]; /* key id of the signer */
+} pgp_dest_signer_info_t;
+
+typedef struct pgp_dest_signed_param_t {
+    pgp_dest_t *         writedst;   /* stream to write signatures and packets to */
+    pgp_write_handler_t *handler;
+    list                 siginfos;   /* list of pgp_dest_signer_info_t */
+    list                 hashes;     /* hashes of the signed data, one per algorithm */
+    pgp_thread_pool_t *  pool;       /* pool for parallel hashing */
+    bool                 detached;   /* detached signature, no one-pass packets */
+    bool                 clearsign;  /* cleartext signed message, no one-pass packets */
+    uint32_t             ctime;      /* signature creation time */
+    bool                 clr_start;  /* cleartext: at the beginning of the line */
+    bool                 clr_fline;  /* cleartext: first line is not completed yet */
+    uint8_t *            clr_buf;    /* cleartext: cache with the incomplete line */
+    size_t               clr_buflen; /* cleartext: number of bytes in clr_buf */
+    uint8_t *            clr_hashed; /* cleartext: canonical text of the block */
+} pgp_dest_signed_param_t;
+
 typedef struct pgp_dest_partial_param_t {
     pgp_dest_t *writedst;
     uint8_t     part[PARTIAL_PKT_BLOCK_SIZE];
@@ -256,12 +318,12 @@ encrypted_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
         return RNP_ERROR_BAD_PARAMETERS;
     }
 
-    if (param->has_mdc) {
-        pgp_hash_add(&param->mdc, buf, len);
-    }
-
+    /* hash and encrypt by chunks, so data is read from memory once */
     while (len > 0) {
         sz = len > sizeof(param->cache) ? sizeof(param->cache) : len;
+        if (param->has_mdc) {
+            pgp_hash_add(&param->mdc, buf, sz);
+        }
         pgp_cipher_cfb_encrypt(&param->encrypt, param->cache, buf, sz);
         dst_write(param->pkt.writedst, param->cache, sz);
         len -= sz;
@@ -305,26 +367,14 @@ encrypted_dst_close(pgp_dest_t *dst, bool discard)
     dst->param = NULL;
 }
 
+/* find the key of the recipient which will be used for encryption */
 static rnp_result_t
-encrypted_add_recipient(pgp_write_handler_t *handler,
-                        pgp_dest_t *         dst,
-                        const char *         userid,
-                        const uint8_t *      key,
-                        const unsigned       keylen)
+encrypted_resolve_recipient(pgp_write_handler_t *handler,
+                            const char *         userid,
+                            pgp_pubkey_t **      pubkey)
 {
-    pgp_key_request_ctx_t       keyctx = {0};
-    pgp_key_t *                 userkey;
-    pgp_pubkey_t *              pubkey;
-    uint8_t                     enckey[PGP_MAX_KEY_SIZE + 3];
-    unsigned                    checksum = 0;
-    pgp_pk_sesskey_pkt_t        pkey = {0};
-    pgp_dest_encrypted_param_t *param = dst->param;
-    rnp_result_t                ret = RNP_ERROR_GENERIC;
-
-    if (!handler->key_provider) {
-        RNP_LOG("no key provider");
-        return RNP_ERROR_BAD_PARAMETERS;
-    }
+    pgp_key_request_ctx_t keyctx = {0};
+    pgp_key_t *           userkey;
 
     keyctx.op = PGP_OP_ENCRYPT_SYM;
     keyctx.secret = false;
@@ -339,14 +389,60 @@ encrypted_add_recipient(pgp_write_handler_t *handler,
 
     /* Use primary key if good for encryption, otherwise look in subkey list */
     if (pgp_key_can_encrypt(userkey)) {
-        pubkey = &userkey->key.pubkey;
+        *pubkey = &userkey->key.pubkey;
     } else {
         pgp_key_t *subkey = find_suitable_subkey(userkey, PGP_KF_ENCRYPT);
         if (!subkey) {
             return RNP_ERROR_NO_SUITABLE_KEY;
         }
-        pubkey = &subkey->key.pubkey;
+        *pubkey = &subkey->key.pubkey;
+    }
+    return RNP_SUCCESS;
+}
+
+/* Resolve keys of all recipients to the list of pgp_pubkey_t *. Request may load new keys to
+ * the key store, moving the already found ones, so pointers are taken on the second pass. */
+static rnp_result_t
+encrypted_resolve_recipients(pgp_write_handler_t *handler, list *keys)
+{
+    pgp_pubkey_t *pubkey = NULL;
+    rnp_result_t  ret;
+
+    if (!list_length(handler->ctx->recipients)) {
+        return RNP_SUCCESS;
+    }
+    if (!handler->key_provider) {
+        RNP_LOG("no key provider");
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (list_item *id = list_front(handler->ctx->recipients); id; id = list_next(id)) {
+            if ((ret = encrypted_resolve_recipient(handler, (char *) id, &pubkey))) {
+                list_destroy(keys);
+                return ret;
+            }
+            if (pass && !list_append(keys, &pubkey, sizeof(pubkey))) {
+                list_destroy(keys);
+                return RNP_ERROR_OUT_OF_MEMORY;
+            }
+        }
     }
+    return RNP_SUCCESS;
+}
+
+static rnp_result_t
+encrypted_add_recipient(pgp_write_handler_t *handler,
+                        pgp_dest_t *         dst,
+                        const pgp_pubkey_t * pubkey,
+                        const uint8_t *      key,
+                        const unsigned       keylen)
+{
+    uint8_t                     enckey[PGP_MAX_KEY_SIZE + 3];
+    unsigned                    checksum = 0;
+    pgp_pk_sesskey_pkt_t        pkey = {0};
+    pgp_dest_encrypted_param_t *param = dst->param;
+    rnp_result_t                ret = RNP_ERROR_GENERIC;
 
     /* Fill pkey */
     pkey.version = PGP_PKSK_V3;
@@ -523,7 +619,10 @@ encrypted_add_password(rnp_symmetric_pass_info_t *pass,
     return RNP_SUCCESS;
 }
 static rnp_result_t
-init_encrypted_dst(pgp_write_handler_t *handler, pgp_dest_t *dst, pgp_dest_t *writedst)
+init_encrypted_dst(pgp_write_handler_t *handler,
+                   pgp_dest_t *         dst,
+                   pgp_dest_t *         writedst,
+                   list                 keys)
 {
     pgp_dest_encrypted_param_t *param;
     bool                        singlepass = true;
@@ -556,7 +655,7 @@ init_encrypted_dst(pgp_write_handler_t *handler, pgp_dest_t *dst, pgp_dest_t *wr
     param->ealg = handler->ctx->ealg;
     param->pkt.origdst = writedst;
 
-    pkeycount = list_length(handler->ctx->recipients);
+    pkeycount = list_length(keys);
     if ((pkeycount > 0) || (list_length(handler->ctx->passwords) > 1)) {
         if (!rng_get_data(rnp_ctx_rng_handle(handler->ctx), enckey, keylen)) {
             ret = RNP_ERROR_RNG;
@@ -567,8 +666,9 @@ init_encrypted_dst(pgp_write_handler_t *handler, pgp_dest_t *dst, pgp_dest_t *wr
 
     /* Configuring and writing pk-encrypted session keys */
     if (pkeycount > 0) {
-        for (list_item *id = list_front(handler->ctx->recipients); id; id = list_next(id)) {
-            ret = encrypted_add_recipient(handler, dst, (char *) id, enckey, keylen);
+        for (list_item *ki = list_front(keys); ki; ki = list_next(ki)) {
+            ret = encrypted_add_recipient(
+              handler, dst, *(const pgp_pubkey_t **) ki, enckey, keylen);
             if (ret != RNP_SUCCESS) {
                 goto finish;
             }
@@ -646,6 +746,358 @@ finish:
     return ret;
 }
 
+static void
+compress_job_deflate(pgp_compress_job_t *job)
+{
+    z_stream z;
+    int      zret;
+
+    /* raw deflate, zlib header and trailer are written separately */
+    memset(&z, 0, sizeof(z));
+    if (deflateInit2(&z, job->level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        RNP_LOG("failed to init zlib");
+        job->ret = RNP_ERROR_BAD_STATE;
+        return;
+    }
+    if (job->dictlen && (deflateSetDictionary(&z, job->dict, job->dictlen) != Z_OK)) {
+        RNP_LOG("failed to set deflate dictionary");
+        job->ret = RNP_ERROR_BAD_STATE;
+        goto done;
+    }
+
+    z.next_in = job->in;
+    z.avail_in = job->inlen;
+    z.next_out = job->out;
+    z.avail_out = job->outcap;
+    /* sync flush ends the data on the byte boundary, so blocks may be concatenated */
+    zret = deflate(&z, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+    /* Z_STREAM_END means that everything is written, even if the output is exactly filled.
+     * Sync flush is complete only if deflate() left some output space */
+    if (job->last ? (zret != Z_STREAM_END) :
+                    ((zret != Z_OK) || z.avail_in || !z.avail_out)) {
+        RNP_LOG("deflate failed, error %d", zret);
+        job->ret = RNP_ERROR_BAD_STATE;
+        goto done;
+    }
+    job->outlen = job->outcap - z.avail_out;
+    job->crc = adler32(adler32(0, Z_NULL, 0), job->in, job->inlen);
+done:
+    deflateEnd(&z);
+}
+
+#ifdef HAVE_BZLIB_H
+/* get up to 32 bits from the buffer, starting from the bit pos, most significant first */
+static uint32_t
+bzip2_get_bits(const uint8_t *buf, size_t pos, unsigned count)
+{
+    uint32_t res = 0;
+
+    for (unsigned i = 0; i < count; i++, pos++) {
+        res = (res << 1) | ((buf[pos >> 3] >> (7 - (pos & 7))) & 1);
+    }
+    return res;
+}
+
+static void
+compress_job_bzip2(pgp_compress_job_t *job)
+{
+    bz_stream bz;
+    int       zret;
+    size_t    end;
+
+    job->outlen = 0;
+    job->bitstart = job->bitend = 0;
+    if (!job->inlen) {
+        return;
+    }
+
+    memset(&bz, 0, sizeof(bz));
+    if (BZ2_bzCompressInit(&bz, job->level, 0, 0) != BZ_OK) {
+        RNP_LOG("failed to init bz");
+        job->ret = RNP_ERROR_BAD_STATE;
+        return;
+    }
+    bz.next_in = (char *) job->in;
+    bz.avail_in = job->inlen;
+    bz.next_out = (char *) job->out;
+    bz.avail_out = job->outcap;
+    do {
+        zret = BZ2_bzCompress(&bz, BZ_FINISH);
+    } while ((zret == BZ_FINISH_OK) && bz.avail_out);
+    job->outlen = job->outcap - bz.avail_out;
+    BZ2_bzCompressEnd(&bz);
+    if ((zret != BZ_STREAM_END) || (job->outlen < 22)) {
+        RNP_LOG("bzip2 compression failed, error %d", zret);
+        job->ret = RNP_ERROR_BAD_STATE;
+        return;
+    }
+
+    /* stream is 'BZh' and level, then block magic 0x314159265359, block crc and data, then
+     * end of stream magic 0x177245385090, combined crc and padding to the byte boundary.
+     * Input fits into single block, so combined crc is equal to the block crc. */
+    job->crc = bzip2_get_bits(job->out, 80, 32);
+    for (unsigned pad = 0; pad < 8; pad++) {
+        end = job->outlen * 8 - pad;
+        if ((bzip2_get_bits(job->out, end - 32, 32) == job->crc) &&
+            (bzip2_get_bits(job->out, end - 80, 24) == 0x177245) &&
+            (bzip2_get_bits(job->out, end - 56, 24) == 0x385090)) {
+            job->bitstart = 32;
+            job->bitend = end - 80;
+            return;
+        }
+    }
+    RNP_LOG("failed to locate bzip2 block");
+    job->ret = RNP_ERROR_BAD_STATE;
+}
+#endif
+
+static void
+compress_job_run(void *param)
+{
+    pgp_compress_job_t *job = param;
+
+    job->ret = RNP_SUCCESS;
+#ifdef HAVE_BZLIB_H
+    if (job->alg == PGP_C_BZIP2) {
+        compress_job_bzip2(job);
+        return;
+    }
+#endif
+    compress_job_deflate(job);
+}
+
+static void
+compressed_put_bits(pgp_dest_compressed_param_t *param, uint32_t bits, unsigned count)
+{
+    /* count is up to 24, so 7 pending bits and new ones fit into 32 bits */
+    param->bits = (param->bits << count) | (bits & ((1U << count) - 1));
+    param->bitc += count;
+    while (param->bitc >= 8) {
+        param->bitc -= 8;
+        param->cache[param->len++] = param->bits >> param->bitc;
+        if (param->len == sizeof(param->cache)) {
+            dst_write(param->pkt.writedst, param->cache, param->len);
+            param->len = 0;
+        }
+    }
+}
+
+/* wait for the first submitted job and write its output */
+static rnp_result_t
+compressed_retire_job(pgp_dest_compressed_param_t *param)
+{
+    pgp_compress_job_t *job = &param->jobs[param->first];
+    size_t              pos;
+
+    pgp_thread_pool_wait(param->pool, &job->task);
+    param->first = (param->first + 1) % param->jobc;
+    param->busy--;
+    if (job->ret) {
+        return job->ret;
+    }
+
+    if (param->alg == PGP_C_BZIP2) {
+        /* bzip2 blocks are not byte-aligned, so they are written bit by bit */
+        if (job->bitend > job->bitstart) {
+            for (pos = job->bitstart; pos + 8 <= job->bitend; pos += 8) {
+                compressed_put_bits(param, job->out[pos >> 3], 8);
+            }
+            if (pos < job->bitend) {
+                compressed_put_bits(
+                  param, job->out[pos >> 3] >> (8 - (job->bitend - pos)), job->bitend - pos);
+            }
+            param->crc = ((param->crc << 1) | (param->crc >> 31)) ^ job->crc;
+        }
+    } else {
+        dst_write(param->pkt.writedst, job->out, job->outlen);
+        param->crc = adler32_combine(param->crc, job->crc, job->inlen);
+    }
+
+    return param->pkt.writedst->werr;
+}
+
+/* submit the job which is being filled, and prepare the next one */
+static rnp_result_t
+compressed_submit_job(pgp_dest_compressed_param_t *param, bool last)
+{
+    pgp_compress_job_t *job = &param->jobs[(param->first + param->busy) % param->jobc];
+    pgp_compress_job_t *next;
+    rnp_result_t        ret;
+
+    job->last = last;
+    job->task.func = compress_job_run;
+    job->task.param = job;
+    pgp_thread_pool_submit(param->pool, &job->task);
+    param->busy++;
+
+    if (last) {
+        return RNP_SUCCESS;
+    }
+    if ((param->busy == param->jobc) && (ret = compressed_retire_job(param))) {
+        return ret;
+    }
+
+    /* previous block is not modified by the job, so it is safe to read its tail */
+    next = &param->jobs[(param->first + param->busy) % param->jobc];
+    next->inlen = 0;
+    if (next->dict) {
+        next->dictlen = job->inlen < PGP_ZDICT_SIZE ? job->inlen : PGP_ZDICT_SIZE;
+        memcpy(next->dict, job->in + job->inlen - next->dictlen, next->dictlen);
+    }
+    return RNP_SUCCESS;
+}
+
+static rnp_result_t
+compressed_dst_write_parallel(pgp_dest_compressed_param_t *param, const void *buf, size_t len)
+{
+    const uint8_t *     bufptr = buf;
+    pgp_compress_job_t *job;
+    size_t              part;
+    rnp_result_t        ret;
+
+    while (len) {
+        job = &param->jobs[(param->first + param->busy) % param->jobc];
+        part = job->incap - job->inlen;
+        part = part > len ? len : part;
+        memcpy(job->in + job->inlen, bufptr, part);
+        job->inlen += part;
+        bufptr += part;
+        len -= part;
+
+        if ((job->inlen == job->incap) && (ret = compressed_submit_job(param, false))) {
+            return ret;
+        }
+    }
+    return RNP_SUCCESS;
+}
+
+static rnp_result_t
+compressed_dst_finish_parallel(pgp_dest_compressed_param_t *param)
+{
+    uint8_t      adler[4];
+    rnp_result_t ret;
+
+    if ((ret = compressed_submit_job(param, true))) {
+        return ret;
+    }
+    while (param->busy) {
+        if ((ret = compressed_retire_job(param))) {
+            return ret;
+        }
+    }
+
+    if (param->alg == PGP_C_ZLIB) {
+        STORE32BE(adler, param->crc);
+        dst_write(param->pkt.writedst, adler, 4);
+    } else if (param->alg == PGP_C_BZIP2) {
+        /* end of stream magic, combined crc and padding */
+        compressed_put_bits(param, 0x177245, 24);
+        compressed_put_bits(param, 0x385090, 24);
+        compressed_put_bits(param, param->crc >> 16, 16);
+        compressed_put_bits(param, param->crc, 16);
+        if (param->bitc) {
+            compressed_put_bits(param, 0, 8 - param->bitc);
+        }
+        dst_write(param->pkt.writedst, param->cache, param->len);
+        param->len = 0;
+    }
+    return RNP_SUCCESS;
+}
+
+static void
+compressed_free_jobs(pgp_dest_compressed_param_t *param)
+{
+    /* jobs must not be freed while pool threads are using them */
+    while (param->busy) {
+        pgp_thread_pool_wait(param->pool, &param->jobs[param->first].task);
+        param->first = (param->first + 1) % param->jobc;
+        param->busy--;
+    }
+    for (unsigned i = 0; param->jobs && (i < param->jobc); i++) {
+        free(param->jobs[i].in);
+        free(param->jobs[i].out);
+        free(param->jobs[i].dict);
+    }
+    free(param->jobs);
+    param->jobs = NULL;
+    param->pool = NULL;
+}
+
+/* setup parallel compression if context has pool, on failure serial compression is used */
+static bool
+compressed_init_parallel(pgp_dest_compressed_param_t *param, rnp_ctx_t *ctx)
+{
+    size_t   incap;
+    size_t   outcap;
+    unsigned flags;
+    unsigned zhdr;
+    uint8_t  hdr[4];
+
+    switch (param->alg) {
+    case PGP_C_ZIP:
+    case PGP_C_ZLIB:
+        incap = PGP_ZBLOCK_SIZE;
+        outcap = deflateBound(NULL, incap) + 16;
+        break;
+#ifdef HAVE_BZLIB_H
+    case PGP_C_BZIP2:
+        if ((ctx->zlevel < 1) || (ctx->zlevel > 9)) {
+            return false;
+        }
+        /* run-length encoding, done by bzip2 before the block sorting, may expand input by
+         * 1.25 at most, and the whole input must fit into the single bzip2 block */
+        incap = (ctx->zlevel * 100000 - 19) / 5 * 4;
+        outcap = incap + incap / 100 + 600;
+        break;
+#endif
+    default:
+        return false;
+    }
+
+    if (!(param->pool = rnp_ctx_thread_pool(ctx))) {
+        return false;
+    }
+    param->jobc = pgp_thread_pool_size(param->pool) * 2;
+    if (!(param->jobs = calloc(param->jobc, sizeof(*param->jobs)))) {
+        param->pool = NULL;
+        return false;
+    }
+    for (unsigned i = 0; i < param->jobc; i++) {
+        pgp_compress_job_t *job = &param->jobs[i];
+        job->alg = param->alg;
+        job->level = ctx->zlevel;
+        job->incap = incap;
+        job->outcap = outcap;
+        job->in = malloc(incap);
+        job->out = malloc(outcap);
+        job->dict = param->alg != PGP_C_BZIP2 ? malloc(PGP_ZDICT_SIZE) : NULL;
+        if (!job->in || !job->out || ((param->alg != PGP_C_BZIP2) && !job->dict)) {
+            compressed_free_jobs(param);
+            return false;
+        }
+    }
+
+    /* stream headers */
+    if (param->alg == PGP_C_ZLIB) {
+        /* the same header as deflate() writes: 32K window and compression level flags */
+        flags = ctx->zlevel < 2 ? 0 : ctx->zlevel < 6 ? 1 : ctx->zlevel == 6 ? 2 : 3;
+        zhdr = (0x78 << 8) | (flags << 6);
+        zhdr += 31 - zhdr % 31;
+        hdr[0] = zhdr >> 8;
+        hdr[1] = zhdr & 0xff;
+        dst_write(param->pkt.writedst, hdr, 2);
+        param->crc = adler32(0, Z_NULL, 0);
+    } else if (param->alg == PGP_C_BZIP2) {
+        hdr[0] = 'B';
+        hdr[1] = 'Z';
+        hdr[2] = 'h';
+        hdr[3] = '0' + ctx->zlevel;
+        dst_write(param->pkt.writedst, hdr, 4);
+        param->crc = 0;
+    }
+    return true;
+}
+
 static rnp_result_t
 compressed_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
 {
@@ -657,6 +1109,10 @@ compressed_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
         return RNP_ERROR_BAD_PARAMETERS;
     }
 
+    if (param->pool) {
+        return compressed_dst_write_parallel(param, buf, len);
+    }
+
     if ((param->alg == PGP_C_ZIP) || (param->alg == PGP_C_ZLIB)) {
         param->z.next_in = (unsigned char *) buf;
         param->z.avail_in = len;
@@ -721,8 +1177,13 @@ compressed_dst_finish(pgp_dest_t *dst)
 {
     int                          zret;
     pgp_dest_compressed_param_t *param = dst->param;
+    rnp_result_t                 ret;
 
-    if ((param->alg == PGP_C_ZIP) || (param->alg == PGP_C_ZLIB)) {
+    if (param->pool) {
+        if ((ret = compressed_dst_finish_parallel(param))) {
+            return ret;
+        }
+    } else if ((param->alg == PGP_C_ZIP) || (param->alg == PGP_C_ZLIB)) {
         param->z.next_in = Z_NULL;
         param->z.avail_in = 0;
         param->z.next_out = param->cache + param->len;
@@ -789,6 +1250,10 @@ compressed_dst_close(pgp_dest_t *dst, bool discard)
         return;
     }
 
+    if (param->pool) {
+        compressed_free_jobs(param);
+    }
+
     if (param->zstarted) {
         if ((param->alg == PGP_C_ZIP) || (param->alg == PGP_C_ZLIB)) {
             deflateEnd(&param->z);
@@ -837,6 +1302,12 @@ init_compressed_dst(pgp_write_handler_t *handler, pgp_dest_t *dst, pgp_dest_t *w
     buf = param->alg;
     dst_write(param->pkt.writedst, &buf, 1);
 
+    /* blocks are compressed by the pool threads and then joined into the single stream */
+    if (compressed_init_parallel(param, handler->ctx)) {
+        ret = RNP_SUCCESS;
+        goto finish;
+    }
+
     /* initializing compression */
     switch (param->alg) {
     case PGP_C_ZIP:
@@ -971,67 +1442,498 @@ finish:
     return ret;
 }
 
-rnp_result_t
-rnp_encrypt_src(pgp_write_handler_t *handler, pgp_source_t *src, pgp_dest_t *dst)
+static rnp_result_t
+signed_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
 {
-    /* stack of the streams would be as following:
-       [armoring stream] - if armoring is enabled
-       encrypting stream, partial writing stream
-       [compressing stream, partial writing stream] - if compression is enabled
-       literal data stream, partial writing stream
-    */
-    uint8_t      readbuf[PGP_INPUT_CACHE_SIZE];
-    ssize_t      read;
-    pgp_dest_t   dests[4];
-    int          destc = 0;
-    rnp_result_t ret = RNP_ERROR_GENERIC;
-    bool         discard;
+    pgp_dest_signed_param_t *param = dst->param;
 
-    /* pushing armoring stream, which will write to the output */
-    if (handler->ctx->armor) {
-        if ((ret = init_armored_dst(&dests[destc], dst, PGP_ARMORED_MESSAGE))) {
-            goto finish;
-        }
-        destc++;
+    if (!param) {
+        RNP_LOG("wrong param");
+        return RNP_ERROR_BAD_PARAMETERS;
     }
 
-    /* pushing encrypting stream, which will write to the output or armoring stream */
-    if ((ret = init_encrypted_dst(handler, &dests[destc], destc ? &dests[destc - 1] : dst))) {
-        goto finish;
+    /* packets of the stream above (literal data) are passed through without hashing */
+    dst_write(param->writedst, buf, len);
+    return RNP_SUCCESS;
+}
+
+/* hash the signed data, it is passed separately since literal packet framing is not signed */
+static void
+signed_dst_update(pgp_dest_t *dst, const void *buf, size_t len)
+{
+    pgp_dest_signed_param_t *param = dst->param;
+
+    pgp_hash_list_update_parallel(param->hashes, buf, len, param->pool);
+}
+
+static bool
+signed_fill_signature(pgp_dest_signed_param_t *param,
+                      pgp_dest_signer_info_t * signer,
+                      pgp_signature_t *        sig)
+{
+    uint8_t *subpkts;
+    size_t   splen;
+    uint64_t expire = param->handler->ctx->sigexpire;
+
+    sig->version = 4;
+    sig->type = param->clearsign ? PGP_SIG_TEXT : PGP_SIG_BINARY;
+    sig->palg = signer->key->pubkey.alg;
+    sig->halg = signer->halg;
+
+    /* version, type, algorithms, subpackets length and creation, expiration, issuer */
+    sig->hashed_len = 6 + 6 + (expire ? 6 : 0) + 2 + PGP_KEY_ID_SIZE;
+    if (!(sig->hashed_data = malloc(sig->hashed_len))) {
+        RNP_LOG("allocation failed");
+        return false;
     }
-    destc++;
 
-    /* if compression is enabled then pushing compressing stream */
-    if (handler->ctx->zlevel > 0) {
-        if ((ret = init_compressed_dst(handler, &dests[destc], &dests[destc - 1]))) {
-            goto finish;
-        }
-        destc++;
+    sig->hashed_data[0] = sig->version;
+    sig->hashed_data[1] = sig->type;
+    sig->hashed_data[2] = sig->palg;
+    sig->hashed_data[3] = sig->halg;
+    splen = sig->hashed_len - 6;
+    sig->hashed_data[4] = splen >> 8;
+    sig->hashed_data[5] = splen & 0xff;
+
+    subpkts = &sig->hashed_data[6];
+    subpkts[0] = 5;
+    subpkts[1] = PGP_SIG_SUBPKT_CREATION_TIME;
+    STORE32BE(&subpkts[2], param->ctime);
+    subpkts += 6;
+    if (expire) {
+        subpkts[0] = 5;
+        subpkts[1] = PGP_SIG_SUBPKT_EXPIRATION_TIME;
+        STORE32BE(&subpkts[2], (uint32_t) expire);
+        subpkts += 6;
     }
+    subpkts[0] = PGP_KEY_ID_SIZE + 1;
+    subpkts[1] = PGP_SIG_SUBPKT_ISSUER_KEY_ID;
+    memcpy(&subpkts[2], signer->keyid, PGP_KEY_ID_SIZE);
+    return true;
+}
 
-    /* pushing literal data stream */
-    if ((ret = init_literal_dst(handler, &dests[destc], &dests[destc - 1]))) {
-        goto finish;
+static rnp_result_t
+signed_write_signature(pgp_dest_signed_param_t *param,
+                       pgp_dest_signer_info_t * signer,
+                       pgp_dest_t *             writedst)
+{
+    pgp_signature_t   sig = {0};
+    pgp_hash_t        hash = {0};
+    const pgp_hash_t *listh;
+    rnp_result_t      ret = RNP_ERROR_GENERIC;
+
+    if (!(listh = pgp_hash_list_get(param->hashes, signer->halg)) ||
+        !pgp_hash_copy(&hash, listh)) {
+        RNP_LOG("failed to clone hash context");
+        return RNP_ERROR_BAD_STATE;
     }
-    destc++;
 
-    /* processing source stream */
-    while (!src->eof) {
-        read = src_read(src, readbuf, sizeof(readbuf));
-        if (read < 0) {
-            RNP_LOG("failed to read from source");
-            ret = RNP_ERROR_READ;
-            goto finish;
-        }
+    if (!signed_fill_signature(param, signer, &sig)) {
+        pgp_hash_finish(&hash, NULL);
+        ret = RNP_ERROR_OUT_OF_MEMORY;
+        goto finish;
+    }
 
-        if (read > 0) {
-            dst_write(&dests[destc - 1], readbuf, read);
+    if (!signature_calculate(
+          &sig, signer->key, &hash, rnp_ctx_rng_handle(param->handler->ctx))) {
+        goto finish;
+    }
+
+    ret = stream_write_signature(&sig, writedst) ? writedst->werr : RNP_ERROR_WRITE;
+finish:
+    free_signature(&sig);
+    return ret;
+}
+
+static rnp_result_t
+signed_write_signatures(pgp_dest_signed_param_t *param, pgp_dest_t *writedst)
+{
+    rnp_result_t ret;
+
+    /* signatures are written in the reverse order to the one-pass packets, so they nest */
+    for (list_item *si = list_back(param->siginfos); si; si = list_prev(si)) {
+        if ((ret = signed_write_signature(param, (pgp_dest_signer_info_t *) si, writedst))) {
+            return ret;
+        }
+    }
+
+    return RNP_SUCCESS;
+}
+
+static rnp_result_t
+signed_dst_finish(pgp_dest_t *dst)
+{
+    pgp_dest_signed_param_t *param = dst->param;
+
+    return signed_write_signatures(param, param->writedst);
+}
+
+/* hash the line of the cleartext in canonical form: \r\n as eol, and trailing whitespaces
+ * removed if line is completed. Eol is hashed before the line, so the last one is not
+ * signed */
+static void
+cleartext_dst_hash_line(
+  pgp_dest_signed_param_t *param, size_t *hlen, const uint8_t *line, size_t len, bool eol)
+{
+    if (param->clr_start && !param->clr_fline) {
+        memcpy(param->clr_hashed + *hlen, ST_CRLF, 2);
+        *hlen += 2;
+    }
+
+    if (eol) {
+        while ((len > 0) && ((line[len - 1] == CH_SPACE) || (line[len - 1] == CH_TAB))) {
+            len--;
+        }
+    }
+    memcpy(param->clr_hashed + *hlen, line, len);
+    *hlen += len;
+}
+
+static bool
+cleartext_is_trailing(uint8_t ch)
+{
+    return (ch == CH_SPACE) || (ch == CH_TAB) || (ch == CH_CR);
+}
+
+/* process complete lines of the cached cleartext. Lines are located with memchr(), which is
+ * vectorized in libc, text is written in spans between the dash-escaped lines and hashed
+ * with a single update. If last is set then the rest is processed as the final line.
+ * Returns number of processed bytes. */
+static size_t
+cleartext_dst_process(pgp_dest_signed_param_t *param, bool last)
+{
+    const uint8_t *bg = param->clr_buf;
+    const uint8_t *en = param->clr_buf + param->clr_buflen;
+    const uint8_t *span = bg;
+    const uint8_t *lf;
+    const uint8_t *lnen;
+    const uint8_t *next;
+    bool           eol;
+    size_t         hlen = 0;
+
+    while (bg < en) {
+        eol = true;
+        if ((lf = memchr(bg, CH_LF, en - bg))) {
+            lnen = (lf > bg) && (*(lf - 1) == CH_CR) ? lf - 1 : lf;
+            next = lf + 1;
+        } else if (last) {
+            /* final line without eol, which is added after it */
+            lnen = next = en;
+        } else if (bg == param->clr_buf) {
+            /* line is longer then the cache: dump it, keeping trailing whitespaces and \r,
+             * since they will be stripped if eol follows them */
+            for (lnen = en; (lnen > bg) && cleartext_is_trailing(*(lnen - 1)); lnen--)
+                ;
+            lnen = next = lnen > bg ? lnen : en;
+            eol = false;
+        } else {
+            break;
+        }
+
+        if (param->clr_start && (*bg == CH_DASH)) {
+            dst_write(param->writedst, span, bg - span);
+            dst_write(param->writedst, "- ", 2);
+            span = bg;
+        }
+
+        cleartext_dst_hash_line(param, &hlen, bg, lnen - bg, eol);
+        param->clr_start = lf != NULL;
+        param->clr_fline = param->clr_fline && !param->clr_start;
+        bg = next;
+    }
+
+    dst_write(param->writedst, span, bg - span);
+    if (hlen) {
+        pgp_hash_list_update_parallel(param->hashes, param->clr_hashed, hlen, param->pool);
+    }
+    return bg - param->clr_buf;
+}
+
+static rnp_result_t
+cleartext_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
+{
+    pgp_dest_signed_param_t *param = dst->param;
+    size_t                   part;
+    size_t                   done;
+
+    while (len > 0) {
+        part = CT_BUF_LEN - param->clr_buflen;
+        part = part > len ? len : part;
+        memcpy(param->clr_buf + param->clr_buflen, buf, part);
+        param->clr_buflen += part;
+        buf = (uint8_t *) buf + part;
+        len -= part;
+
+        /* process only full cache, so hash updates and writes go in large blocks */
+        if (param->clr_buflen < CT_BUF_LEN) {
+            break;
+        }
+        done = cleartext_dst_process(param, false);
+        param->clr_buflen -= done;
+        memmove(param->clr_buf, param->clr_buf + done, param->clr_buflen);
+    }
+
+    return param->writedst->werr;
+}
+
+static rnp_result_t
+cleartext_dst_finish(pgp_dest_t *dst)
+{
+    pgp_dest_signed_param_t *param = dst->param;
+    pgp_dest_t               armordst = {0};
+    rnp_result_t             ret;
+
+    /* process the rest of text, the last line should be followed by the eol */
+    if (param->clr_buflen) {
+        cleartext_dst_process(param, true);
+        param->clr_buflen = 0;
+    }
+    if (!param->clr_start) {
+        dst_write(param->writedst, ST_CRLF, 2);
+    }
+    if (param->writedst->werr) {
+        return param->writedst->werr;
+    }
+
+    if ((ret = init_armored_dst(&armordst, param->writedst, PGP_ARMORED_SIGNATURE))) {
+        return ret;
+    }
+    if (!(ret = signed_write_signatures(param, &armordst))) {
+        ret = dst_finish(&armordst);
+    }
+    dst_close(&armordst, ret != RNP_SUCCESS);
+    return ret;
+}
+
+static void
+signed_dst_close(pgp_dest_t *dst, bool discard)
+{
+    pgp_dest_signed_param_t *param = dst->param;
+
+    if (!param) {
+        return;
+    }
+
+    pgp_hash_list_free(&param->hashes);
+    list_destroy(&param->siginfos);
+    free(param->clr_buf);
+    free(param->clr_hashed);
+    free(param);
+    dst->param = NULL;
+}
+
+static rnp_result_t
+signed_add_signer(pgp_dest_signed_param_t *param, const pgp_seckey_t *key, bool last)
+{
+    pgp_dest_signer_info_t sinfo = {0};
+    pgp_one_pass_sig_t     onepass = {0};
+
+    sinfo.key = key;
+    if (pgp_keyid(sinfo.keyid, PGP_KEY_ID_SIZE, &key->pubkey)) {
+        RNP_LOG("failed to calculate keyid");
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+
+    if ((sinfo.halg = pgp_pick_hash_alg(param->handler->ctx, key)) == PGP_HASH_UNKNOWN) {
+        RNP_LOG("cannot pick hash algorithm");
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+
+    /* data is hashed once for all signers which use the same hash algorithm */
+    if (!pgp_hash_list_add(&param->hashes, sinfo.halg)) {
+        RNP_LOG("failed to initialize hash");
+        return RNP_ERROR_BAD_STATE;
+    }
+
+    if (!list_append(&param->siginfos, &sinfo, sizeof(sinfo))) {
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
+
+    if (param->detached || param->clearsign) {
+        return RNP_SUCCESS;
+    }
+
+    /* nested flag is set only for the last one-pass, which is the closest to the data */
+    onepass.version = 3;
+    onepass.type = PGP_SIG_BINARY;
+    onepass.halg = sinfo.halg;
+    onepass.palg = key->pubkey.alg;
+    memcpy(onepass.keyid, sinfo.keyid, PGP_KEY_ID_SIZE);
+    onepass.nested = last;
+
+    if (!stream_write_one_pass(&onepass, param->writedst)) {
+        return RNP_ERROR_WRITE;
+    }
+    return param->writedst->werr;
+}
+
+static rnp_result_t
+init_signed_dst(pgp_write_handler_t *handler, pgp_dest_t *dst, pgp_dest_t *writedst)
+{
+    pgp_dest_signed_param_t *param;
+    rnp_ctx_t *              ctx = handler->ctx;
+    rnp_result_t             ret = RNP_ERROR_GENERIC;
+
+    if (!list_length(ctx->signers)) {
+        RNP_LOG("no signers");
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+
+    if (!init_dst_common(dst, sizeof(*param))) {
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
+
+    param = dst->param;
+    param->writedst = writedst;
+    param->handler = handler;
+    param->detached = ctx->detached;
+    param->clearsign = ctx->clearsign;
+    param->pool = rnp_ctx_thread_pool(ctx);
+    param->ctime = ctx->sigcreate ? ctx->sigcreate : time(NULL);
+    dst->write = signed_dst_write;
+    dst->finish = signed_dst_finish;
+    dst->close = signed_dst_close;
+    dst->type = PGP_STREAM_SIGNED;
+
+    for (list_item *si = list_front(ctx->signers); si; si = list_next(si)) {
+        if ((ret = signed_add_signer(param, *(pgp_seckey_t **) si, !list_next(si)))) {
+            signed_dst_close(dst, true);
+            return ret;
+        }
+    }
+
+    return RNP_SUCCESS;
+}
+
+static rnp_result_t
+init_cleartext_dst(pgp_write_handler_t *handler, pgp_dest_t *dst, pgp_dest_t *writedst)
+{
+    pgp_dest_signed_param_t *param;
+    rnp_result_t             ret;
+
+    if ((ret = init_signed_dst(handler, dst, writedst))) {
+        return ret;
+    }
+
+    param = dst->param;
+    param->clr_buf = malloc(CT_BUF_LEN);
+    /* every byte may become \r\n, plus eol of the previous block */
+    param->clr_hashed = malloc(CT_BUF_LEN * 2 + 2);
+    if (!param->clr_buf || !param->clr_hashed) {
+        RNP_LOG("allocation failed");
+        signed_dst_close(dst, true);
+        return RNP_ERROR_OUT_OF_MEMORY;
+    }
+    param->clr_start = true;
+    param->clr_fline = true;
+    dst->write = cleartext_dst_write;
+    dst->finish = cleartext_dst_finish;
+
+    /* header with the list of used hash algorithms, and the empty line */
+    dst_write(writedst, ST_CLEAR_BEGIN, strlen(ST_CLEAR_BEGIN));
+    dst_write(writedst, ST_CRLF, 2);
+    dst_write(writedst, ST_HEADER_HASH, strlen(ST_HEADER_HASH));
+    for (list_item *hash = list_front(param->hashes); hash; hash = list_next(hash)) {
+        const char *hname = pgp_hash_name((pgp_hash_t *) hash);
+        if (hash != list_front(param->hashes)) {
+            dst_write(writedst, ",", 1);
+        }
+        dst_write(writedst, hname, strlen(hname));
+    }
+    dst_write(writedst, ST_CRLF, 2);
+    dst_write(writedst, ST_CRLF, 2);
+
+    if ((ret = writedst->werr)) {
+        signed_dst_close(dst, true);
+    }
+    return ret;
+}
+
+/* pipes which are added to the stack, in the order of priority: between compression and
+ * encryption, between encryption and armoring, and after the literal data stream */
+typedef struct pgp_encrypt_pipes_t {
+    bool compress_encrypt;
+    bool encrypt_armor;
+    bool literal_compress;
+} pgp_encrypt_pipes_t;
+
+static pgp_encrypt_pipes_t
+encrypt_pipes(rnp_ctx_t *ctx)
+{
+    pgp_encrypt_pipes_t pipes = {0};
+    unsigned            left = ctx->threads > 1 ? ctx->threads - 1 : 0;
+
+    if (left && (ctx->zlevel > 0)) {
+        pipes.compress_encrypt = true;
+        left--;
+    }
+    if (left && ctx->armor) {
+        pipes.encrypt_armor = true;
+        left--;
+    }
+    if (left) {
+        pipes.literal_compress = true;
+    }
+    return pipes;
+}
+
+/* push pipe to the stack if needed, so following stream will be processed on its own thread */
+static rnp_result_t
+push_pipe_dst(bool needed, pgp_dest_t *dests, int *destc, pgp_dest_t *writedst)
+{
+    rnp_result_t ret;
+
+    if (!needed) {
+        return RNP_SUCCESS;
+    }
+    ret = init_pipe_dst(&dests[*destc], writedst);
+    if (ret == RNP_ERROR_NOT_SUPPORTED) {
+        /* no threads, everything will be processed in a single thread */
+        return RNP_SUCCESS;
+    }
+    if (ret == RNP_SUCCESS) {
+        (*destc)++;
+    }
+    return ret;
+}
+
+/* feed the source to the stack of streams and finish them. Data is written to the wstream,
+ * and, if sstream is not NULL, hashed by it. */
+static rnp_result_t
+process_stream_sequence(pgp_source_t *src,
+                        pgp_dest_t *  dests,
+                        int           destc,
+                        pgp_dest_t *  sstream,
+                        pgp_dest_t *  wstream)
+{
+    uint8_t      readbuf[PGP_INPUT_CACHE_SIZE];
+    ssize_t      read;
+    rnp_result_t ret;
+
+    /* processing source stream */
+    while (!src->eof) {
+        read = src_read(src, readbuf, sizeof(readbuf));
+        if (read < 0) {
+            RNP_LOG("failed to read from source");
+            return RNP_ERROR_READ;
+        }
+
+        if (read > 0) {
+            if (sstream) {
+                signed_dst_update(sstream, readbuf, read);
+            }
+            if (wstream) {
+                dst_write(wstream, readbuf, read);
+            }
 
             for (int i = destc - 1; i >= 0; i--) {
                 if (dests[i].werr != RNP_SUCCESS) {
                     RNP_LOG("failed to process data");
-                    ret = RNP_ERROR_WRITE;
-                    goto finish;
+                    return RNP_ERROR_WRITE;
+                }
+                /* streams below are written by the pipe thread, it reports their errors */
+                if (dests[i].type == PGP_STREAM_PIPE) {
+                    break;
                 }
             }
         }
@@ -1042,11 +1944,291 @@ rnp_encrypt_src(pgp_write_handler_t *handler, pgp_source_t *src, pgp_dest_t *dst
         ret = dst_finish(&dests[i]);
         if (ret != RNP_SUCCESS) {
             RNP_LOG("failed to finish stream");
+            return ret;
+        }
+    }
+
+    return RNP_SUCCESS;
+}
+
+/* encrypt the source to the already resolved recipient keys */
+static rnp_result_t
+encrypt_src(pgp_write_handler_t *handler, list keys, pgp_source_t *src, pgp_dest_t *dst)
+{
+    /* stack of the streams would be as following:
+       [armoring stream] - if armoring is enabled
+       [pipe] - if enabled
+       encrypting stream, partial writing stream
+       [pipe] - if enabled
+       [compressing stream, partial writing stream] - if compression is enabled
+       [pipe] - if enabled
+       [signing stream] - if there are signers
+       literal data stream, partial writing stream
+       Each pipe runs the streams below it on the separate thread, so with threads > 1
+       compression, encryption and armoring work in parallel.
+    */
+    pgp_dest_t          dests[8];
+    pgp_dest_t *        sstream = NULL;
+    int                 destc = 0;
+    rnp_result_t        ret = RNP_ERROR_GENERIC;
+    bool                discard;
+    pgp_encrypt_pipes_t pipes = encrypt_pipes(handler->ctx);
+
+    if (handler->ctx->detached || handler->ctx->clearsign) {
+        RNP_LOG("detached or cleartext signature cannot be encrypted");
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+
+    /* pushing armoring stream, which will write to the output */
+    if (handler->ctx->armor) {
+        if ((ret = init_armored_dst(&dests[destc], dst, PGP_ARMORED_MESSAGE))) {
             goto finish;
         }
+        destc++;
+        if ((ret = push_pipe_dst(pipes.encrypt_armor, dests, &destc, &dests[destc - 1]))) {
+            goto finish;
+        }
+    }
+
+    /* pushing encrypting stream, which will write to the output or armoring stream */
+    if ((ret = init_encrypted_dst(
+           handler, &dests[destc], destc ? &dests[destc - 1] : dst, keys))) {
+        goto finish;
+    }
+    destc++;
+
+    /* if compression is enabled then pushing compressing stream */
+    if (handler->ctx->zlevel > 0) {
+        if ((ret = push_pipe_dst(pipes.compress_encrypt, dests, &destc, &dests[destc - 1]))) {
+            goto finish;
+        }
+        if ((ret = init_compressed_dst(handler, &dests[destc], &dests[destc - 1]))) {
+            goto finish;
+        }
+        destc++;
+    }
+
+    if ((ret = push_pipe_dst(pipes.literal_compress, dests, &destc, &dests[destc - 1]))) {
+        goto finish;
+    }
+
+    /* pushing signing stream, which hashes the data and writes one-pass and signatures */
+    if (list_length(handler->ctx->signers)) {
+        if ((ret = init_signed_dst(handler, &dests[destc], &dests[destc - 1]))) {
+            goto finish;
+        }
+        sstream = &dests[destc++];
+    }
+
+    /* pushing literal data stream */
+    if ((ret = init_literal_dst(handler, &dests[destc], &dests[destc - 1]))) {
+        goto finish;
+    }
+    destc++;
+
+    ret = process_stream_sequence(src, dests, destc, sstream, &dests[destc - 1]);
+finish:
+    discard = ret != RNP_SUCCESS;
+    for (int i = destc - 1; i >= 0; i--) {
+        dst_close(&dests[i], discard);
+    }
+
+    return ret;
+}
+
+rnp_result_t
+rnp_encrypt_src(pgp_write_handler_t *handler, pgp_source_t *src, pgp_dest_t *dst)
+{
+    list         keys = NULL;
+    rnp_result_t ret;
+
+    if ((ret = encrypted_resolve_recipients(handler, &keys))) {
+        return ret;
+    }
+    ret = encrypt_src(handler, keys, src, dst);
+    list_destroy(&keys);
+    return ret;
+}
+
+/* range of the batch items, encrypted by a single task */
+typedef struct pgp_encrypt_chunk_t {
+    pgp_write_handler_t *handler;
+    list                 keys;  /* resolved recipient keys, shared by all chunks */
+    pgp_encrypt_item_t * items;
+    size_t               count;
+} pgp_encrypt_chunk_t;
+
+/* task: encrypt the range of items. Context, with its own rng, is set up once per chunk and
+ * reused for every message, so per-message work is the symmetric encryption and pkesks. */
+static void
+encrypt_batch_chunk(void *param)
+{
+    pgp_encrypt_chunk_t *chunk = param;
+    rnp_ctx_t *          bctx = chunk->handler->ctx;
+    rnp_ctx_t            ctx = *bctx;
+    pgp_write_handler_t  handler = *chunk->handler;
+    rng_t                rng = {0};
+    rnp_result_t         ret = RNP_SUCCESS;
+
+    /* lists of the operation are shared between the tasks, only own ones are destroyed */
+    ctx.recipients = NULL;
+    ctx.passwords = NULL;
+
+    /* rng is not thread-safe, so each task uses its own one of the same type */
+    if (!rng_init(&rng, bctx->rng->rng_type)) {
+        RNP_LOG("failed to initialize rng");
+        ret = RNP_ERROR_RNG;
+    }
+
+    /* messages of the chunk are processed sequentially on this thread */
+    ctx.rng = &rng;
+    ctx.threads = 1;
+    ctx.pool = NULL;
+    handler.ctx = &ctx;
+
+    for (size_t i = 0; i < chunk->count; i++) {
+        if (ret == RNP_SUCCESS) {
+            /* password infos are wiped out after use, so each message gets a copy */
+            for (list_item *pi = list_front(bctx->passwords); pi; pi = list_next(pi)) {
+                if (!list_append(&ctx.passwords, pi, sizeof(rnp_symmetric_pass_info_t))) {
+                    ret = RNP_ERROR_OUT_OF_MEMORY;
+                    break;
+                }
+            }
+        }
+        if (ret == RNP_SUCCESS) {
+            chunk->items[i].result =
+              encrypt_src(&handler, chunk->keys, chunk->items[i].src, chunk->items[i].dst);
+        } else {
+            chunk->items[i].result = ret;
+        }
+        for (list_item *pi = list_front(ctx.passwords); pi; pi = list_next(pi)) {
+            pgp_forget(pi, sizeof(rnp_symmetric_pass_info_t));
+        }
+        list_destroy(&ctx.passwords);
     }
 
+    rng_destroy(&rng);
+}
+
+rnp_result_t
+rnp_encrypt_batch(pgp_write_handler_t *handler, pgp_encrypt_item_t *items, size_t count)
+{
+    pgp_thread_pool_t *  pool = rnp_ctx_thread_pool(handler->ctx);
+    pgp_encrypt_chunk_t *chunks = NULL;
+    pgp_task_t *         tasks = NULL;
+    list                 keys = NULL;
+    size_t               chunkc;
+    rnp_result_t         ret;
+
+    if (handler->ctx->detached || handler->ctx->clearsign) {
+        RNP_LOG("detached or cleartext signature cannot be encrypted");
+        return RNP_ERROR_BAD_PARAMETERS;
+    }
+    if (!count) {
+        return RNP_SUCCESS;
+    }
+
+    /* recipients are resolved once, from the calling thread since key provider is not
+     * thread-safe */
+    if ((ret = encrypted_resolve_recipients(handler, &keys))) {
+        return ret;
+    }
+
+    chunkc = pgp_thread_pool_size(pool) * 4;
+    if (chunkc > count) {
+        chunkc = count;
+    }
+    chunks = calloc(chunkc, sizeof(*chunks));
+    tasks = calloc(chunkc, sizeof(*tasks));
+    if (!chunks || !tasks) {
+        RNP_LOG("allocation failed");
+        ret = RNP_ERROR_OUT_OF_MEMORY;
+        goto finish;
+    }
+
+    for (size_t i = 0; i < chunkc; i++) {
+        size_t start = count * i / chunkc;
+        chunks[i].handler = handler;
+        chunks[i].keys = keys;
+        chunks[i].items = &items[start];
+        chunks[i].count = count * (i + 1) / chunkc - start;
+        tasks[i] = (pgp_task_t){.func = encrypt_batch_chunk, .param = &chunks[i]};
+    }
+    pgp_thread_pool_run(pool, tasks, chunkc);
     ret = RNP_SUCCESS;
+
+finish:
+    list_destroy(&keys);
+    free(chunks);
+    free(tasks);
+    return ret;
+}
+
+rnp_result_t
+rnp_sign_src(pgp_write_handler_t *handler, pgp_source_t *src, pgp_dest_t *dst)
+{
+    /* stack of the streams would be as following:
+       [armoring stream] - if armoring is enabled
+       [compressing stream, partial writing stream] - if compression is enabled, and not
+       detached
+       signing stream
+       literal data stream, partial writing stream - if not detached
+       Data is hashed once per hash algorithm, and never kept in memory as a whole.
+       Cleartext signed message is written by the single cleartext stream instead.
+    */
+    pgp_dest_t   dests[4];
+    pgp_dest_t * sstream;
+    int          destc = 0;
+    rnp_result_t ret = RNP_ERROR_GENERIC;
+    bool         discard;
+    rnp_ctx_t *  ctx = handler->ctx;
+
+    /* cleartext stream writes the text and the armored signatures on its own */
+    if (ctx->clearsign) {
+        if ((ret = init_cleartext_dst(handler, &dests[destc], dst))) {
+            goto finish;
+        }
+        destc++;
+        ret = process_stream_sequence(src, dests, destc, NULL, &dests[0]);
+        goto finish;
+    }
+
+    /* pushing armoring stream, which will write to the output */
+    if (ctx->armor) {
+        pgp_armored_msg_t msgtype =
+          ctx->detached ? PGP_ARMORED_SIGNATURE : PGP_ARMORED_MESSAGE;
+        if ((ret = init_armored_dst(&dests[destc], dst, msgtype))) {
+            goto finish;
+        }
+        destc++;
+    }
+
+    /* if compression is enabled then pushing compressing stream */
+    if (!ctx->detached && (ctx->zlevel > 0)) {
+        if ((ret = init_compressed_dst(
+               handler, &dests[destc], destc ? &dests[destc - 1] : dst))) {
+            goto finish;
+        }
+        destc++;
+    }
+
+    /* pushing signing stream */
+    if ((ret = init_signed_dst(handler, &dests[destc], destc ? &dests[destc - 1] : dst))) {
+        goto finish;
+    }
+    sstream = &dests[destc++];
+
+    /* pushing literal data stream, if not detached */
+    if (!ctx->detached) {
+        if ((ret = init_literal_dst(handler, &dests[destc], &dests[destc - 1]))) {
+            goto finish;
+        }
+        destc++;
+    }
+
+    ret = process_stream_sequence(
+      src, dests, destc, sstream, ctx->detached ? NULL : &dests[destc - 1]);
 finish:
     discard = ret != RNP_SUCCESS;
     for (int i = destc - 1; i >= 0; i--) {
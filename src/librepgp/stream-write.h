@@ -43,11 +43,42 @@ typedef struct pgp_write_handler_t {
     void *param;
 } pgp_write_handler_t;
 
-/** @brief symmetrically encrypt the input data
+/** @brief encrypt the input data, and sign it in the same pass if handler->ctx->signers
+ *         is not empty
  *  @param handler handler to respond on stream processor callbacks
  *  @param src input source: file, stdin, memory, whatever else conforming to pgp_source_t
  *  @param dst output destination: file, stdout, memory, whatever else conforming to pgp_dest_t
  **/
 rnp_result_t rnp_encrypt_src(pgp_write_handler_t *handler, pgp_source_t *src, pgp_dest_t *dst);
 
+/* single message of the batch encryption */
+typedef struct pgp_encrypt_item_t {
+    pgp_source_t *src;    /* data to encrypt */
+    pgp_dest_t *  dst;    /* destination for the encrypted message */
+    rnp_result_t  result; /* encryption result of this item */
+} pgp_encrypt_item_t;
+
+/** @brief encrypt a batch of messages to the same recipients and passwords
+ *  Recipient keys are requested once, from the calling thread, and messages are encrypted
+ *  on the thread pool of handler->ctx, so sources and destinations of the different items
+ *  are processed concurrently. Each message gets its own session key.
+ *  @param handler handler with key_provider and ctx set, as for rnp_encrypt_src()
+ *  @param items array of items with src and dst initialized. Result is stored in the result
+ *         field, sources and destinations are not closed.
+ *  @param count number of items
+ *  @return RNP_SUCCESS if batch was processed, even if some items failed, or error code
+ **/
+rnp_result_t rnp_encrypt_batch(pgp_write_handler_t *handler,
+                               pgp_encrypt_item_t * items,
+                               size_t               count);
+
+/** @brief sign the input data, attached or detached signature is created depending on the
+ *         ctx->detached flag. Data is processed in a single pass with constant memory usage.
+ *  @param handler handler to respond on stream processor callbacks. Decrypted secret keys
+ *         are taken from the handler->ctx->signers list
+ *  @param src input source: file, stdin, memory, whatever else conforming to pgp_source_t
+ *  @param dst output destination: file, stdout, memory, whatever else conforming to pgp_dest_t
+ **/
+rnp_result_t rnp_sign_src(pgp_write_handler_t *handler, pgp_source_t *src, pgp_dest_t *dst);
+
 #endif
@@ -85,6 +85,8 @@ static const char *usage = "--help OR\n"
                            "\t[--numtries=<attempts>] AND/OR\n"
                            "\t[--userid=<userid>] AND/OR\n"
                            "\t[--maxmemalloc=<number of bytes>] AND/OR\n"
+                           "\t[--threads=<number of threads>] AND/OR\n"
+                           "\t[--direct-io] AND/OR\n"
                            "\t[--verbose]\n";
 
 enum optdefs {
@@ -129,6 +131,8 @@ enum optdefs {
     OPT_ZALG_BZIP,
     OPT_ZLEVEL,
     OPT_OVERWRITE,
+    OPT_THREADS,
+    OPT_DIRECT_IO,
 
     /* debug */
     OPT_DEBUG
@@ -201,6 +205,8 @@ static struct option options[] = {
   {"bzip", no_argument, NULL, OPT_ZALG_BZIP},
   {"bzip2", no_argument, NULL, OPT_ZALG_BZIP},
   {"overwrite", no_argument, NULL, OPT_OVERWRITE},
+  {"threads", required_argument, NULL, OPT_THREADS},
+  {"direct-io", no_argument, NULL, OPT_DIRECT_IO},
 
   {NULL, 0, NULL, 0},
 };
@@ -436,6 +442,8 @@ rnp_cmd(rnp_cfg_t *cfg, rnp_t *rnp, int cmd, char *f)
     rnp_ctx_init(&ctx, rnp);
     ctx.armor = rnp_cfg_getint(cfg, CFG_ARMOR);
     ctx.overwrite = rnp_cfg_getbool(cfg, CFG_OVERWRITE);
+    ctx.threads = rnp_cfg_getint(cfg, CFG_THREADS);
+    ctx.directio = rnp_cfg_getbool(cfg, CFG_DIRECTIO);
     if (f) {
         ctx.filename = strdup(rnp_filename(f));
         ctx.filemtime = rnp_filemtime(f);
@@ -711,6 +719,16 @@ setoption(rnp_cfg_t *cfg, int *cmd, int val, char *arg)
     case OPT_OVERWRITE:
         rnp_cfg_setbool(cfg, CFG_OVERWRITE, true);
         break;
+    case OPT_THREADS:
+        if ((arg == NULL) || (atoi(arg) < 1)) {
+            fputs("Wrong number of threads argument provided\n", stderr);
+            exit(EXIT_ERROR);
+        }
+        rnp_cfg_set(cfg, CFG_THREADS, arg);
+        break;
+    case OPT_DIRECT_IO:
+        rnp_cfg_setbool(cfg, CFG_DIRECTIO, true);
+        break;
     case OPT_DEBUG:
         rnp_set_debug(arg);
         break;
@@ -841,6 +859,11 @@ main(int argc, char **argv)
         }
     }
 
+    /* decryption and verification search keys by keyid only, so parse them on demand */
+    if ((cmd == CMD_DECRYPT) || (cmd == CMD_VERIFY) || (cmd == CMD_VERIFY_CAT)) {
+        rnp_cfg_setbool(&cfg, CFG_LAZYKEYRING, true);
+    }
+
     rnp_params_init(&rnp_params);
     if (!rnp_cfg_apply(&cfg, &rnp_params)) {
         fputs("fatal: cannot apply configuration\n", stderr);
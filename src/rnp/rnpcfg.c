@@ -111,6 +111,13 @@ rnp_cfg_apply(rnp_cfg_t *cfg, rnp_params_t *params)
     /* default key/userid */
     rnp_cfg_get_defkey(cfg, params);
 
+    /* keys are parsed on demand */
+    params->lazy_keyring = rnp_cfg_getbool(cfg, CFG_LAZYKEYRING);
+    /* keyring changes are appended */
+    params->incremental_keyring = rnp_cfg_getbool(cfg, CFG_INCREMENTALKEYRING);
+    /* large keyrings are parsed in parallel */
+    params->keyring_threads = rnp_cfg_getint(cfg, CFG_THREADS);
+
     return true;
 }
 
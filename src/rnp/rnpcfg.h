@@ -67,6 +67,12 @@
 #define CFG_KEYSTORE_DISABLED \
     "disable_keystore"    /* indicates wether keystore must be initialized */
 #define CFG_FORCE "force" /* force command to succeed operation */
+#define CFG_THREADS "threads" /* number of threads used for the operation */
+#define CFG_DIRECTIO "directio"       /* write output file bypassing the page cache */
+#define CFG_LAZYKEYRING "lazykeyring" /* parse keyring keys on demand */
+#define CFG_INCREMENTALKEYRING "incrementalkeyring" /* append keyring changes */
+#define CFG_S2K_ITER "s2k-iterations" /* number of S2K iterations for key protection */
+#define CFG_S2K_MSEC "s2k-msec"       /* desired key protection S2K time in milliseconds */
 
 /* rnp CLI config : contains all the system-dependent and specified by the user configuration
  * options */
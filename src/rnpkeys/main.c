@@ -94,6 +94,12 @@ main(int argc, char **argv)
         }
     }
 
+    /* imported keys are looked up by grip and appended to the keyrings */
+    if (cmd == CMD_IMPORT_KEY) {
+        rnp_cfg_setbool(&opt_cfg, CFG_LAZYKEYRING, true);
+        rnp_cfg_setbool(&opt_cfg, CFG_INCREMENTALKEYRING, true);
+    }
+
     rnp_cfg_t cfg = {0};
     if (!rnpkeys_init(&cfg, &rnp, &opt_cfg, true)) {
         return EXIT_ERROR;
@@ -105,6 +111,12 @@ main(int argc, char **argv)
         if (!rnp_cmd(&cfg, &rnp, cmd, NULL)) {
             ret = EXIT_FAILURE;
         }
+    } else if (cmd == CMD_IMPORT_KEY) {
+        /* all of the files are imported at once, so keyrings are written once */
+        if (!rnp_import_keys(
+              &rnp, &argv[optind], argc - optind, rnp_cfg_getint(&cfg, CFG_THREADS))) {
+            ret = EXIT_FAILURE;
+        }
     } else {
         for (int i = optind; i < argc; i++) {
             if (!rnp_cmd(&cfg, &rnp, cmd, argv[i])) {
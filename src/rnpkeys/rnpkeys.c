@@ -35,6 +35,7 @@
 #include <string.h>
 #include <rnp/rnp.h>
 #include "crypto.h"
+#include "crypto/s2k.h"
 #include <rnp/rnp_def.h>
 #include "../rnp/rnpcfg.h"
 #include "rnpkeys.h"
@@ -62,6 +63,9 @@ const char *usage = "--help OR\n"
                     "\t[--keyring=<keyring>] AND/OR\n"
                     "\t[--output=file] file OR\n"
                     "\t[--keystore-format=<format>] AND/OR\n"
+                    "\t[--s2k-iterations=<number>] AND/OR\n"
+                    "\t[--s2k-msec=<milliseconds>] AND/OR\n"
+                    "\t[--threads=<number of threads>] AND/OR\n"
                     "\t[--userid=<userid>] AND/OR\n"
                     "\t[--verbose]\n";
 
@@ -107,9 +111,33 @@ struct option options[] = {
   {"expert", no_argument, NULL, OPT_EXPERT},
   {"output", required_argument, NULL, OPT_OUTPUT},
   {"force", no_argument, NULL, OPT_FORCE},
+  {"s2k-iterations", required_argument, NULL, OPT_S2K_ITER},
+  {"s2k-msec", required_argument, NULL, OPT_S2K_MSEC},
+  {"threads", required_argument, NULL, OPT_THREADS},
   {NULL, 0, NULL, 0},
 };
 
+/* set S2K iterations of the key protection, explicitly given or calibrated for the time */
+static bool
+set_protection_iterations(rnp_cfg_t *cfg, rnp_key_protection_params_t *protection)
+{
+    int            iterations = rnp_cfg_getint(cfg, CFG_S2K_ITER);
+    int            msec = rnp_cfg_getint(cfg, CFG_S2K_MSEC);
+    pgp_hash_alg_t halg = protection->hash_alg;
+
+    if (!iterations && msec) {
+        if (halg == PGP_HASH_UNKNOWN) {
+            halg = PGP_DEFAULT_HASH_ALGORITHM;
+        }
+        if (!(iterations = pgp_s2k_compute_iters(halg, msec, 0))) {
+            (void) fprintf(stderr, "Failed to calculate S2K iterations\n");
+            return false;
+        }
+    }
+    protection->iterations = iterations;
+    return true;
+}
+
 /* match keys, decoding from json if we do find any */
 static int
 match_keys(rnp_cfg_t *cfg, rnp_t *rnp, FILE *fp, char *f, const int psigs)
@@ -225,6 +253,10 @@ rnp_cmd(rnp_cfg_t *cfg, rnp_t *rnp, optdefs_t cmd, char *f)
             RNP_LOG("Critical error: Key generation failed");
             return false;
         }
+        if (!set_protection_iterations(cfg, &action->primary.protection) ||
+            !set_protection_iterations(cfg, &action->subkey.protection)) {
+            return false;
+        }
         return rnp_generate_key(rnp);
     case CMD_GET_KEY:
         key = rnp_get_key(rnp, f, rnp_cfg_get(cfg, CFG_KEYFORMAT));
@@ -357,6 +389,27 @@ setoption(rnp_cfg_t *cfg, optdefs_t *cmd, int val, char *arg)
     case OPT_FORCE:
         rnp_cfg_setbool(cfg, CFG_FORCE, true);
         break;
+    case OPT_S2K_ITER:
+        if ((arg == NULL) || (atoi(arg) <= 0)) {
+            (void) fprintf(stderr, "Wrong number of S2K iterations provided\n");
+            exit(EXIT_ERROR);
+        }
+        rnp_cfg_set(cfg, CFG_S2K_ITER, arg);
+        break;
+    case OPT_S2K_MSEC:
+        if ((arg == NULL) || (atoi(arg) <= 0)) {
+            (void) fprintf(stderr, "Wrong S2K time provided\n");
+            exit(EXIT_ERROR);
+        }
+        rnp_cfg_set(cfg, CFG_S2K_MSEC, arg);
+        break;
+    case OPT_THREADS:
+        if ((arg == NULL) || (atoi(arg) < 1)) {
+            (void) fprintf(stderr, "Wrong number of threads argument provided\n");
+            exit(EXIT_ERROR);
+        }
+        rnp_cfg_set(cfg, CFG_THREADS, arg);
+        break;
     default:
         *cmd = CMD_HELP;
         break;
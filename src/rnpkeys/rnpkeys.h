@@ -38,6 +38,9 @@ typedef enum {
     OPT_EXPERT,
     OPT_OUTPUT,
     OPT_FORCE,
+    OPT_S2K_ITER,
+    OPT_S2K_MSEC,
+    OPT_THREADS,
 
     /* debug */
     OPT_DEBUG
@@ -36,10 +36,13 @@
 #include <crypto/ecdh.h>
 #include <crypto/rng.h>
 #include <crypto/sm2.h>
+#include <botan/ffi.h>
+#include <time.h>
 
 #include "rnp_tests.h"
 #include "support.h"
 #include "fingerprint.h"
+#include "thread-pool.h"
 
 extern rng_t global_rng;
 
@@ -91,6 +94,60 @@ hash_test_success(void **state)
     }
 }
 
+void
+hash_list_test_success(void **state)
+{
+    const pgp_hash_alg_t halgs[] = {PGP_HASH_SHA1, PGP_HASH_SHA256, PGP_HASH_SHA512};
+    const size_t         lens[] = {0, 1, 1000, PGP_HASH_BLOCK_SIZE + 1, 100000};
+    const size_t         maxlen = 100000;
+    uint8_t *            data = calloc(1, maxlen);
+    uint8_t              expected[PGP_MAX_HASH_SIZE];
+    uint8_t              actual[PGP_MAX_HASH_SIZE];
+
+    assert_non_null(data);
+    for (size_t i = 0; i < maxlen; i++) {
+        data[i] = i * 13 + (i >> 9);
+    }
+
+    /* serial and parallel single-pass update must be the same as separate hashes */
+    for (unsigned threads = 1; threads <= 4; threads += 3) {
+        pgp_thread_pool_t *pool = pgp_thread_pool_create(threads);
+
+        for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+            list hashes = NULL;
+
+            for (size_t h = 0; h < sizeof(halgs) / sizeof(halgs[0]); h++) {
+                assert_true(pgp_hash_list_add(&hashes, halgs[h]));
+            }
+            /* second call must not add the same hash */
+            assert_true(pgp_hash_list_add(&hashes, PGP_HASH_SHA256));
+            assert_int_equal(list_length(hashes), 3);
+
+            pgp_hash_list_update_parallel(hashes, data, lens[l], pool);
+            pgp_hash_list_update(hashes, data, lens[l]);
+
+            for (size_t h = 0; h < sizeof(halgs) / sizeof(halgs[0]); h++) {
+                pgp_hash_t        hash = {0};
+                pgp_hash_t        copy = {0};
+                const pgp_hash_t *listed = pgp_hash_list_get(hashes, halgs[h]);
+
+                assert_non_null(listed);
+                assert_true(pgp_hash_create(&hash, halgs[h]));
+                pgp_hash_add(&hash, data, lens[l]);
+                pgp_hash_add(&hash, data, lens[l]);
+                size_t len = pgp_hash_finish(&hash, expected);
+                assert_true(pgp_hash_copy(&copy, listed));
+                assert_int_equal(pgp_hash_finish(&copy, actual), len);
+                assert_memory_equal(expected, actual, len);
+            }
+            pgp_hash_list_free(&hashes);
+        }
+        pgp_thread_pool_destroy(pool);
+    }
+
+    free(data);
+}
+
 void
 cipher_test_success(void **state)
 {
@@ -128,6 +185,153 @@ cipher_test_success(void **state)
     rnp_assert_int_equal(rstate, 0, pgp_cipher_finish(&crypt));
 }
 
+/* reference CFB decryption with one cipher call per block, len must be multiple of block */
+static void
+cfb_decrypt_blockwise(pgp_crypt_t *crypt, uint8_t *out, const uint8_t *in, size_t len)
+{
+    size_t  blsize = crypt->blocksize;
+    uint8_t ks[PGP_MAX_BLOCK_SIZE];
+
+    for (size_t pos = 0; pos < len; pos += blsize) {
+        botan_block_cipher_encrypt_blocks(crypt->obj, crypt->iv, ks, 1);
+        memcpy(crypt->iv, in + pos, blsize);
+        for (size_t i = 0; i < blsize; i++) {
+            out[pos + i] = in[pos + i] ^ ks[i];
+        }
+    }
+}
+
+void
+cipher_cfb_bulk_decrypt(void **state)
+{
+    rnp_test_state_t *   rstate = *state;
+    const pgp_symm_alg_t algs[] = {PGP_SA_IDEA,
+                                   PGP_SA_TRIPLEDES,
+                                   PGP_SA_CAST5,
+                                   PGP_SA_BLOWFISH,
+                                   PGP_SA_AES_128,
+                                   PGP_SA_AES_192,
+                                   PGP_SA_AES_256,
+                                   PGP_SA_TWOFISH,
+                                   PGP_SA_CAMELLIA_128,
+                                   PGP_SA_CAMELLIA_192,
+                                   PGP_SA_CAMELLIA_256,
+                                   PGP_SA_SM4};
+    const size_t         len = 1048576;
+    uint8_t              key[PGP_MAX_KEY_SIZE];
+    uint8_t              iv[PGP_MAX_BLOCK_SIZE];
+    pgp_crypt_t          crypt;
+    uint8_t *            enc = malloc(len);
+    uint8_t *            dec = malloc(len);
+    uint8_t *            ref = malloc(len);
+
+    assert_non_null(enc);
+    assert_non_null(dec);
+    assert_non_null(ref);
+    assert_true(rng_get_data(&global_rng, key, sizeof(key)));
+    assert_true(rng_get_data(&global_rng, iv, sizeof(iv)));
+    assert_true(rng_get_data(&global_rng, enc, len));
+
+    for (size_t a = 0; a < ARRAY_SIZE(algs); a++) {
+        clock_t start, bulk, blockwise;
+
+        if (!pgp_is_sa_supported(algs[a])) {
+            continue;
+        }
+
+        rnp_assert_true(rstate, pgp_cipher_start(&crypt, algs[a], key, iv));
+        start = clock();
+        rnp_assert_int_equal(rstate, 0, pgp_cipher_cfb_decrypt(&crypt, dec, enc, len));
+        bulk = clock() - start;
+        pgp_cipher_finish(&crypt);
+
+        rnp_assert_true(rstate, pgp_cipher_start(&crypt, algs[a], key, iv));
+        start = clock();
+        cfb_decrypt_blockwise(&crypt, ref, enc, len);
+        blockwise = clock() - start;
+        pgp_cipher_finish(&crypt);
+
+        rnp_assert_int_equal(rstate, 0, memcmp(dec, ref, len));
+#if defined(DEBUG_PRINT)
+        printf("cipher %2d CFB decrypt: bulk %.2f MB/sec, per-block %.2f MB/sec\n",
+               (int) algs[a],
+               len / 1048576.0 / ((double) (bulk + 1) / CLOCKS_PER_SEC),
+               len / 1048576.0 / ((double) (blockwise + 1) / CLOCKS_PER_SEC));
+#else
+        (void) bulk;
+        (void) blockwise;
+#endif
+    }
+
+    free(enc);
+    free(dec);
+    free(ref);
+}
+
+void
+cipher_cfb_parallel_decrypt(void **state)
+{
+    rnp_test_state_t * rstate = *state;
+    const pgp_symm_alg_t algs[] = {
+      PGP_SA_AES_128, PGP_SA_AES_256, PGP_SA_CAST5, PGP_SA_TWOFISH};
+    const size_t         sizes[] = {200000, 1048576 + 13};
+    const size_t         head = 5;
+    uint8_t              key[PGP_MAX_KEY_SIZE];
+    uint8_t              iv[PGP_MAX_BLOCK_SIZE];
+    pgp_crypt_t          crypt;
+    pgp_thread_pool_t *  pool = pgp_thread_pool_create(4);
+
+    for (size_t a = 0; a < ARRAY_SIZE(algs); a++) {
+        for (size_t s = 0; s < ARRAY_SIZE(sizes); s++) {
+            size_t   len = sizes[s];
+            uint8_t *plain = malloc(len);
+            uint8_t *enc = malloc(len);
+            uint8_t *dec = malloc(len);
+            assert_non_null(plain);
+            assert_non_null(enc);
+            assert_non_null(dec);
+
+            assert_true(rng_get_data(&global_rng, key, sizeof(key)));
+            assert_true(rng_get_data(&global_rng, iv, sizeof(iv)));
+            assert_true(rng_get_data(&global_rng, plain, len));
+
+            rnp_assert_true(rstate, pgp_cipher_start(&crypt, algs[a], key, iv));
+            rnp_assert_int_equal(rstate, 0, pgp_cipher_cfb_encrypt(&crypt, enc, plain, len));
+            pgp_cipher_finish(&crypt);
+
+            /* out of place, starting from the middle of the block */
+            rnp_assert_true(rstate, pgp_cipher_start(&crypt, algs[a], key, iv));
+            rnp_assert_int_equal(rstate, 0, pgp_cipher_cfb_decrypt(&crypt, dec, enc, head));
+            rnp_assert_int_equal(
+              rstate,
+              0,
+              pgp_cipher_cfb_decrypt_parallel(
+                &crypt, dec + head, enc + head, len - head, pool));
+            pgp_cipher_finish(&crypt);
+            rnp_assert_int_equal(rstate, 0, memcmp(dec, plain, len));
+
+            /* in place, in two chunks to check the cipher state */
+            rnp_assert_true(rstate, pgp_cipher_start(&crypt, algs[a], key, iv));
+            size_t half = len / 2;
+            rnp_assert_int_equal(
+              rstate, 0, pgp_cipher_cfb_decrypt_parallel(&crypt, enc, enc, half, pool));
+            rnp_assert_int_equal(
+              rstate,
+              0,
+              pgp_cipher_cfb_decrypt_parallel(
+                &crypt, enc + half, enc + half, len - half, pool));
+            pgp_cipher_finish(&crypt);
+            rnp_assert_int_equal(rstate, 0, memcmp(enc, plain, len));
+
+            free(plain);
+            free(enc);
+            free(dec);
+        }
+    }
+
+    pgp_thread_pool_destroy(pool);
+}
+
 void
 pkcs1_rsa_test_success(void **state)
 {
@@ -257,8 +461,8 @@ raw_elg_test_success(void **state)
       0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFD, 0xC7,
     };
 
-    pgp_elgamal_pubkey_t pub_elg;
-    pgp_elgamal_seckey_t sec_elg;
+    pgp_elgamal_pubkey_t pub_elg = {0};
+    pgp_elgamal_seckey_t sec_elg = {0};
     uint8_t              encm[64];
     uint8_t              g_to_k[64];
     uint8_t              decryption_result[1024];
@@ -329,12 +533,76 @@ raw_elg_test_success(void **state)
       test_value_equal("ElGamal decrypt", "0102030417", decryption_result, sizeof(plaintext)));
 
     // Free heap
+    pgp_pk_cache_destroy(&pub_elg.cache);
+    pgp_pk_cache_destroy(&sec_elg.cache);
     bn_clear_free(pub_elg.p);
     bn_clear_free(pub_elg.g);
     bn_clear_free(sec_elg.x);
     bn_clear_free(pub_elg.y);
 }
 
+void
+rnp_test_pk_cache(void **state)
+{
+    uint8_t hash[32] = {0};
+    uint8_t sig[1024 / 8];
+    uint8_t ctext[1024 / 8];
+    uint8_t ptext[1024 / 8];
+    int     sig_size;
+
+    const rnp_keygen_crypto_params_t key_desc = {.key_alg = PGP_PKA_RSA,
+                                                 .hash_alg = PGP_HASH_SHA256,
+                                                 .rsa = {.modulus_bit_len = 1024},
+                                                 .rng = &global_rng};
+    pgp_seckey_t *seckey = calloc(1, sizeof(*seckey));
+    assert_non_null(seckey);
+    assert_true(pgp_generate_seckey(&key_desc, seckey));
+
+    const pgp_rsa_pubkey_t *pub_rsa = &seckey->pubkey.key.rsa;
+    const pgp_rsa_seckey_t *sec_rsa = &seckey->key.rsa;
+    assert_null(pub_rsa->cache);
+    assert_null(sec_rsa->cache);
+
+    // repeated operations reuse the cached keys, including after the failed ones
+    for (int i = 0; i < 3; i++) {
+        hash[0] = i;
+        sig_size = pgp_rsa_pkcs1_sign_hash(&global_rng,
+                                           sig,
+                                           sizeof(sig),
+                                           PGP_HASH_SHA256,
+                                           hash,
+                                           sizeof(hash),
+                                           sec_rsa,
+                                           pub_rsa);
+        assert_int_equal(sig_size, sizeof(sig));
+        assert_true(pgp_rsa_pkcs1_verify_hash(
+          &global_rng, sig, sig_size, PGP_HASH_SHA256, hash, sizeof(hash), pub_rsa));
+        hash[1] ^= 0xff;
+        assert_false(pgp_rsa_pkcs1_verify_hash(
+          &global_rng, sig, sig_size, PGP_HASH_SHA256, hash, sizeof(hash), pub_rsa));
+        hash[1] ^= 0xff;
+
+        assert_int_equal(
+          pgp_rsa_encrypt_pkcs1(&global_rng, ctext, sizeof(ctext), hash, 16, pub_rsa),
+          sizeof(ctext));
+        assert_int_equal(
+          pgp_rsa_decrypt_pkcs1(
+            &global_rng, ptext, sizeof(ptext), ctext, sizeof(ctext), sec_rsa, pub_rsa),
+          16);
+        assert_memory_equal(ptext, hash, 16);
+    }
+    assert_non_null(pub_rsa->cache);
+    assert_non_null(sec_rsa->cache);
+
+    // secret part is dropped together with the secret key material, i.e. on key lock
+    pgp_seckey_free_secret_mpis(seckey);
+    assert_null(sec_rsa->cache);
+    assert_non_null(pub_rsa->cache);
+
+    pgp_seckey_free(seckey);
+    free(seckey);
+}
+
 void
 ecdsa_signverify_success(void **state)
 {
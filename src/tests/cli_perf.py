@@ -95,10 +95,12 @@ def run_iterated(iterations, func, src, dst, *args):
     #print '{} average run time: {}'.format(func.__name__, res)
     return res
 
-def rnp_symencrypt_file(src, dst, cipher, zlevel = 6, zalgo = 'zip', armor = False):
+def rnp_symencrypt_file(src, dst, cipher, zlevel = 6, zalgo = 'zip', armor = False, s2khash = None):
     params = ['--homedir', RNPDIR, '--password', PASSWORD, '--cipher', cipher, '-z', str(zlevel), '--' + zalgo, '-c', src, '--output', dst]
     if armor:
         params += ['--armor']
+    if s2khash:
+        params += ['--hash', s2khash]
     ret = run_proc_fast(RNP, params)
     if ret != 0:
         raise_err('rnp symmetric encryption failed')
@@ -108,10 +110,13 @@ def rnp_decrypt_file(src, dst):
     if ret != 0:
         raise_err('rnp decryption failed')
 
-def gpg_symencrypt_file(src, dst, cipher = 'AES', zlevel = 6, zalgo = 1, armor = False):
+def gpg_symencrypt_file(src, dst, cipher = 'AES', zlevel = 6, zalgo = 1, armor = False, s2khash = None):
     params = ['--homedir', GPGDIR, '-c', '-z', str(zlevel), '--s2k-count', '524288', '--compress-algo', str(zalgo), '--batch', '--passphrase', PASSWORD, '--cipher-algo', cipher, '--output', dst, src]
     if armor:
         params.insert(2, '--armor')
+    if s2khash:
+        params.insert(2, '--s2k-digest-algo')
+        params.insert(3, s2khash)
     ret = run_proc_fast(GPG, params)
     if ret != 0:
         raise_err('gpg symmetric encryption failed for cipher ' + cipher)
@@ -246,6 +251,17 @@ class Benchmark(object):
         # 6. Detached signature
         #print '\n#6. Detached signing and verification\n'
 
+    def s2k_key_derivation(self):
+        '''
+        S2K key derivation with 524288 iterations, per hash algorithm
+        '''
+        # small file encryption time is dominated by the password-based key derivation
+        infile, rnpout, gpgout, iterations, fsize = get_file_params('small')
+        for s2khash in ['SHA1', 'SHA256', 'SHA512']:
+            tmrnp = run_iterated(iterations, rnp_symencrypt_file, infile, rnpout, 'AES128', 0, 'zip', False, s2khash)
+            tmgpg = run_iterated(iterations, gpg_symencrypt_file, infile, gpgout, 'AES128', 0, 1, False, s2khash)
+            print_test_results(fsize, tmrnp, tmgpg, 'S2K-{}'.format(s2khash))
+
 # Usage ./cli_perf.py [working_directory]
 #
 # It's better to use RAMDISK to perform tests
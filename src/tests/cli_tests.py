@@ -738,6 +738,31 @@ class Keystore(unittest.TestCase):
         ret, out, err = run_proc(GPG, ['--batch', '--homedir', GPGDIR, '--import', pubpath])
         if ret != 0: raise_err('gpg : public key import failed', err)
 
+    def test_generate_key_s2k_iterations(self):
+        '''
+        Generate keys with explicit and calibrated S2K iterations of the secret key protection
+        '''
+        for s2kparams, mincount in [(['--s2k-iterations', '1000000'], 1000000),
+                                    (['--s2k-msec', '50'], 65536)]:
+            clear_keyrings()
+            pipe = pswd_pipe(PASSWORD)
+            ret, out, err = run_proc(RNPK, s2kparams + ['--homedir', RNPDIR, '--pass-fd', str(pipe),
+                                                        '--userid', 's2k@rnp', '--generate-key'])
+            os.close(pipe)
+            if ret != 0: raise_err('key generation failed', err)
+            # Both primary key and subkey must use the same count
+            ret, out, err = run_proc(GPG, ['--list-packets', path.join(RNPDIR, 'secring.gpg')])
+            if ret != 0: raise_err('gpg : packet listing failed', err)
+            counts = re.findall(r'protect count: (\d+)', out)
+            if len(counts) != 2 or counts[0] != counts[1] or int(counts[0]) < mincount:
+                raise_err('wrong protect count', out)
+            # Key must be usable with the password
+            src, dst = reg_workfiles('s2k', '.txt', '.sig')
+            random_text(src, 1000)
+            rnp_sign_file(src, dst, 's2k@rnp')
+            clear_workfiles()
+        clear_keyrings()
+
 
 class Misc(unittest.TestCase):
 
@@ -796,6 +821,56 @@ class Misc(unittest.TestCase):
             rnp_encryption_s2k_gpg(ciphers[i % len(ciphers)], hashes[
                                 i % len(hashes)], s2kmodes[i % len(s2kmodes)])
 
+    def test_encryption_threads(self):
+        src, dst, dec = reg_workfiles('cleartext', '.txt', '.gpg', '.rnp')
+        random_text(src, 1000000)
+
+        # Compression, encryption and armoring are pipelined between the threads
+        for threads in [2, 3, 4]:
+            for zlevel, armor in [(6, True), (6, False), (0, True), (0, False)]:
+                pipe = pswd_pipe(PASSWORD)
+                params = ['--homedir', RNPDIR, '--pass-fd', str(pipe), '--threads', str(threads),
+                          '-z', str(zlevel), '-c', src, '--output', dst]
+                if armor:
+                    params += ['--armor']
+                ret, _, err = run_proc(RNP, params)
+                os.close(pipe)
+                if ret != 0:
+                    raise_err('rnp pipelined encryption failed', err)
+                gpg_decrypt_file(dst, dec, PASSWORD)
+                compare_files(src, dec, 'gpg decrypted data differs')
+                remove_files(dst, dec)
+
+        # Blocks are compressed in parallel and joined into the single stream
+        for zalgo in ['zip', 'zlib', 'bzip2']:
+            for zlevel in [1, 9]:
+                pipe = pswd_pipe(PASSWORD)
+                params = ['--homedir', RNPDIR, '--pass-fd', str(pipe), '--threads', '4',
+                          '--' + zalgo, '-z', str(zlevel), '-c', src, '--output', dst]
+                ret, _, err = run_proc(RNP, params)
+                os.close(pipe)
+                if ret != 0:
+                    raise_err('rnp parallel compression failed', err)
+                gpg_decrypt_file(dst, dec, PASSWORD)
+                compare_files(src, dec, 'gpg decrypted data differs')
+                remove_files(dst, dec)
+
+    def test_encryption_direct_io(self):
+        src, dst, dec = reg_workfiles('cleartext', '.txt', '.gpg', '.rnp')
+        random_text(src, 3000000)
+
+        # Output is written bypassing the page cache, or in a usual way if not supported
+        pipe = pswd_pipe(PASSWORD)
+        params = ['--homedir', RNPDIR, '--pass-fd', str(pipe), '--direct-io', '-z', '0', '-c',
+                  src, '--output', dst]
+        ret, _, err = run_proc(RNP, params)
+        os.close(pipe)
+        if ret != 0:
+            raise_err('rnp encryption with direct I/O failed', err)
+        gpg_decrypt_file(dst, dec, PASSWORD)
+        compare_files(src, dec, 'gpg decrypted data differs')
+        remove_files(dst, dec)
+
     def test_armor(self):
         src_beg, dst_beg, dst_mid, dst_fin = reg_workfiles('beg','.src','.dst', '.mid.dst', '.fin.dst')
 
@@ -931,6 +1006,50 @@ class SignDefault(Sign):
             rnp_detached_signing_rnp_to_gpg(size)
             rnp_cleartext_signing_rnp_to_gpg(size)
 
+    def test_rnp_streamed_signing(self):
+        src, sig, ver = reg_workfiles('cleartext', '.txt', '.gpg', '.ver')
+        random_text(src, 3000000)
+
+        # Data is hashed while it is compressed and written, in a single pass
+        for threads in [1, 4]:
+            for zlevel, armor in [(6, True), (0, False)]:
+                pipe = pswd_pipe(PASSWORD)
+                params = ['--homedir', RNPDIR, '--pass-fd', str(pipe), '--threads', str(threads),
+                          '-z', str(zlevel), '--userid', KEY_SIGN_RNP, '--sign', src,
+                          '--output', sig]
+                if armor:
+                    params += ['--armor']
+                ret, _, err = run_proc(RNP, params)
+                os.close(pipe)
+                if ret != 0:
+                    raise_err('rnp streamed signing failed', err)
+                gpg_verify_file(sig, ver, KEY_SIGN_RNP)
+                compare_files(src, ver, 'gpg verified data differs')
+                remove_files(sig, ver)
+
+    def test_rnp_streamed_cleartext_signing(self):
+        src, asc = reg_workfiles('cleartext', '.txt', '.txt.asc')
+        # Dash-escaped lines, trailing whitespaces, CRLF and lines longer then the text block
+        lines = ['-----BEGIN PGP SIGNATURE-----', '- dash', 'trailing \t ', 'crlf\r', '',
+                 'x' * 100000, 'y' * 40000 + ' ' * 1000, '-' * 70000]
+        with open(src, 'w+') as f:
+            for i in range(200):
+                f.write('\n'.join(lines))
+                f.write('\n')
+            f.write('last line without eol  ')
+
+        for threads in [1, 4]:
+            pipe = pswd_pipe(PASSWORD)
+            ret, _, err = run_proc(RNP, ['--homedir', RNPDIR, '--pass-fd', str(pipe),
+                                         '--threads', str(threads), '--userid', KEY_SIGN_RNP,
+                                         '--output', asc, '--clearsign', src])
+            os.close(pipe)
+            if ret != 0:
+                raise_err('rnp streamed cleartext signing failed', err)
+            rnp_verify_cleartext(asc, KEY_SIGN_RNP)
+            gpg_verify_cleartext(asc, KEY_SIGN_RNP)
+            remove_files(asc)
+
     def test_gpg_to_rnp_default_key(self):
         for size in Sign.SIZES:
             rnp_signing_gpg_to_rnp(size)
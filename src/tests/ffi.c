@@ -634,7 +634,7 @@ test_ffi_keygen_json_sub_pass_required(void **state)
     parsed_results = NULL;
 
     // protect+lock the primary key
-    assert_int_equal(RNP_SUCCESS, rnp_key_protect(primary, "pass123"));
+    assert_int_equal(RNP_SUCCESS, rnp_key_protect(primary, "pass123", NULL, NULL, 0));
     assert_int_equal(RNP_SUCCESS, rnp_key_lock(primary));
     rnp_key_handle_free(&primary);
     primary = NULL;
@@ -720,6 +720,51 @@ test_ffi_keygen_json_sub_pass_required(void **state)
     rnp_ffi_destroy(ffi);
 }
 
+void
+test_ffi_protect_iterations(void **state)
+{
+    rnp_ffi_t        ffi = NULL;
+    rnp_keyring_t    secring;
+    rnp_key_handle_t key = NULL;
+    size_t           fast = 0;
+    size_t           slow = 0;
+    bool             locked = false;
+
+    // calibration
+    assert_int_not_equal(RNP_SUCCESS, rnp_calculate_iterations("SHA256", 10, NULL));
+    assert_int_not_equal(RNP_SUCCESS, rnp_calculate_iterations("WRONG", 10, &fast));
+    assert_int_equal(RNP_SUCCESS, rnp_calculate_iterations("SHA256", 1, &fast));
+    assert_int_equal(RNP_SUCCESS, rnp_calculate_iterations(NULL, 20, &slow));
+    assert_true(fast >= 65536);
+    assert_true(slow >= fast);
+
+    // setup FFI
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_create(&ffi, "GPG", "GPG"));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_secring(ffi, &secring));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path(secring, "data/keyrings/1/secring.gpg"));
+    assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "userid", "key0-uid0", &key));
+    assert_int_equal(RNP_SUCCESS, rnp_key_unlock(key, "password"));
+
+    // wrong parameters
+    assert_int_not_equal(RNP_SUCCESS, rnp_key_protect(key, "pass", "WRONG", NULL, 0));
+    assert_int_not_equal(RNP_SUCCESS, rnp_key_protect(key, "pass", NULL, "WRONG", 0));
+
+    // protect with the calibrated iterations and unlock with the new password
+    assert_int_equal(RNP_SUCCESS, rnp_key_protect(key, "pass", "AES128", "SHA256", slow));
+    assert_int_equal(RNP_SUCCESS, rnp_key_lock(key));
+    assert_int_equal(RNP_SUCCESS, rnp_key_is_locked(key, &locked));
+    assert_true(locked);
+    assert_int_not_equal(RNP_SUCCESS, rnp_key_unlock(key, "password"));
+    assert_int_equal(RNP_SUCCESS, rnp_key_unlock(key, "pass"));
+    assert_int_equal(RNP_SUCCESS, rnp_key_is_locked(key, &locked));
+    assert_false(locked);
+
+    // cleanup
+    rnp_key_handle_free(&key);
+    rnp_ffi_destroy(ffi);
+}
+
 void
 test_ffi_encrypt_pass(void **state)
 {
@@ -959,3 +1004,517 @@ test_ffi_encrypt_pk(void **state)
     // final cleanup
     rnp_ffi_destroy(ffi);
 }
+
+void
+test_ffi_encrypt_batch(void **state)
+{
+    rnp_ffi_t        ffi = NULL;
+    rnp_keyring_t    pubring, secring;
+    rnp_op_encrypt_t op = NULL;
+    rnp_key_handle_t key = NULL;
+    const char *     plaintexts[] = {
+      "record 0", "record 1", "record 2", "record 3", "record 4"};
+    const size_t     count = sizeof(plaintexts) / sizeof(plaintexts[0]);
+    const size_t     threads[] = {1, 4};
+    rnp_input_t      inputs[count];
+    rnp_output_t     outputs[count];
+    rnp_result_t     results[count];
+    char             name[32];
+
+    // setup FFI
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_create(&ffi, "GPG", "GPG"));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_pubring(ffi, &pubring));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_secring(ffi, &secring));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path(pubring, "data/keyrings/1/pubring.gpg"));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path(secring, "data/keyrings/1/secring.gpg"));
+
+    // batch operation is created without input and output
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_create(&op, ffi, NULL, NULL));
+    assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "userid", "key0-uid2", &key));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_add_recipient(op, key));
+    assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "userid", "key1-uid1", &key));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_add_recipient(op, key));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_set_cipher(op, "AES256"));
+
+    // empty batch
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_op_encrypt_execute_batch(op, NULL, NULL, 0, 1, NULL));
+    assert_int_not_equal(RNP_SUCCESS,
+                         rnp_op_encrypt_execute_batch(op, NULL, NULL, 1, 1, NULL));
+
+    // the same operation is executed for several batches
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        for (size_t i = 0; i < count; i++) {
+            assert_int_equal(RNP_SUCCESS,
+                             rnp_input_from_memory(&inputs[i],
+                                                   (const uint8_t *) plaintexts[i],
+                                                   strlen(plaintexts[i])));
+            snprintf(name, sizeof(name), "encrypted%zu", i);
+            assert_int_equal(RNP_SUCCESS, rnp_output_to_file(&outputs[i], name));
+            results[i] = RNP_ERROR_GENERIC;
+        }
+
+        assert_int_equal(
+          RNP_SUCCESS,
+          rnp_op_encrypt_execute_batch(op, inputs, outputs, count, threads[t], results));
+
+        for (size_t i = 0; i < count; i++) {
+            assert_int_equal(results[i], RNP_SUCCESS);
+            rnp_input_destroy(inputs[i]);
+            rnp_output_destroy(outputs[i]);
+        }
+
+        // decrypt every message
+        assert_int_equal(RNP_SUCCESS, rnp_ffi_set_pass_provider(ffi, getpasscb, "password"));
+        for (size_t i = 0; i < count; i++) {
+            rnp_input_t  input = NULL;
+            rnp_output_t output = NULL;
+            pgp_memory_t mem = {0};
+
+            snprintf(name, sizeof(name), "encrypted%zu", i);
+            assert_int_equal(RNP_SUCCESS, rnp_input_from_file(&input, name));
+            assert_int_equal(RNP_SUCCESS, rnp_output_to_file(&output, "decrypted"));
+            assert_int_equal(RNP_SUCCESS, rnp_decrypt(ffi, input, output));
+            rnp_input_destroy(input);
+            rnp_output_destroy(output);
+
+            assert_true(pgp_mem_readfile(&mem, "decrypted"));
+            assert_int_equal(mem.length, strlen(plaintexts[i]));
+            assert_true(memcmp(mem.buf, plaintexts[i], mem.length) == 0);
+            pgp_memory_release(&mem);
+            unlink("decrypted");
+            unlink(name);
+        }
+    }
+
+    // cleanup
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_destroy(op));
+    rnp_ffi_destroy(ffi);
+}
+
+static void
+check_decrypt_pass(rnp_ffi_t ffi, const char *pass, const char *plaintext, bool success)
+{
+    rnp_input_t  input = NULL;
+    rnp_output_t output = NULL;
+    pgp_memory_t mem = {0};
+
+    assert_int_equal(RNP_SUCCESS, rnp_input_from_file(&input, "encrypted"));
+    assert_int_equal(RNP_SUCCESS, rnp_output_to_file(&output, "decrypted"));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_set_pass_provider(ffi, getpasscb_once, &pass));
+    assert_int_equal(success, rnp_decrypt(ffi, input, output) == RNP_SUCCESS);
+    rnp_input_destroy(input);
+    rnp_output_destroy(output);
+    if (!success) {
+        return;
+    }
+
+    assert_true(pgp_mem_readfile(&mem, "decrypted"));
+    assert_int_equal(mem.length, strlen(plaintext));
+    assert_true(memcmp(mem.buf, plaintext, mem.length) == 0);
+    pgp_memory_release(&mem);
+    unlink("decrypted");
+}
+
+void
+test_ffi_decrypt_pass_cache(void **state)
+{
+    rnp_ffi_t        ffi = NULL;
+    rnp_input_t      input = NULL;
+    rnp_output_t     output = NULL;
+    rnp_op_encrypt_t op = NULL;
+    const char *     plaintext = "data1";
+    const char *     passwords[] = {"pass1", "pass2", "pass3"};
+
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_create(&ffi, "GPG", "GPG"));
+
+    // encrypt with several passwords, so several SKESK packets are tried on decryption
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_input_from_memory(
+                       &input, (const uint8_t *) plaintext, strlen(plaintext)));
+    assert_int_equal(RNP_SUCCESS, rnp_output_to_file(&output, "encrypted"));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_create(&op, ffi, input, output));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_op_encrypt_add_password(op, passwords[0], NULL, 0, NULL));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_op_encrypt_add_password(op, passwords[1], "SHA1", 12345, "AES128"));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_op_encrypt_add_password(op, passwords[2], "SHA512", 0, "Twofish"));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_execute(op));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_destroy(op));
+    rnp_input_destroy(input);
+    rnp_output_destroy(output);
+
+    // cache is disabled by default
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_set_s2k_cache_expiry(ffi, 300));
+
+    // second decryption with the same password uses the cached key
+    for (int i = 0; i < 2; i++) {
+        for (size_t p = 0; p < sizeof(passwords) / sizeof(passwords[0]); p++) {
+            check_decrypt_pass(ffi, passwords[p], plaintext, true);
+        }
+        // wrong password must not match any cached key
+        check_decrypt_pass(ffi, "wrong", plaintext, false);
+    }
+
+    // disable the cache and enable it back
+    assert_int_not_equal(RNP_SUCCESS, rnp_ffi_set_s2k_cache_expiry(NULL, 0));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_set_s2k_cache_expiry(ffi, 0));
+    check_decrypt_pass(ffi, passwords[1], plaintext, true);
+    check_decrypt_pass(ffi, "wrong", plaintext, false);
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_set_s2k_cache_expiry(ffi, 10));
+    check_decrypt_pass(ffi, passwords[2], plaintext, true);
+    check_decrypt_pass(ffi, passwords[2], plaintext, true);
+
+    unlink("encrypted");
+    rnp_ffi_destroy(ffi);
+}
+
+static void
+check_decrypt_pk(rnp_ffi_t ffi, const char *plaintext, bool success)
+{
+    rnp_input_t  input = NULL;
+    rnp_output_t output = NULL;
+    pgp_memory_t mem = {0};
+
+    assert_int_equal(RNP_SUCCESS, rnp_input_from_file(&input, "encrypted"));
+    assert_int_equal(RNP_SUCCESS, rnp_output_to_file(&output, "decrypted"));
+    assert_int_equal(success, rnp_decrypt(ffi, input, output) == RNP_SUCCESS);
+    rnp_input_destroy(input);
+    rnp_output_destroy(output);
+    if (!success) {
+        return;
+    }
+
+    assert_true(pgp_mem_readfile(&mem, "decrypted"));
+    assert_int_equal(mem.length, strlen(plaintext));
+    assert_true(memcmp(mem.buf, plaintext, mem.length) == 0);
+    pgp_memory_release(&mem);
+    unlink("decrypted");
+}
+
+void
+test_ffi_decrypt_pk_cache(void **state)
+{
+    rnp_ffi_t        ffi = NULL;
+    rnp_keyring_t    pubring, secring;
+    rnp_input_t      input = NULL;
+    rnp_output_t     output = NULL;
+    rnp_op_encrypt_t op = NULL;
+    rnp_key_handle_t key = NULL;
+    const char *     plaintext = "data1";
+    const char *     keyids[] = {"7BC6709B15C23A4A",
+                            "1ED63EE56FADC34D",
+                            "1D7E8A5393C997A8",
+                            "8A05B89FAD5ADED1",
+                            "2FCADF05FFA501BB",
+                            "54505A936A4A970E",
+                            "326EF111425D14A5"};
+    const size_t     keyc = sizeof(keyids) / sizeof(keyids[0]);
+
+    // setup FFI
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_create(&ffi, "GPG", "GPG"));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_pubring(ffi, &pubring));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_secring(ffi, &secring));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path(pubring, "data/keyrings/1/pubring.gpg"));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path(secring, "data/keyrings/1/secring.gpg"));
+
+    // encrypt to two keys, so several PKESK packets are tried on decryption
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_input_from_memory(
+                       &input, (const uint8_t *) plaintext, strlen(plaintext)));
+    assert_int_equal(RNP_SUCCESS, rnp_output_to_file(&output, "encrypted"));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_create(&op, ffi, input, output));
+    assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "userid", "key0-uid2", &key));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_add_recipient(op, key));
+    rnp_key_handle_free(&key);
+    assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "userid", "key1-uid1", &key));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_add_recipient(op, key));
+    rnp_key_handle_free(&key);
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_execute(op));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_destroy(op));
+    rnp_input_destroy(input);
+    rnp_output_destroy(output);
+
+    // locked keys, no password provider
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_set_pass_provider(ffi, NULL, NULL));
+    check_decrypt_pk(ffi, plaintext, false);
+
+    // unlocked keys are tried without the password, second time the cached key goes first
+    for (size_t i = 0; i < keyc; i++) {
+        assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "keyid", keyids[i], &key));
+        assert_int_equal(RNP_SUCCESS, rnp_key_unlock(key, "password"));
+        rnp_key_handle_free(&key);
+    }
+    check_decrypt_pk(ffi, plaintext, true);
+    check_decrypt_pk(ffi, plaintext, true);
+
+    // locked again, cached key still requires the password
+    for (size_t i = 0; i < keyc; i++) {
+        assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "keyid", keyids[i], &key));
+        assert_int_equal(RNP_SUCCESS, rnp_key_lock(key));
+        rnp_key_handle_free(&key);
+    }
+    check_decrypt_pk(ffi, plaintext, false);
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_set_pass_provider(ffi, getpasscb, "password"));
+    check_decrypt_pk(ffi, plaintext, true);
+
+    unlink("encrypted");
+    rnp_ffi_destroy(ffi);
+}
+
+static int
+getpasscb_count(
+  void *app_ctx, rnp_key_handle_t key, const char *pgp_context, char *buf, size_t buf_len)
+{
+    size_t *count = (size_t *) app_ctx;
+    (*count)++;
+    strcpy(buf, "password");
+    return 0;
+}
+
+void
+test_ffi_decrypt_pk_wildcard(void **state)
+{
+    rnp_ffi_t        ffi = NULL;
+    rnp_keyring_t    pubring, secring;
+    rnp_input_t      input = NULL;
+    rnp_output_t     output = NULL;
+    rnp_op_encrypt_t op = NULL;
+    rnp_key_handle_t key = NULL;
+    pgp_memory_t     mem = {0};
+    const char *     plaintext = "data1";
+    size_t           hdrlen;
+    size_t           calls = 0;
+
+    // setup FFI
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_create(&ffi, "GPG", "GPG"));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_pubring(ffi, &pubring));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_secring(ffi, &secring));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path(pubring, "data/keyrings/1/pubring.gpg"));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path(secring, "data/keyrings/1/secring.gpg"));
+
+    // encrypt to the last RSA encrypting subkey of key0, 8A05B89FAD5ADED1
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_input_from_memory(
+                       &input, (const uint8_t *) plaintext, strlen(plaintext)));
+    assert_int_equal(RNP_SUCCESS, rnp_output_to_file(&output, "encrypted"));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_create(&op, ffi, input, output));
+    assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "userid", "key0-uid2", &key));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_add_recipient(op, key));
+    rnp_key_handle_free(&key);
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_execute(op));
+    assert_int_equal(RNP_SUCCESS, rnp_op_encrypt_destroy(op));
+    rnp_input_destroy(input);
+    rnp_output_destroy(output);
+
+    // hide the recipient: replace keyid of the PKESK packet with zeroes
+    assert_true(pgp_mem_readfile(&mem, "encrypted"));
+    assert_true(mem.length > 10);
+    if (mem.buf[0] & 0x40) {
+        hdrlen = mem.buf[1] < 192 ? 2 : (mem.buf[1] < 224 ? 3 : 6);
+    } else {
+        hdrlen = (mem.buf[0] & 0x03) == 0 ? 2 : ((mem.buf[0] & 0x03) == 1 ? 3 : 5);
+    }
+    assert_int_equal(mem.buf[hdrlen], 3);
+    memset(&mem.buf[hdrlen + 1], 0, 8);
+    FILE *fp = fopen("encrypted", "wb");
+    assert_non_null(fp);
+    assert_int_equal(fwrite(mem.buf, 1, mem.length, fp), mem.length);
+    fclose(fp);
+    pgp_memory_release(&mem);
+
+    // all secret RSA encrypting keys are tried, 1ED63EE56FADC34D goes first
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_set_pass_provider(ffi, getpasscb_count, &calls));
+    check_decrypt_pk(ffi, plaintext, true);
+    assert_int_equal(calls, 2);
+
+    // the key which decrypted the message is remembered and tried first
+    calls = 0;
+    check_decrypt_pk(ffi, plaintext, true);
+    assert_int_equal(calls, 1);
+
+    // no password, so nothing is decrypted
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_set_pass_provider(ffi, NULL, NULL));
+    check_decrypt_pk(ffi, plaintext, false);
+
+    unlink("encrypted");
+    rnp_ffi_destroy(ffi);
+}
+
+void
+test_ffi_verify_detached_batch(void **state)
+{
+    rnp_ffi_t     ffi = NULL;
+    rnp_keyring_t pubring;
+    const char *  sigs[] = {"data/test_detached_batch/data.txt.sig",
+                            "data/test_detached_batch/data.txt.asc",
+                            "data/test_detached_batch/data.txt.two.sig",
+                            "data/test_detached_batch/data.txt.sig",
+                            "data/test_detached_batch/data.txt.unknown.sig",
+                            "data/test_detached_batch/data.txt"};
+    const size_t  count = sizeof(sigs) / sizeof(sigs[0]);
+    const size_t  threads[] = {1, 4};
+    rnp_input_t   data[count];
+    rnp_input_t   signatures[count];
+    rnp_result_t  results[count];
+
+    // setup FFI
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_create(&ffi, "GPG", "GPG"));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_pubring(ffi, &pubring));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path(pubring, "data/keyrings/1/pubring.gpg"));
+
+    // empty batch
+    assert_int_equal(RNP_SUCCESS, rnp_verify_detached_batch(ffi, NULL, NULL, 0, 1, NULL));
+    assert_int_not_equal(RNP_SUCCESS, rnp_verify_detached_batch(ffi, NULL, NULL, 1, 1, NULL));
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        for (size_t i = 0; i < count; i++) {
+            const char *path = i == 3 ? "data/test_detached_batch/data.txt.modified" :
+                                        "data/test_detached_batch/data.txt";
+            assert_int_equal(RNP_SUCCESS, rnp_input_from_file(&data[i], path));
+            assert_int_equal(RNP_SUCCESS, rnp_input_from_file(&signatures[i], sigs[i]));
+            results[i] = RNP_ERROR_GENERIC;
+        }
+
+        assert_int_equal(
+          RNP_SUCCESS,
+          rnp_verify_detached_batch(ffi, data, signatures, count, threads[t], results));
+        // RSA, DSA armored and both of them
+        assert_int_equal(results[0], RNP_SUCCESS);
+        assert_int_equal(results[1], RNP_SUCCESS);
+        assert_int_equal(results[2], RNP_SUCCESS);
+        // modified data
+        assert_int_equal(results[3], RNP_ERROR_SIGNATURE_INVALID);
+        // signer is not in the keyring
+        assert_int_equal(results[4], RNP_ERROR_KEY_NOT_FOUND);
+        // not a signature
+        assert_int_not_equal(results[5], RNP_SUCCESS);
+
+        for (size_t i = 0; i < count; i++) {
+            rnp_input_destroy(data[i]);
+            rnp_input_destroy(signatures[i]);
+        }
+    }
+
+    // cleanup
+    rnp_ffi_destroy(ffi);
+}
+
+void
+test_ffi_import_keys_from_paths(void **state)
+{
+    rnp_ffi_t     ffi = NULL;
+    rnp_ffi_t     ffi2 = NULL;
+    rnp_keyring_t pubring, secring, ring2;
+    // directory with info.txt, pubring.gpg and secring.gpg, then duplicate and new keys
+    const char * paths[] = {
+      "data/keyrings/1", "data/keyrings/1/pubring.gpg", "data/keyrings/2/pubring.gpg"};
+    const size_t threads[] = {1, 4};
+    size_t       count2 = 0;
+    size_t       count = 0;
+    size_t       imported = 0;
+    size_t       failed = 0;
+
+    // number of keys in the keyrings/2
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_create(&ffi2, "GPG", "GPG"));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_pubring(ffi2, &ring2));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path(ring2, "data/keyrings/2/pubring.gpg"));
+    assert_int_equal(RNP_SUCCESS, rnp_keyring_get_key_count(ring2, &count2));
+    assert_true(count2 > 0);
+    rnp_ffi_destroy(ffi2);
+
+    assert_int_not_equal(RNP_SUCCESS,
+                         rnp_import_keys_from_paths(NULL, paths, 1, 1, NULL, NULL));
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        assert_int_equal(RNP_SUCCESS, rnp_ffi_create(&ffi, "GPG", "GPG"));
+        assert_int_equal(RNP_SUCCESS, rnp_ffi_get_pubring(ffi, &pubring));
+        assert_int_equal(RNP_SUCCESS, rnp_ffi_get_secring(ffi, &secring));
+
+        assert_int_equal(
+          RNP_SUCCESS,
+          rnp_import_keys_from_paths(ffi, paths, 3, threads[t], &imported, &failed));
+        assert_int_equal(imported, 14 + count2);
+        assert_int_equal(failed, 1);
+        assert_int_equal(RNP_SUCCESS, rnp_keyring_get_key_count(pubring, &count));
+        assert_int_equal(count, 7 + count2);
+        assert_int_equal(RNP_SUCCESS, rnp_keyring_get_key_count(secring, &count));
+        assert_int_equal(count, 7);
+
+        // subkeys are imported together with the primary key
+        rnp_key_handle_t key = NULL;
+        bool             secret = false;
+        assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "keyid", "1ED63EE56FADC34D", &key));
+        assert_non_null(key);
+        assert_int_equal(RNP_SUCCESS, rnp_key_have_secret(key, &secret));
+        assert_true(secret);
+        rnp_key_handle_free(&key);
+
+        // everything is already imported
+        assert_int_equal(
+          RNP_SUCCESS,
+          rnp_import_keys_from_paths(ffi, paths + 1, 2, threads[t], &imported, &failed));
+        assert_int_equal(imported, 0);
+        assert_int_equal(failed, 0);
+        assert_int_equal(RNP_SUCCESS, rnp_keyring_get_key_count(pubring, &count));
+        assert_int_equal(count, 7 + count2);
+
+        rnp_ffi_destroy(ffi);
+    }
+}
+
+void
+test_ffi_lazy_key_handles(void **state)
+{
+    rnp_ffi_t        ffi = NULL;
+    rnp_keyring_t    pubring;
+    rnp_key_handle_t primary = NULL;
+    rnp_key_handle_t key = NULL;
+    char *           keyid = NULL;
+    size_t           count = 0;
+    const char *     keyids[] = {"7BC6709B15C23A4A",
+                            "1ED63EE56FADC34D",
+                            "1D7E8A5393C997A8",
+                            "8A05B89FAD5ADED1",
+                            "2FCADF05FFA501BB",
+                            "54505A936A4A970E",
+                            "326EF111425D14A5"};
+    const size_t     keyc = sizeof(keyids) / sizeof(keyids[0]);
+
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_create(&ffi, "GPG", "GPG"));
+    assert_int_equal(RNP_SUCCESS, rnp_ffi_get_pubring(ffi, &pubring));
+    assert_int_equal(RNP_SUCCESS,
+                     rnp_keyring_load_from_path_lazy(pubring, "data/keyrings/1/pubring.gpg"));
+    assert_int_equal(RNP_SUCCESS, rnp_keyring_get_key_count(pubring, &count));
+    assert_int_equal(count, 4);
+    assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "keyid", keyids[0], &primary));
+    assert_non_null(primary);
+
+    // handle must stay valid while other keys are parsed and added to the keyring
+    for (size_t i = 0; i < keyc; i++) {
+        assert_int_equal(RNP_SUCCESS, rnp_locate_key(ffi, "keyid", keyids[i], &key));
+        assert_non_null(key);
+        assert_int_equal(RNP_SUCCESS, rnp_key_get_keyid(key, &keyid));
+        assert_string_equal(keyid, keyids[i]);
+        rnp_buffer_free(keyid);
+        rnp_key_handle_free(&key);
+
+        assert_int_equal(RNP_SUCCESS, rnp_key_get_keyid(primary, &keyid));
+        assert_string_equal(keyid, keyids[0]);
+        rnp_buffer_free(keyid);
+    }
+    assert_int_equal(RNP_SUCCESS, rnp_keyring_get_key_count(pubring, &count));
+    assert_int_equal(count, keyc);
+
+    rnp_key_handle_free(&primary);
+    rnp_ffi_destroy(ffi);
+}
@@ -24,7 +24,11 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <utime.h>
+
 #include "../librekey/key_store_pgp.h"
+#include "../librekey/key_store_lazy.h"
+#include "../librekey/key_store_journal.h"
 #include "pgp-key.h"
 
 #include "rnp_tests.h"
@@ -159,7 +163,7 @@ check_pgp_keyring_counts(const char *   path,
     // count primary keys first
     unsigned total_primary_count = 0;
     for (unsigned i = 0; i < key_store->keyc; i++) {
-        pgp_key_t *key = &key_store->keys[i];
+        pgp_key_t *key = key_store->keys[i];
         if (pgp_key_is_primary_key(key)) {
             total_primary_count++;
         }
@@ -170,7 +174,7 @@ check_pgp_keyring_counts(const char *   path,
     unsigned total_subkey_count = 0;
     unsigned primary = 0;
     for (unsigned i = 0; i < key_store->keyc; i++) {
-        pgp_key_t *key = &key_store->keys[i];
+        pgp_key_t *key = key_store->keys[i];
         if (pgp_key_is_primary_key(key)) {
             // check the subkey count for this primary key
             assert_int_equal(key->subkeyc, subkey_counts[primary++]);
@@ -438,3 +442,554 @@ test_load_check_bitfields_and_times_v3(void **state)
     // cleanup
     rnp_key_store_free(key_store);
 }
+
+/* This test loads the same V4 keyring twice into the key store, and
+ * confirms that lookups by keyid, short keyid, fingerprint and grip
+ * return duplicate keys in keyring order, including after removal.
+ */
+void
+test_load_keyring_search_duplicates(void **state)
+{
+    rnp_test_state_t *rstate = *state;
+    char              path[PATH_MAX];
+    pgp_io_t          io = {.errs = stderr, .res = stdout, .outs = stdout};
+    pgp_memory_t      mem = {0};
+    uint8_t           shortid[PGP_KEY_ID_SIZE] = {0};
+    uint8_t           keyid[PGP_KEY_ID_SIZE];
+    unsigned          from;
+    unsigned          count;
+
+    paths_concat(path, sizeof(path), rstate->data_dir, "keyrings/1/pubring.gpg", NULL);
+    assert_true(pgp_mem_readfile(&mem, path));
+
+    rnp_key_store_t *key_store = calloc(1, sizeof(*key_store));
+    assert_non_null(key_store);
+
+    assert_true(rnp_key_store_pgp_read_from_mem(&io, key_store, 0, &mem));
+    count = key_store->keyc;
+    assert_int_equal(7, count);
+    assert_true(rnp_key_store_pgp_read_from_mem(&io, key_store, 0, &mem));
+    assert_int_equal(2 * count, key_store->keyc);
+
+    for (unsigned i = 0; i < count; i++) {
+        const pgp_key_t *key = key_store->keys[i];
+
+        // full keyid, both copies must be found in order
+        from = 0;
+        assert_ptr_equal(key,
+                         rnp_key_store_get_key_by_id(&io, key_store, key->keyid, &from, NULL));
+        assert_int_equal(i, from);
+        from++;
+        assert_ptr_equal(key_store->keys[i + count],
+                         rnp_key_store_get_key_by_id(&io, key_store, key->keyid, &from, NULL));
+        assert_int_equal(i + count, from);
+        from++;
+        assert_null(rnp_key_store_get_key_by_id(&io, key_store, key->keyid, &from, NULL));
+
+        // short keyid
+        memcpy(shortid, &key->keyid[PGP_KEY_ID_SIZE / 2], PGP_KEY_ID_SIZE / 2);
+        from = 0;
+        assert_ptr_equal(key,
+                         rnp_key_store_get_key_by_id(&io, key_store, shortid, &from, NULL));
+
+        // fingerprint and grip
+        assert_ptr_equal(key, rnp_key_store_get_key_by_fpr(&io, key_store, &key->fingerprint));
+        assert_ptr_equal(key, rnp_key_store_get_key_by_grip(&io, key_store, key->grip));
+    }
+
+    // remove the first key, its copy must be found on the shifted position
+    memcpy(keyid, key_store->keys[0]->keyid, PGP_KEY_ID_SIZE);
+    pgp_key_free_data(key_store->keys[0]);
+    assert_true(rnp_key_store_remove_key(&io, key_store, key_store->keys[0]));
+    assert_int_equal(2 * count - 1, key_store->keyc);
+    from = 0;
+    assert_ptr_equal(key_store->keys[count - 1],
+                     rnp_key_store_get_key_by_id(&io, key_store, keyid, &from, NULL));
+    assert_int_equal(count - 1, from);
+    assert_ptr_equal(key_store->keys[0],
+                     rnp_key_store_get_key_by_grip(&io, key_store, key_store->keys[0]->grip));
+
+    // unknown keyid
+    memset(keyid, 0xAB, sizeof(keyid));
+    from = 0;
+    assert_null(rnp_key_store_get_key_by_id(&io, key_store, keyid, &from, NULL));
+
+    rnp_key_store_free(key_store);
+    pgp_memory_release(&mem);
+}
+
+/* This test loads the V4 keyring on demand, and confirms that only the first transferable
+ * key is parsed on load, other keys are parsed when they are searched for, and that the
+ * offset index file is written and then reused.
+ */
+void
+test_load_keyring_lazy(void **state)
+{
+    rnp_test_state_t *rstate = *state;
+    char              path[PATH_MAX];
+    char              idxpath[PATH_MAX];
+    pgp_io_t          io = {.errs = stderr, .res = stdout, .outs = stdout};
+    rnp_key_store_t * full;
+    rnp_key_store_t * lazy;
+    pgp_key_t *       key;
+    pgp_key_t *       first;
+    uint8_t           keyid[PGP_KEY_ID_SIZE];
+    char              name[PGP_KEY_ID_SIZE * 2 + 2];
+
+    paths_concat(path, sizeof(path), rstate->data_dir, "keyrings/1/pubring.gpg", NULL);
+    paths_concat(
+      idxpath, sizeof(idxpath), rstate->data_dir, "keyrings/1/pubring.gpg.idx", NULL);
+    assert_false(file_exists(idxpath));
+
+    full = rnp_key_store_new(RNP_KEYSTORE_GPG, path);
+    assert_non_null(full);
+    assert_true(rnp_key_store_load_from_file(&io, full, 0, NULL));
+    assert_int_equal(7, full->keyc);
+
+    // first pass builds the index, second one reads it
+    for (int pass = 0; pass < 2; pass++) {
+        lazy = rnp_key_store_new(RNP_KEYSTORE_GPG, path);
+        assert_non_null(lazy);
+        lazy->lazy_load = true;
+        assert_true(rnp_key_store_load_from_file(&io, lazy, 0, NULL));
+        assert_non_null(lazy->lazy);
+        assert_true(file_exists(idxpath));
+        // primary key with 3 subkeys
+        assert_int_equal(4, lazy->keyc);
+        first = lazy->keys[0];
+
+        for (unsigned i = 0; i < full->keyc; i++) {
+            key = rnp_key_store_lazy_get_key_by_id(&io, lazy, full->keys[i]->keyid);
+            assert_non_null(key);
+            assert_int_equal(key->fingerprint.length, full->keys[i]->fingerprint.length);
+            assert_memory_equal(key->fingerprint.fingerprint,
+                                full->keys[i]->fingerprint.fingerprint,
+                                key->fingerprint.length);
+            assert_int_equal(key->subkeyc, full->keys[i]->subkeyc);
+            assert_ptr_equal(
+              key, rnp_key_store_lazy_get_key_by_grip(&io, lazy, full->keys[i]->grip));
+        }
+        assert_int_equal(full->keyc, lazy->keyc);
+
+        // keys parsed before stay at the same place, as well as their subkeys
+        key = rnp_key_store_lazy_get_key_by_id(&io, lazy, full->keys[0]->keyid);
+        assert_ptr_equal(first, key);
+        for (unsigned i = 0; i < first->subkeyc; i++) {
+            assert_ptr_equal(first->subkeys[i], lazy->keys[i + 1]);
+            assert_memory_equal(
+              first->subkeys[i]->keyid, full->keys[i + 1]->keyid, PGP_KEY_ID_SIZE);
+        }
+
+        memset(keyid, 0xAB, sizeof(keyid));
+        assert_null(rnp_key_store_lazy_get_key_by_id(&io, lazy, keyid));
+        rnp_key_store_free(lazy);
+    }
+
+    // userids are indexed, so only the matching key is parsed
+    lazy = rnp_key_store_new(RNP_KEYSTORE_GPG, path);
+    assert_non_null(lazy);
+    lazy->lazy_load = true;
+    assert_true(rnp_key_store_load_from_file(&io, lazy, 0, NULL));
+    assert_int_equal(4, lazy->keyc);
+    assert_true(rnp_key_store_lazy_get_key_by_name(&io, lazy, "no such userid", &key));
+    assert_null(key);
+    assert_non_null(lazy->lazy);
+    assert_int_equal(4, lazy->keyc);
+    assert_true(rnp_key_store_lazy_get_key_by_name(&io, lazy, "key1-uid0", &key));
+    assert_non_null(key);
+    assert_int_equal(full->keyc, lazy->keyc);
+    rnp_key_store_free(lazy);
+
+    // leading hex digits of the name are tried as keyid, as the full search does
+    assert_true(rnp_hex_encode(&full->keys[5]->keyid[PGP_KEY_ID_SIZE / 2],
+                               PGP_KEY_ID_SIZE / 2,
+                               name,
+                               sizeof(name),
+                               RNP_HEX_LOWERCASE));
+    strcat(name, "f");
+    lazy = rnp_key_store_new(RNP_KEYSTORE_GPG, path);
+    assert_non_null(lazy);
+    lazy->lazy_load = true;
+    assert_true(rnp_key_store_load_from_file(&io, lazy, 0, NULL));
+    assert_int_equal(4, lazy->keyc);
+    assert_true(rnp_key_store_lazy_get_key_by_name(&io, lazy, name, &key));
+    assert_non_null(key);
+    assert_memory_equal(key->keyid, full->keys[5]->keyid, PGP_KEY_ID_SIZE);
+    rnp_key_store_free(lazy);
+
+    // index is still used if keyring's mtime is changed but contents are the same
+    struct utimbuf times = {.actime = 1000000000, .modtime = 1000000000};
+    assert_int_equal(0, utime(path, &times));
+    lazy = rnp_key_store_new(RNP_KEYSTORE_GPG, path);
+    assert_non_null(lazy);
+    lazy->lazy_load = true;
+    assert_true(rnp_key_store_load_from_file(&io, lazy, 0, NULL));
+    assert_non_null(lazy->lazy);
+    assert_int_equal(full->keyc, rnp_key_store_lazy_key_count(lazy));
+    assert_non_null(rnp_key_store_lazy_get_key_by_grip(&io, lazy, full->keys[6]->grip));
+    rnp_key_store_free(lazy);
+
+    rnp_key_store_free(full);
+}
+
+static rnp_key_store_t *
+load_incremental_keyring(pgp_io_t *io, const char *path, bool lazy)
+{
+    rnp_key_store_t *key_store = rnp_key_store_new(RNP_KEYSTORE_GPG, path);
+    assert_non_null(key_store);
+    key_store->incremental = true;
+    key_store->lazy_load = lazy;
+    assert_true(rnp_key_store_load_from_file(io, key_store, 0, NULL));
+    assert_non_null(key_store->journal);
+    return key_store;
+}
+
+static void
+remove_and_free_key(pgp_io_t *io, rnp_key_store_t *key_store, unsigned idx)
+{
+    pgp_key_t *key = key_store->keys[idx];
+    pgp_key_free_data(key);
+    assert_true(rnp_key_store_remove_key(io, key_store, key));
+}
+
+/* This test saves the keyring incrementally: added key is appended to the end of the file,
+ * removed keys are listed in the tombstone file and skipped on load, until there are too many
+ * of them and keyring is rewritten.
+ */
+void
+test_load_keyring_incremental(void **state)
+{
+    rnp_test_state_t *rstate = *state;
+    char              path[PATH_MAX];
+    char              delpath[PATH_MAX];
+    char              idxpath[PATH_MAX];
+    pgp_io_t          io = {.errs = stderr, .res = stdout, .outs = stdout};
+    pgp_memory_t      orig = {0};
+    pgp_memory_t      mem = {0};
+    rnp_key_store_t * key_store;
+    rnp_key_store_t * v3_store;
+    uint8_t           v3_keyid[PGP_KEY_ID_SIZE];
+    size_t            v3_size;
+    uint64_t          size;
+
+    assert_true(rnp_hex_decode("DC70C124A50283F1", v3_keyid, sizeof(v3_keyid)));
+    paths_concat(path, sizeof(path), rstate->data_dir, "keyrings/1/pubring.gpg", NULL);
+    assert_true(pgp_mem_readfile(&orig, path));
+    paths_concat(path, sizeof(path), rstate->home, "incremental.gpg", NULL);
+    paths_concat(delpath, sizeof(delpath), rstate->home, "incremental.gpg.del", NULL);
+    paths_concat(idxpath, sizeof(idxpath), rstate->home, "incremental.gpg.idx", NULL);
+    assert_true(pgp_mem_writefile(&orig, path));
+
+    // append the V3 key
+    key_store = load_incremental_keyring(&io, path, false);
+    assert_int_equal(7, key_store->keyc);
+    v3_store = rnp_key_store_new(RNP_KEYSTORE_GPG, "data/keyrings/2/pubring.gpg");
+    assert_non_null(v3_store);
+    assert_true(rnp_key_store_load_from_file(&io, v3_store, 0, NULL));
+    assert_int_equal(1, v3_store->keyc);
+    assert_true(rnp_key_store_add_key(&io, key_store, v3_store->keys[0]));
+    // key store took ownership of the key data
+    assert_true(rnp_key_store_remove_key(&io, v3_store, v3_store->keys[0]));
+    rnp_key_store_free(v3_store);
+    assert_true(rnp_key_store_write_to_file(&io, key_store, 0));
+    rnp_key_store_free(key_store);
+
+    assert_true(pgp_mem_readfile(&mem, path));
+    assert_true(mem.length > orig.length);
+    assert_memory_equal(mem.buf, orig.buf, orig.length);
+    v3_size = mem.length - orig.length;
+    pgp_memory_release(&mem);
+
+    // remove it, keyring file is not changed
+    key_store = load_incremental_keyring(&io, path, false);
+    assert_int_equal(8, key_store->keyc);
+    assert_memory_equal(key_store->keys[7]->keyid, v3_keyid, PGP_KEY_ID_SIZE);
+    remove_and_free_key(&io, key_store, 7);
+    assert_true(rnp_key_store_write_to_file(&io, key_store, 0));
+    rnp_key_store_free(key_store);
+    assert_true(file_exists(delpath));
+    assert_true(pgp_mem_readfile(&mem, path));
+    assert_int_equal(mem.length, orig.length + v3_size);
+    pgp_memory_release(&mem);
+
+    // removed key is skipped by both full and lazy load
+    key_store = load_incremental_keyring(&io, path, false);
+    assert_int_equal(7, key_store->keyc);
+    assert_null(rnp_key_store_lazy_get_key_by_id(&io, key_store, v3_keyid));
+    rnp_key_store_free(key_store);
+    key_store = load_incremental_keyring(&io, path, true);
+    assert_null(rnp_key_store_lazy_get_key_by_id(&io, key_store, v3_keyid));
+    assert_true(rnp_key_store_lazy_load_all(&io, key_store));
+    assert_int_equal(7, key_store->keyc);
+    rnp_key_store_free(key_store);
+
+    // removed subkey is skipped on load and unlinked from the primary key
+    key_store = load_incremental_keyring(&io, path, false);
+    assert_true(pgp_key_is_primary_key(key_store->keys[4]));
+    assert_int_equal(2, key_store->keys[4]->subkeyc);
+    remove_and_free_key(&io, key_store, 6);
+    assert_true(rnp_key_store_write_to_file(&io, key_store, 0));
+    rnp_key_store_free(key_store);
+    assert_true(file_exists(delpath));
+    for (int lazy = 0; lazy < 2; lazy++) {
+        key_store = load_incremental_keyring(&io, path, lazy);
+        if (lazy) {
+            assert_true(rnp_key_store_lazy_load_all(&io, key_store));
+        }
+        assert_int_equal(6, key_store->keyc);
+        assert_true(pgp_key_is_primary_key(key_store->keys[4]));
+        assert_int_equal(1, key_store->keys[4]->subkeyc);
+        assert_ptr_equal(key_store->keys[4]->subkeys[0], key_store->keys[5]);
+        rnp_key_store_free(key_store);
+    }
+
+    // removing the other subkey makes too many dead keys in the file
+    key_store = load_incremental_keyring(&io, path, false);
+    remove_and_free_key(&io, key_store, 5);
+    // removed subkey is unlinked from the primary key
+    assert_int_equal(0, key_store->keys[4]->subkeyc);
+    assert_true(rnp_key_store_write_to_file(&io, key_store, 0));
+    rnp_key_store_free(key_store);
+    assert_false(file_exists(delpath));
+    assert_true(pgp_mem_readfile(&mem, path));
+    assert_true(mem.length < orig.length);
+    pgp_memory_release(&mem);
+
+    key_store = rnp_key_store_new(RNP_KEYSTORE_GPG, path);
+    assert_non_null(key_store);
+    assert_true(rnp_key_store_load_from_file(&io, key_store, 0, NULL));
+    assert_int_equal(5, key_store->keyc);
+    rnp_key_store_free(key_store);
+
+    // append to the lazily loaded keyring updates the index without hashing the keyring
+    key_store = load_incremental_keyring(&io, path, true);
+    assert_non_null(key_store->lazy);
+    assert_int_equal(5, rnp_key_store_lazy_key_count(key_store));
+    v3_store = rnp_key_store_new(RNP_KEYSTORE_GPG, "data/keyrings/2/pubring.gpg");
+    assert_non_null(v3_store);
+    assert_true(rnp_key_store_load_from_file(&io, v3_store, 0, NULL));
+    assert_true(rnp_key_store_add_key(&io, key_store, v3_store->keys[0]));
+    assert_true(rnp_key_store_remove_key(&io, v3_store, v3_store->keys[0]));
+    rnp_key_store_free(v3_store);
+    assert_true(rnp_key_store_write_to_file(&io, key_store, 0));
+    rnp_key_store_free(key_store);
+    // index header keeps the new keyring size, while the keyring hash is left unknown
+    assert_true(pgp_mem_readfile(&mem, path));
+    size = mem.length;
+    pgp_memory_release(&mem);
+    assert_true(pgp_mem_readfile(&mem, idxpath));
+    assert_true(mem.length > 64);
+    for (int i = 0; i < 8; i++) {
+        assert_int_equal((size >> (56 - 8 * i)) & 0xff, mem.buf[8 + i]);
+    }
+    for (int i = 32; i < 64; i++) {
+        assert_int_equal(0, mem.buf[i]);
+    }
+    pgp_memory_release(&mem);
+    // index is used while keyring is not touched
+    key_store = load_incremental_keyring(&io, path, true);
+    assert_int_equal(6, rnp_key_store_lazy_key_count(key_store));
+    assert_non_null(rnp_key_store_lazy_get_key_by_id(&io, key_store, v3_keyid));
+    rnp_key_store_free(key_store);
+    // then changed mtime makes it rebuilt, since unknown hash cannot be checked
+    struct utimbuf times = {.actime = 1000000000, .modtime = 1000000000};
+    assert_int_equal(0, utime(path, &times));
+    key_store = load_incremental_keyring(&io, path, true);
+    assert_int_equal(6, rnp_key_store_lazy_key_count(key_store));
+    assert_non_null(rnp_key_store_lazy_get_key_by_id(&io, key_store, v3_keyid));
+    rnp_key_store_free(key_store);
+    assert_true(pgp_mem_readfile(&mem, idxpath));
+    bool hashed = false;
+    for (int i = 32; i < 64; i++) {
+        hashed |= mem.buf[i] != 0;
+    }
+    assert_true(hashed);
+    pgp_memory_release(&mem);
+    pgp_memory_release(&orig);
+}
+
+void
+test_load_keyring_parallel(void **state)
+{
+    rnp_test_state_t *rstate = *state;
+    char              path[PATH_MAX];
+    pgp_io_t          io = {.errs = stderr, .res = stdout, .outs = stdout};
+    pgp_memory_t      orig = {0};
+    pgp_memory_t      mem = {0};
+    rnp_key_store_t * key_stores[2];
+
+    // large enough keyring made from the copies of the same keys
+    paths_concat(path, sizeof(path), rstate->data_dir, "keyrings/1/pubring.gpg", NULL);
+    assert_true(pgp_mem_readfile(&orig, path));
+    while (mem.length < 256 * 1024) {
+        assert_true(pgp_memory_add(&mem, orig.buf, orig.length));
+    }
+
+    for (int i = 0; i < 2; i++) {
+        key_stores[i] = rnp_key_store_new(RNP_KEYSTORE_GPG, path);
+        assert_non_null(key_stores[i]);
+        key_stores[i]->load_threads = i ? 4 : 0;
+        assert_true(rnp_key_store_pgp_read_from_mem(&io, key_stores[i], 0, &mem));
+    }
+    assert_int_equal(7 * (mem.length / orig.length), key_stores[0]->keyc);
+    assert_int_equal(key_stores[0]->keyc, key_stores[1]->keyc);
+
+    // same keys in the same order, subkeys point to the keys of own key store
+    for (unsigned i = 0; i < key_stores[0]->keyc; i++) {
+        pgp_key_t *key = key_stores[0]->keys[i];
+        pgp_key_t *pkey = key_stores[1]->keys[i];
+
+        assert_memory_equal(key->grip, pkey->grip, PGP_FINGERPRINT_SIZE);
+        assert_int_equal(key->subkeyc, pkey->subkeyc);
+        for (unsigned j = 0; j < key->subkeyc; j++) {
+            assert_ptr_equal(pkey->subkeys[j], key_stores[1]->keys[i + j + 1]);
+            assert_memory_equal(
+              key->subkeys[j]->grip, pkey->subkeys[j]->grip, PGP_FINGERPRINT_SIZE);
+        }
+    }
+
+    rnp_key_store_free(key_stores[0]);
+    rnp_key_store_free(key_stores[1]);
+    pgp_memory_release(&mem);
+    pgp_memory_release(&orig);
+}
+
+/* Keys are stored in slabs: pointers to the keys stay valid while the keyring grows, reserved
+ * keys are added without reallocation and slots of the removed keys are reused.
+ */
+void
+test_load_keyring_slabs(void **state)
+{
+    pgp_io_t         io = {.errs = stderr, .res = stdout, .outs = stdout};
+    pgp_memory_t     mem = {0};
+    pgp_memory_t     v3mem = {0};
+    rnp_key_store_t *key_store;
+    rnp_key_store_t *v3_store;
+    pgp_key_t *      keys[7];
+    uint8_t          keyids[7][PGP_KEY_ID_SIZE];
+    pgp_key_t **     keyarr;
+    pgp_key_t *      key;
+    unsigned         keyc;
+
+    assert_true(pgp_mem_readfile(&mem, "data/keyrings/1/pubring.gpg"));
+    assert_true(pgp_mem_readfile(&v3mem, "data/keyrings/2/pubring.gpg"));
+    key_store = rnp_key_store_new(RNP_KEYSTORE_GPG, "");
+    assert_non_null(key_store);
+    v3_store = rnp_key_store_new(RNP_KEYSTORE_GPG, "");
+    assert_non_null(v3_store);
+
+    assert_true(rnp_key_store_pgp_read_from_mem(&io, key_store, 0, &mem));
+    assert_int_equal(7, key_store->keyc);
+    for (unsigned i = 0; i < 7; i++) {
+        keys[i] = key_store->keys[i];
+        memcpy(keyids[i], keys[i]->keyid, PGP_KEY_ID_SIZE);
+    }
+
+    // add keys one by one, more than fit the smallest slab (KEY_SLAB_MIN_SIZE)
+    for (unsigned i = 0; i < 20; i++) {
+        assert_true(rnp_key_store_pgp_read_from_mem(&io, v3_store, 0, &v3mem));
+        assert_int_equal(1, v3_store->keyc);
+        key = rnp_key_store_add_key(&io, key_store, v3_store->keys[0]);
+        assert_non_null(key);
+        assert_ptr_equal(key, key_store->keys[key_store->keyc - 1]);
+        // key store took ownership of the key data
+        assert_true(rnp_key_store_remove_key(&io, v3_store, v3_store->keys[0]));
+    }
+    assert_int_equal(27, key_store->keyc);
+
+    // first keys are not moved, subkeys still point to them
+    for (unsigned i = 0; i < 7; i++) {
+        assert_ptr_equal(keys[i], key_store->keys[i]);
+        assert_memory_equal(keys[i]->keyid, keyids[i], PGP_KEY_ID_SIZE);
+    }
+    assert_int_equal(3, keys[0]->subkeyc);
+    assert_ptr_equal(keys[0]->subkeys[0], keys[1]);
+    assert_ptr_equal(keys[0]->subkeys[2], keys[3]);
+    assert_int_equal(2, keys[4]->subkeyc);
+    assert_ptr_equal(keys[4]->subkeys[1], keys[6]);
+
+    // reserved keys are added without reallocation of the keys array
+    keyc = key_store->keyc;
+    assert_true(rnp_key_store_reserve(key_store, 70));
+    assert_true(key_store->keyvsize >= keyc + 70);
+    keyarr = key_store->keys;
+    for (unsigned i = 0; i < 10; i++) {
+        assert_true(rnp_key_store_pgp_read_from_mem(&io, key_store, 0, &mem));
+    }
+    assert_int_equal(keyc + 70, key_store->keyc);
+    assert_ptr_equal(keyarr, key_store->keys);
+    assert_ptr_equal(keys[0], key_store->keys[0]);
+
+    // slot of the removed key is given to the next added key
+    key = key_store->keys[7];
+    pgp_key_free_data(key);
+    assert_true(rnp_key_store_remove_key(&io, key_store, key));
+    assert_int_equal(keyc + 69, key_store->keyc);
+    assert_true(rnp_key_store_pgp_read_from_mem(&io, v3_store, 0, &v3mem));
+    assert_ptr_equal(key, rnp_key_store_add_key(&io, key_store, v3_store->keys[0]));
+    assert_true(rnp_key_store_remove_key(&io, v3_store, v3_store->keys[0]));
+    assert_ptr_equal(key, key_store->keys[key_store->keyc - 1]);
+    assert_ptr_equal(keys[6], key_store->keys[6]);
+
+    rnp_key_store_free(v3_store);
+    rnp_key_store_free(key_store);
+    pgp_memory_release(&v3mem);
+    pgp_memory_release(&mem);
+}
+
+static bool
+key_listed(const pgp_key_t *key, void *param)
+{
+    pgp_key_t **keys = param;
+    return (key == keys[0]) || (key == keys[1]);
+}
+
+/* Several keys are removed at once: they are unlinked from the subkeys of the other keys, and
+ * the remaining keys are found via the index.
+ */
+void
+test_load_keyring_remove_keys(void **state)
+{
+    pgp_io_t         io = {.errs = stderr, .res = stdout, .outs = stdout};
+    rnp_key_store_t *key_store;
+    pgp_key_t *      keys[7];
+    pgp_key_t *      dead[2];
+    uint8_t          grips[2][PGP_FINGERPRINT_SIZE];
+
+    key_store = rnp_key_store_new(RNP_KEYSTORE_GPG, "data/keyrings/1/pubring.gpg");
+    assert_non_null(key_store);
+    assert_true(rnp_key_store_load_from_file(&io, key_store, 0, NULL));
+    assert_int_equal(7, key_store->keyc);
+    memcpy(keys, key_store->keys, sizeof(keys));
+
+    // subkey of the first primary key and the second primary key
+    dead[0] = keys[2];
+    dead[1] = keys[4];
+    memcpy(grips[0], keys[2]->grip, PGP_FINGERPRINT_SIZE);
+    memcpy(grips[1], keys[4]->grip, PGP_FINGERPRINT_SIZE);
+    assert_int_equal(0, rnp_key_store_remove_keys_if(&io, key_store, 5, key_listed, dead));
+    assert_int_equal(7, key_store->keyc);
+    assert_int_equal(2, rnp_key_store_remove_keys_if(&io, key_store, 0, key_listed, dead));
+    assert_int_equal(5, key_store->keyc);
+
+    assert_ptr_equal(keys[0], key_store->keys[0]);
+    assert_ptr_equal(keys[1], key_store->keys[1]);
+    assert_ptr_equal(keys[3], key_store->keys[2]);
+    assert_ptr_equal(keys[5], key_store->keys[3]);
+    assert_ptr_equal(keys[6], key_store->keys[4]);
+    assert_int_equal(2, keys[0]->subkeyc);
+    assert_ptr_equal(keys[1], keys[0]->subkeys[0]);
+    assert_ptr_equal(keys[3], keys[0]->subkeys[1]);
+
+    for (unsigned i = 0; i < key_store->keyc; i++) {
+        const pgp_key_t *key = key_store->keys[i];
+        unsigned         from = 0;
+        assert_ptr_equal(key, rnp_key_store_get_key_by_grip(&io, key_store, key->grip));
+        assert_ptr_equal(key,
+                         rnp_key_store_get_key_by_id(&io, key_store, key->keyid, &from, NULL));
+        assert_int_equal(i, from);
+    }
+    assert_null(rnp_key_store_get_key_by_grip(&io, key_store, grips[0]));
+    assert_null(rnp_key_store_get_key_by_grip(&io, key_store, grips[1]));
+    rnp_key_store_free(key_store);
+}
@@ -26,6 +26,7 @@
 
 #include <assert.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include <botan/ffi.h>
 
 #include <rnp/rnp.h>
@@ -33,6 +34,15 @@
 
 #include <librepgp/packet-parse.h>
 #include <librepgp/reader.h>
+#include <librepgp/stream-common.h>
+#include <librepgp/stream-def.h>
+#include <librepgp/stream-armor.h>
+#include <librepgp/stream-pipe.h>
+#include <librepgp/stream-packet.h>
+#include <librepgp/stream-parse.h>
+#include <librepgp/stream-write.h>
+#include <librepgp/base64.h>
+#include <librepgp/crc24.h>
 
 #include <crypto.h>
 #include <crypto/bn.h>
@@ -50,9 +60,16 @@
 #include "list.h"
 #include "pgp-parse-data.h"
 #include "compress.h"
+#include "signature.h"
+#include "symmetric.h"
+#include "pass-provider.h"
+#include "crypto/s2k.h"
+#include "crypto/rng.h"
 
 static const char *KEYRING_1_PASSWORD = "password";
 
+extern rng_t global_rng;
+
 static bool
 read_file_to_memory(rnp_test_state_t *rstate,
                     uint8_t *         out_buffer,
@@ -232,6 +249,580 @@ pgp_compress_roundtrip(void **state)
     }
 }
 
+void
+pgp_armor_roundtrip(void **state)
+{
+    const size_t lens[] = {0, 1, 2, 3, 4, 56, 57, 58, 100, 1000, 4095, 4096, 100000};
+    const size_t maxlen = 100000;
+    uint8_t *    data = calloc(1, maxlen);
+    uint8_t *    back = calloc(1, maxlen);
+    uint8_t      chars[256];
+    uint8_t      values[256];
+    size_t       used;
+    size_t       len;
+
+    assert_non_null(data);
+    assert_non_null(back);
+    for (size_t i = 0; i < maxlen; i++) {
+        data[i] = i * 7 + (i >> 8);
+    }
+
+    /* known answer */
+    pgp_base64_encode(chars, (const uint8_t *) "foobar", 6);
+    assert_memory_equal(chars, "Zm9vYmFy", 8);
+
+    /* whitespaces and eols are skipped, '=' stops decoding */
+    const char *b64 =
+      "Zm9v\r\nYmFy Zm9vYmFyZm9vYmFy\tZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFy==";
+    len = pgp_base64_decode_chars(values, (const uint8_t *) b64, strlen(b64), &used);
+    assert_int_equal(len, 64);
+    assert_int_equal(used, strlen(b64) - 2);
+    pgp_base64_pack(back, values, len, NULL);
+    for (size_t i = 0; i < 48; i += 6) {
+        assert_memory_equal(&back[i], "foobar", 6);
+    }
+    len = pgp_base64_decode_chars(values, (const uint8_t *) "Zm9v!mFy", 8, &used);
+    assert_int_equal(len, 4);
+    assert_int_equal(used, 4);
+
+    /* armor and dearmor, writing and reading with different chunk sizes */
+    for (size_t i = 0; i < ARRAY_SIZE(lens); i++) {
+        pgp_dest_t   memdst = {0};
+        pgp_dest_t   armdst = {0};
+        pgp_source_t memsrc = {0};
+        pgp_source_t armsrc = {0};
+        size_t       chunk = 1 + i * 37;
+        size_t       read = 0;
+        ssize_t      res;
+
+        assert_int_equal(RNP_SUCCESS, init_mem_dest(&memdst, maxlen * 2));
+        assert_int_equal(RNP_SUCCESS, init_armored_dst(&armdst, &memdst, PGP_ARMORED_MESSAGE));
+        for (size_t pos = 0; pos < lens[i]; pos += chunk) {
+            dst_write(&armdst, &data[pos], lens[i] - pos < chunk ? lens[i] - pos : chunk);
+        }
+        assert_int_equal(RNP_SUCCESS, dst_finish(&armdst));
+        dst_close(&armdst, false);
+
+        uint8_t *armored = malloc(memdst.writeb);
+        assert_non_null(armored);
+        memcpy(armored, mem_dest_get_memory(&memdst), memdst.writeb);
+        /* memory source takes ownership of the buffer */
+        assert_int_equal(RNP_SUCCESS, init_mem_src(&memsrc, armored, memdst.writeb));
+        dst_close(&memdst, true);
+
+        assert_int_equal(RNP_SUCCESS, init_armored_src(&armsrc, &memsrc));
+        while ((res = src_read(&armsrc, &back[read], chunk * 3)) > 0) {
+            read += res;
+        }
+        assert_true(res == 0);
+        assert_int_equal(read, lens[i]);
+        assert_memory_equal(back, data, lens[i]);
+        src_close(&armsrc);
+        src_close(&memsrc);
+    }
+
+    free(data);
+    free(back);
+}
+
+void
+pgp_armor_crc24(void **state)
+{
+    const size_t maxlen = 10000;
+    uint8_t *    data = calloc(1, maxlen);
+    uint8_t *    chars = calloc(1, maxlen / 3 * 4);
+    uint8_t *    values = calloc(1, maxlen / 3 * 4);
+    uint8_t *    back = calloc(1, maxlen);
+    uint8_t      crcbuf[3];
+    uint32_t     crc;
+    uint32_t     fused;
+    size_t       used;
+
+    assert_non_null(data);
+    assert_non_null(chars);
+    assert_non_null(values);
+    assert_non_null(back);
+    for (size_t i = 0; i < maxlen; i++) {
+        data[i] = i * 13 + (i >> 5);
+    }
+
+    /* known answer */
+    crc = pgp_crc24_update(PGP_CRC24_INIT, (const uint8_t *) "123456789", 9);
+    pgp_crc24_final(crc, crcbuf);
+    assert_memory_equal(crcbuf, "\x21\xcf\x02", 3);
+
+    /* compare to the bytewise implementation, both for the short and folded lengths */
+    for (size_t len = 0; len < maxlen; len += len < 300 ? 1 : 997) {
+        unsigned ref = CRC24_INIT;
+        for (size_t i = 0; i < len; i++) {
+            ref = pgp_crc24(ref, data[i]);
+        }
+        /* odd split, so the second part is not aligned */
+        crc = pgp_crc24_update(PGP_CRC24_INIT, data, len / 3);
+        crc = pgp_crc24_update(crc, data + len / 3, len - len / 3);
+        assert_int_equal(crc, ref & 0xffffff);
+
+        /* crc which is calculated while packing the decoded base64 values */
+        pgp_base64_encode(chars, data, len / 3 * 3);
+        assert_int_equal(pgp_base64_decode_chars(values, chars, len / 3 * 4, &used), used);
+        fused = PGP_CRC24_INIT;
+        pgp_base64_pack(back, values, len / 3 * 4, &fused);
+        assert_memory_equal(back, data, len / 3 * 3);
+        assert_int_equal(fused, pgp_crc24_update(PGP_CRC24_INIT, data, len / 3 * 3));
+    }
+
+    free(data);
+    free(chars);
+    free(values);
+    free(back);
+}
+
+void
+pgp_pipe_write(void **state)
+{
+    const size_t chunks[] = {1, 1000, 32768, 65536, 100000};
+    const size_t maxlen = 1000000;
+    uint8_t *    data = calloc(1, maxlen);
+
+    assert_non_null(data);
+    for (size_t i = 0; i < maxlen; i++) {
+        data[i] = i * 11 + (i >> 10);
+    }
+
+    /* armoring on the separate thread, and writing via two pipes */
+    for (size_t i = 0; i < ARRAY_SIZE(chunks); i++) {
+        pgp_dest_t   memdst = {0};
+        pgp_dest_t   armdst = {0};
+        pgp_dest_t   pipes[2];
+        pgp_source_t memsrc = {0};
+        pgp_source_t armsrc = {0};
+        size_t       len = i ? maxlen - i : 70000;
+        size_t       read = 0;
+        uint8_t *    back = calloc(1, len + 1);
+        ssize_t      res;
+
+        assert_non_null(back);
+        assert_int_equal(RNP_SUCCESS, init_mem_dest(&memdst, maxlen * 2));
+        assert_int_equal(RNP_SUCCESS, init_armored_dst(&armdst, &memdst, PGP_ARMORED_MESSAGE));
+        assert_int_equal(RNP_SUCCESS, init_pipe_dst(&pipes[0], &armdst));
+        assert_int_equal(RNP_SUCCESS, init_pipe_dst(&pipes[1], &pipes[0]));
+        for (size_t pos = 0; pos < len; pos += chunks[i]) {
+            dst_write(&pipes[1], &data[pos], len - pos < chunks[i] ? len - pos : chunks[i]);
+            assert_int_equal(pipes[1].werr, RNP_SUCCESS);
+        }
+        assert_int_equal(RNP_SUCCESS, dst_finish(&pipes[1]));
+        assert_int_equal(RNP_SUCCESS, dst_finish(&pipes[0]));
+        assert_int_equal(RNP_SUCCESS, dst_finish(&armdst));
+        dst_close(&pipes[1], false);
+        dst_close(&pipes[0], false);
+        dst_close(&armdst, false);
+
+        uint8_t *armored = malloc(memdst.writeb);
+        assert_non_null(armored);
+        memcpy(armored, mem_dest_get_memory(&memdst), memdst.writeb);
+        assert_int_equal(RNP_SUCCESS, init_mem_src(&memsrc, armored, memdst.writeb));
+        dst_close(&memdst, true);
+
+        assert_int_equal(RNP_SUCCESS, init_armored_src(&armsrc, &memsrc));
+        while ((res = src_read(&armsrc, &back[read], len + 1 - read)) > 0) {
+            read += res;
+        }
+        assert_true(res == 0);
+        assert_int_equal(read, len);
+        assert_memory_equal(back, data, len);
+        src_close(&armsrc);
+        src_close(&memsrc);
+        free(back);
+    }
+
+    /* write error is reported via the pipe */
+    pgp_dest_t memdst = {0};
+    pgp_dest_t pipe = {0};
+    assert_int_equal(RNP_SUCCESS, init_mem_dest(&memdst, 100000));
+    assert_int_equal(RNP_SUCCESS, init_pipe_dst(&pipe, &memdst));
+    for (size_t pos = 0; (pos < maxlen) && (pipe.werr == RNP_SUCCESS); pos += 1000) {
+        dst_write(&pipe, &data[pos], 1000);
+    }
+    assert_int_not_equal(dst_finish(&pipe), RNP_SUCCESS);
+    dst_close(&pipe, true);
+    dst_close(&memdst, true);
+
+    /* closing without finishing */
+    assert_int_equal(RNP_SUCCESS, init_null_dest(&memdst));
+    assert_int_equal(RNP_SUCCESS, init_pipe_dst(&pipe, &memdst));
+    dst_write(&pipe, data, maxlen);
+    dst_close(&pipe, true);
+    dst_close(&memdst, true);
+
+    free(data);
+}
+
+void
+pgp_file_src_mapped(void **state)
+{
+    const size_t len = 1000000;
+    uint8_t *    data = calloc(1, len);
+    uint8_t *    back = calloc(1, len);
+    pgp_source_t src = {0};
+    size_t       pos = 0;
+    ssize_t      res;
+    FILE *       fp;
+
+    assert_non_null(data);
+    assert_non_null(back);
+    for (size_t i = 0; i < len; i++) {
+        data[i] = i * 13 + (i >> 12);
+    }
+    fp = fopen("mapped.bin", "wb");
+    assert_non_null(fp);
+    assert_int_equal(fwrite(data, 1, len, fp), len);
+    fclose(fp);
+
+    /* regular file is read directly from the mapping, without the cache */
+    assert_int_equal(RNP_SUCCESS, init_file_src(&src, "mapped.bin"));
+    assert_non_null(src.map);
+    assert_null(src.cache);
+    assert_int_equal(src_peek(&src, back, 100), 100);
+    assert_memory_equal(back, data, 100);
+    while (!src_eof(&src)) {
+        size_t chunk = (pos % 3) ? 70000 : 1000;
+        if ((pos / 1000) % 5 == 4) {
+            res = src_skip(&src, chunk);
+        } else {
+            res = src_read(&src, &back[pos], chunk);
+            assert_true(res > 0);
+            assert_memory_equal(&back[pos], &data[pos], res);
+        }
+        assert_int_equal(res, len - pos < chunk ? len - pos : chunk);
+        pos += res;
+    }
+    assert_int_equal(pos, len);
+    assert_int_equal(src.readb, len);
+    assert_int_equal(src_read(&src, back, 1), 0);
+    src_close(&src);
+
+    /* empty file is read in a usual way */
+    fp = fopen("empty.bin", "wb");
+    assert_non_null(fp);
+    fclose(fp);
+    assert_int_equal(RNP_SUCCESS, init_file_src(&src, "empty.bin"));
+    assert_null(src.map);
+    assert_true(src_eof(&src));
+    src_close(&src);
+
+    free(data);
+    free(back);
+}
+
+void
+pgp_file_dst_buffered(void **state)
+{
+    const size_t chunks[] = {1, 5000, 40000, 3000000};
+    const size_t len = 5000000;
+    uint8_t *    data = calloc(1, len);
+    uint8_t *    back = calloc(1, len + 1);
+
+    assert_non_null(data);
+    assert_non_null(back);
+    for (size_t i = 0; i < len; i++) {
+        data[i] = i * 17 + (i >> 9);
+    }
+
+    /* buffered and direct writes with different chunks, direct I/O may be unavailable */
+    for (int direct = 0; direct < 2; direct++) {
+        for (size_t i = 0; i < ARRAY_SIZE(chunks); i++) {
+            pgp_dest_t   dst = {0};
+            pgp_source_t src = {0};
+            size_t       size = len - i * 4097;
+
+            assert_int_equal(RNP_SUCCESS, init_file_dest(&dst, "buffered.bin", true));
+            if (direct) {
+                file_dest_set_direct(&dst);
+            }
+            for (size_t pos = 0; pos < size; pos += chunks[i]) {
+                dst_write(&dst, &data[pos], size - pos < chunks[i] ? size - pos : chunks[i]);
+            }
+            assert_int_equal(RNP_SUCCESS, dst_finish(&dst));
+            dst_close(&dst, false);
+
+            assert_int_equal(RNP_SUCCESS, init_file_src(&src, "buffered.bin"));
+            assert_int_equal(src_read(&src, back, len + 1), size);
+            assert_memory_equal(back, data, size);
+            src_close(&src);
+        }
+    }
+
+    /* direct mode may be set only before writing */
+    pgp_dest_t dst = {0};
+    assert_int_equal(RNP_SUCCESS, init_file_dest(&dst, "buffered.bin", true));
+    dst_write(&dst, data, 100);
+    assert_false(file_dest_set_direct(&dst));
+    dst_close(&dst, true);
+
+    /* buffered data is written on finish, and the write error must be reported */
+    if (!access("/dev/full", W_OK)) {
+        assert_int_equal(RNP_SUCCESS, init_file_dest(&dst, "/dev/full", true));
+        dst_write(&dst, data, 100);
+        assert_int_equal(dst.werr, RNP_SUCCESS);
+        assert_int_not_equal(dst_finish(&dst), RNP_SUCCESS);
+        dst_close(&dst, false);
+    }
+
+    free(data);
+    free(back);
+}
+
+/* dest which compares the written data with the expected one */
+typedef struct cmp_dest_param_t {
+    const uint8_t *data;
+    size_t         len;
+    size_t         pos;
+    bool           bad;
+} cmp_dest_param_t;
+
+static rnp_result_t
+cmp_dst_write(pgp_dest_t *dst, const void *buf, size_t len)
+{
+    cmp_dest_param_t *param = dst->param;
+
+    if ((param->pos + len > param->len) || memcmp(param->data + param->pos, buf, len)) {
+        param->bad = true;
+    }
+    param->pos += len;
+    return RNP_SUCCESS;
+}
+
+static bool
+cmp_dest_provider(pgp_parse_handler_t *handler, pgp_dest_t *dst, const char *filename)
+{
+    dst->write = cmp_dst_write;
+    dst->param = handler->param;
+    dst->type = PGP_STREAM_MEMORY;
+    return true;
+}
+
+/* build the message with symmetrically encrypted data packet without mdc */
+static uint8_t *
+build_encrypted_no_mdc(const uint8_t *data, size_t len, const char *password, size_t *msglen)
+{
+    pgp_sk_sesskey_t skey = {0};
+    pgp_dest_t       dst = {0};
+    pgp_crypt_t      crypt;
+    uint8_t          key[PGP_MAX_KEY_SIZE];
+    uint8_t          hdr[PGP_MAX_BLOCK_SIZE + 18];
+    size_t           hlen;
+    size_t           blsize = pgp_block_size(PGP_SA_AES_256);
+    uint8_t *        body;
+    uint8_t *        msg;
+
+    skey.version = 4;
+    skey.alg = PGP_SA_AES_256;
+    skey.s2k.specifier = PGP_S2KS_SIMPLE;
+    skey.s2k.hash_alg = PGP_HASH_SHA256;
+    assert_true(pgp_s2k_derive_key(&skey.s2k, password, key, pgp_key_size(skey.alg)));
+    assert_int_equal(RNP_SUCCESS, init_mem_dest(&dst, len + 1024));
+    assert_true(stream_write_sk_sesskey(&skey, &dst));
+
+    /* prefix, resync and then literal packet with the binary data */
+    hlen = blsize + 2 + 6 + 6;
+    assert_non_null(body = malloc(hlen + len));
+    assert_true(rng_generate(body, blsize));
+    body[blsize] = body[blsize - 2];
+    body[blsize + 1] = body[blsize - 1];
+    assert_true(pgp_cipher_start(&crypt, skey.alg, key, NULL));
+    pgp_cipher_cfb_encrypt(&crypt, body, body, blsize + 2);
+    pgp_cipher_cfb_resync(&crypt, body + 2);
+
+    hdr[0] = PGP_PTAG_ALWAYS_SET | PGP_PTAG_NEW_FORMAT | PGP_PTAG_CT_LITDATA;
+    assert_int_equal(write_packet_len(&hdr[1], len + 6), 5);
+    hdr[6] = 'b';
+    memset(&hdr[7], 0, 5);
+    memcpy(body + blsize + 2, hdr, 12);
+    memcpy(body + hlen, data, len);
+    pgp_cipher_cfb_encrypt(
+      &crypt, body + blsize + 2, body + blsize + 2, hlen + len - blsize - 2);
+    pgp_cipher_finish(&crypt);
+
+    hdr[0] = PGP_PTAG_ALWAYS_SET | PGP_PTAG_NEW_FORMAT | PGP_PTAG_CT_SE_DATA;
+    dst_write(&dst, hdr, 1 + write_packet_len(&hdr[1], hlen + len));
+    dst_write(&dst, body, hlen + len);
+    assert_int_equal(RNP_SUCCESS, dst_finish(&dst));
+    free(body);
+
+    *msglen = dst.writeb;
+    assert_non_null(msg = malloc(*msglen));
+    memcpy(msg, mem_dest_get_memory(&dst), *msglen);
+    dst_close(&dst, true);
+    return msg;
+}
+
+static rnp_result_t
+decrypt_with_threads(uint8_t *msg, size_t msglen, cmp_dest_param_t *cmp, unsigned threads)
+{
+    rnp_ctx_t               ctx = {0};
+    pgp_source_t            src = {0};
+    pgp_password_provider_t prov = {.callback = rnp_password_provider_string,
+                                    .userdata = (void *) KEYRING_1_PASSWORD};
+    pgp_parse_handler_t     handler = {0};
+    rnp_result_t            res;
+
+    ctx.rng = &global_rng;
+    ctx.threads = threads;
+    handler.password_provider = &prov;
+    handler.dest_provider = cmp_dest_provider;
+    handler.ctx = &ctx;
+    handler.param = cmp;
+    cmp->pos = 0;
+    cmp->bad = false;
+
+    /* memory source takes ownership of the buffer */
+    uint8_t *copy = malloc(msglen);
+    assert_non_null(copy);
+    memcpy(copy, msg, msglen);
+    assert_int_equal(RNP_SUCCESS, init_mem_src(&src, copy, msglen));
+    res = process_pgp_source(&handler, &src);
+    src_close(&src);
+    rnp_ctx_free(&ctx);
+    return res;
+}
+
+void
+pgp_encrypted_windows(void **state)
+{
+    const size_t              len = 3 * PGP_DECRYPT_WINDOW_SIZE + 12345;
+    uint8_t *                 data = malloc(len);
+    rnp_ctx_t                 ctx = {0};
+    rnp_symmetric_pass_info_t pass = {0};
+    pgp_write_handler_t       handler = {0};
+    pgp_source_t              src = {0};
+    pgp_dest_t                dst = {0};
+    uint8_t *                 msgs[2];
+    size_t                    lens[2];
+    cmp_dest_param_t          cmp = {0};
+
+    assert_non_null(data);
+    for (size_t i = 0; i < len; i++) {
+        data[i] = i * 19 + (i >> 13);
+    }
+    cmp.data = data;
+    cmp.len = len;
+
+    /* message with mdc, written via partial length packets */
+    ctx.rng = &global_rng;
+    ctx.ealg = PGP_SA_AES_256;
+    assert_int_equal(
+      RNP_SUCCESS,
+      rnp_encrypt_set_pass_info(
+        &pass, KEYRING_1_PASSWORD, PGP_HASH_SHA256, 1024, PGP_SA_AES_256));
+    assert_non_null(list_append(&ctx.passwords, &pass, sizeof(pass)));
+    handler.ctx = &ctx;
+    uint8_t *copy = malloc(len);
+    assert_non_null(copy);
+    memcpy(copy, data, len);
+    assert_int_equal(RNP_SUCCESS, init_mem_src(&src, copy, len));
+    assert_int_equal(RNP_SUCCESS, init_mem_dest(&dst, 2 * len));
+    assert_int_equal(RNP_SUCCESS, rnp_encrypt_src(&handler, &src, &dst));
+    src_close(&src);
+    lens[0] = dst.writeb;
+    assert_non_null(msgs[0] = malloc(lens[0]));
+    memcpy(msgs[0], mem_dest_get_memory(&dst), lens[0]);
+    dst_close(&dst, true);
+    list_destroy(&ctx.passwords);
+    pgp_forget(&pass, sizeof(pass));
+    rnp_ctx_free(&ctx);
+
+    /* message without mdc, with fixed length packet */
+    msgs[1] = build_encrypted_no_mdc(data, len, KEYRING_1_PASSWORD, &lens[1]);
+
+    /* serial and windowed parallel decryption must give the same data */
+    for (unsigned threads = 1; threads <= 4; threads += 3) {
+        for (size_t i = 0; i < ARRAY_SIZE(msgs); i++) {
+            assert_int_equal(RNP_SUCCESS,
+                             decrypt_with_threads(msgs[i], lens[i], &cmp, threads));
+            assert_false(cmp.bad);
+            assert_int_equal(cmp.pos, len);
+        }
+
+        /* tampered mdc must be rejected by the asynchronous check as well */
+        msgs[0][lens[0] - 1] ^= 0x01;
+        assert_int_not_equal(RNP_SUCCESS,
+                             decrypt_with_threads(msgs[0], lens[0], &cmp, threads));
+        msgs[0][lens[0] - 1] ^= 0x01;
+
+        /* as well as the modified data in the middle window */
+        msgs[0][lens[0] / 2] ^= 0x01;
+        assert_int_not_equal(RNP_SUCCESS,
+                             decrypt_with_threads(msgs[0], lens[0], &cmp, threads));
+        msgs[0][lens[0] / 2] ^= 0x01;
+    }
+
+    free(msgs[0]);
+    free(msgs[1]);
+    free(data);
+}
+
+/* run the batch encryption of the same text into the memory destinations */
+static void
+encrypt_batch_text(pgp_write_handler_t *handler, const char *text, rnp_result_t result)
+{
+    pgp_source_t       srcs[8];
+    pgp_dest_t         dsts[ARRAY_SIZE(srcs)];
+    pgp_encrypt_item_t items[ARRAY_SIZE(srcs)];
+
+    for (size_t i = 0; i < ARRAY_SIZE(items); i++) {
+        char *copy = strdup(text);
+        assert_non_null(copy);
+        assert_int_equal(RNP_SUCCESS, init_mem_src(&srcs[i], copy, strlen(copy)));
+        assert_int_equal(RNP_SUCCESS, init_mem_dest(&dsts[i], 4096));
+        items[i] = (pgp_encrypt_item_t){.src = &srcs[i], .dst = &dsts[i]};
+    }
+    assert_int_equal(RNP_SUCCESS, rnp_encrypt_batch(handler, items, ARRAY_SIZE(items)));
+    for (size_t i = 0; i < ARRAY_SIZE(items); i++) {
+        assert_int_equal(result, items[i].result);
+        assert_int_equal(result == RNP_SUCCESS, dsts[i].writeb > strlen(text));
+        src_close(&srcs[i]);
+        dst_close(&dsts[i], true);
+    }
+}
+
+/* Tasks of the batch encryption which fail before encrypting their messages must leave the
+ * password list of the operation intact, so it may be reused.
+ */
+void
+pgp_encrypt_batch_failure(void **state)
+{
+    rnp_ctx_t                 ctx = {0};
+    rnp_symmetric_pass_info_t pass = {0};
+    pgp_write_handler_t       handler = {0};
+    rng_t                     badrng = {0};
+
+    /* rng of the unknown type cannot be initialized by the tasks */
+    badrng.rng_type = RNG_SYSTEM + 1;
+    ctx.rng = &badrng;
+    ctx.ealg = PGP_SA_AES_256;
+    ctx.threads = 4;
+    assert_int_equal(
+      RNP_SUCCESS,
+      rnp_encrypt_set_pass_info(
+        &pass, KEYRING_1_PASSWORD, PGP_HASH_SHA256, 1024, PGP_SA_AES_256));
+    assert_non_null(list_append(&ctx.passwords, &pass, sizeof(pass)));
+    handler.ctx = &ctx;
+
+    encrypt_batch_text(&handler, "batch message", RNP_ERROR_RNG);
+    assert_int_equal(1, list_length(ctx.passwords));
+    assert_memory_equal(list_front(ctx.passwords), &pass, sizeof(pass));
+
+    /* the same operation succeeds with the valid rng */
+    ctx.rng = &global_rng;
+    encrypt_batch_text(&handler, "batch message", RNP_SUCCESS);
+    assert_int_equal(1, list_length(ctx.passwords));
+    assert_memory_equal(list_front(ctx.passwords), &pass, sizeof(pass));
+
+    list_destroy(&ctx.passwords);
+    pgp_forget(&pass, sizeof(pass));
+    rnp_ctx_free(&ctx);
+}
+
 static bool
 setup_keystore_1(rnp_test_state_t *state, rnp_t *rnp)
 {
@@ -142,10 +142,14 @@ main(int argc, char *argv[])
 
     struct CMUnitTest tests[] = {
       cmocka_unit_test(hash_test_success),
+      cmocka_unit_test(hash_list_test_success),
       cmocka_unit_test(cipher_test_success),
+      cmocka_unit_test(cipher_cfb_parallel_decrypt),
+      cmocka_unit_test(cipher_cfb_bulk_decrypt),
       cmocka_unit_test(pkcs1_rsa_test_success),
       cmocka_unit_test(raw_elg_test_success),
       cmocka_unit_test(rnp_test_eddsa),
+      cmocka_unit_test(rnp_test_pk_cache),
       cmocka_unit_test(ecdsa_signverify_success),
       cmocka_unit_test(rnpkeys_generatekey_testSignature),
       cmocka_unit_test(rnpkeys_generatekey_testEncryption),
@@ -161,6 +165,7 @@ main(int argc, char *argv[])
       cmocka_unit_test(generatekeyECDSA_explicitlySetBiggerThanNeededDigest_ShouldSuceed),
       cmocka_unit_test(generatekeyECDSA_explicitlySetWrongDigest_ShouldFail),
       cmocka_unit_test(test_utils_list),
+      cmocka_unit_test(test_utils_list_arena),
       cmocka_unit_test(pgp_parse_keyrings_1_pubring),
       cmocka_unit_test(test_load_user_prefs),
       cmocka_unit_test(ecdh_roundtrip),
@@ -171,7 +176,20 @@ main(int argc, char *argv[])
       cmocka_unit_test(test_load_keyring_and_count_pgp),
       cmocka_unit_test(test_load_check_bitfields_and_times),
       cmocka_unit_test(test_load_check_bitfields_and_times_v3),
+      cmocka_unit_test(test_load_keyring_search_duplicates),
+      cmocka_unit_test(test_load_keyring_lazy),
+      cmocka_unit_test(test_load_keyring_incremental),
+      cmocka_unit_test(test_load_keyring_parallel),
+      cmocka_unit_test(test_load_keyring_slabs),
+      cmocka_unit_test(test_load_keyring_remove_keys),
       cmocka_unit_test(pgp_compress_roundtrip),
+      cmocka_unit_test(pgp_armor_roundtrip),
+      cmocka_unit_test(pgp_armor_crc24),
+      cmocka_unit_test(pgp_pipe_write),
+      cmocka_unit_test(pgp_file_src_mapped),
+      cmocka_unit_test(pgp_file_dst_buffered),
+      cmocka_unit_test(pgp_encrypted_windows),
+      cmocka_unit_test(pgp_encrypt_batch_failure),
       cmocka_unit_test(test_key_unlock_pgp),
       cmocka_unit_test(test_key_protect_load_pgp),
       cmocka_unit_test(test_key_add_userid),
@@ -185,8 +203,16 @@ main(int argc, char *argv[])
       cmocka_unit_test(test_ffi_keygen_json_sub),
       cmocka_unit_test(test_ffi_keygen_json_sub_pass_required),
       cmocka_unit_test(test_ffi_detect_key_format),
+      cmocka_unit_test(test_ffi_protect_iterations),
       cmocka_unit_test(test_ffi_encrypt_pass),
       cmocka_unit_test(test_ffi_encrypt_pk),
+      cmocka_unit_test(test_ffi_encrypt_batch),
+      cmocka_unit_test(test_ffi_decrypt_pass_cache),
+      cmocka_unit_test(test_ffi_decrypt_pk_cache),
+      cmocka_unit_test(test_ffi_decrypt_pk_wildcard),
+      cmocka_unit_test(test_ffi_verify_detached_batch),
+      cmocka_unit_test(test_ffi_import_keys_from_paths),
+      cmocka_unit_test(test_ffi_lazy_key_handles),
     };
 
     /* Each test entry will invoke setup_test before running
@@ -55,12 +55,20 @@ void rnp_test_eddsa(void **state);
 
 void hash_test_success(void **state);
 
+void hash_list_test_success(void **state);
+
 void cipher_test_success(void **state);
 
+void cipher_cfb_parallel_decrypt(void **state);
+
+void cipher_cfb_bulk_decrypt(void **state);
+
 void pkcs1_rsa_test_success(void **state);
 
 void raw_elg_test_success(void **state);
 
+void rnp_test_pk_cache(void **state);
+
 void ecdsa_signverify_success(void **state);
 
 void rnpkeys_generatekey_testExpertMode(void **state);
@@ -73,6 +81,8 @@ void generatekeyECDSA_explicitlySetWrongDigest_ShouldFail(void **state);
 
 void test_utils_list(void **state);
 
+void test_utils_list_arena(void **state);
+
 void pgp_parse_keyrings_1_pubring(void **state);
 
 void test_load_user_prefs(void **state);
@@ -93,8 +103,34 @@ void test_load_check_bitfields_and_times(void **state);
 
 void test_load_check_bitfields_and_times_v3(void **state);
 
+void test_load_keyring_search_duplicates(void **state);
+
+void test_load_keyring_lazy(void **state);
+
+void test_load_keyring_incremental(void **state);
+
+void test_load_keyring_parallel(void **state);
+
+void test_load_keyring_slabs(void **state);
+
+void test_load_keyring_remove_keys(void **state);
+
 void pgp_compress_roundtrip(void **state);
 
+void pgp_armor_roundtrip(void **state);
+
+void pgp_armor_crc24(void **state);
+
+void pgp_pipe_write(void **state);
+
+void pgp_file_src_mapped(void **state);
+
+void pgp_file_dst_buffered(void **state);
+
+void pgp_encrypted_windows(void **state);
+
+void pgp_encrypt_batch_failure(void **state);
+
 void test_key_unlock_pgp(void **state);
 
 void test_key_protect_load_pgp(void **state);
@@ -123,10 +159,26 @@ void test_ffi_keygen_json_sub_pass_required(void **state);
 
 void test_ffi_detect_key_format(void **state);
 
+void test_ffi_protect_iterations(void **state);
+
 void test_ffi_encrypt_pass(void **state);
 
 void test_ffi_encrypt_pk(void **state);
 
+void test_ffi_encrypt_batch(void **state);
+
+void test_ffi_decrypt_pass_cache(void **state);
+
+void test_ffi_decrypt_pk_cache(void **state);
+
+void test_ffi_decrypt_pk_wildcard(void **state);
+
+void test_ffi_verify_detached_batch(void **state);
+
+void test_ffi_import_keys_from_paths(void **state);
+
+void test_ffi_lazy_key_handles(void **state);
+
 #define rnp_assert_int_equal(state, a, b)           \
     do {                                            \
         int _rnp_a = (a);                           \
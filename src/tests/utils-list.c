@@ -208,3 +208,50 @@ test_utils_list(void **state)
     list_destroy(&l);
     assert_null(l);
 }
+
+void
+test_utils_list_arena(void **state)
+{
+    pgp_arena_t arena;
+    list        l = NULL;
+
+    pgp_arena_init(&arena);
+    for (int round = 0; round < 3; round++) {
+        assert_true(list_init_arena(&l, &arena));
+        assert_non_null(l);
+        assert_int_equal(list_length(l), 0);
+
+        for (int i = 0; i < 10000; i++) {
+            assert_non_null(list_append(&l, &i, sizeof(i)));
+        }
+        {
+            int i = -1;
+            assert_non_null(list_insert(&l, &i, sizeof(i)));
+        }
+        assert_int_equal(list_length(l), 10001);
+        assert_int_equal(*(int *) list_front(l), -1);
+        assert_int_equal(*(int *) list_back(l), 9999);
+
+        // items are not freed on removal, but list is still consistent
+        list_remove(list_front(l));
+        list_remove(list_back(l));
+        assert_int_equal(list_length(l), 9999);
+        assert_int_equal(*(int *) list_front(l), 0);
+        assert_int_equal(*(int *) list_back(l), 9998);
+
+        // large allocation and alignment
+        uint8_t *buf = pgp_arena_alloc(&arena, PGP_ARENA_CHUNK_SIZE * 2);
+        assert_non_null(buf);
+        memset(buf, 0xab, PGP_ARENA_CHUNK_SIZE * 2);
+        assert_int_equal((uintptr_t) pgp_arena_alloc(&arena, 3) % _Alignof(max_align_t), 0);
+
+        list_destroy(&l);
+        assert_null(l);
+        pgp_arena_reset(&arena);
+    }
+    pgp_arena_destroy(&arena);
+
+    // no arena means regular list
+    assert_true(list_init_arena(&l, NULL));
+    assert_null(l);
+}